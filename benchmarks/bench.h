@@ -0,0 +1,505 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Benchmark harness shared by the programs in benchmarks/
+ *
+ * Each program in this directory is built as its own binary, so the harness
+ * is header-only. A benchmark is a set of callbacks over caller state: setup
+ * and teardown run untimed around every sample, run is timed. The number of
+ * iterations per sample is calibrated once so a sample lasts at least
+ * min_sample_time, then warmup samples are discarded and reps samples are
+ * kept. Results report per-operation time as median and median absolute
+ * deviation, which ignore the occasional descheduled sample.
+ *
+ * JSON output (schema 1) has one record per benchmark, keyed by name and a
+ * parameter string, so runs from different commits can be compared.
+ *
+ * Where the kernel allows it, hardware counters (cycles, instructions,
+ * L1D and LLC read misses, branch misses, backend stalls) and page faults
+ * are read with perf_event_open around the measured samples of the calling
+ * thread. Counters that cannot be opened, as is common in containers and
+ * VMs, are left out and the harness reports wall time only. Benchmarks can
+ * give a work unit per operation (connections evaluated, say) to get misses
+ * per unit.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+#define BENCH_SCHEMA_VERSION 1
+#define BENCH_MAX_ITERATIONS ((size_t)1 << 20)
+
+typedef struct {
+    size_t warmup;              /* Samples discarded before measuring */
+    size_t reps;                /* Samples measured */
+    double min_sample_time;     /* Seconds; iterations per sample are calibrated to reach it */
+    const char *filter;         /* Run only benchmarks whose name contains this (NULL = all) */
+    const char *json_path;      /* Write results here (NULL = none, "-" = stdout) */
+    bool counters;              /* Read performance counters where available */
+} bench_config_t;
+
+typedef struct {
+    void (*setup)(void *state, size_t iterations);    /* Untimed, before each sample (may be NULL) */
+    void (*run)(void *state, size_t iterations);      /* Timed */
+    void (*teardown)(void *state, size_t iterations); /* Untimed, after each sample (may be NULL) */
+    double units;               /* Work units per operation for per-unit counter rates (0 = none) */
+    const char *unit;           /* Name of the work unit, e.g. "connection" */
+} bench_ops_t;
+
+/* Performance counters */
+typedef enum {
+    BENCH_CYCLES,
+    BENCH_INSTRUCTIONS,
+    BENCH_L1D_MISSES,
+    BENCH_LLC_MISSES,
+    BENCH_BRANCH_MISSES,
+    BENCH_STALLED_CYCLES,       /* Backend stalls */
+    BENCH_PAGE_FAULTS,
+    BENCH_COUNTER_COUNT
+} bench_counter_t;
+
+static const char *const bench_counter_names[BENCH_COUNTER_COUNT] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses",
+    "branch_misses", "stalled_cycles", "page_faults"
+};
+
+typedef struct {
+    char name[64];
+    char params[128];           /* "key=value,..." identifying the configuration */
+    size_t iterations;          /* Operations per sample */
+    size_t reps;
+    double median_ns;           /* Per operation */
+    double mad_ns;
+    double min_ns;
+    double mean_ns;
+    double counters[BENCH_COUNTER_COUNT]; /* Per operation; negative if unavailable */
+    double units;               /* From bench_ops_t */
+    char unit[32];
+} bench_result_t;
+
+typedef struct {
+    const char *suite;
+    bench_config_t config;
+    bench_result_t *results;
+    size_t count;
+    size_t capacity;
+} bench_report_t;
+
+/* Keeps the compiler from discarding benchmarked work */
+static volatile double bench_sink;
+
+/* Counter file descriptors for the measuring thread; -1 where unavailable */
+static int bench_counter_fds[BENCH_COUNTER_COUNT];
+static bool bench_counters_opened;
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static inline bench_config_t bench_default_config(void) {
+    bench_config_t config;
+    config.warmup = 3;
+    config.reps = 15;
+    config.min_sample_time = 0.002;
+    config.filter = NULL;
+    config.json_path = NULL;
+    config.counters = true;
+    return config;
+}
+
+static inline void bench_usage(const char *program, const char *extra) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --reps N         Measured samples per benchmark\n"
+            "  --warmup N       Discarded samples per benchmark\n"
+            "  --min-time S     Minimum seconds per sample\n"
+            "  --filter TEXT    Run benchmarks whose name contains TEXT\n"
+            "  --json PATH      Write JSON results to PATH ('-' for stdout)\n"
+            "  --quick          Fewer, shorter samples\n"
+            "  --no-counters    Do not read performance counters\n"
+            "%s", program, extra ? extra : "");
+}
+
+/*
+ * Parse one common option at argv[*i]. Returns 1 and advances *i past its
+ * value if the option was consumed, 0 if the caller should handle it.
+ */
+static inline int bench_parse_option(int argc, char **argv, int *i, bench_config_t *config) {
+    const char *arg = argv[*i];
+    const char *value = *i + 1 < argc ? argv[*i + 1] : NULL;
+    if (strcmp(arg, "--quick") == 0) {
+        config->warmup = 1;
+        config->reps = 5;
+        config->min_sample_time = 0.0005;
+        return 1;
+    }
+    if (strcmp(arg, "--no-counters") == 0) {
+        config->counters = false;
+        return 1;
+    }
+    if (!value) return 0;
+
+    if (strcmp(arg, "--reps") == 0) {
+        config->reps = (size_t)strtoul(value, NULL, 10);
+        if (config->reps == 0) config->reps = 1;
+    } else if (strcmp(arg, "--warmup") == 0) {
+        config->warmup = (size_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--min-time") == 0) {
+        config->min_sample_time = strtod(value, NULL);
+    } else if (strcmp(arg, "--filter") == 0) {
+        config->filter = value;
+    } else if (strcmp(arg, "--json") == 0) {
+        config->json_path = value;
+    } else {
+        return 0;
+    }
+    (*i)++;
+    return 1;
+}
+
+/* Parse a command line of common options only; returns 0 on a usage error */
+static inline int bench_parse_args(int argc, char **argv, bench_config_t *config) {
+    for (int i = 1; i < argc; i++) {
+        if (!bench_parse_option(argc, argv, &i, config)) return 0;
+    }
+    return 1;
+}
+
+static inline bool bench_selected(const bench_config_t *config, const char *name) {
+    return !config->filter || strstr(name, config->filter) != NULL;
+}
+
+static int bench_compare_doubles(const void *a, const void *b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/* Median of a sorted array */
+static inline double bench_median_sorted(const double *values, size_t n) {
+    if (n == 0) return 0.0;
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+/* Median and median absolute deviation; sorts values */
+static inline void bench_robust_stats(double *values, size_t n, double *median, double *mad) {
+    qsort(values, n, sizeof(double), bench_compare_doubles);
+    *median = bench_median_sorted(values, n);
+
+    double *deviations = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    for (size_t i = 0; i < n; i++) {
+        double d = values[i] - *median;
+        deviations[i] = d < 0.0 ? -d : d;
+    }
+    qsort(deviations, n, sizeof(double), bench_compare_doubles);
+    *mad = bench_median_sorted(deviations, n);
+    free(deviations);
+}
+
+#ifdef __linux__
+static inline int bench_counter_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static inline uint64_t bench_cache_event(uint64_t cache) {
+    return cache | ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+/*
+ * Open the counters for the calling thread once. Each counter is opened on
+ * its own so one the PMU lacks does not take the others with it. Reports on
+ * stderr which counters are missing; returns the number opened.
+ */
+static inline int bench_counters_open(void) {
+    if (bench_counters_opened) {
+        int open_count = 0;
+        for (int c = 0; c < BENCH_COUNTER_COUNT; c++) open_count += bench_counter_fds[c] >= 0;
+        return open_count;
+    }
+    bench_counters_opened = true;
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) bench_counter_fds[c] = -1;
+
+    int open_count = 0;
+    int error = ENOSYS;
+#ifdef __linux__
+    bench_counter_fds[BENCH_CYCLES] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    bench_counter_fds[BENCH_INSTRUCTIONS] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    bench_counter_fds[BENCH_L1D_MISSES] = bench_counter_open(PERF_TYPE_HW_CACHE, bench_cache_event(PERF_COUNT_HW_CACHE_L1D));
+    bench_counter_fds[BENCH_LLC_MISSES] = bench_counter_open(PERF_TYPE_HW_CACHE, bench_cache_event(PERF_COUNT_HW_CACHE_LL));
+    bench_counter_fds[BENCH_BRANCH_MISSES] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    bench_counter_fds[BENCH_STALLED_CYCLES] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+    bench_counter_fds[BENCH_PAGE_FAULTS] = bench_counter_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    error = errno;
+#endif
+
+    char missing[256] = "";
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        if (bench_counter_fds[c] >= 0) {
+            open_count++;
+        } else {
+            size_t length = strlen(missing);
+            snprintf(missing + length, sizeof(missing) - length, "%s%s", length ? ", " : "", bench_counter_names[c]);
+        }
+    }
+    if (open_count == 0) {
+        fprintf(stderr, "Performance counters unavailable (%s); reporting wall time only\n", strerror(error));
+    } else if (missing[0]) {
+        fprintf(stderr, "Performance counters unavailable: %s\n", missing);
+    }
+    return open_count;
+}
+
+static inline void bench_counters_close(void) {
+    if (!bench_counters_opened) return;
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        if (bench_counter_fds[c] >= 0) close(bench_counter_fds[c]);
+        bench_counter_fds[c] = -1;
+    }
+    bench_counters_opened = false;
+}
+
+static inline void bench_counters_start(void) {
+#ifdef __linux__
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        if (bench_counter_fds[c] < 0) continue;
+        ioctl(bench_counter_fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(bench_counter_fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+/* Stop the counters and add their values, scaled for multiplexing, to totals */
+static inline void bench_counters_stop(double *totals) {
+#ifdef __linux__
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        if (bench_counter_fds[c] >= 0) ioctl(bench_counter_fds[c], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        uint64_t values[3]; /* value, time enabled, time running */
+        if (bench_counter_fds[c] < 0 ||
+            read(bench_counter_fds[c], values, sizeof(values)) != (ssize_t)sizeof(values)) {
+            continue;
+        }
+        double scale = values[2] > 0 ? (double)values[1] / (double)values[2] : 0.0;
+        totals[c] += (double)values[0] * scale;
+    }
+#else
+    (void)totals;
+#endif
+}
+
+/* Run one sample; counter totals are accumulated into counters unless it is NULL */
+static inline double bench_sample(const bench_ops_t *ops, void *state, size_t iterations, double *counters) {
+    if (ops->setup) ops->setup(state, iterations);
+    if (counters) bench_counters_start();
+    double start = bench_now();
+    ops->run(state, iterations);
+    double elapsed = bench_now() - start;
+    if (counters) bench_counters_stop(counters);
+    if (ops->teardown) ops->teardown(state, iterations);
+    return elapsed;
+}
+
+static inline bench_result_t bench_measure(const bench_config_t *config, const char *name, const char *params,
+                                           const bench_ops_t *ops, void *state) {
+    bench_result_t result;
+    memset(&result, 0, sizeof(result));
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    snprintf(result.params, sizeof(result.params), "%s", params ? params : "");
+    snprintf(result.unit, sizeof(result.unit), "%s", ops->unit ? ops->unit : "");
+    result.units = ops->units;
+    bool counters = config->counters && bench_counters_open() > 0;
+    double totals[BENCH_COUNTER_COUNT] = { 0 };
+
+    /* Calibrate: double the iterations until one sample is long enough */
+    size_t iterations = 1;
+    while (iterations < BENCH_MAX_ITERATIONS &&
+           bench_sample(ops, state, iterations, NULL) < config->min_sample_time) {
+        iterations *= 2;
+    }
+
+    for (size_t i = 0; i < config->warmup; i++) {
+        bench_sample(ops, state, iterations, NULL);
+    }
+
+    double *per_op = (double*)malloc(config->reps * sizeof(double));
+    double sum = 0.0;
+    for (size_t i = 0; i < config->reps; i++) {
+        per_op[i] = bench_sample(ops, state, iterations, counters ? totals : NULL) * 1e9 / (double)iterations;
+        sum += per_op[i];
+    }
+
+    result.iterations = iterations;
+    result.reps = config->reps;
+    result.mean_ns = sum / (double)config->reps;
+    bench_robust_stats(per_op, config->reps, &result.median_ns, &result.mad_ns);
+    result.min_ns = per_op[0];
+    free(per_op);
+
+    double operations = (double)iterations * (double)config->reps;
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        result.counters[c] = counters && bench_counter_fds[c] >= 0 ? totals[c] / operations : -1.0;
+    }
+    return result;
+}
+
+static inline void bench_report_init(bench_report_t *report, const char *suite, const bench_config_t *config) {
+    report->suite = suite;
+    report->config = *config;
+    report->results = NULL;
+    report->count = 0;
+    report->capacity = 0;
+}
+
+static inline void bench_report_add(bench_report_t *report, const bench_result_t *result) {
+    if (report->count == report->capacity) {
+        report->capacity = report->capacity ? report->capacity * 2 : 32;
+        report->results = (bench_result_t*)realloc(report->results, report->capacity * sizeof(bench_result_t));
+        if (!report->results) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    report->results[report->count++] = *result;
+
+    printf("%-28s %-36s %12.1f ns  +/- %8.1f  (%zu x %zu)\n",
+           result->name, result->params, result->median_ns, result->mad_ns,
+           result->reps, result->iterations);
+
+    const double *counters = result->counters;
+    if (counters[BENCH_CYCLES] > 0.0 && counters[BENCH_INSTRUCTIONS] >= 0.0) {
+        printf("%28s ipc %.2f", "", counters[BENCH_INSTRUCTIONS] / counters[BENCH_CYCLES]);
+        if (result->units > 0.0) {
+            if (counters[BENCH_L1D_MISSES] >= 0.0) {
+                printf("  l1d misses/%s %.3f", result->unit, counters[BENCH_L1D_MISSES] / result->units);
+            }
+            if (counters[BENCH_LLC_MISSES] >= 0.0) {
+                printf("  llc misses/%s %.4f", result->unit, counters[BENCH_LLC_MISSES] / result->units);
+            }
+        }
+        if (counters[BENCH_BRANCH_MISSES] >= 0.0) printf("  branch misses/op %.1f", counters[BENCH_BRANCH_MISSES]);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+/* Run one benchmark if the filter selects it and add its result */
+static inline void bench_run(bench_report_t *report, const char *name, const char *params,
+                             const bench_ops_t *ops, void *state) {
+    if (!bench_selected(&report->config, name)) return;
+    bench_result_t result = bench_measure(&report->config, name, params, ops, state);
+    bench_report_add(report, &result);
+}
+
+/* Header fields shared by every JSON result file */
+static inline void bench_write_json_header(FILE *fp, const char *suite) {
+    struct utsname host;
+    char timestamp[32] = "";
+    time_t now = time(NULL);
+    struct tm tm;
+    if (gmtime_r(&now, &tm)) {
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    }
+    if (uname(&host) != 0) {
+        strcpy(host.nodename, "unknown");
+        strcpy(host.machine, "unknown");
+    }
+
+    fprintf(fp, "{\n  \"schema\": %d,\n  \"suite\": \"%s\",\n", BENCH_SCHEMA_VERSION, suite);
+    fprintf(fp, "  \"timestamp\": \"%s\",\n  \"host\": \"%s\",\n  \"machine\": \"%s\",\n",
+            timestamp, host.nodename, host.machine);
+#ifdef __VERSION__
+    fprintf(fp, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+}
+
+/* Counters per operation, IPC and misses per work unit, for the counters that were read */
+static inline void bench_write_json_counters(FILE *fp, const bench_result_t *r) {
+    const double *counters = r->counters;
+    int written = 0;
+    for (int c = 0; c < BENCH_COUNTER_COUNT; c++) {
+        if (counters[c] < 0.0) continue;
+        fprintf(fp, "%s\"%s\": %.3f", written++ ? ", " : ", \"counters\": {", bench_counter_names[c], counters[c]);
+    }
+    if (!written) return;
+    fprintf(fp, "}");
+
+    if (counters[BENCH_CYCLES] > 0.0 && counters[BENCH_INSTRUCTIONS] >= 0.0) {
+        fprintf(fp, ", \"ipc\": %.3f", counters[BENCH_INSTRUCTIONS] / counters[BENCH_CYCLES]);
+    }
+    if (r->units > 0.0) {
+        fprintf(fp, ", \"unit\": \"%s\", \"units\": %.1f", r->unit, r->units);
+        static const bench_counter_t per_unit[] = { BENCH_L1D_MISSES, BENCH_LLC_MISSES, BENCH_BRANCH_MISSES };
+        for (size_t k = 0; k < sizeof(per_unit) / sizeof(per_unit[0]); k++) {
+            if (counters[per_unit[k]] < 0.0) continue;
+            fprintf(fp, ", \"%s_per_unit\": %.5f", bench_counter_names[per_unit[k]], counters[per_unit[k]] / r->units);
+        }
+    }
+}
+
+static inline int bench_report_write_json(const bench_report_t *report) {
+    const char *path = report->config.json_path;
+    if (!path) return 1;
+
+    FILE *fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return 0;
+    }
+
+    bench_write_json_header(fp, report->suite);
+    fprintf(fp, "  \"config\": {\"warmup\": %zu, \"reps\": %zu, \"min_sample_time\": %g},\n",
+            report->config.warmup, report->config.reps, report->config.min_sample_time);
+    fprintf(fp, "  \"results\": [\n");
+    for (size_t i = 0; i < report->count; i++) {
+        const bench_result_t *r = &report->results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"params\": \"%s\", \"iterations\": %zu, \"reps\": %zu, "
+                    "\"median_ns\": %.3f, \"mad_ns\": %.3f, \"min_ns\": %.3f, \"mean_ns\": %.3f",
+                r->name, r->params, r->iterations, r->reps,
+                r->median_ns, r->mad_ns, r->min_ns, r->mean_ns);
+        bench_write_json_counters(fp, r);
+        fprintf(fp, "}%s\n", i + 1 < report->count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+
+    int ok = !ferror(fp);
+    if (fp != stdout) ok = fclose(fp) == 0 && ok;
+    return ok;
+}
+
+static inline void bench_report_free(bench_report_t *report) {
+    free(report->results);
+    report->results = NULL;
+    report->count = report->capacity = 0;
+}
+
+#endif /* BENCH_H */
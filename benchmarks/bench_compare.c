@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+/*
+ * Compare two benchmark result files
+ *
+ * Usage: bench_compare [--threshold F] [--noise K] BASELINE.json CURRENT.json
+ *
+ * Reads results written by the benchmarks in this directory (one result
+ * object per line), matches them by name and params, and prints the change
+ * in median time. A result regresses when it is slower than the baseline by
+ * more than the threshold fraction (default 0.10) and the difference exceeds
+ * K times the combined median absolute deviations (default 3), so noisy
+ * results do not fail the comparison on their own.
+ *
+ * Exits 0 if nothing regressed, 1 if something did and 2 on a usage or
+ * read error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define COMPARE_KEY_SIZE 192
+
+typedef struct {
+    char key[COMPARE_KEY_SIZE]; /* "name params" */
+    double median_ns;
+    double mad_ns;
+    bool matched;
+} compare_entry_t;
+
+typedef struct {
+    compare_entry_t *entries;
+    size_t count;
+    size_t capacity;
+} compare_file_t;
+
+/* Copy the string value of "field" in line into out; returns false if absent */
+static bool json_string_field(const char *line, const char *field, char *out, size_t size) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", field);
+    const char *start = strstr(line, pattern);
+    if (!start) return false;
+    start += strlen(pattern);
+    const char *end = strchr(start, '"');
+    if (!end) return false;
+    size_t length = (size_t)(end - start);
+    if (length >= size) length = size - 1;
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return true;
+}
+
+static bool json_number_field(const char *line, const char *field, double *out) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", field);
+    const char *start = strstr(line, pattern);
+    if (!start) return false;
+    char *end;
+    *out = strtod(start + strlen(pattern), &end);
+    return end != start + strlen(pattern);
+}
+
+static bool load_results(const char *path, compare_file_t *file) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+
+    memset(file, 0, sizeof(*file));
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) {
+        char name[96], params[COMPARE_KEY_SIZE];
+        double median, mad = 0.0;
+        if (!json_string_field(line, "name", name, sizeof(name)) ||
+            !json_number_field(line, "median_ns", &median)) {
+            continue;
+        }
+        if (!json_string_field(line, "params", params, sizeof(params))) params[0] = '\0';
+        json_number_field(line, "mad_ns", &mad);
+
+        if (file->count == file->capacity) {
+            file->capacity = file->capacity ? file->capacity * 2 : 64;
+            file->entries = (compare_entry_t*)realloc(file->entries, file->capacity * sizeof(compare_entry_t));
+            if (!file->entries) {
+                fclose(fp);
+                fprintf(stderr, "Out of memory\n");
+                return false;
+            }
+        }
+        compare_entry_t *entry = &file->entries[file->count++];
+        snprintf(entry->key, sizeof(entry->key), "%s %s", name, params);
+        entry->median_ns = median;
+        entry->mad_ns = mad;
+        entry->matched = false;
+    }
+
+    fclose(fp);
+    if (file->count == 0) {
+        fprintf(stderr, "No results in %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+static compare_entry_t* find_entry(compare_file_t *file, const char *key) {
+    for (size_t i = 0; i < file->count; i++) {
+        if (!file->entries[i].matched && strcmp(file->entries[i].key, key) == 0) {
+            return &file->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--threshold F] [--noise K] BASELINE.json CURRENT.json\n"
+            "  --threshold F    Fractional slowdown that counts as a regression (default 0.10)\n"
+            "  --noise K        Also require the slowdown to exceed K x (MAD + MAD) (default 3)\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    double threshold = 0.10;
+    double noise = 3.0;
+    const char *paths[2];
+    int path_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            noise = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && path_count < 2) {
+            paths[path_count++] = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path_count != 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    compare_file_t baseline, current;
+    if (!load_results(paths[0], &baseline)) return 2;
+    if (!load_results(paths[1], &current)) {
+        free(baseline.entries);
+        return 2;
+    }
+
+    size_t regressions = 0, improvements = 0, missing = 0;
+    printf("%-64s %14s %14s %9s\n", "benchmark", "baseline (ns)", "current (ns)", "change");
+    for (size_t i = 0; i < current.count; i++) {
+        compare_entry_t *now = &current.entries[i];
+        compare_entry_t *before = find_entry(&baseline, now->key);
+        if (!before) {
+            printf("%-64s %14s %14.1f %9s\n", now->key, "-", now->median_ns, "new");
+            continue;
+        }
+        before->matched = true;
+
+        double change = before->median_ns > 0.0 ? now->median_ns / before->median_ns - 1.0 : 0.0;
+        double difference = now->median_ns - before->median_ns;
+        double spread = noise * (now->mad_ns + before->mad_ns);
+        const char *flag = "";
+        if (change > threshold && difference > spread) {
+            flag = "  REGRESSION";
+            regressions++;
+        } else if (change < -threshold && -difference > spread) {
+            flag = "  faster";
+            improvements++;
+        }
+        printf("%-64s %14.1f %14.1f %+8.1f%%%s\n", now->key, before->median_ns, now->median_ns,
+               change * 100.0, flag);
+    }
+    for (size_t i = 0; i < baseline.count; i++) {
+        if (!baseline.entries[i].matched) {
+            printf("%-64s %14.1f %14s %9s\n", baseline.entries[i].key, baseline.entries[i].median_ns, "-", "missing");
+            missing++;
+        }
+    }
+
+    printf("\n%zu regressed, %zu faster, %zu missing (threshold %.0f%%, noise %gx MAD)\n",
+           regressions, improvements, missing, threshold * 100.0, noise);
+
+    free(baseline.entries);
+    free(current.entries);
+    return regressions > 0 ? 1 : 0;
+}
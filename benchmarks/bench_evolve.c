@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+/*
+ * End-to-end evolution throughput
+ *
+ * Runs fixed-seed evolutions of XOR, 3-bit parity and single pole balancing
+ * for a fixed number of generations at several population sizes and thread
+ * counts, so allocator churn, cache effects and speciation cost show up the
+ * way they do in real runs. Each configuration reports:
+ *   generations/sec and evaluations/sec
+ *   time and generation at which the task was first solved (if it was)
+ *   peak resident set size of the process and peak library memory per subsystem
+ *   time per generation spent in each phase, from pop->stats
+ *
+ * median_ns and mad_ns in the JSON are per generation, across --reps runs,
+ * so bench_compare can diff these results like any other suite.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "neat.h"
+#include "envs.h"
+#include "bench.h"
+
+#define EVOLVE_SEED 2024
+#define EVOLVE_MAX_LIST 16
+#define EVOLVE_POLE_STEPS 1000
+
+typedef struct {
+    const char *name;
+    size_t inputs;
+    size_t outputs;
+    double solve_fitness;       /* Task counts as solved once max fitness reaches this */
+    double (*fitness)(neat_genome_t *genome, void *user_data);
+    void *user_data;
+} evolve_task_t;
+
+/* Phase totals in seconds, summed over generations */
+typedef struct {
+    double evaluate;
+    double speciate;
+    double adjust;
+    double remove_stale;
+    double remove_weak;
+    double reproduce;
+    double epoch;
+} evolve_phases_t;
+
+typedef struct {
+    double wall_time;
+    size_t evaluations;
+    int solved_generation;      /* -1 if not solved */
+    double time_to_solve;       /* Seconds, -1 if not solved */
+    evolve_phases_t phases;
+} evolve_run_t;
+
+static void accumulate_phases(const neat_population_t *pop, const neat_generation_stats_t *stats,
+                              void *user_data) {
+    evolve_phases_t *phases = (evolve_phases_t*)user_data;
+    (void)pop;
+    phases->evaluate += stats->evaluate_time;
+    phases->speciate += stats->speciate_time;
+    phases->adjust += stats->adjust_time;
+    phases->remove_stale += stats->remove_stale_time;
+    phases->remove_weak += stats->remove_weak_time;
+    phases->reproduce += stats->reproduce_time;
+    phases->epoch += stats->epoch_time;
+}
+
+/* Counting allocator over malloc, so each configuration reports its own peaks */
+static void* counting_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+/* Reset the kernel's peak RSS for this process; returns 0 where unsupported */
+static int reset_peak_rss(void) {
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (!fp) return 0;
+    int ok = fputs("5", fp) >= 0;
+    return fclose(fp) == 0 && ok;
+}
+
+/* Peak RSS in kB since the last reset, or since process start */
+static long peak_rss_kb(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+        }
+        fclose(fp);
+        if (kb >= 0) return kb;
+    }
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+}
+
+static evolve_run_t evolve_once(const evolve_task_t *task, size_t population, int threads,
+                                int generations, neat_allocator_t *allocator) {
+    evolve_run_t run;
+    memset(&run, 0, sizeof(run));
+    run.solved_generation = -1;
+    run.time_to_solve = -1.0;
+
+    neat_srand(EVOLVE_SEED);
+    neat_allocator_t *outer = neat_use_allocator(allocator);
+    neat_population_t *pop = neat_create_population(task->inputs, task->outputs, population);
+    neat_use_allocator(outer);
+    pop->evaluate_genome = task->fitness;
+    pop->evaluate_user_data = task->user_data;
+    pop->on_generation = accumulate_phases;
+    pop->on_generation_user_data = &run.phases;
+
+    double start = bench_now();
+    for (int gen = 0; gen < generations; gen++) {
+        run.evaluations += pop->genome_count;
+        if (threads > 1) {
+            neat_evolve_parallel(pop, threads);
+        } else {
+            neat_evolve(pop);
+        }
+        if (run.solved_generation < 0 && pop->max_fitness_achieved >= task->solve_fitness) {
+            run.solved_generation = gen;
+            run.time_to_solve = bench_now() - start;
+        }
+    }
+    run.wall_time = bench_now() - start;
+
+    neat_free_population(pop);
+    return run;
+}
+
+static void write_phase(FILE *fp, const char *name, double total, size_t runs, int generations, int last) {
+    fprintf(fp, "\"%s\": %.6f%s", name, total * 1e3 / (double)runs / (double)generations, last ? "" : ", ");
+}
+
+static void write_result(FILE *fp, const char *name, const char *params, int generations,
+                         const double *wall_times, size_t reps, const evolve_run_t *last,
+                         const evolve_phases_t *phases, long rss_kb, const neat_mem_stats_t *mem, int first) {
+    double *per_gen = (double*)malloc(reps * sizeof(double));
+    for (size_t i = 0; i < reps; i++) per_gen[i] = wall_times[i] * 1e9 / (double)generations;
+    double median_ns, mad_ns;
+    bench_robust_stats(per_gen, reps, &median_ns, &mad_ns);
+    double min_ns = per_gen[0];
+    free(per_gen);
+
+    double median_wall = median_ns * (double)generations / 1e9;
+    fprintf(fp, "%s    {\"name\": \"%s\", \"params\": \"%s\", \"reps\": %zu, "
+                "\"median_ns\": %.1f, \"mad_ns\": %.1f, \"min_ns\": %.1f, "
+                "\"generations_per_sec\": %.3f, \"evaluations_per_sec\": %.1f, ",
+            first ? "" : ",\n", name, params, reps, median_ns, mad_ns, min_ns,
+            (double)generations / median_wall, (double)last->evaluations / median_wall);
+    if (last->solved_generation >= 0) {
+        fprintf(fp, "\"solved_generation\": %d, \"time_to_solve\": %.6f, ",
+                last->solved_generation, last->time_to_solve);
+    } else {
+        fprintf(fp, "\"solved_generation\": null, \"time_to_solve\": null, ");
+    }
+    fprintf(fp, "\"peak_rss_kb\": %ld, \"peak_bytes\": {", rss_kb);
+    int written = 0;
+    for (int t = 0; t < NEAT_MEM_TAG_COUNT; t++) {
+        if (mem->peak_bytes[t] == 0) continue;
+        fprintf(fp, "%s\"%s\": %zu", written++ ? ", " : "", neat_mem_tag_name((neat_mem_tag_t)t), mem->peak_bytes[t]);
+    }
+    fprintf(fp, "}, \"phase_ms_per_generation\": {");
+    write_phase(fp, "evaluate", phases->evaluate, reps, generations, 0);
+    write_phase(fp, "speciate", phases->speciate, reps, generations, 0);
+    write_phase(fp, "adjust", phases->adjust, reps, generations, 0);
+    write_phase(fp, "remove_stale", phases->remove_stale, reps, generations, 0);
+    write_phase(fp, "remove_weak", phases->remove_weak, reps, generations, 0);
+    write_phase(fp, "reproduce", phases->reproduce, reps, generations, 0);
+    write_phase(fp, "epoch", phases->epoch, reps, generations, 1);
+    fprintf(fp, "}}");
+}
+
+/* Parse a comma-separated list of positive integers */
+static size_t parse_list(const char *text, size_t *values, size_t max) {
+    size_t count = 0;
+    while (*text && count < max) {
+        char *end;
+        unsigned long value = strtoul(text, &end, 10);
+        if (end == text || value == 0) return 0;
+        values[count++] = (size_t)value;
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return count;
+}
+
+static const char *usage_extra =
+    "  --generations N  Generations per run (default 50)\n"
+    "  --populations L  Comma-separated population sizes (default 150,500)\n"
+    "  --threads L      Comma-separated thread counts (default 1,4)\n";
+
+int main(int argc, char **argv) {
+    bench_config_t config = bench_default_config();
+    config.reps = 3;
+    int generations = 50;
+    size_t populations[EVOLVE_MAX_LIST] = { 150, 500 };
+    size_t population_count = 2;
+    size_t thread_counts[EVOLVE_MAX_LIST] = { 1, 4 };
+    size_t thread_count_count = 2;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--quick") == 0) {
+            config.reps = 1;
+            generations = 10;
+            population_count = 1;
+        } else if (strcmp(argv[i], "--generations") == 0 && value) {
+            generations = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--populations") == 0 && value) {
+            population_count = parse_list(value, populations, EVOLVE_MAX_LIST);
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            thread_count_count = parse_list(value, thread_counts, EVOLVE_MAX_LIST);
+            i++;
+        } else if (!bench_parse_option(argc, argv, &i, &config)) {
+            bench_usage(argv[0], usage_extra);
+            return 1;
+        }
+    }
+    if (generations < 1 || population_count == 0 || thread_count_count == 0) {
+        bench_usage(argv[0], usage_extra);
+        return 1;
+    }
+
+    neat_env_dataset_t *xor_data = neat_env_xor_create();
+    neat_env_dataset_t *parity_data = neat_env_parity_create(3);
+    neat_pole_task_t pole = neat_pole_task_default(1, true);
+    pole.max_steps = EVOLVE_POLE_STEPS;
+
+    evolve_task_t tasks[] = {
+        { "evolve_xor", xor_data->num_inputs, 1, (double)xor_data->case_count - 0.1,
+          neat_env_dataset_fitness, xor_data },
+        { "evolve_parity3", parity_data->num_inputs, 1, (double)parity_data->case_count - 0.1,
+          neat_env_dataset_fitness, parity_data },
+        { "evolve_pole", 4, 1, (double)EVOLVE_POLE_STEPS, neat_env_pole_fitness, &pole },
+    };
+
+    FILE *json = NULL;
+    if (config.json_path) {
+        json = strcmp(config.json_path, "-") == 0 ? stdout : fopen(config.json_path, "w");
+        if (!json) {
+            fprintf(stderr, "Cannot write %s\n", config.json_path);
+            return 1;
+        }
+        bench_write_json_header(json, "evolve");
+        fprintf(json, "  \"config\": {\"reps\": %zu, \"generations\": %d, \"seed\": %d},\n  \"results\": [\n",
+                config.reps, generations, EVOLVE_SEED);
+    }
+
+    printf("%-16s %-40s %10s %12s %8s %10s %10s\n",
+           "task", "params", "gens/s", "evals/s", "solved", "solve (s)", "rss (kB)");
+
+    double *wall_times = (double*)malloc(config.reps * sizeof(double));
+    int first = 1;
+    for (size_t t = 0; t < sizeof(tasks) / sizeof(tasks[0]); t++) {
+        if (!bench_selected(&config, tasks[t].name)) continue;
+        for (size_t p = 0; p < population_count; p++) {
+            for (size_t n = 0; n < thread_count_count; n++) {
+                char params[128];
+                snprintf(params, sizeof(params), "population=%zu,threads=%zu,generations=%d",
+                         populations[p], thread_counts[n], generations);
+
+                neat_allocator_t allocator;
+                neat_allocator_init(&allocator, counting_alloc, counting_realloc, counting_free, NULL);
+                reset_peak_rss();
+
+                evolve_phases_t phases;
+                memset(&phases, 0, sizeof(phases));
+                evolve_run_t run;
+                for (size_t r = 0; r < config.reps; r++) {
+                    run = evolve_once(&tasks[t], populations[p], (int)thread_counts[n], generations, &allocator);
+                    wall_times[r] = run.wall_time;
+                    phases.evaluate += run.phases.evaluate;
+                    phases.speciate += run.phases.speciate;
+                    phases.adjust += run.phases.adjust;
+                    phases.remove_stale += run.phases.remove_stale;
+                    phases.remove_weak += run.phases.remove_weak;
+                    phases.reproduce += run.phases.reproduce;
+                    phases.epoch += run.phases.epoch;
+                }
+                long rss_kb = peak_rss_kb();
+                neat_mem_stats_t mem;
+                neat_allocator_stats(&allocator, &mem);
+
+                double *sorted = (double*)malloc(config.reps * sizeof(double));
+                memcpy(sorted, wall_times, config.reps * sizeof(double));
+                qsort(sorted, config.reps, sizeof(double), bench_compare_doubles);
+                double median_wall = bench_median_sorted(sorted, config.reps);
+                free(sorted);
+
+                char solved[16] = "-", solve_time[16] = "-";
+                if (run.solved_generation >= 0) {
+                    snprintf(solved, sizeof(solved), "%d", run.solved_generation);
+                    snprintf(solve_time, sizeof(solve_time), "%.3f", run.time_to_solve);
+                }
+                printf("%-16s %-40s %10.2f %12.0f %8s %10s %10ld\n",
+                       tasks[t].name, params, generations / median_wall, run.evaluations / median_wall,
+                       solved, solve_time, rss_kb);
+                fflush(stdout);
+
+                if (json) {
+                    write_result(json, tasks[t].name, params, generations, wall_times, config.reps,
+                                 &run, &phases, rss_kb, &mem, first);
+                    first = 0;
+                }
+            }
+        }
+    }
+    free(wall_times);
+
+    int ok = 1;
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        ok = !ferror(json);
+        if (json != stdout) ok = fclose(json) == 0 && ok;
+    }
+
+    neat_env_dataset_free(xor_data);
+    neat_env_dataset_free(parity_data);
+    return ok ? 0 : 1;
+}
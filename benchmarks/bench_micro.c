@@ -0,0 +1,367 @@
+#define _GNU_SOURCE
+/*
+ * Microbenchmarks for the NEAT core hot paths
+ *
+ * Measures, each as a function of its input size:
+ *   evaluate                forward pass vs. hidden node count
+ *   compatibility_distance  genome pairs vs. genome size
+ *   crossover, clone        offspring construction vs. genome size
+ *   mutate                  one full mutation step on a fresh clone
+ *   innovation_hit/insert   neat_get_innovation vs. innovation table size
+ *   speciate                neat_speciate vs. population size and species count
+ *
+ * Inputs are generated from a fixed seed, so the same configuration measures
+ * the same work on every commit. Use --json to save results for comparison.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "neat.h"
+#include "config.h"
+#include "bench.h"
+
+#define BENCH_SEED 12345
+#define BENCH_INPUTS 8
+#define BENCH_OUTPUTS 2
+
+/* Shared fixture: an innovation table that all generated genomes draw from */
+static neat_population_t *fixture;
+
+/* Grow a genome to the given number of hidden nodes, adding about two
+ * connections per new node so density stays roughly constant */
+static neat_genome_t* make_genome(size_t hidden) {
+    neat_genome_t *genome = neat_clone_genome(fixture->genomes[0]);
+    size_t target = genome->node_count + hidden;
+    size_t attempts = 0;
+    while (genome->node_count < target && attempts++ < hidden * 16) {
+        neat_mutate_add_node(genome, fixture->innovation_table);
+        neat_mutate_add_connection(genome, fixture->innovation_table);
+        neat_mutate_add_connection(genome, fixture->innovation_table);
+    }
+    neat_mutate_weights(genome);
+    return genome;
+}
+
+/* Derive a relative of a genome by a few structural and weight mutations */
+static neat_genome_t* make_relative(const neat_genome_t *genome, size_t mutations) {
+    neat_genome_t *relative = neat_clone_genome(genome);
+    for (size_t i = 0; i < mutations; i++) {
+        neat_mutate_add_connection(relative, fixture->innovation_table);
+        if (i % 3 == 0) neat_mutate_add_node(relative, fixture->innovation_table);
+    }
+    neat_mutate_weights(relative);
+    return relative;
+}
+
+static void format_genome_params(char *buffer, size_t size, const neat_genome_t *genome) {
+    snprintf(buffer, size, "nodes=%zu,connections=%zu", genome->node_count, genome->connection_count);
+}
+
+static size_t enabled_connections(const neat_genome_t *genome) {
+    size_t count = 0;
+    for (size_t i = 0; i < genome->connection_count; i++) count += genome->connections[i].enabled;
+    return count;
+}
+
+/* Evaluate */
+
+typedef struct {
+    neat_genome_t *genome;
+    double inputs[BENCH_INPUTS];
+    double outputs[BENCH_OUTPUTS];
+} evaluate_state_t;
+
+static void evaluate_run(void *state, size_t iterations) {
+    evaluate_state_t *s = (evaluate_state_t*)state;
+    for (size_t i = 0; i < iterations; i++) {
+        s->inputs[i % BENCH_INPUTS] += 1e-3;
+        neat_evaluate(s->genome, s->inputs, s->outputs);
+    }
+    bench_sink = s->outputs[0];
+}
+
+static void bench_evaluate(bench_report_t *report, const size_t *sizes, size_t count) {
+    bench_ops_t ops = { NULL, evaluate_run, NULL, 0.0, "connection" };
+    for (size_t i = 0; i < count; i++) {
+        evaluate_state_t state;
+        state.genome = make_genome(sizes[i]);
+        for (size_t j = 0; j < BENCH_INPUTS; j++) state.inputs[j] = neat_random_uniform(-1.0, 1.0);
+        neat_evaluate(state.genome, state.inputs, state.outputs); /* Build the evaluation order */
+
+        ops.units = (double)enabled_connections(state.genome);
+        char params[128];
+        format_genome_params(params, sizeof(params), state.genome);
+        bench_run(report, "evaluate", params, &ops, &state);
+        neat_free_genome(state.genome);
+    }
+}
+
+/* Compatibility distance */
+
+typedef struct {
+    neat_genome_t *a;
+    neat_genome_t *b;
+} pair_state_t;
+
+static void distance_run(void *state, size_t iterations) {
+    pair_state_t *s = (pair_state_t*)state;
+    double total = 0.0;
+    for (size_t i = 0; i < iterations; i++) {
+        total += neat_compatibility_distance(s->a, s->b);
+    }
+    bench_sink = total;
+}
+
+/* Crossover and clone: offspring are kept until teardown so freeing them is not timed */
+
+typedef struct {
+    neat_genome_t *a;
+    neat_genome_t *b;
+    neat_genome_t **offspring;
+    size_t count;
+    size_t innovations;         /* Shared table size before the sample */
+    int next_innovation;
+    int next_node_id;
+} offspring_state_t;
+
+static void offspring_setup(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    s->offspring = (neat_genome_t**)malloc(iterations * sizeof(neat_genome_t*));
+    s->count = 0;
+}
+
+static void offspring_teardown(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    (void)iterations;
+    for (size_t i = 0; i < s->count; i++) neat_free_genome(s->offspring[i]);
+    free(s->offspring);
+    s->offspring = NULL;
+}
+
+static void crossover_run(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    for (size_t i = 0; i < iterations; i++) {
+        s->offspring[s->count++] = neat_crossover(s->a, s->b);
+    }
+}
+
+static void clone_run(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    for (size_t i = 0; i < iterations; i++) {
+        s->offspring[s->count++] = neat_clone_genome(s->a);
+    }
+}
+
+/* Mutate: each iteration mutates its own fresh clone, and the shared innovation
+ * table is rolled back afterwards, so every sample does the same work */
+
+static void mutate_setup(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    offspring_setup(state, iterations);
+    for (size_t i = 0; i < iterations; i++) {
+        s->offspring[s->count++] = neat_clone_genome(s->a);
+    }
+    s->innovations = fixture->innovation_table->count;
+    s->next_innovation = fixture->innovation_table->next_innovation;
+    s->next_node_id = fixture->innovation_table->next_node_id;
+}
+
+static void mutate_run(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    for (size_t i = 0; i < iterations; i++) {
+        neat_mutate(s->offspring[i], fixture->innovation_table);
+    }
+}
+
+static void mutate_teardown(void *state, size_t iterations) {
+    offspring_state_t *s = (offspring_state_t*)state;
+    offspring_teardown(state, iterations);
+    fixture->innovation_table->count = s->innovations;
+    fixture->innovation_table->next_innovation = s->next_innovation;
+    fixture->innovation_table->next_node_id = s->next_node_id;
+}
+
+static void bench_genome_ops(bench_report_t *report, const size_t *sizes, size_t count) {
+    bench_ops_t distance_ops = { NULL, distance_run, NULL, 0.0, "gene" };
+    bench_ops_t crossover_ops = { offspring_setup, crossover_run, offspring_teardown, 0.0, NULL };
+    bench_ops_t clone_ops = { offspring_setup, clone_run, offspring_teardown, 0.0, NULL };
+    bench_ops_t mutate_ops = { mutate_setup, mutate_run, mutate_teardown, 0.0, NULL };
+
+    for (size_t i = 0; i < count; i++) {
+        neat_genome_t *a = make_genome(sizes[i]);
+        neat_genome_t *b = make_relative(a, 4 + sizes[i] / 8);
+        a->fitness = 1.0;
+        b->fitness = 0.5;
+
+        char params[128];
+        format_genome_params(params, sizeof(params), a);
+
+        pair_state_t pair = { a, b };
+        distance_ops.units = (double)(a->connection_count + b->connection_count);
+        bench_run(report, "compatibility_distance", params, &distance_ops, &pair);
+
+        offspring_state_t offspring = { a, b, NULL, 0, 0, 0, 0 };
+        bench_run(report, "crossover", params, &crossover_ops, &offspring);
+        bench_run(report, "clone", params, &clone_ops, &offspring);
+        bench_run(report, "mutate", params, &mutate_ops, &offspring);
+
+        neat_free_genome(a);
+        neat_free_genome(b);
+    }
+}
+
+/* Innovation lookups against a table of a given size */
+
+typedef struct {
+    neat_innovation_table_t *table;
+    size_t size;                /* Entries present before each sample */
+    int next_innovation;
+    int next_node_id;
+    int *keys;                  /* Pre-drawn (in, out) pairs for hits */
+    size_t key_count;
+} innovation_state_t;
+
+static void innovation_hit_run(void *state, size_t iterations) {
+    innovation_state_t *s = (innovation_state_t*)state;
+    long total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        const int *key = &s->keys[2 * (i % s->key_count)];
+        total += neat_get_innovation(s->table, key[0], key[1], false, 0, 0.0);
+    }
+    bench_sink = (double)total;
+}
+
+static void innovation_insert_run(void *state, size_t iterations) {
+    innovation_state_t *s = (innovation_state_t*)state;
+    long total = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        /* Keys outside the populated range always miss */
+        total += neat_get_innovation(s->table, -1 - (int)i, -2, false, 0, 0.0);
+    }
+    bench_sink = (double)total;
+}
+
+static void innovation_reset(void *state, size_t iterations) {
+    innovation_state_t *s = (innovation_state_t*)state;
+    (void)iterations;
+    s->table->count = s->size;
+    s->table->next_innovation = s->next_innovation;
+    s->table->next_node_id = s->next_node_id;
+}
+
+static void bench_innovation(bench_report_t *report, const size_t *sizes, size_t count) {
+    bench_ops_t hit_ops = { NULL, innovation_hit_run, NULL, 0.0, NULL };
+    bench_ops_t insert_ops = { NULL, innovation_insert_run, innovation_reset, 0.0, NULL };
+
+    for (size_t i = 0; i < count; i++) {
+        innovation_state_t state;
+        state.table = neat_create_innovation_table();
+        state.size = sizes[i];
+        for (size_t j = 0; j < state.size; j++) {
+            neat_get_innovation(state.table, (int)(j / 64), (int)(j % 64) + 1000, false, 0, 0.0);
+        }
+        state.next_innovation = state.table->next_innovation;
+        state.next_node_id = state.table->next_node_id;
+
+        state.key_count = 1024;
+        state.keys = (int*)malloc(2 * state.key_count * sizeof(int));
+        for (size_t j = 0; j < state.key_count; j++) {
+            size_t entry = (size_t)neat_random_int(0, (int)state.size - 1);
+            state.keys[2 * j] = (int)(entry / 64);
+            state.keys[2 * j + 1] = (int)(entry % 64) + 1000;
+        }
+
+        char params[128];
+        snprintf(params, sizeof(params), "table=%zu", state.size);
+        bench_run(report, "innovation_hit", params, &hit_ops, &state);
+        bench_run(report, "innovation_insert", params, &insert_ops, &state);
+
+        free(state.keys);
+        neat_free_innovation_table(state.table);
+    }
+}
+
+/* Speciation of a population built from K mutually incompatible archetypes */
+
+#define ARCHETYPE_WEIGHT_GAP (NEAT_COMPATIBILITY_THRESHOLD / NEAT_WEIGHT_COEFF + 1.0)
+
+static void speciate_run(void *state, size_t iterations) {
+    neat_population_t *pop = (neat_population_t*)state;
+    for (size_t i = 0; i < iterations; i++) {
+        neat_speciate(pop);
+    }
+    bench_sink = (double)pop->species_count;
+}
+
+static void bench_speciate(bench_report_t *report, const size_t *pop_sizes, size_t pop_count,
+                           const size_t *species_counts, size_t species_count_count) {
+    bench_ops_t ops = { NULL, speciate_run, NULL, 0.0, NULL };
+
+    for (size_t k = 0; k < species_count_count; k++) {
+        /* Archetypes share one topology but sit ARCHETYPE_WEIGHT_GAP apart in every
+         * weight, which puts each pair beyond the compatibility threshold */
+        size_t archetype_count = species_counts[k];
+        neat_genome_t *base = make_genome(4);
+        neat_genome_t **archetypes = (neat_genome_t**)malloc(archetype_count * sizeof(neat_genome_t*));
+        for (size_t a = 0; a < archetype_count; a++) {
+            archetypes[a] = neat_clone_genome(base);
+            for (size_t c = 0; c < archetypes[a]->connection_count; c++) {
+                archetypes[a]->connections[c].weight += ARCHETYPE_WEIGHT_GAP * (double)a;
+            }
+        }
+        neat_free_genome(base);
+
+        for (size_t p = 0; p < pop_count; p++) {
+            neat_population_t *pop = neat_create_population(BENCH_INPUTS, BENCH_OUTPUTS, pop_sizes[p]);
+            for (size_t g = 0; g < pop->genome_count; g++) {
+                neat_genome_t *genome = neat_clone_genome(archetypes[g % archetype_count]);
+                genome->id = pop->genomes[g]->id;
+                neat_free_genome(pop->genomes[g]);
+                pop->genomes[g] = genome;
+            }
+            neat_speciate(pop);
+
+            char params[128];
+            snprintf(params, sizeof(params), "population=%zu,archetypes=%zu,species=%zu",
+                     pop->genome_count, archetype_count, pop->species_count);
+            bench_run(report, "speciate", params, &ops, pop);
+            neat_free_population(pop);
+        }
+
+        for (size_t a = 0; a < archetype_count; a++) neat_free_genome(archetypes[a]);
+        free(archetypes);
+    }
+}
+
+int main(int argc, char **argv) {
+    bench_config_t config = bench_default_config();
+    if (!bench_parse_args(argc, argv, &config)) {
+        bench_usage(argv[0], NULL);
+        return 1;
+    }
+
+    neat_srand(BENCH_SEED);
+    fixture = neat_create_population(BENCH_INPUTS, BENCH_OUTPUTS, 1);
+
+    bench_report_t report;
+    bench_report_init(&report, "micro", &config);
+
+    static const size_t genome_sizes[] = { 0, 8, 32, 128, 512 };
+    static const size_t table_sizes[] = { 64, 512, 4096, 32768 };
+    static const size_t pop_sizes[] = { 100, 500, 2000 };
+    static const size_t species_counts[] = { 1, 10, 50 };
+    const size_t genome_size_count = sizeof(genome_sizes) / sizeof(genome_sizes[0]);
+
+    bench_evaluate(&report, genome_sizes, genome_size_count);
+    bench_genome_ops(&report, genome_sizes, genome_size_count);
+    bench_innovation(&report, table_sizes, sizeof(table_sizes) / sizeof(table_sizes[0]));
+    bench_speciate(&report, pop_sizes, sizeof(pop_sizes) / sizeof(pop_sizes[0]),
+                   species_counts, sizeof(species_counts) / sizeof(species_counts[0]));
+
+    int ok = bench_report_write_json(&report);
+    bench_report_free(&report);
+    bench_counters_close();
+    neat_free_population(fixture);
+    return ok ? 0 : 1;
+}
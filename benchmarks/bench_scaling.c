@@ -0,0 +1,538 @@
+#define _GNU_SOURCE
+/*
+ * Thread scaling of parallel evaluation and the phases around it
+ *
+ * Sweeps thread counts over:
+ *   evaluate_cheap      neat_evaluate_parallel, one forward pass per genome
+ *   evaluate_expensive  neat_evaluate_parallel, many forward passes per genome
+ *   evaluate_variable   neat_evaluate_parallel, heavy-tailed cost per genome
+ *   clone               threads clone and free disjoint genome slices, which
+ *                       exposes contention in the allocator and its accounting
+ *   distance            threads compute compatibility distances against shared
+ *                       representatives, the inner loop of speciation, which
+ *                       exposes memory bandwidth
+ * and times the serial speciate and reproduce phases once, so the generation
+ * speedup each evaluation profile can reach is reported alongside.
+ *
+ * For every phase and thread count it reports speedup and efficiency against
+ * one thread, and the imbalance ratio: the busiest thread's working time over
+ * the mean across threads (1.0 is perfect balance; threads that got no work
+ * count as zero). --pin places worker threads on CPUs node by node (compact)
+ * or round-robin across NUMA nodes (spread) to expose cross-socket effects.
+ * The library creates its own evaluation threads, so those are pinned from the
+ * fitness callback on their first evaluation of each round. --numa instead
+ * attaches the library's NUMA sharding to the population, which pins its own
+ * workers per node and places each shard's genes on its node.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "neat.h"
+#include "bench.h"
+
+#define SCALING_SEED 4242
+#define SCALING_INPUTS 8
+#define SCALING_OUTPUTS 2
+#define SCALING_MAX_THREADS 1024
+#define SCALING_MAX_CPUS 4096
+#define SCALING_MAX_NODES 64
+#define SCALING_GROWTH 12               /* Structural mutations per genome */
+#define SCALING_EXPENSIVE_REPEATS 256   /* Forward passes per expensive evaluation */
+#define SCALING_VARIABLE_MAX 4096       /* Cap on forward passes per variable evaluation */
+#define SCALING_CLONE_REPEATS 4
+#define SCALING_REPRESENTATIVES 32
+
+typedef enum {
+    PIN_NONE,
+    PIN_COMPACT,                /* Fill NUMA node 0, then node 1, ... */
+    PIN_SPREAD                  /* Round-robin across NUMA nodes */
+} pin_policy_t;
+
+static const char *const pin_names[] = { "none", "compact", "spread" };
+
+typedef enum {
+    COST_CHEAP,
+    COST_EXPENSIVE,
+    COST_VARIABLE
+} cost_profile_t;
+
+/* Working time per thread slot, padded so slots do not share cache lines */
+typedef struct {
+    _Alignas(64) double busy;
+} thread_slot_t;
+
+static thread_slot_t slots[SCALING_MAX_THREADS];
+static atomic_uint current_round;
+static atomic_size_t next_slot;
+static _Thread_local unsigned thread_round;
+static _Thread_local size_t thread_slot;
+
+static pin_policy_t pin_policy = PIN_NONE;
+static int cpu_order[SCALING_MAX_CPUS];
+static size_t cpu_order_count;
+
+/* CPU placement */
+
+/* Parse a sysfs cpulist such as "0-3,8-11" */
+static size_t parse_cpulist(const char *text, int *cpus, size_t max) {
+    size_t count = 0;
+    while (*text && *text != '\n' && count < max) {
+        char *end;
+        long first = strtol(text, &end, 10);
+        if (end == text) break;
+        long last = first;
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && count < max; cpu++) cpus[count++] = (int)cpu;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+/* Order CPUs for the pin policy from the NUMA topology; falls back to 0..n-1 */
+static void build_cpu_order(pin_policy_t policy) {
+    static int node_cpus[SCALING_MAX_NODES][SCALING_MAX_CPUS / SCALING_MAX_NODES];
+    size_t node_sizes[SCALING_MAX_NODES];
+    size_t node_count = 0;
+
+    for (int node = 0; node < SCALING_MAX_NODES; node++) {
+        char path[96], line[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *fp = fopen(path, "r");
+        if (!fp) continue;
+        if (fgets(line, sizeof(line), fp)) {
+            node_sizes[node_count] = parse_cpulist(line, node_cpus[node_count], SCALING_MAX_CPUS / SCALING_MAX_NODES);
+            if (node_sizes[node_count] > 0) node_count++;
+        }
+        fclose(fp);
+    }
+
+    cpu_order_count = 0;
+    if (node_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long cpu = 0; cpu < online && cpu < SCALING_MAX_CPUS; cpu++) cpu_order[cpu_order_count++] = (int)cpu;
+        return;
+    }
+
+    if (policy == PIN_SPREAD) {
+        for (size_t i = 0; cpu_order_count < SCALING_MAX_CPUS; i++) {
+            size_t added = 0;
+            for (size_t n = 0; n < node_count; n++) {
+                if (i < node_sizes[n]) {
+                    cpu_order[cpu_order_count++] = node_cpus[n][i];
+                    added++;
+                }
+            }
+            if (added == 0) break;
+        }
+    } else {
+        for (size_t n = 0; n < node_count; n++) {
+            for (size_t i = 0; i < node_sizes[n] && cpu_order_count < SCALING_MAX_CPUS; i++) {
+                cpu_order[cpu_order_count++] = node_cpus[n][i];
+            }
+        }
+    }
+    printf("NUMA nodes: %zu, CPUs: %zu, pin: %s\n", node_count, cpu_order_count, pin_names[policy]);
+}
+
+static void pin_thread(size_t slot) {
+    if (pin_policy == PIN_NONE || cpu_order_count == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_order[slot % cpu_order_count], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Per-thread accounting */
+
+static void begin_round(void) {
+    memset(slots, 0, sizeof(slots));
+    atomic_store(&next_slot, 0);
+    atomic_fetch_add(&current_round, 1);
+}
+
+/* Slot of the calling thread in the current round, claimed (and pinned) on first use */
+static size_t claim_slot(void) {
+    unsigned round = atomic_load_explicit(&current_round, memory_order_relaxed);
+    if (thread_round != round) {
+        thread_round = round;
+        thread_slot = atomic_fetch_add(&next_slot, 1) % SCALING_MAX_THREADS;
+        pin_thread(thread_slot);
+    }
+    return thread_slot;
+}
+
+/* Busiest thread's working time over the mean across threads */
+static double round_imbalance(size_t threads) {
+    double max = 0.0, sum = 0.0;
+    for (size_t i = 0; i < threads && i < SCALING_MAX_THREADS; i++) {
+        sum += slots[i].busy;
+        if (slots[i].busy > max) max = slots[i].busy;
+    }
+    return sum > 0.0 ? max / (sum / (double)threads) : 1.0;
+}
+
+/* Synthetic fitness */
+
+/* Forward passes for a genome; the variable profile draws a Pareto(1.2) tail from the genome ID */
+static size_t cost_repeats(cost_profile_t profile, int id) {
+    if (profile == COST_CHEAP) return 1;
+    if (profile == COST_EXPENSIVE) return SCALING_EXPENSIVE_REPEATS;
+
+    uint32_t h = (uint32_t)id * 2654435761u;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+    double u = ((double)h + 1.0) / 4294967296.0;
+    double repeats = 4.0 / pow(u, 1.0 / 1.2);
+    return repeats > SCALING_VARIABLE_MAX ? SCALING_VARIABLE_MAX : (size_t)repeats;
+}
+
+static double synthetic_fitness(neat_genome_t *genome, void *user_data) {
+    cost_profile_t profile = *(const cost_profile_t*)user_data;
+    size_t slot = claim_slot();
+    double start = bench_now();
+
+    double inputs[SCALING_INPUTS] = { 0 };
+    double outputs[SCALING_OUTPUTS];
+    double total = 0.0;
+    size_t repeats = cost_repeats(profile, genome->id);
+    for (size_t r = 0; r < repeats; r++) {
+        inputs[r % SCALING_INPUTS] = (double)r * 1e-3;
+        neat_evaluate(genome, inputs, outputs);
+        total += outputs[0];
+    }
+
+    slots[slot].busy += bench_now() - start;
+    return fabs(total) / (double)repeats;
+}
+
+/* Probe workers for the phases the library runs serially */
+
+typedef enum {
+    PROBE_CLONE,
+    PROBE_DISTANCE
+} probe_kind_t;
+
+typedef struct {
+    probe_kind_t kind;
+    neat_population_t *pop;
+    size_t begin;
+    size_t end;
+    double sink;
+} probe_task_t;
+
+static void* probe_worker(void *arg) {
+    probe_task_t *task = (probe_task_t*)arg;
+    size_t slot = claim_slot();
+    double start = bench_now();
+    neat_genome_t **genomes = task->pop->genomes;
+    size_t representatives = task->pop->genome_count < SCALING_REPRESENTATIVES ?
+                             task->pop->genome_count : SCALING_REPRESENTATIVES;
+
+    double total = 0.0;
+    for (size_t i = task->begin; i < task->end; i++) {
+        if (task->kind == PROBE_CLONE) {
+            for (int r = 0; r < SCALING_CLONE_REPEATS; r++) {
+                neat_genome_t *copy = neat_clone_genome(genomes[i]);
+                total += (double)copy->connection_count;
+                neat_free_genome(copy);
+            }
+        } else {
+            for (size_t r = 0; r < representatives; r++) {
+                total += neat_compatibility_distance(genomes[i], genomes[r]);
+            }
+        }
+    }
+
+    slots[slot].busy = bench_now() - start;
+    task->sink = total;
+    return NULL;
+}
+
+static void run_probe(probe_kind_t kind, neat_population_t *pop, size_t threads) {
+    pthread_t handles[SCALING_MAX_THREADS];
+    probe_task_t tasks[SCALING_MAX_THREADS];
+    size_t n = pop->genome_count;
+    for (size_t t = 0; t < threads; t++) {
+        tasks[t].kind = kind;
+        tasks[t].pop = pop;
+        tasks[t].begin = n * t / threads;
+        tasks[t].end = n * (t + 1) / threads;
+        pthread_create(&handles[t], NULL, probe_worker, &tasks[t]);
+    }
+    for (size_t t = 0; t < threads; t++) {
+        pthread_join(handles[t], NULL);
+        bench_sink = tasks[t].sink;
+    }
+}
+
+/* Population of grown genomes, identical for a given seed and size */
+static neat_population_t* make_population(size_t size) {
+    neat_srand(SCALING_SEED);
+    neat_population_t *pop = neat_create_population(SCALING_INPUTS, SCALING_OUTPUTS, size);
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        neat_genome_t *genome = pop->genomes[i];
+        size_t growth = (size_t)neat_random_int(0, 2 * SCALING_GROWTH);
+        for (size_t k = 0; k < growth; k++) {
+            neat_mutate_add_node(genome, pop->innovation_table);
+            neat_mutate_add_connection(genome, pop->innovation_table);
+            neat_mutate_add_connection(genome, pop->innovation_table);
+        }
+        neat_mutate_weights(genome);
+    }
+    return pop;
+}
+
+/* Measurement */
+
+typedef struct {
+    const char *name;
+    bool library;               /* neat_evaluate_parallel rather than a probe */
+    cost_profile_t profile;
+    probe_kind_t probe;
+} scaling_phase_t;
+
+typedef struct {
+    double median_ns;
+    double mad_ns;
+    double imbalance;           /* Median across reps */
+} scaling_point_t;
+
+static cpu_set_t main_affinity;
+
+static scaling_point_t measure(const scaling_phase_t *phase, neat_population_t *pop, size_t threads,
+                               const bench_config_t *config) {
+    size_t total = config->warmup + config->reps;
+    double *times = (double*)malloc(config->reps * sizeof(double));
+    double *imbalances = (double*)malloc(config->reps * sizeof(double));
+
+    for (size_t r = 0; r < total; r++) {
+        begin_round();
+        double start = bench_now();
+        if (phase->library) {
+            neat_evaluate_parallel(pop, synthetic_fitness, (void*)&phase->profile, (int)threads);
+        } else {
+            run_probe(phase->probe, pop, threads);
+        }
+        double elapsed = bench_now() - start;
+
+        /* One thread evaluates on the caller, which may have pinned itself */
+        sched_setaffinity(0, sizeof(main_affinity), &main_affinity);
+
+        if (r >= config->warmup) {
+            times[r - config->warmup] = elapsed * 1e9;
+            imbalances[r - config->warmup] = round_imbalance(threads);
+        }
+    }
+
+    scaling_point_t point;
+    double unused;
+    bench_robust_stats(times, config->reps, &point.median_ns, &point.mad_ns);
+    bench_robust_stats(imbalances, config->reps, &point.imbalance, &unused);
+    free(times);
+    free(imbalances);
+    return point;
+}
+
+/* Serial speciate and reproduce times of one generation, medians over reps */
+static void measure_serial(size_t population, const bench_config_t *config, double *speciate_ns, double *reproduce_ns) {
+    double *speciate = (double*)malloc(config->reps * sizeof(double));
+    double *reproduce = (double*)malloc(config->reps * sizeof(double));
+    cost_profile_t cheap = COST_CHEAP;
+
+    for (size_t r = 0; r < config->reps; r++) {
+        neat_population_t *pop = make_population(population);
+        pop->stats_level = NEAT_STATS_PHASES;
+        neat_evaluate_parallel(pop, synthetic_fitness, &cheap, 1);
+        neat_evolve_epoch(pop);
+        speciate[r] = pop->stats.speciate_time * 1e9;
+        reproduce[r] = pop->stats.reproduce_time * 1e9;
+        neat_free_population(pop);
+    }
+
+    double unused;
+    bench_robust_stats(speciate, config->reps, speciate_ns, &unused);
+    bench_robust_stats(reproduce, config->reps, reproduce_ns, &unused);
+    free(speciate);
+    free(reproduce);
+}
+
+/* Comma-separated positive integers */
+static size_t parse_list(const char *text, size_t *values, size_t max) {
+    size_t count = 0;
+    while (*text && count < max) {
+        char *end;
+        unsigned long value = strtoul(text, &end, 10);
+        if (end == text || value == 0 || value > SCALING_MAX_THREADS) return 0;
+        values[count++] = (size_t)value;
+        if (*end && *end != ',') return 0;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static const char *usage_extra =
+    "  --threads L      Comma-separated thread counts (default 1,2,4,... up to the CPU count)\n"
+    "  --population N   Genomes per round (default 1000)\n"
+    "  --pin P          Thread placement: none, compact or spread (default none)\n"
+    "  --numa           Evaluate with the population's NUMA sharding\n";
+
+int main(int argc, char **argv) {
+    bench_config_t config = bench_default_config();
+    config.warmup = 1;
+    config.reps = 5;
+    size_t population = 1000;
+    size_t thread_counts[64];
+    size_t thread_count_count = 0;
+    bool numa_shards = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--quick") == 0) {
+            config.warmup = 1;
+            config.reps = 2;
+            population = 200;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            thread_count_count = parse_list(value, thread_counts, 64);
+            if (thread_count_count == 0) {
+                bench_usage(argv[0], usage_extra);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            numa_shards = true;
+        } else if (strcmp(argv[i], "--population") == 0 && value) {
+            population = (size_t)strtoul(value, NULL, 10);
+            i++;
+        } else if (strcmp(argv[i], "--pin") == 0 && value) {
+            if (strcmp(value, "compact") == 0) pin_policy = PIN_COMPACT;
+            else if (strcmp(value, "spread") == 0) pin_policy = PIN_SPREAD;
+            else if (strcmp(value, "none") == 0) pin_policy = PIN_NONE;
+            else {
+                bench_usage(argv[0], usage_extra);
+                return 1;
+            }
+            i++;
+        } else if (!bench_parse_option(argc, argv, &i, &config)) {
+            bench_usage(argv[0], usage_extra);
+            return 1;
+        }
+    }
+    if (population < 2) {
+        bench_usage(argv[0], usage_extra);
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count_count == 0) {
+        for (size_t t = 1; t < (size_t)online && thread_count_count < 63; t *= 2) thread_counts[thread_count_count++] = t;
+        thread_counts[thread_count_count++] = online > 0 ? (size_t)online : 1;
+    }
+    if (thread_counts[0] != 1) {
+        fprintf(stderr, "Note: speedup is relative to the first thread count, %zu\n", thread_counts[0]);
+    }
+
+    sched_getaffinity(0, sizeof(main_affinity), &main_affinity);
+    if (pin_policy != PIN_NONE) build_cpu_order(pin_policy);
+
+    static const scaling_phase_t phases[] = {
+        { "evaluate_cheap", true, COST_CHEAP, PROBE_CLONE },
+        { "evaluate_expensive", true, COST_EXPENSIVE, PROBE_CLONE },
+        { "evaluate_variable", true, COST_VARIABLE, PROBE_CLONE },
+        { "clone", false, COST_CHEAP, PROBE_CLONE },
+        { "distance", false, COST_CHEAP, PROBE_DISTANCE },
+    };
+
+    double speciate_ns = 0.0, reproduce_ns = 0.0;
+    measure_serial(population, &config, &speciate_ns, &reproduce_ns);
+    double serial_ns = speciate_ns + reproduce_ns;
+    printf("serial phases: speciate %.3f ms, reproduce %.3f ms (population %zu)\n\n",
+           speciate_ns / 1e6, reproduce_ns / 1e6, population);
+
+    FILE *json = NULL;
+    if (config.json_path) {
+        json = strcmp(config.json_path, "-") == 0 ? stdout : fopen(config.json_path, "w");
+        if (!json) {
+            fprintf(stderr, "Cannot write %s\n", config.json_path);
+            return 1;
+        }
+        bench_write_json_header(json, "scaling");
+        fprintf(json, "  \"config\": {\"warmup\": %zu, \"reps\": %zu, \"population\": %zu, \"pin\": \"%s\", \"numa\": %s, \"cpus\": %ld},\n",
+                config.warmup, config.reps, population, pin_names[pin_policy], numa_shards ? "true" : "false", online);
+        fprintf(json, "  \"results\": [\n");
+        fprintf(json, "    {\"name\": \"serial_speciate\", \"params\": \"population=%zu\", \"median_ns\": %.1f, \"mad_ns\": 0},\n",
+                population, speciate_ns);
+        fprintf(json, "    {\"name\": \"serial_reproduce\", \"params\": \"population=%zu\", \"median_ns\": %.1f, \"mad_ns\": 0}",
+                population, reproduce_ns);
+    }
+
+    neat_population_t *pop = make_population(population);
+    if (numa_shards) {
+        pop->numa = neat_numa_create();
+        printf("NUMA sharding: %d nodes\n", pop->numa->node_count);
+    }
+    printf("%-20s %8s %12s %10s %9s %11s %10s %11s\n",
+           "phase", "threads", "time (ms)", "+/- (ms)", "speedup", "efficiency", "imbalance", "gen speedup");
+
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+        const scaling_phase_t *phase = &phases[p];
+        if (!bench_selected(&config, phase->name)) continue;
+
+        double base_ns = 0.0;
+        for (size_t t = 0; t < thread_count_count; t++) {
+            size_t threads = thread_counts[t];
+            scaling_point_t point = measure(phase, pop, threads, &config);
+            if (t == 0) base_ns = point.median_ns;
+
+            double speedup = point.median_ns > 0.0 ? base_ns / point.median_ns : 0.0;
+            double efficiency = speedup * (double)thread_counts[0] / (double)threads;
+
+            /* Evaluation plus the serial phases: what a whole generation gains */
+            char generation[16] = "-";
+            double generation_speedup = 0.0;
+            if (phase->library) {
+                generation_speedup = (base_ns + serial_ns) / (point.median_ns + serial_ns);
+                snprintf(generation, sizeof(generation), "%.2f", generation_speedup);
+            }
+
+            printf("%-20s %8zu %12.3f %10.3f %9.2f %11.2f %10.2f %11s\n",
+                   phase->name, threads, point.median_ns / 1e6, point.mad_ns / 1e6,
+                   speedup, efficiency, point.imbalance, generation);
+            fflush(stdout);
+
+            if (json) {
+                fprintf(json, ",\n    {\"name\": \"scaling_%s\", \"params\": \"threads=%zu,population=%zu,pin=%s\", "
+                              "\"reps\": %zu, \"median_ns\": %.1f, \"mad_ns\": %.1f, \"speedup\": %.4f, "
+                              "\"efficiency\": %.4f, \"imbalance\": %.4f",
+                        phase->name, threads, population, pin_names[pin_policy], config.reps,
+                        point.median_ns, point.mad_ns, speedup, efficiency, point.imbalance);
+                if (phase->library) fprintf(json, ", \"generation_speedup\": %.4f", generation_speedup);
+                fprintf(json, "}");
+            }
+        }
+    }
+    if (pop->numa) {
+        printf("\nlast sharded evaluation: %zu local, %zu stolen, %zu relocated, %zu already placed, %d/%d nodes bound\n",
+               pop->numa->local_jobs, pop->numa->stolen_jobs, pop->numa->relocated, pop->numa->resident,
+               pop->numa->bound_nodes, pop->numa->node_count);
+        neat_numa_free(pop->numa);
+        pop->numa = NULL;
+    }
+    neat_free_population(pop);
+
+    int ok = 1;
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        ok = !ferror(json);
+        if (json != stdout) ok = fclose(json) == 0 && ok;
+    }
+    return ok ? 0 : 1;
+}
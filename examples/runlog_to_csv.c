@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../include/runlog.h"
+
+/*
+ * Convert a run log written by neat_runlog_open to CSV.
+ *
+ *   runlog_to_csv run.nlog            generation summaries to stdout
+ *   runlog_to_csv run.nlog out        out_generations.csv, out_species.csv, out_genomes.csv
+ */
+static FILE* open_output(const char* prefix, const char* suffix) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s_%s.csv", prefix, suffix);
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Cannot create %s\n", path);
+    }
+    return fp;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <run log> [output prefix]\n", argv[0]);
+        return 1;
+    }
+    
+    if (argc == 2) {
+        if (!neat_runlog_export_csv(argv[1], stdout, NULL, NULL)) {
+            fprintf(stderr, "%s is not a run log\n", argv[1]);
+            return 1;
+        }
+        return 0;
+    }
+    
+    FILE* generations = open_output(argv[2], "generations");
+    FILE* species = open_output(argv[2], "species");
+    FILE* genomes = open_output(argv[2], "genomes");
+    int ok = generations && species && genomes &&
+             neat_runlog_export_csv(argv[1], generations, species, genomes);
+    if (generations) fclose(generations);
+    if (species) fclose(species);
+    if (genomes) fclose(genomes);
+    
+    if (!ok) {
+        fprintf(stderr, "Failed to convert %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "neat.h"
+
+/*
+ * Population checkpoints
+ *
+ * A checkpoint is a single file holding everything needed to resume a run:
+ * genomes, species, the innovation table, counters and the RNG state. Genes
+ * are stored as raw neat_node_t / neat_connection_t arrays in two contiguous
+ * sections, addressed through a fixed-size genome table. Loading maps the
+ * file and points every genome's gene arrays into the mapping, so restore
+ * cost does not depend on genome size. A restored genome copies its genes
+ * to the heap the first time they have to grow.
+ *
+ * The layout is host-native. The header records byte order and struct
+ * sizes, and a file written by an incompatible build is refused. Evaluation
+ * callbacks and the surrogate are not saved and must be set again.
+ */
+
+#define NEAT_CHECKPOINT_MAGIC   0x4E504F50  /* 'NPOP' */
+#define NEAT_CHECKPOINT_VERSION 2
+#define NEAT_CHECKPOINT_ALIGN   64          /* Section alignment in bytes */
+
+/* Synchronous save and restore */
+int neat_population_save(const neat_population_t *pop, const char *path);
+neat_population_t* neat_population_load(const char *path);
+neat_population_t* neat_checkpoint_restore(const char *dir);
+
+/*
+ * Background checkpointing
+ *
+ * At a generation boundary the checkpointer copies the population into a
+ * private in-memory image laid out exactly like the file (one allocation
+ * and a memcpy per gene array), then a writer thread checksums it, writes
+ * it to a temp file and renames it into place while the next generation
+ * evaluates. A written image is recycled by the next snapshot so steady-state
+ * snapshots do not fault in fresh pages. If a snapshot is due while the
+ * previous one is still queued, the queued one is dropped in favour of the
+ * newer state.
+ *
+ * With keyframe_interval above 1, a snapshot that directly follows the last
+ * one written is written as a delta against it: each genome becomes its
+ * parent ID plus the gene edits made by crossover and mutation. Every
+ * keyframe_interval-th checkpoint is a full keyframe, and
+ * neat_checkpoint_restore replays the deltas after the newest keyframe.
+ * Only the newest keep_count keyframes, with their deltas, are kept. Deltas
+ * need save_frequency 1 (the default); with any other save_frequency the
+ * checkpointer sets keyframe_interval to 1 and writes keyframes only.
+ */
+typedef struct {
+    int save_frequency;         /* Generations between checkpoints (0 = disabled) */
+    const char *checkpoint_dir; /* Directory for checkpoint files (copied) */
+    int keep_count;             /* Most recent keyframes kept on disk */
+    int keyframe_interval;      /* Checkpoints per keyframe (1 = no deltas; forced to 1 unless save_frequency is 1) */
+} neat_checkpoint_config_t;
+
+/* File written by the checkpointer */
+typedef struct {
+    char *path;
+    bool keyframe;              /* Full checkpoint rather than a delta */
+} neat_checkpoint_file_t;
+
+/* Snapshot waiting for or being written by the writer thread */
+typedef struct {
+    uint8_t *data;              /* File image; header checksums filled in by the writer */
+    size_t size;                /* Image size in bytes */
+    size_t capacity;            /* Allocated bytes, reused by later snapshots */
+    int generation;             /* Generation the snapshot was taken at */
+} neat_checkpoint_image_t;
+
+typedef struct neat_checkpointer {
+    neat_checkpoint_config_t config;
+    char *checkpoint_dir;       /* Owned copy of config.checkpoint_dir */
+    
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    neat_checkpoint_image_t *pending; /* Next snapshot to write (guarded by lock) */
+    neat_checkpoint_image_t *spare; /* Written image kept for reuse (guarded by lock) */
+    bool writing;               /* Writer thread busy (guarded by lock) */
+    bool stop;                  /* Shutdown requested (guarded by lock) */
+    
+    neat_checkpoint_file_t *written; /* Kept checkpoint files, oldest first (writer thread) */
+    int written_count;
+    int written_capacity;
+    neat_checkpoint_image_t *base; /* Last image written, base of the next delta (writer thread) */
+    int delta_run;              /* Deltas written since the last keyframe (writer thread) */
+    
+    /* Statistics (guarded by lock) */
+    int checkpoint_count;       /* Checkpoints written successfully */
+    int delta_count;            /* Of which deltas */
+    int dropped_count;          /* Snapshots superseded before being written */
+    int failed_count;           /* Writes that failed */
+    double last_snapshot_time;  /* Seconds the evolution loop spent on the last snapshot */
+    double last_write_time;     /* Seconds the writer spent on the last checkpoint */
+    size_t last_write_size;     /* Bytes in the last checkpoint file */
+    int last_generation;        /* Generation of the newest checkpoint on disk (-1 = none) */
+    bool last_delta;            /* Newest checkpoint on disk is a delta */
+} neat_checkpointer_t;
+
+/* Configuration */
+neat_checkpoint_config_t neat_checkpoint_default_config(void);
+
+/* Lifecycle */
+neat_checkpointer_t* neat_checkpointer_create(const neat_checkpoint_config_t *config);
+void neat_checkpointer_free(neat_checkpointer_t *cp);
+
+/* Snapshots */
+int neat_checkpointer_submit(neat_checkpointer_t *cp, const neat_population_t *pop);
+int neat_checkpointer_step(neat_checkpointer_t *cp, const neat_population_t *pop);
+void neat_checkpointer_flush(neat_checkpointer_t *cp);
+int neat_checkpointer_latest_path(neat_checkpointer_t *cp, char *buffer, size_t size);
+
+#endif /* CHECKPOINT_H */
@@ -16,6 +16,12 @@
 #define NEAT_DEFAULT_POPULATION_SIZE 150
 #define NEAT_DEFAULT_ELITISM 2
 #define NEAT_DEFAULT_STAGNATION_LIMIT 15
+#define NEAT_DEFAULT_FIDELITY_PROMOTE 0.25
+
+/* Instrumentation: define as 0 to compile out generation statistics */
+#ifndef NEAT_ENABLE_STATS
+#define NEAT_ENABLE_STATS 1
+#endif
 
 /* Speciation parameters */
 #define NEAT_COMPATIBILITY_THRESHOLD 3.0
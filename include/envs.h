@@ -0,0 +1,102 @@
+#ifndef ENVS_H
+#define ENVS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "neat.h"
+
+/*
+ * Built-in benchmark environments
+ *
+ * Every environment is stored structure-of-arrays so that thousands of
+ * instances can be stepped in lockstep with SIMD. The *_fitness functions
+ * match the population's evaluate_genome callback signature and can be
+ * plugged in directly as standard fitness functions.
+ */
+
+/* Pole balancing constants (Barto et al. 1983, Wieland 1991) */
+#define NEAT_ENV_GRAVITY          9.8f
+#define NEAT_ENV_CART_MASS        1.0f
+#define NEAT_ENV_POLE1_MASS       0.1f
+#define NEAT_ENV_POLE1_HALF_LEN   0.5f
+#define NEAT_ENV_POLE2_MASS       0.01f
+#define NEAT_ENV_POLE2_HALF_LEN   0.05f
+#define NEAT_ENV_FORCE_MAG        10.0f
+#define NEAT_ENV_TRACK_LIMIT      2.4f
+#define NEAT_ENV_SINGLE_TAU       0.02f
+#define NEAT_ENV_DOUBLE_TAU       0.01f
+#define NEAT_ENV_SINGLE_FAIL_ANGLE 0.2094384f  /* 12 degrees */
+#define NEAT_ENV_DOUBLE_FAIL_ANGLE 0.6283185f  /* 36 degrees */
+
+/* Default episode limits */
+#define NEAT_ENV_DEFAULT_MAX_STEPS  100000
+#define NEAT_ENV_DEFAULT_INSTANCES  8
+
+/*
+ * Supervised dataset (XOR, N-bit parity, multiplexer)
+ * Inputs are stored column-major: inputs[i * case_count + c] is input i of case c.
+ */
+typedef struct {
+    size_t num_inputs;          /* Number of input columns */
+    size_t case_count;          /* Number of test cases */
+    float* inputs;              /* Input columns (num_inputs * case_count) */
+    float* targets;             /* Expected output per case */
+} neat_env_dataset_t;
+
+/*
+ * Batch of cart-pole instances (one or two poles)
+ * All state arrays have `count` entries; unused pole-2 arrays are NULL.
+ */
+typedef struct {
+    size_t count;               /* Number of instances */
+    int num_poles;              /* 1 = single pole, 2 = double pole */
+    bool velocities;            /* Whether observations include velocities */
+    float tau;                  /* Integration timestep */
+    float fail_angle;           /* Pole angle at which an instance fails */
+    float* x;                   /* Cart position */
+    float* x_dot;               /* Cart velocity */
+    float* theta1;              /* Pole 1 angle */
+    float* theta1_dot;          /* Pole 1 angular velocity */
+    float* theta2;              /* Pole 2 angle (double pole only) */
+    float* theta2_dot;          /* Pole 2 angular velocity (double pole only) */
+    float* alive;               /* 1.0f while balancing, 0.0f after failure */
+    int* steps;                 /* Steps survived by each instance */
+    size_t alive_count;         /* Number of instances still balancing */
+} neat_pole_batch_t;
+
+/* Pole balancing task passed as user_data to neat_env_pole_fitness */
+typedef struct {
+    int num_poles;              /* 1 or 2 */
+    bool velocities;            /* Markovian (true) or non-Markovian (false) */
+    size_t instances;           /* Start states evaluated per genome */
+    int max_steps;              /* Episode length cap */
+    uint32_t seed;              /* Seed for start state perturbations */
+} neat_pole_task_t;
+
+/* Dataset functions */
+neat_env_dataset_t* neat_env_xor_create(void);
+neat_env_dataset_t* neat_env_parity_create(size_t bits);
+neat_env_dataset_t* neat_env_multiplexer_create(size_t address_bits);
+void neat_env_dataset_free(neat_env_dataset_t* data);
+double neat_env_dataset_fitness(neat_genome_t* genome, void* user_data);
+
+/* Pole balancing batch functions */
+neat_pole_batch_t* neat_pole_batch_create(size_t count, int num_poles, bool velocities);
+void neat_pole_batch_free(neat_pole_batch_t* batch);
+void neat_pole_batch_reset(neat_pole_batch_t* batch, uint32_t seed, float noise);
+size_t neat_pole_batch_step(neat_pole_batch_t* batch, const float* forces);
+size_t neat_pole_batch_observation_size(const neat_pole_batch_t* batch);
+void neat_pole_batch_observe(const neat_pole_batch_t* batch, size_t index, double* obs);
+
+/*
+ * Pole balancing task. Fitness is the mean number of steps balanced. Under an
+ * evaluation timeout retry the episode is cut to neat_eval_budget() of
+ * max_steps and the mean is not scaled, so a retried genome scores only the
+ * steps it actually balanced and cannot reach a solved threshold it never
+ * demonstrated.
+ */
+neat_pole_task_t neat_pole_task_default(int num_poles, bool velocities);
+double neat_env_pole_fitness(neat_genome_t* genome, void* user_data);
+
+#endif /* ENVS_H */
@@ -0,0 +1,94 @@
+#ifndef EVAL_PROFILE_H
+#define EVAL_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "neat.h"
+
+/*
+ * Evaluation cost profile
+ *
+ * Collects the measured evaluation time of every genome at each generation
+ * boundary into log-scale histograms, for the generation as a whole, for
+ * each species and for the run, and flags the genomes slower than a
+ * percentile of their generation together with the size features that
+ * usually explain the cost. Attach one to a population to find the few
+ * bloated genomes that dominate a generation:
+ *
+ *   pop->eval_profile = neat_eval_profile_create(0.99);
+ *   ...
+ *   neat_eval_profile_print(pop->eval_profile, stdout);
+ *
+ * Bucket 0 holds evaluations under a microsecond (and untimed ask/tell
+ * results); bucket b holds [2^(b-1), 2^b) microseconds, and the last bucket
+ * everything slower.
+ */
+
+#define NEAT_EVAL_PROFILE_BUCKETS       32
+#define NEAT_EVAL_PROFILE_MAX_OUTLIERS  16  /* Default cap on outliers kept per generation */
+
+typedef struct {
+    uint32_t counts[NEAT_EVAL_PROFILE_BUCKETS];
+    size_t count;
+    double total_time;          /* Seconds */
+    double max_time;
+} neat_eval_histogram_t;
+
+typedef struct {
+    int species_id;
+    neat_eval_histogram_t histogram;
+} neat_eval_species_profile_t;
+
+/* A genome slower than the outlier percentile of its generation */
+typedef struct {
+    int genome_id;
+    int species_id;
+    double eval_time;
+    size_t node_count;
+    size_t connection_count;
+    double disabled_ratio;      /* Disabled connections / connections */
+} neat_eval_outlier_t;
+
+typedef struct neat_eval_profile {
+    /* Settings */
+    double outlier_percentile;  /* Genomes slower than this fraction of the generation are flagged */
+    size_t max_outliers;        /* Slowest outliers kept per generation */
+
+    /* Last captured generation */
+    int generation;
+    neat_eval_histogram_t histogram;
+    neat_eval_species_profile_t *species; /* In population species order */
+    size_t species_count;
+    size_t species_capacity;
+    double threshold;           /* Evaluation time at the outlier percentile */
+    double time_per_connection; /* Total evaluation time / total connections */
+    neat_eval_outlier_t *outliers; /* Slowest first */
+    size_t outlier_count;
+    size_t outlier_capacity;
+
+    /* Whole run */
+    neat_eval_histogram_t run_histogram;
+    size_t generations;
+    size_t total_outliers;      /* Before the per-generation cap */
+
+    double *scratch;            /* Sorted evaluation times */
+    size_t scratch_capacity;
+} neat_eval_profile_t;
+
+/* Lifecycle */
+neat_eval_profile_t* neat_eval_profile_create(double outlier_percentile);
+void neat_eval_profile_free(neat_eval_profile_t *profile);
+
+/* Recording; called by the evolution loop after speciation */
+void neat_eval_profile_capture(neat_eval_profile_t *profile, const neat_population_t *pop);
+
+/* Histograms */
+size_t neat_eval_histogram_bucket(double seconds);
+double neat_eval_histogram_upper_bound(size_t bucket);
+double neat_eval_histogram_percentile(const neat_eval_histogram_t *histogram, double fraction);
+
+/* Reporting */
+void neat_eval_profile_print(const neat_eval_profile_t *profile, FILE *fp);
+
+#endif /* EVAL_PROFILE_H */
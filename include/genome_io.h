@@ -0,0 +1,49 @@
+#ifndef GENOME_IO_H
+#define GENOME_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "neat.h"
+
+/*
+ * Binary genome format
+ *
+ * A file is a plain concatenation of self-contained genome records, so any
+ * number of genomes can be streamed to and from one FILE*. All integers are
+ * little-endian regardless of host byte order.
+ *
+ *   u32  magic        'NGEN'
+ *   u8   version      NEAT_GENOME_FORMAT_VERSION
+ *   u8   flags        NEAT_GENOME_FLAG_*
+ *   u16  reserved     0
+ *   u32  payload size in bytes
+ *   ...  payload
+ *   u32  CRC-32C of the 12 header bytes and the payload
+ *
+ * The payload holds the genome ID, species ID and fitness, the node and
+ * connection counts, then the genes. Node IDs, innovation numbers and
+ * connection endpoints are stored as zigzag varints of the difference to
+ * the previous gene, so the usual sequential IDs take one byte each.
+ * Weights and biases are float64, or float32 with NEAT_GENOME_FLAG_FLOAT32.
+ */
+
+#define NEAT_GENOME_FORMAT_MAGIC   0x4E47454E  /* 'NGEN' */
+#define NEAT_GENOME_FORMAT_VERSION 1
+#define NEAT_GENOME_HEADER_SIZE    12
+#define NEAT_GENOME_MAX_PAYLOAD    (1u << 30)
+
+#define NEAT_GENOME_FLAG_FLOAT32   0x01        /* Weights and biases stored as float32 */
+
+/* Checksum */
+uint32_t neat_crc32c(uint32_t crc, const void *data, size_t size);
+
+/* Whole-file helpers: write or read every genome record of a file */
+int neat_save_genomes(const char *filename, neat_genome_t **genomes, size_t count,
+                      neat_weight_format_t format);
+neat_genome_t** neat_load_genomes(const char *filename, size_t *count);
+
+/* Deployment: write a genome as a dependency-free C header with <name>_forward */
+int neat_export_header(const neat_genome_t *genome, const char *name, const char *path);
+
+#endif /* GENOME_IO_H */
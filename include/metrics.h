@@ -0,0 +1,113 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "neat.h"
+
+/*
+ * Metrics server
+ *
+ * Serves the state of a running population in the Prometheus text format
+ * (version 0.0.4) over HTTP on a loopback TCP port or a Unix socket, so a
+ * long run can be watched from Prometheus or with curl:
+ *
+ *   neat_metrics_t *metrics = neat_metrics_start("127.0.0.1:9464");
+ *   pop->metrics = metrics;
+ *   ...
+ *   curl -s localhost:9464/metrics
+ *
+ * The evolution loop fills a private snapshot at each generation boundary
+ * and publishes it through a triple buffer: publishing is one atomic
+ * exchange, so a slow scrape never holds up evolution, and the server
+ * thread always renders a complete generation. The evaluation queue depth
+ * is the only value read live.
+ */
+
+#define NEAT_METRICS_BUCKETS    19  /* Latency histogram bounds, +Inf implied */
+
+/* Epoch phases with latency histograms */
+typedef enum {
+    NEAT_METRICS_EVALUATE,
+    NEAT_METRICS_SPECIATE,
+    NEAT_METRICS_ADJUST,
+    NEAT_METRICS_REMOVE_STALE,
+    NEAT_METRICS_REMOVE_WEAK,
+    NEAT_METRICS_REPRODUCE,
+    NEAT_METRICS_EPOCH,
+    NEAT_METRICS_PHASE_COUNT
+} neat_metrics_phase_t;
+
+/* Cumulative phase latency histogram; bucket counts are not cumulative */
+typedef struct {
+    uint64_t buckets[NEAT_METRICS_BUCKETS + 1]; /* Last bucket is +Inf */
+    uint64_t count;
+    double sum;                 /* Seconds */
+} neat_metrics_histogram_t;
+
+/* Everything one scrape reports, as of the last published generation */
+typedef struct {
+    uint64_t sequence;          /* Generations published (0 = none yet) */
+    int generation;             /* Generations completed */
+    size_t genome_count;
+    size_t species_count;
+    size_t innovation_count;
+    uint64_t evaluations_total;
+    double evaluations_per_second; /* Genomes evaluated per wall second, last generation */
+    double best_fitness;        /* Of the last evaluated generation */
+    double mean_fitness;
+    double max_fitness_achieved;
+    size_t archive_size;        /* Novelty archive entries, as set by the caller */
+    bool has_memory;            /* Population has an accounting allocator */
+    neat_mem_stats_t memory;
+    neat_metrics_histogram_t phases[NEAT_METRICS_PHASE_COUNT];
+} neat_metrics_snapshot_t;
+
+typedef struct neat_metrics {
+    int listen_fd;
+    int wake_pipe[2];           /* Written by neat_metrics_stop to end the server loop */
+    char unix_path[108];        /* Socket file to remove on stop ("" for TCP) */
+    int port;                   /* Bound TCP port (0 for a Unix socket) */
+    pthread_t thread;
+
+    /* Triple buffer: the writer fills buffers[back], then swaps it with middle */
+    neat_metrics_snapshot_t buffers[3];
+    atomic_uint middle;         /* Index of the newest snapshot, flagged fresh until read */
+    unsigned back;              /* Evolution thread */
+    unsigned front;             /* Readers (guarded by read_lock) */
+    pthread_mutex_t read_lock;  /* Serializes readers; never taken by the writer */
+
+    /* Generation being prepared (evolution thread) */
+    neat_metrics_snapshot_t pending;
+    double last_publish;        /* Wall time of the previous publish (0 = none) */
+
+    /* Live values */
+    atomic_size_t queue_depth;  /* Genomes waiting for an evaluation worker */
+    atomic_size_t archive_size;
+    atomic_uint_fast64_t scrapes;
+} neat_metrics_t;
+
+/*
+ * Lifecycle; address is "[host:]port" (host defaults to 127.0.0.1, port 0
+ * picks one) or "unix:/path" (an existing socket there is replaced, any
+ * other file makes start fail). The server is unauthenticated, so only
+ * loopback hosts (127.0.0.0/8) are accepted; prefix "public:" (e.g.
+ * "public:0.0.0.0:9464") to deliberately listen on another interface.
+ */
+neat_metrics_t* neat_metrics_start(const char *address);
+void neat_metrics_stop(neat_metrics_t *metrics);
+int neat_metrics_port(const neat_metrics_t *metrics);
+
+/* Recording; called by the evolution loop after speciation and after reproduction */
+void neat_metrics_capture(neat_metrics_t *metrics, const neat_population_t *pop);
+void neat_metrics_publish(neat_metrics_t *metrics, const neat_population_t *pop);
+void neat_metrics_set_archive_size(neat_metrics_t *metrics, size_t size);
+
+/* Reading */
+void neat_metrics_read(neat_metrics_t *metrics, neat_metrics_snapshot_t *snapshot);
+char* neat_metrics_render(neat_metrics_t *metrics, size_t *length);
+
+#endif /* METRICS_H */
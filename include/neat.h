@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdatomic.h>
 #include "config.h"
 
 /* Forward declarations */
@@ -14,6 +15,11 @@ struct neat_connection;
 struct neat_genome;
 struct neat_species;
 struct neat_population;
+struct neat_surrogate;
+struct neat_checkpointer;
+struct neat_runlog;
+struct neat_metrics;
+struct neat_eval_profile;
 
 typedef struct neat_innovation neat_innovation_t;
 typedef struct neat_innovation_table neat_innovation_table_t;
@@ -59,6 +65,15 @@ struct neat_genome {
     double adjusted_fitness;    /* Fitness adjusted for species sharing */
     int global_rank;            /* Global rank in population */
     int species_id;             /* ID of the species this genome belongs to */
+    bool evaluated;             /* Whether fitness has been set this generation */
+    bool elite;                 /* Unmutated champion carried over from the previous generation */
+    double eval_time;           /* Measured evaluation wall time in seconds */
+    double parent_eval_time;    /* Evaluation time of the primary parent */
+    double parent_fitness;      /* Fitness of the fitter parent */
+    int fidelity;               /* Fidelity level at which fitness was measured */
+    int parent1_id;             /* Primary parent's ID (-1 for the initial population) */
+    int parent2_id;             /* Crossover partner's ID (-1 if none) */
+    bool mapped;                /* Gene arrays point into a checkpoint mapping */
     
     /* For network evaluation */
     int *evaluation_order;      /* Order in which to evaluate nodes */
@@ -82,6 +97,185 @@ typedef struct neat_species {
     struct neat_genome *representative; /* Representative genome for compatibility */
 } neat_species_t;
 
+/* Evaluation cost model - linear fit of eval time on genome size features */
+#define NEAT_COST_FEATURES 4    /* bias, node count, enabled connections, parent time */
+
+typedef struct neat_cost_model {
+    double xtx[NEAT_COST_FEATURES][NEAT_COST_FEATURES]; /* Decayed normal equations */
+    double xty[NEAT_COST_FEATURES];
+    double coef[NEAT_COST_FEATURES]; /* Fitted coefficients */
+    double decay;               /* Weight kept by old samples each generation */
+    size_t samples;             /* Samples seen since creation */
+} neat_cost_model_t;
+
+/*
+ * NUMA sharding for parallel evaluation
+ *
+ * With a topology attached to the population, neat_evaluate_parallel splits
+ * the genomes into one contiguous shard per NUMA node, each with its own
+ * longest-first queue. Workers are spread across nodes and pinned to their
+ * node's CPUs; a worker drains its own shard and only then steals from the
+ * other nodes' queues. With place_genes, each node gets an arena of memory
+ * bound to it with mbind (or, where the kernel refuses, first touched by
+ * that node's pinned worker). A worker moves the gene arrays and evaluation
+ * order of each genome it takes from its own shard into its node's arena
+ * before evaluating it, unless they are already there; genome pointers stay
+ * valid. Offspring are allocated by the evolution thread, so new genomes
+ * are moved once, in the generation they are first evaluated. Blocks in an
+ * arena are accounted by the arena, not the population's allocator, and an
+ * arena outlives neat_numa_free until its last block is freed.
+ */
+#define NEAT_NUMA_MAX_NODES 64
+
+struct neat_numa_arena;
+
+typedef struct neat_numa {
+    int node_count;             /* NUMA nodes (1 when the topology is unknown) */
+    int node_ids[NEAT_NUMA_MAX_NODES]; /* Kernel node number of each node */
+    int *cpus;                  /* CPUs of every node, node by node */
+    size_t cpu_offsets[NEAT_NUMA_MAX_NODES + 1]; /* Node n owns cpus[cpu_offsets[n] .. cpu_offsets[n + 1]) */
+    bool pin_workers;           /* Bind each worker to its node's CPUs (default true) */
+    bool place_genes;           /* Move shard genomes' genes into their node's arena (default true) */
+    struct neat_numa_arena *arenas[NEAT_NUMA_MAX_NODES]; /* Created by the first sharded evaluation */
+    
+    /* Last sharded evaluation */
+    size_t local_jobs;          /* Evaluated by a worker on the genome's own node */
+    size_t stolen_jobs;         /* Evaluated by a worker on another node */
+    size_t relocated;           /* Local genomes copied into their node's arena */
+    size_t resident;            /* Local genomes already in their node's arena */
+    int bound_nodes;            /* Arenas whose memory the kernel bound to the node */
+} neat_numa_t;
+
+/*
+ * Evaluation timeouts
+ *
+ * With a timeout set, neat_evaluate_parallel (and neat_evolve, which then
+ * evaluates through it on one thread) runs every evaluation under a
+ * cancellation token with a deadline. A watchdog thread raises the token's
+ * cancelled flag once the deadline passes, and long-running callbacks poll
+ * neat_eval_cancelled() to return early. Threads cannot be killed, so a
+ * callback that never polls runs to completion, but an overdue result is
+ * still replaced according to the policy: the penalty fitness, or another
+ * attempt with neat_eval_budget() scaled down, falling back to the penalty
+ * once the retries are used up. A callback that shortens its work by the
+ * budget should report only what that shorter run showed, as
+ * neat_env_pole_fitness does; extrapolating to the full evaluation would
+ * reward genomes for being slow.
+ */
+typedef enum {
+    NEAT_TIMEOUT_PENALTY,       /* Overdue evaluations get penalty_fitness */
+    NEAT_TIMEOUT_RETRY          /* Retry with a smaller budget, then penalize */
+} neat_timeout_policy_t;
+
+typedef struct neat_eval_token {
+    atomic_bool cancelled;      /* Raised by the watchdog once the deadline passes */
+    double deadline;            /* neat_get_time() at which the attempt is overdue */
+    double budget;              /* Fraction of the full evaluation to attempt (1 on the first try) */
+    int attempt;                /* 0 on the first try */
+} neat_eval_token_t;
+
+typedef struct {
+    double timeout;             /* Seconds per evaluation attempt (0 = no timeout) */
+    neat_timeout_policy_t policy;
+    double penalty_fitness;     /* Fitness of an evaluation that finally timed out */
+    int max_retries;            /* Attempts after the first with NEAT_TIMEOUT_RETRY (default 1) */
+    double retry_budget;        /* Budget multiplier per retry (default 0.5) */
+    
+    /* Last evaluation */
+    size_t timed_out;           /* Attempts that overran their deadline */
+    size_t retried;
+    size_t penalized;
+} neat_eval_timeout_t;
+
+/*
+ * Allocators
+ *
+ * Every allocation made by the library goes through a neat_allocator_t. A
+ * small header in front of each block records the allocator and the size, so
+ * neat_free and neat_realloc return a block to the allocator that made it
+ * whichever allocator is current. Allocators count live bytes, high-water
+ * marks and allocations per subsystem tag.
+ *
+ * The current allocator is per thread: neat_use_allocator installs one, and
+ * population operations (creation, neat_evolve, neat_evolve_parallel,
+ * neat_tell) install the population's allocator while they run. Blocks from
+ * the neat_ allocation functions must be released with neat_free, and an
+ * allocator must outlive every block it has handed out.
+ */
+typedef enum {
+    NEAT_MEM_GENERAL,           /* Untagged and scratch allocations */
+    NEAT_MEM_GENOMES,           /* Genomes, gene arrays and genome lists */
+    NEAT_MEM_SPECIES,
+    NEAT_MEM_INNOVATION,        /* Innovation table */
+    NEAT_MEM_ARCHIVE,           /* Novelty archive and behaviors */
+    NEAT_MEM_SUBSTRATE,         /* HyperNEAT substrates */
+    NEAT_MEM_VISUALIZATION,
+    NEAT_MEM_TAG_COUNT
+} neat_mem_tag_t;
+
+typedef struct neat_allocator {
+    /* Hooks; sizes include the block header. realloc may be NULL (allocate, copy, free) */
+    void* (*alloc)(void *ctx, size_t size);
+    void* (*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+    
+    /* Accounting per tag, in requested bytes */
+    atomic_size_t live_bytes[NEAT_MEM_TAG_COUNT];
+    atomic_size_t peak_bytes[NEAT_MEM_TAG_COUNT];
+    atomic_size_t allocations[NEAT_MEM_TAG_COUNT]; /* Blocks allocated so far */
+} neat_allocator_t;
+
+/* Snapshot of an allocator's accounting */
+typedef struct {
+    size_t live_bytes[NEAT_MEM_TAG_COUNT];
+    size_t peak_bytes[NEAT_MEM_TAG_COUNT];
+    size_t allocations[NEAT_MEM_TAG_COUNT];
+    size_t total_live_bytes;
+} neat_mem_stats_t;
+
+/* Generation statistics */
+typedef enum {
+    NEAT_STATS_OFF,             /* No timing */
+    NEAT_STATS_PHASES,          /* Wall time of each phase, a few clock reads per generation */
+    NEAT_STATS_DETAILED         /* Phases plus sub-phase counts and timers */
+} neat_stats_level_t;
+
+typedef struct {
+    int generation;             /* Generation the statistics describe */
+    
+    /* Phase wall times in seconds */
+    double evaluate_time;       /* Evaluation in neat_evolve / neat_evolve_parallel (0 with ask/tell) */
+    double speciate_time;
+    double adjust_time;         /* Fitness sharing */
+    double remove_stale_time;
+    double remove_weak_time;
+    double reproduce_time;
+    double epoch_time;          /* Speciation through reproduction, run log and checkpoint snapshot */
+    
+    /* Speciation (NEAT_STATS_DETAILED) */
+    size_t distance_count;      /* Compatibility distance computations */
+    double distance_time;       /* Assigning genomes to species, mostly distances */
+    
+    /* Reproduction (NEAT_STATS_DETAILED) */
+    size_t elite_count;
+    size_t crossover_count;
+    size_t clone_count;         /* Asexual offspring */
+    size_t mutation_count;
+    double crossover_time;
+    double clone_time;
+    double mutation_time;       /* Includes the innovation lookups mutations make */
+    
+    /* Innovation table (NEAT_STATS_DETAILED) */
+    size_t innovation_lookups;
+    size_t innovation_scanned;  /* Table entries compared across all lookups */
+    size_t innovations_created;
+    double innovation_time;
+} neat_generation_stats_t;
+
+typedef void (*neat_generation_callback_t)(const struct neat_population *pop,
+                                           const neat_generation_stats_t *stats, void *user_data);
+
 /* Population structure - contains all genomes and species */
 typedef struct neat_population {
     struct neat_genome **genomes;    /* Array of all genomes */
@@ -97,7 +291,51 @@ typedef struct neat_population {
     /* Configuration */
     size_t population_size;     /* Target population size */
     int generation;             /* Current generation number */
-    int max_fitness_achieved;   /* Best fitness achieved so far */
+    double max_fitness_achieved; /* Best fitness achieved so far */
+    int next_genome_id;         /* Next available genome ID */
+    
+    /* External evaluation (ask/tell) */
+    size_t ask_batch_size;      /* Max genomes per neat_ask (0 = all remaining) */
+    size_t ask_cursor;          /* Index of the next genome to hand out */
+    size_t tell_count;          /* Results received for the current generation */
+    
+    /* Parallel evaluation scheduling */
+    neat_cost_model_t cost_model; /* Predicts eval cost for LPT dispatch */
+    struct neat_numa *numa;     /* Optional NUMA sharding (NULL = off, caller owns) */
+    neat_eval_timeout_t eval_timeout; /* Per-evaluation deadline (timeout 0 = off) */
+    
+    /* Optional surrogate prescreening in neat_evolve (NULL = off, caller owns) */
+    struct neat_surrogate *surrogate;
+    
+    /* Multi-fidelity evaluation ladder in neat_evolve (off unless fidelity_levels > 1) */
+    int fidelity_levels;        /* Number of fidelity levels; level fidelity_levels - 1 is full fidelity */
+    double fidelity_promote_fraction; /* Fraction of each species promoted to the next level */
+    double (*evaluate_fidelity)(struct neat_genome *genome, int fidelity, void *user_data);
+    
+    /* Optional background checkpointing at generation boundaries (NULL = off, caller owns) */
+    struct neat_checkpointer *checkpointer;
+    
+    /* Optional run log written at generation boundaries (NULL = off, caller owns) */
+    struct neat_runlog *runlog;
+    
+    /* Optional Prometheus metrics server fed at generation boundaries (NULL = off, caller owns) */
+    struct neat_metrics *metrics;
+    
+    /* Optional per-genome evaluation cost profile, captured after speciation (NULL = off, caller owns) */
+    struct neat_eval_profile *eval_profile;
+    
+    /* Generation statistics */
+    neat_stats_level_t stats_level; /* Default NEAT_STATS_PHASES */
+    neat_generation_stats_t stats; /* Last generation; filled in while its epoch runs */
+    neat_generation_callback_t on_generation; /* Called after each generation (NULL = none) */
+    void *on_generation_user_data;
+    
+    /* Allocator for the population's memory (NULL = process default, caller owns) */
+    neat_allocator_t *allocator;
+    
+    /* Checkpoint file mapping that restored genomes may still reference */
+    void *mapping;
+    size_t mapping_size;
     
     /* Callback for evaluating genomes */
     double (*evaluate_genome)(struct neat_genome *genome, void *user_data);
@@ -131,6 +369,20 @@ void* neat_malloc(size_t size);
 void neat_free(void *ptr);
 void* neat_calloc(size_t nmemb, size_t size);
 void* neat_realloc(void *ptr, size_t size);
+void* neat_malloc_tagged(neat_mem_tag_t tag, size_t size);
+void* neat_calloc_tagged(neat_mem_tag_t tag, size_t nmemb, size_t size);
+
+/* Allocators */
+void neat_allocator_init(neat_allocator_t *allocator,
+                         void* (*alloc)(void *ctx, size_t size),
+                         void* (*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size),
+                         void (*free)(void *ctx, void *ptr, size_t size),
+                         void *ctx);
+neat_allocator_t* neat_default_allocator(void);
+neat_allocator_t* neat_current_allocator(void);
+neat_allocator_t* neat_use_allocator(neat_allocator_t *allocator);
+void neat_allocator_stats(const neat_allocator_t *allocator, neat_mem_stats_t *stats);
+const char* neat_mem_tag_name(neat_mem_tag_t tag);
 
 /* Node functions */
 neat_node_t neat_create_node(int id, neat_node_type_t type, neat_node_placement_t placement);
@@ -141,10 +393,18 @@ neat_connection_t neat_create_connection(int innovation, int in_node, int out_no
                                          double weight, bool enabled);
 void neat_free_connection(neat_connection_t *conn);
 
+/* Weight precision used when saving genomes */
+typedef enum {
+    NEAT_WEIGHTS_FLOAT64,
+    NEAT_WEIGHTS_FLOAT32
+} neat_weight_format_t;
+
 /* Genome functions */
 neat_genome_t* neat_load_genome(FILE* fp);
+int neat_save_genome(FILE* fp, const neat_genome_t *genome, neat_weight_format_t format);
 void neat_free_genome(neat_genome_t *genome);
 neat_genome_t* neat_clone_genome(const neat_genome_t *genome);
+int neat_genome_relocate(neat_genome_t *genome);
 int neat_add_node(neat_genome_t *genome, neat_node_type_t type, 
                  neat_node_placement_t placement);
 int neat_add_connection(neat_genome_t *genome, int in_node, int out_node, 
@@ -177,6 +437,39 @@ void neat_speciate(neat_population_t *pop);
 void neat_remove_stale_species(neat_population_t *pop);
 void neat_remove_weak_species(neat_population_t *pop);
 void neat_reproduce(neat_population_t *pop);
+void neat_evolve_epoch(neat_population_t *pop);
+
+/* Multi-fidelity evaluation */
+int neat_top_fidelity(const neat_population_t *pop);
+void neat_evaluate_fidelity_ladder(neat_population_t *pop);
+
+/* Parallel evaluation */
+typedef double (*neat_evaluate_func_t)(neat_genome_t *genome, void *user_data);
+void neat_evaluate_parallel(neat_population_t *pop, neat_evaluate_func_t evaluate_func, 
+                            void *user_data, int num_threads);
+void neat_evolve_parallel(neat_population_t *pop, int num_threads);
+
+/* NUMA topology for sharded evaluation */
+neat_numa_t* neat_numa_create(void);
+void neat_numa_free(neat_numa_t *numa);
+int neat_numa_node_of_cpu(const neat_numa_t *numa, int cpu);
+
+/* Evaluation timeouts; the token is the calling thread's current evaluation (NULL outside one) */
+void neat_eval_timeout_init(neat_eval_timeout_t *timeout);
+const neat_eval_token_t* neat_eval_token(void);
+bool neat_eval_cancelled(void);
+double neat_eval_budget(void);
+
+/* Evaluation cost model */
+void neat_cost_model_init(neat_cost_model_t *model);
+double neat_cost_model_predict(const neat_cost_model_t *model, const neat_genome_t *genome);
+void neat_cost_model_update(neat_cost_model_t *model, neat_genome_t **genomes, size_t count);
+
+/* External evaluation (ask/tell) */
+int neat_ask(neat_population_t *pop, neat_genome_t ***genomes, size_t *count);
+int neat_tell(neat_population_t *pop, const int *ids, const double *fitnesses, size_t count);
+int neat_requeue(neat_population_t *pop);
+neat_genome_t* neat_find_genome(const neat_population_t *pop, int id);
 
 /* Innovation table functions */
 neat_innovation_table_t* neat_create_innovation_table(void);
@@ -199,6 +492,11 @@ double neat_abs(double x);
 double neat_random_uniform(double min, double max);
 double neat_random_normal(double mean, double stddev);
 int neat_random_int(int min, int max);
+void neat_srand(unsigned long seed);
+unsigned long neat_get_random_state(void);
+void neat_set_random_state(unsigned long state);
+double neat_get_time(void);
+double neat_stats_clock(const neat_population_t *pop);
 
 /* Activation functions */
 activation_func_t neat_get_activation_function(neat_activation_type_t type);
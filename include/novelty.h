@@ -97,11 +97,28 @@ typedef struct {
     size_t size;                /* Size of the behavior space */
 } population_stats_t;
 
+typedef struct novelty_search novelty_search_t;
+
+/* 
+ * Function pointer types for user-defined functions
+ */
+typedef void* (*novelty_alloc_func_t)(size_t size);
+typedef void (*novelty_free_func_t)(void* ptr);
+typedef float (*distance_func_t)(const float* a, const float* b, size_t size, void* user_data);
+typedef void (*behavior_func_t)(const void* individual, float* behavior, size_t size, void* user_data);
+typedef float (*fitness_func_t)(const void* individual, void* user_data);
+typedef int (*termination_func_t)(novelty_search_t* ns, void* user_data);
+typedef void (*mutation_func_t)(void* individual, float rate, void* user_data);
+typedef void* (*crossover_func_t)(const void* parent1, const void* parent2, void* user_data);
+typedef void* (*initialization_func_t)(size_t index, void* user_data);
+typedef void (*evaluation_func_t)(void* individual, float* fitness, float* behavior, size_t behavior_size, void* user_data);
+typedef void (*visualization_func_t)(novelty_search_t* ns, void* user_data);
+
 /* 
  * Novelty Search Context
  * Main structure for managing the novelty search
  */
-typedef struct {
+struct novelty_search {
     novelty_config_t config;    /* Configuration parameters */
     novelty_archive_t* archive; /* Archive of novel individuals */
     population_stats_t* stats;  /* Population statistics */
@@ -126,6 +143,7 @@ typedef struct {
     /* User-defined callback functions */
     novelty_alloc_func_t user_alloc_func;      /* Memory allocation function */
     novelty_free_func_t user_free_func;        /* Memory deallocation function */
+    neat_allocator_t allocator;                /* Adapter over user_alloc_func/user_free_func */
     distance_func_t user_distance_func;        /* Custom distance function */
     behavior_func_t user_behavior_func;        /* Behavior extraction function */
     fitness_func_t user_fitness_func;          /* Fitness evaluation function */
@@ -145,7 +163,6 @@ typedef struct {
     float avg_novelty;          /* Average novelty of current population */
     float* behavior_min_bounds; /* Minimum bounds for behavior space */
     float* behavior_max_bounds; /* Maximum bounds for behavior space */
-    int generation;             /* Current generation number */
     int max_generations;        /* Maximum number of generations to run */
     int num_evaluations;        /* Number of evaluations performed */
     int max_evaluations;        /* Maximum number of evaluations */
@@ -158,22 +175,7 @@ typedef struct {
     int checkpoint_count;       /* Number of checkpoints saved */
     double start_time;          /* Start time of search */
     double last_checkpoint;     /* Time of last checkpoint */
-} novelty_search_t;
-
-/* 
- * Function pointer types for user-defined functions
- */
-typedef void* (*novelty_alloc_func_t)(size_t size);
-typedef void (*novelty_free_func_t)(void* ptr);
-typedef float (*distance_func_t)(const float* a, const float* b, size_t size, void* user_data);
-typedef void (*behavior_func_t)(const void* individual, float* behavior, size_t size, void* user_data);
-typedef float (*fitness_func_t)(const void* individual, void* user_data);
-typedef int (*termination_func_t)(novelty_search_t* ns, void* user_data);
-typedef void (*mutation_func_t)(void* individual, float rate, void* user_data);
-typedef void* (*crossover_func_t)(const void* parent1, const void* parent2, void* user_data);
-typedef void* (*initialization_func_t)(size_t index, void* user_data);
-typedef void (*evaluation_func_t)(void* individual, float* fitness, float* behavior, size_t behavior_size, void* user_data);
-typedef void (*visualization_func_t)(novelty_search_t* ns, void* user_data);
+};
 
 /* 
  * Novelty Search API Functions
@@ -199,11 +201,12 @@ void novelty_archive_free(novelty_archive_t* archive);
 int novelty_archive_add(novelty_archive_t* archive, const behavior_t* behavior, float threshold);
 void novelty_archive_update(novelty_archive_t* archive, const behavior_t* behaviors, size_t count, float threshold);
 void novelty_archive_prune(novelty_archive_t* archive, size_t max_size);
-void novelty_archive_save(const novelty_archive_t* archive, const char* filename);
-int novelty_archive_load(novelty_archive_t* archive, const char* filename);
+int novelty_archive_save(const novelty_archive_t* archive, const char* filename);
+novelty_archive_t* novelty_archive_load(const char* filename);
 
 /* Novelty calculation */
 float calculate_novelty(const behavior_t* behavior, const novelty_archive_t* archive, size_t k, distance_func_t dist_func, void* user_data);
+/* Returns scores allocated with neat_calloc; release with neat_free */
 float* calculate_novelty_batch(const behavior_t* behaviors, size_t count, const novelty_archive_t* archive, size_t k, distance_func_t dist_func, void* user_data);
 void update_novelty_scores(novelty_search_t* ns, behavior_t* behaviors, size_t count);
 
@@ -247,7 +250,7 @@ void multi_archive_novelty_search(novelty_search_t** ns_array, size_t num_search
 /* Parallel evaluation */
 void parallel_evaluate(novelty_search_t* ns, void** population, size_t population_size, evaluation_func_t eval_func, void* user_data);
 
-/* Callbacks */
+/* Callbacks; alloc_func and free_func, when both set, back the memory novelty_search_step allocates */
 void novelty_search_set_callbacks(
     novelty_search_t* ns,
     novelty_alloc_func_t alloc_func,
@@ -258,6 +261,10 @@ void novelty_search_set_callbacks(
     void* user_data
 );
 
+/* Archive-tagged memory from the search's allocator: the user callbacks when set, else the caller's */
+void* novelty_alloc(novelty_search_t* ns, size_t size);
+void novelty_free(novelty_search_t* ns, void* ptr);
+
 /* Default configuration */
 novelty_config_t novelty_get_default_config(void);
 
@@ -265,8 +272,8 @@ novelty_config_t novelty_get_default_config(void);
 #define NOVELTY_MIN(a, b) ((a) < (b) ? (a) : (b))
 #define NOVELTY_MAX(a, b) ((a) > (b) ? (a) : (b))
 #define NOVELTY_CLAMP(x, min, max) ((x) < (min) ? (min) : ((x) > (max) ? (max) : (x)))
-#define NOVELTY_ALLOC(ns, type, count) ((type*)(ns)->alloc_func((count) * sizeof(type)))
-#define NOVELTY_FREE(ns, ptr) do { if ((ns)->free_func) (ns)->free_func(ptr); } while (0)
+#define NOVELTY_ALLOC(ns, type, count) ((type*)novelty_alloc((ns), (count) * sizeof(type)))
+#define NOVELTY_FREE(ns, ptr) novelty_free((ns), (ptr))
 
 /* Error codes */
 #define NOVELTY_SUCCESS 0
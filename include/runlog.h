@@ -0,0 +1,136 @@
+#ifndef RUNLOG_H
+#define RUNLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "neat.h"
+
+/*
+ * Run log
+ *
+ * An append-only binary log of a run's history. After the 16-byte file
+ * header the file is a sequence of chunks, and each chunk holds `count`
+ * fixed-size records of one kind for one generation. The records are
+ * stored column by column, so a reader can pull a single column without
+ * touching the others:
+ *
+ *   u32  magic         'NRLC'
+ *   u32  kind          NEAT_RUNLOG_GENERATION / _SPECIES / _GENOMES
+ *   u32  count         Records in the chunk
+ *   u32  payload size  Bytes of column data
+ *   i64  generation
+ *   ...  columns, each `count` values wide, in the field order of the
+ *        matching neat_runlog_*_t struct
+ *   u32  CRC-32C of the chunk header and columns
+ *
+ * Values are host-native, and the file header records the byte order.
+ * Every generation gets one chunk of each kind. A chunk that fails its
+ * checksum marks the end of the log, so a run that crashes while writing
+ * still leaves a readable log up to its last complete chunk. Reopening such
+ * a log truncates it to its last complete generation before appending.
+ *
+ * The evolution loop only copies values into a buffer. A background
+ * thread checksums the chunks and does the file writes.
+ */
+
+#define NEAT_RUNLOG_MAGIC       0x4E524C47  /* 'NRLG' */
+#define NEAT_RUNLOG_CHUNK_MAGIC 0x4E524C43  /* 'NRLC' */
+#define NEAT_RUNLOG_VERSION     1
+
+typedef enum {
+    NEAT_RUNLOG_GENERATION = 1,
+    NEAT_RUNLOG_SPECIES = 2,
+    NEAT_RUNLOG_GENOMES = 3
+} neat_runlog_kind_t;
+
+/* Per-generation summary, one record per generation chunk */
+typedef struct {
+    int32_t generation;
+    uint32_t genome_count;
+    uint32_t species_count;
+    uint32_t innovation_count;
+    double best_fitness;
+    double mean_fitness;
+    double min_fitness;
+    double stddev_fitness;
+    double max_fitness_achieved; /* Best fitness of the run so far */
+    double mean_nodes;
+    double mean_connections;
+    uint32_t max_nodes;
+    uint32_t max_connections;
+    double eval_time;           /* Wall seconds spent evaluating */
+    double eval_cpu_time;       /* Sum of per-genome evaluation times */
+    double speciate_time;       /* Wall seconds in speciation and fitness sharing */
+    double reproduce_time;      /* Wall seconds in culling and reproduction */
+    double log_time;            /* Seconds the evolution loop spent on the run log */
+} neat_runlog_generation_t;
+
+/* One species of a generation */
+typedef struct {
+    int32_t id;
+    uint32_t size;
+    double best_fitness;
+    double average_fitness;
+    int32_t staleness;
+} neat_runlog_species_t;
+
+/* One genome of a generation */
+typedef struct {
+    int32_t id;
+    int32_t parent1_id;
+    int32_t parent2_id;
+    int32_t species_id;
+    double fitness;
+    uint32_t node_count;
+    uint32_t connection_count;
+    double eval_time;
+} neat_runlog_genome_t;
+
+/* Buffer of encoded chunks handed from the evolution loop to the writer */
+typedef struct neat_runlog_block {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    struct neat_runlog_block *next;
+} neat_runlog_block_t;
+
+typedef struct neat_runlog {
+    FILE *fp;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    neat_runlog_block_t *queue;      /* Blocks waiting to be written, oldest first (guarded by lock) */
+    neat_runlog_block_t *queue_tail;
+    neat_runlog_block_t *free_blocks; /* Written blocks kept for reuse (guarded by lock) */
+    bool writing;               /* Writer thread busy (guarded by lock) */
+    bool stop;                  /* Shutdown requested (guarded by lock) */
+
+    /* Generation being recorded (evolution thread) */
+    neat_runlog_block_t *current;
+    neat_runlog_generation_t record; /* Summary, finished by neat_runlog_commit */
+    size_t record_offset;       /* Offset of the generation chunk in current */
+    void *scratch;              /* Row buffer for species and genome records */
+    size_t scratch_capacity;
+
+    /* Statistics (guarded by lock) */
+    size_t bytes_written;
+    int failed_writes;
+} neat_runlog_t;
+
+/* Lifecycle */
+neat_runlog_t* neat_runlog_open(const char *path);
+void neat_runlog_close(neat_runlog_t *log);
+void neat_runlog_flush(neat_runlog_t *log);
+
+/* Recording; called by the evolution loop after speciation and after reproduction */
+void neat_runlog_capture(neat_runlog_t *log, const neat_population_t *pop);
+void neat_runlog_commit(neat_runlog_t *log, const neat_population_t *pop);
+
+/* Reading */
+int neat_runlog_export_csv(const char *path, FILE *generations, FILE *species, FILE *genomes);
+
+#endif /* RUNLOG_H */
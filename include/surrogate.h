@@ -0,0 +1,72 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <stddef.h>
+#include "neat.h"
+
+/*
+ * Surrogate-assisted fitness prescreening
+ *
+ * A k-nearest-neighbour regressor over recently evaluated genomes predicts
+ * the fitness of new offspring. Distance is the NEAT compatibility distance
+ * plus a relative size term, and the neighbour estimate is blended with the
+ * parent's fitness. Only the best-predicted fraction of offspring, plus a
+ * random exploration quota, receive a real evaluation; the rest keep their
+ * prediction (capped below every real score of the generation). Elites are
+ * not prescreened: a carried-over champion is always evaluated for real, so
+ * a pessimistic prediction can never demote it.
+ */
+
+typedef struct {
+    size_t k;                   /* Neighbours used for a prediction */
+    size_t capacity;            /* Evaluated genomes kept as training data */
+    size_t min_samples;         /* Training samples required before prescreening */
+    double top_fraction;        /* Fraction of offspring always evaluated */
+    double explore_fraction;    /* Extra random offspring evaluated per generation */
+    double parent_weight;       /* Weight of parent fitness in the prediction */
+    double size_coeff;          /* Weight of the relative size difference in distance */
+} neat_surrogate_config_t;
+
+/* Prescreening quality; positives are offspring at least as fit as their parent */
+typedef struct {
+    size_t candidates;          /* Offspring considered (elites excluded) */
+    size_t elites;              /* Carried-over champions, always evaluated */
+    size_t evaluated;           /* Offspring given a real evaluation */
+    size_t skipped;             /* Offspring that kept their predicted fitness */
+    size_t true_positives;      /* Promoted and actually good */
+    size_t false_positives;     /* Promoted but not good */
+    size_t false_negatives;     /* Explored from the rejected set and actually good */
+    size_t explored;            /* Rejected offspring evaluated for exploration */
+    double precision;           /* TP / (TP + FP) */
+    double recall;              /* TP / (TP + estimated FN over all rejected) */
+    double mean_abs_error;      /* Mean |predicted - real| over real evaluations */
+} neat_surrogate_stats_t;
+
+typedef struct neat_surrogate {
+    neat_surrogate_config_t config;
+    neat_genome_t** samples;    /* Ring buffer of evaluated genome clones */
+    double* sample_fitness;     /* Real fitness of each sample */
+    size_t sample_count;        /* Samples currently stored */
+    size_t next_slot;           /* Ring buffer write position */
+    neat_surrogate_stats_t last_stats;  /* Stats of the most recent generation */
+    neat_surrogate_stats_t total_stats; /* Counts accumulated over the run */
+} neat_surrogate_t;
+
+/* Configuration */
+neat_surrogate_config_t neat_surrogate_default_config(void);
+
+/* Lifecycle */
+neat_surrogate_t* neat_surrogate_create(const neat_surrogate_config_t* config);
+void neat_surrogate_free(neat_surrogate_t* surrogate);
+
+/* Model */
+double neat_surrogate_predict(const neat_surrogate_t* surrogate, const neat_genome_t* genome);
+void neat_surrogate_train(neat_surrogate_t* surrogate, const neat_genome_t* genome, double fitness);
+
+/* Evaluate a population's current generation through the prescreening stage */
+void neat_surrogate_evaluate(neat_population_t* pop, neat_surrogate_t* surrogate);
+
+/* Reporting */
+void neat_surrogate_print_stats(const neat_surrogate_t* surrogate, FILE* fp);
+
+#endif /* SURROGATE_H */
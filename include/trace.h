@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Trace events
+ *
+ * An optional process-wide tracer that writes Chrome trace-event JSON,
+ * which chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+ * The library marks per-genome evaluations, the phases of each generation,
+ * novelty kNN searches and HyperNEAT substrate construction.
+ *
+ * neat_trace_begin records a start time on a small per-thread stack and
+ * neat_trace_end turns it into one complete ("X") event in the calling
+ * thread's ring buffer. A thread only ever writes its own buffer, and the
+ * flush reads it through an acquire/release head and tail, so recording
+ * takes no locks. When a buffer is full, new spans are dropped and counted
+ * rather than blocking the thread. neat_evolve_epoch flushes every buffer
+ * to the file at the end of each generation.
+ *
+ * Span names are stored by pointer and must outlive the trace (string
+ * literals). While no trace is running, begin and end return after one
+ * relaxed atomic load; building with -DNEAT_ENABLE_TRACE=0 removes the
+ * library's own spans entirely.
+ */
+
+#ifndef NEAT_ENABLE_TRACE
+#define NEAT_ENABLE_TRACE 1
+#endif
+
+#define NEAT_TRACE_BUFFER_EVENTS 65536  /* Default events per thread buffer */
+#define NEAT_TRACE_MAX_DEPTH     32     /* Nested open spans per thread */
+#define NEAT_TRACE_NO_ARG        INT64_MIN
+
+/* Lifecycle; neat_trace_stop must not race with threads that are still tracing */
+int neat_trace_start(const char *path, size_t buffer_events);
+void neat_trace_stop(void);
+bool neat_trace_enabled(void);
+
+/* Recording */
+void neat_trace_begin(const char *name, int64_t arg);
+void neat_trace_end(void);
+void neat_trace_thread_name(const char *name);
+
+/* Output */
+void neat_trace_flush(void);
+size_t neat_trace_dropped(void);
+
+#if NEAT_ENABLE_TRACE
+#define NEAT_TRACE_BEGIN(name, arg) neat_trace_begin((name), (arg))
+#define NEAT_TRACE_END() neat_trace_end()
+#else
+#define NEAT_TRACE_BEGIN(name, arg) ((void)0)
+#define NEAT_TRACE_END() ((void)0)
+#endif
+
+#endif /* TRACE_H */
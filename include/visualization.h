@@ -4,13 +4,90 @@
 #include <SDL2/SDL.h>
 #include "../include/neat.h"
 
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+#error "The visualizer needs SDL 2.0.18 or later for SDL_RenderGeometry"
+#endif
+
+/*
+ * Rendering backends
+ *
+ * A window backend draws to an SDL window and needs a display. The headless
+ * backend draws with SDL's software renderer into an in-memory RGBA32
+ * framebuffer instead, so every neat_draw_* and neat_visualize_* function
+ * also works on machines without a display server, and frames can be read
+ * back or dumped to files. NEAT_VIS_AUTO opens a window when it can and
+ * falls back to headless otherwise.
+ */
+typedef enum {
+    NEAT_VIS_WINDOW,
+    NEAT_VIS_HEADLESS,
+    NEAT_VIS_AUTO
+} neat_vis_backend_t;
+
+/*
+ * Geometry batch
+ *
+ * Rectangles, circles, lines and text are not drawn one renderer call at a
+ * time. They are queued as triangles (a quad per rectangle, line, glyph
+ * or row of a circle) and drawn with a single SDL_RenderGeometry call
+ * when the batch is flushed: before anything that must see the drawn pixels
+ * (present, pixel reads, frame dumps) and before drawing that does not go
+ * through the batch. Text samples a glyph atlas; shapes sample its white
+ * texel, so both share a batch and only a change of font size flushes.
+ */
+typedef struct {
+    SDL_Vertex* vertices;
+    int vertex_count;
+    int vertex_capacity;
+    int* indices;               /* Triangle list into vertices */
+    int index_count;
+    int index_capacity;
+    SDL_Texture* texture;       /* Atlas being sampled (NULL before any text) */
+    SDL_FPoint white;           /* Texture coordinates of its white texel */
+} neat_vis_batch_t;
+
+/*
+ * Glyph atlas
+ *
+ * One texture per font size holding the printable ASCII glyphs, rendered in
+ * white and tinted by vertex color, so a string is drawn as one textured
+ * quad per character with no per-call font rendering or texture uploads.
+ * Atlases are built on first use of a size and kept until the visualizer
+ * is destroyed.
+ */
+#define NEAT_VIS_GLYPH_FIRST    32
+#define NEAT_VIS_GLYPH_COUNT    95  /* ' ' to '~' */
+
+typedef struct {
+    SDL_Rect rect;              /* Source rectangle in the atlas */
+    int offset_x;               /* Left edge relative to the pen (a negative bearing starts left of it) */
+    int advance;                /* Pen movement after the glyph */
+} neat_vis_glyph_t;
+
+typedef struct {
+    int size;                   /* Point size */
+    SDL_Texture* texture;       /* NULL if no font could be opened at this size */
+    int width;
+    int height;
+    SDL_FPoint white;           /* Center of the white block, in texture coordinates */
+    neat_vis_glyph_t glyphs[NEAT_VIS_GLYPH_COUNT];
+} neat_vis_atlas_t;
+
 /* Visualization context */
 typedef struct {
-    SDL_Window* window;
+    SDL_Window* window;         /* NULL when headless */
     SDL_Renderer* renderer;
+    SDL_Surface* framebuffer;   /* Headless render target, RGBA32 (NULL with a window) */
+    neat_vis_backend_t backend; /* NEAT_VIS_WINDOW or NEAT_VIS_HEADLESS once created */
     int width;
     int height;
     int is_running;
+    int frames_dumped;          /* Frames written by neat_visualizer_dump_frame */
+    neat_vis_batch_t batch;     /* Geometry queued since the last flush */
+    neat_vis_atlas_t* atlases;  /* One per font size drawn so far */
+    int atlas_count;
+    int atlas_capacity;
+    const char* font_path;      /* Font tried before the system fonts (NULL for none); set before drawing text */
 } neat_visualizer_t;
 
 /* Color structure */
@@ -20,11 +97,14 @@ typedef struct {
 
 /* Visualization functions */
 neat_visualizer_t* neat_visualizer_create(const char* title, int width, int height);
+neat_visualizer_t* neat_visualizer_create_with_backend(const char* title, int width, int height,
+                                                       neat_vis_backend_t backend);
 void neat_visualizer_destroy(neat_visualizer_t* vis);
 int neat_visualizer_is_running(neat_visualizer_t* vis);
 void neat_visualizer_handle_events(neat_visualizer_t* vis);
 void neat_visualizer_clear(neat_visualizer_t* vis, neat_color_t color);
 void neat_visualizer_present(neat_visualizer_t* vis);
+void neat_visualizer_flush(neat_visualizer_t* vis);
 
 /* Drawing functions */
 void neat_draw_rect(neat_visualizer_t* vis, int x, int y, int w, int h, neat_color_t color);
@@ -72,6 +152,10 @@ void neat_interactive_explorer(neat_visualizer_t* vis, neat_population_t* pop);
 /* Save visualization to file */
 int neat_save_screenshot(neat_visualizer_t* vis, const char* filename);
 
+/* Headless frame access */
+const Uint8* neat_visualizer_framebuffer(neat_visualizer_t* vis, int* pitch);
+int neat_visualizer_dump_frame(neat_visualizer_t* vis, const char* prefix);
+
 /* Animation recording */
 typedef struct {
     char** frames;
@@ -0,0 +1,1507 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/checkpoint.h"
+#include "../include/genome_io.h"
+
+#define CHECKPOINT_ENDIAN_TAG 0x01020304u
+
+/* File header; all section offsets are from the start of the file */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t header_size;
+    uint32_t node_size;
+    uint32_t connection_size;
+    uint32_t innovation_size;
+    uint32_t genome_record_size;
+    uint32_t species_record_size;
+    uint32_t cost_model_size;
+    uint64_t file_size;
+
+    /* Population state */
+    uint64_t genome_count;
+    uint64_t species_count;
+    uint64_t population_size;
+    int64_t generation;
+    int64_t next_genome_id;
+    double max_fitness_achieved;
+    uint64_t rng_state;
+    uint64_t ask_batch_size;
+    uint64_t ask_cursor;
+    uint64_t tell_count;
+    int32_t fidelity_levels;
+    int32_t reserved;
+    double fidelity_promote_fraction;
+    neat_cost_model_t cost_model;
+
+    /* Innovation table state */
+    uint64_t innovation_count;
+    int64_t next_innovation;
+    int64_t next_node_id;
+    int64_t next_species_id;
+
+    /* Sections */
+    uint64_t total_nodes;
+    uint64_t total_connections;
+    uint64_t total_members;
+    uint64_t genome_table_offset;
+    uint64_t node_offset;
+    uint64_t connection_offset;
+    uint64_t species_table_offset;
+    uint64_t member_offset;
+    uint64_t innovation_offset;
+
+    uint32_t body_crc;          /* CRC-32C of everything after the header */
+    uint32_t header_crc;        /* CRC-32C of the header up to this field */
+} checkpoint_header_t;
+
+/* Genome table entry; genes are indices into the node and connection sections */
+typedef struct {
+    int32_t id;
+    int32_t species_id;
+    int32_t global_rank;
+    int32_t fidelity;
+    int32_t parent1_id;
+    int32_t parent2_id;
+    double fitness;
+    double adjusted_fitness;
+    double eval_time;
+    double parent_eval_time;
+    double parent_fitness;
+    uint64_t node_index;
+    uint64_t node_count;
+    uint64_t connection_index;
+    uint64_t connection_count;
+    uint8_t evaluated;
+    uint8_t elite;
+    uint8_t padding[6];
+} checkpoint_genome_t;
+
+/* Species table entry; members are indices into the genome table */
+typedef struct {
+    int32_t id;
+    int32_t staleness;
+    int32_t age;
+    int32_t padding;
+    double best_fitness;
+    double average_fitness;
+    uint64_t member_index;
+    uint64_t member_count;
+    int64_t representative;     /* Genome index, or -1 */
+    int64_t champion;           /* Genome index, or -1 */
+} checkpoint_species_t;
+
+/* Genome pointer to table index, for resolving species members */
+typedef struct {
+    const neat_genome_t *genome;
+    uint64_t index;
+} checkpoint_ref_t;
+
+/*
+ * Sequential writer that tracks the offset. With a stream sink the body
+ * checksum is maintained as bytes go out; with a memory sink bytes are
+ * copied into a preallocated image; with neither only sizes are computed.
+ */
+typedef struct {
+    FILE *fp;
+    uint8_t *buffer;
+    uint64_t offset;
+    uint32_t crc;
+    bool ok;
+} checkpoint_writer_t;
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + NEAT_CHECKPOINT_ALIGN - 1) & ~(uint64_t)(NEAT_CHECKPOINT_ALIGN - 1);
+}
+
+static void writer_put(checkpoint_writer_t *w, const void *data, size_t size) {
+    if (!w->ok || size == 0) return;
+    if (w->fp) {
+        if (fwrite(data, 1, size, w->fp) != size) {
+            w->ok = false;
+            return;
+        }
+        w->crc = neat_crc32c(w->crc, data, size);
+    } else if (w->buffer) {
+        memcpy(w->buffer + w->offset, data, size);
+    }
+    w->offset += size;
+}
+
+static void writer_pad(checkpoint_writer_t *w) {
+    static const uint8_t zeros[NEAT_CHECKPOINT_ALIGN];
+    writer_put(w, zeros, align_up(w->offset) - w->offset);
+}
+
+static int compare_refs(const void *a, const void *b) {
+    uintptr_t pa = (uintptr_t)((const checkpoint_ref_t*)a)->genome;
+    uintptr_t pb = (uintptr_t)((const checkpoint_ref_t*)b)->genome;
+    return (pa > pb) - (pa < pb);
+}
+
+/* Genome pointers of the population sorted for lookup */
+static checkpoint_ref_t* checkpoint_refs_build(const neat_population_t *pop) {
+    size_t n = pop->genome_count;
+    checkpoint_ref_t *refs = (checkpoint_ref_t*)neat_malloc((n > 0 ? n : 1) * sizeof(checkpoint_ref_t));
+    for (size_t i = 0; i < n; i++) {
+        refs[i].genome = pop->genomes[i];
+        refs[i].index = i;
+    }
+    qsort(refs, n, sizeof(checkpoint_ref_t), compare_refs);
+    return refs;
+}
+
+static int64_t find_ref(const checkpoint_ref_t *refs, size_t count, const neat_genome_t *genome) {
+    if (!genome) return -1;
+    checkpoint_ref_t key = { genome, 0 };
+    const checkpoint_ref_t *found = (const checkpoint_ref_t*)bsearch(&key, refs, count, sizeof(checkpoint_ref_t), compare_refs);
+    return found ? (int64_t)found->index : -1;
+}
+
+/*
+ * Emit the whole checkpoint layout through the writer. The header is
+ * emitted as a placeholder and returned in `header`, complete except for
+ * the checksums of a non-stream sink and the header checksum.
+ */
+static void checkpoint_emit(const neat_population_t *pop, const checkpoint_ref_t *refs,
+                            checkpoint_writer_t *w, checkpoint_header_t *header) {
+    const neat_innovation_table_t *table = pop->innovation_table;
+    size_t n = pop->genome_count;
+
+    memset(header, 0, sizeof(*header));
+    header->magic = NEAT_CHECKPOINT_MAGIC;
+    header->version = NEAT_CHECKPOINT_VERSION;
+    header->endian_tag = CHECKPOINT_ENDIAN_TAG;
+    header->header_size = sizeof(checkpoint_header_t);
+    header->node_size = sizeof(neat_node_t);
+    header->connection_size = sizeof(neat_connection_t);
+    header->innovation_size = sizeof(neat_innovation_t);
+    header->genome_record_size = sizeof(checkpoint_genome_t);
+    header->species_record_size = sizeof(checkpoint_species_t);
+    header->cost_model_size = sizeof(neat_cost_model_t);
+
+    header->genome_count = n;
+    header->species_count = pop->species_count;
+    header->population_size = pop->population_size;
+    header->generation = pop->generation;
+    header->next_genome_id = pop->next_genome_id;
+    header->max_fitness_achieved = pop->max_fitness_achieved;
+    header->rng_state = neat_get_random_state();
+    header->ask_batch_size = pop->ask_batch_size;
+    header->ask_cursor = pop->ask_cursor;
+    header->tell_count = pop->tell_count;
+    header->fidelity_levels = pop->fidelity_levels;
+    header->fidelity_promote_fraction = pop->fidelity_promote_fraction;
+    header->cost_model = pop->cost_model;
+
+    header->innovation_count = table->count;
+    header->next_innovation = table->next_innovation;
+    header->next_node_id = table->next_node_id;
+    header->next_species_id = table->next_species_id;
+
+    for (size_t i = 0; i < n; i++) {
+        header->total_nodes += pop->genomes[i]->node_count;
+        header->total_connections += pop->genomes[i]->connection_count;
+    }
+
+    /* Placeholder header, rewritten once offsets and checksums are known */
+    writer_put(w, header, sizeof(*header));
+    writer_pad(w);
+    w->crc = 0;
+
+    /* Genome table */
+    header->genome_table_offset = w->offset;
+    uint64_t node_index = 0, connection_index = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_genome_t *genome = pop->genomes[i];
+        checkpoint_genome_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.id = genome->id;
+        rec.species_id = genome->species_id;
+        rec.global_rank = genome->global_rank;
+        rec.fidelity = genome->fidelity;
+        rec.parent1_id = genome->parent1_id;
+        rec.parent2_id = genome->parent2_id;
+        rec.fitness = genome->fitness;
+        rec.adjusted_fitness = genome->adjusted_fitness;
+        rec.eval_time = genome->eval_time;
+        rec.parent_eval_time = genome->parent_eval_time;
+        rec.parent_fitness = genome->parent_fitness;
+        rec.node_index = node_index;
+        rec.node_count = genome->node_count;
+        rec.connection_index = connection_index;
+        rec.connection_count = genome->connection_count;
+        rec.evaluated = genome->evaluated ? 1 : 0;
+        rec.elite = genome->elite ? 1 : 0;
+        writer_put(w, &rec, sizeof(rec));
+        node_index += genome->node_count;
+        connection_index += genome->connection_count;
+    }
+    writer_pad(w);
+
+    /* Gene sections */
+    header->node_offset = w->offset;
+    for (size_t i = 0; i < n; i++) {
+        writer_put(w, pop->genomes[i]->nodes, pop->genomes[i]->node_count * sizeof(neat_node_t));
+    }
+    writer_pad(w);
+    header->connection_offset = w->offset;
+    for (size_t i = 0; i < n; i++) {
+        writer_put(w, pop->genomes[i]->connections, pop->genomes[i]->connection_count * sizeof(neat_connection_t));
+    }
+    writer_pad(w);
+
+    /* Species table */
+    header->species_table_offset = w->offset;
+    uint64_t member_index = 0;
+    for (size_t s = 0; s < pop->species_count; s++) {
+        const neat_species_t *species = pop->species[s];
+        checkpoint_species_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.id = species->id;
+        rec.staleness = species->staleness;
+        rec.age = species->age;
+        rec.best_fitness = species->best_fitness;
+        rec.average_fitness = species->average_fitness;
+        rec.member_index = member_index;
+        for (size_t m = 0; m < species->member_count; m++) {
+            if (find_ref(refs, n, species->members[m]) >= 0) rec.member_count++;
+        }
+        rec.representative = find_ref(refs, n, species->representative);
+        rec.champion = find_ref(refs, n, species->champion);
+        writer_put(w, &rec, sizeof(rec));
+        member_index += rec.member_count;
+    }
+    header->total_members = member_index;
+    writer_pad(w);
+
+    /* Species members */
+    header->member_offset = w->offset;
+    for (size_t s = 0; s < pop->species_count; s++) {
+        const neat_species_t *species = pop->species[s];
+        for (size_t m = 0; m < species->member_count; m++) {
+            int64_t index = find_ref(refs, n, species->members[m]);
+            if (index >= 0) {
+                uint64_t value = (uint64_t)index;
+                writer_put(w, &value, sizeof(value));
+            }
+        }
+    }
+    writer_pad(w);
+
+    /* Innovation table */
+    header->innovation_offset = w->offset;
+    writer_put(w, table->innovations, table->count * sizeof(neat_innovation_t));
+    writer_pad(w);
+
+    header->file_size = w->offset;
+    header->body_crc = w->crc;
+}
+
+static void checkpoint_seal(checkpoint_header_t *header) {
+    header->header_crc = neat_crc32c(0, header, offsetof(checkpoint_header_t, header_crc));
+}
+
+/* Flush, sync and close a temp file, then rename it over `path` if all went well */
+static int checkpoint_commit(FILE *fp, bool ok, const char *tmp_path, const char *path) {
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) ok = false;
+    if (fclose(fp) != 0) ok = false;
+
+    if (ok && rename(tmp_path, path) != 0) ok = false;
+    if (!ok) remove(tmp_path);
+    return ok ? 1 : 0;
+}
+
+static char* checkpoint_tmp_path(const char *path) {
+    size_t len = strlen(path) + 5;
+    char *tmp_path = (char*)neat_malloc(len);
+    snprintf(tmp_path, len, "%s.tmp", path);
+    return tmp_path;
+}
+
+/*
+ * Write the population to `path`. The file is written next to the target
+ * and renamed over it, so an interrupted save never leaves a torn
+ * checkpoint. Returns 1 on success, 0 on failure.
+ */
+int neat_population_save(const neat_population_t *pop, const char *path) {
+    if (!pop || !path) return 0;
+
+    char *tmp_path = checkpoint_tmp_path(path);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        neat_free(tmp_path);
+        return 0;
+    }
+
+    checkpoint_ref_t *refs = checkpoint_refs_build(pop);
+    checkpoint_writer_t w = { fp, NULL, 0, 0, true };
+    checkpoint_header_t header;
+    checkpoint_emit(pop, refs, &w, &header);
+    checkpoint_seal(&header);
+
+    if (w.ok && (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, fp) != 1)) {
+        w.ok = false;
+    }
+    int ok = checkpoint_commit(fp, w.ok, tmp_path, path);
+
+    neat_free(tmp_path);
+    neat_free(refs);
+    return ok;
+}
+
+/* Scalar population state and the RNG */
+static void checkpoint_apply_state(neat_population_t *pop, const checkpoint_header_t *h) {
+    pop->population_size = h->population_size;
+    pop->generation = (int)h->generation;
+    pop->next_genome_id = (int)h->next_genome_id;
+    pop->max_fitness_achieved = h->max_fitness_achieved;
+    pop->ask_batch_size = h->ask_batch_size;
+    pop->ask_cursor = h->ask_cursor;
+    pop->tell_count = h->tell_count;
+    pop->fidelity_levels = h->fidelity_levels;
+    pop->fidelity_promote_fraction = h->fidelity_promote_fraction;
+    pop->cost_model = h->cost_model;
+    neat_set_random_state((unsigned long)h->rng_state);
+}
+
+/* Rebuild the species array from validated species records */
+static void checkpoint_restore_species(neat_population_t *pop, const checkpoint_species_t *species_table,
+                                       uint64_t species_count, const uint64_t *members) {
+    pop->species_capacity = species_count > NEAT_DEFAULT_ALLOC_SIZE ? species_count : NEAT_DEFAULT_ALLOC_SIZE;
+    pop->species = (neat_species_t**)neat_malloc_tagged(NEAT_MEM_SPECIES, pop->species_capacity * sizeof(neat_species_t*));
+    for (uint64_t s = 0; s < species_count; s++) {
+        const checkpoint_species_t *rec = &species_table[s];
+        neat_species_t *species = neat_create_species(rec->id);
+        species->staleness = rec->staleness;
+        species->age = rec->age;
+        species->best_fitness = rec->best_fitness;
+        species->average_fitness = rec->average_fitness;
+        if (rec->member_count > species->member_capacity) {
+            species->member_capacity = rec->member_count;
+            species->members = (neat_genome_t**)neat_realloc(species->members, species->member_capacity * sizeof(neat_genome_t*));
+        }
+        for (uint64_t m = 0; m < rec->member_count; m++) {
+            species->members[m] = pop->genomes[members[rec->member_index + m]];
+        }
+        species->member_count = rec->member_count;
+        species->representative = rec->representative >= 0 ? pop->genomes[rec->representative] : NULL;
+        species->champion = rec->champion >= 0 ? pop->genomes[rec->champion] : NULL;
+        pop->species[s] = species;
+    }
+    pop->species_count = species_count;
+}
+
+static bool section_fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t file_size) {
+    if (offset > file_size) return false;
+    return count <= (file_size - offset) / (size ? size : 1);
+}
+
+/* Written by a compatible build: same version, byte order and struct sizes */
+static bool checkpoint_layout_valid(const checkpoint_header_t *h) {
+    return h->magic == NEAT_CHECKPOINT_MAGIC && h->version == NEAT_CHECKPOINT_VERSION &&
+           h->endian_tag == CHECKPOINT_ENDIAN_TAG && h->header_size == sizeof(checkpoint_header_t) &&
+           h->node_size == sizeof(neat_node_t) && h->connection_size == sizeof(neat_connection_t) &&
+           h->innovation_size == sizeof(neat_innovation_t) &&
+           h->genome_record_size == sizeof(checkpoint_genome_t) &&
+           h->species_record_size == sizeof(checkpoint_species_t) &&
+           h->cost_model_size == sizeof(neat_cost_model_t);
+}
+
+static bool checkpoint_header_valid(const checkpoint_header_t *h, uint64_t file_size) {
+    if (!checkpoint_layout_valid(h)) return false;
+    if (h->header_crc != neat_crc32c(0, h, offsetof(checkpoint_header_t, header_crc)) ||
+        h->file_size != file_size) {
+        return false;
+    }
+
+    /* Every section and every alignment boundary must lie inside the file */
+    return section_fits(h->genome_table_offset, h->genome_count, sizeof(checkpoint_genome_t), file_size) &&
+           section_fits(h->node_offset, h->total_nodes, sizeof(neat_node_t), file_size) &&
+           section_fits(h->connection_offset, h->total_connections, sizeof(neat_connection_t), file_size) &&
+           section_fits(h->species_table_offset, h->species_count, sizeof(checkpoint_species_t), file_size) &&
+           section_fits(h->member_offset, h->total_members, sizeof(uint64_t), file_size) &&
+           section_fits(h->innovation_offset, h->innovation_count, sizeof(neat_innovation_t), file_size) &&
+           h->genome_table_offset % NEAT_CHECKPOINT_ALIGN == 0 && h->node_offset % NEAT_CHECKPOINT_ALIGN == 0 &&
+           h->connection_offset % NEAT_CHECKPOINT_ALIGN == 0 && h->species_table_offset % NEAT_CHECKPOINT_ALIGN == 0 &&
+           h->member_offset % NEAT_CHECKPOINT_ALIGN == 0 && h->innovation_offset % NEAT_CHECKPOINT_ALIGN == 0;
+}
+
+static bool checkpoint_species_valid(const checkpoint_species_t *species_table, uint64_t species_count,
+                                     const uint64_t *members, uint64_t total_members, uint64_t genome_count) {
+    for (uint64_t s = 0; s < species_count; s++) {
+        const checkpoint_species_t *rec = &species_table[s];
+        if (rec->member_index > total_members || rec->member_count > total_members - rec->member_index ||
+            rec->representative >= (int64_t)genome_count || rec->champion >= (int64_t)genome_count) {
+            return false;
+        }
+        for (uint64_t m = 0; m < rec->member_count; m++) {
+            if (members[rec->member_index + m] >= genome_count) return false;
+        }
+    }
+    return true;
+}
+
+
+/*
+ * Restore a population saved by neat_population_save. Gene arrays are not
+ * copied: the file is mapped privately (copy-on-write), genomes point into
+ * the mapping, and the population keeps it until neat_free_population.
+ * Returns NULL if the file is missing, corrupted or from an incompatible build.
+ */
+neat_population_t* neat_population_load(const char *path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(checkpoint_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t file_size = (size_t)st.st_size;
+    uint8_t *base = (uint8_t*)mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    const checkpoint_header_t *h = (const checkpoint_header_t*)base;
+    if (!checkpoint_header_valid(h, file_size) ||
+        neat_crc32c(0, base + h->genome_table_offset, file_size - h->genome_table_offset) != h->body_crc) {
+        munmap(base, file_size);
+        return NULL;
+    }
+
+    const checkpoint_genome_t *genome_table = (const checkpoint_genome_t*)(base + h->genome_table_offset);
+    const checkpoint_species_t *species_table = (const checkpoint_species_t*)(base + h->species_table_offset);
+    const uint64_t *members = (const uint64_t*)(base + h->member_offset);
+    neat_node_t *nodes = (neat_node_t*)(base + h->node_offset);
+    neat_connection_t *connections = (neat_connection_t*)(base + h->connection_offset);
+
+    /* Validate the index tables before adopting anything */
+    for (uint64_t i = 0; i < h->genome_count; i++) {
+        const checkpoint_genome_t *rec = &genome_table[i];
+        if (rec->node_index > h->total_nodes || rec->node_count > h->total_nodes - rec->node_index ||
+            rec->connection_index > h->total_connections ||
+            rec->connection_count > h->total_connections - rec->connection_index) {
+            munmap(base, file_size);
+            return NULL;
+        }
+    }
+    if (!checkpoint_species_valid(species_table, h->species_count, members, h->total_members, h->genome_count)) {
+        munmap(base, file_size);
+        return NULL;
+    }
+
+    neat_population_t *pop = (neat_population_t*)neat_calloc(1, sizeof(neat_population_t));
+    checkpoint_apply_state(pop, h);
+    pop->allocator = neat_current_allocator();
+    pop->stats_level = NEAT_STATS_PHASES;
+    neat_eval_timeout_init(&pop->eval_timeout);
+    pop->mapping = base;
+    pop->mapping_size = file_size;
+
+    /* Genomes adopt their slices of the gene sections */
+    pop->genome_capacity = h->genome_count > h->population_size ? h->genome_count : h->population_size;
+    if (pop->genome_capacity == 0) pop->genome_capacity = 1;
+    pop->genomes = (neat_genome_t**)neat_malloc_tagged(NEAT_MEM_GENOMES, pop->genome_capacity * sizeof(neat_genome_t*));
+    for (uint64_t i = 0; i < h->genome_count; i++) {
+        const checkpoint_genome_t *rec = &genome_table[i];
+        neat_genome_t *genome = (neat_genome_t*)neat_calloc_tagged(NEAT_MEM_GENOMES, 1, sizeof(neat_genome_t));
+        genome->id = rec->id;
+        genome->species_id = rec->species_id;
+        genome->global_rank = rec->global_rank;
+        genome->fidelity = rec->fidelity;
+        genome->parent1_id = rec->parent1_id;
+        genome->parent2_id = rec->parent2_id;
+        genome->fitness = rec->fitness;
+        genome->adjusted_fitness = rec->adjusted_fitness;
+        genome->eval_time = rec->eval_time;
+        genome->parent_eval_time = rec->parent_eval_time;
+        genome->parent_fitness = rec->parent_fitness;
+        genome->evaluated = rec->evaluated != 0;
+        genome->elite = rec->elite != 0;
+        genome->nodes = nodes + rec->node_index;
+        genome->node_count = rec->node_count;
+        genome->node_capacity = rec->node_count;
+        genome->connections = connections + rec->connection_index;
+        genome->connection_count = rec->connection_count;
+        genome->connection_capacity = rec->connection_count;
+        genome->mapped = true;
+        pop->genomes[i] = genome;
+    }
+    pop->genome_count = h->genome_count;
+
+    /* Species */
+    checkpoint_restore_species(pop, species_table, h->species_count, members);
+
+    /* Innovation table */
+    neat_innovation_table_t *table = neat_create_innovation_table();
+    if (h->innovation_count > table->capacity) {
+        table->capacity = h->innovation_count;
+        table->innovations = (neat_innovation_t*)neat_realloc(table->innovations, table->capacity * sizeof(neat_innovation_t));
+    }
+    memcpy(table->innovations, base + h->innovation_offset, h->innovation_count * sizeof(neat_innovation_t));
+    table->count = h->innovation_count;
+    table->next_innovation = (int)h->next_innovation;
+    table->next_node_id = (int)h->next_node_id;
+    table->next_species_id = (int)h->next_species_id;
+    pop->innovation_table = table;
+
+    return pop;
+}
+
+/*
+ * Delta checkpoints
+ *
+ * A delta file stands for the full checkpoint of one generation, written
+ * against the checkpoint of the generation before it. Every genome is
+ * stored as the gene edits that turn one of its parents (whichever gives
+ * the shorter record) into it: unchanged genes cost nothing, a changed gene
+ * costs its index, a field mask and the changed fields, and genes past the
+ * parent's length are stored whole. Species, new innovation table entries
+ * and the header state are stored as they are.
+ *
+ *   checkpoint_delta_header_t
+ *   ...  payload
+ *   u32  CRC-32C of the header and the payload
+ */
+#define CHECKPOINT_DELTA_MAGIC 0x4E444C54u  /* 'NDLT' */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t generation;
+    int64_t base_generation;
+    uint64_t payload_size;
+    checkpoint_header_t state;  /* Header of the checkpoint this delta stands for */
+} checkpoint_delta_header_t;
+
+/* Genome record flags */
+#define DELTA_GENOME_EVALUATED 0x01
+#define DELTA_GENOME_HAS_BASE  0x02 /* Genes are edits of a previous-generation genome */
+#define DELTA_GENOME_PARENT2   0x04 /* The base is parent2 rather than parent1 */
+#define DELTA_GENOME_ELITE     0x08
+
+/* Edit masks */
+#define DELTA_NODE_ALL         0xFF
+#define DELTA_CONN_INNOVATION  0x01
+#define DELTA_CONN_IN          0x02
+#define DELTA_CONN_OUT         0x04
+#define DELTA_CONN_WEIGHT      0x08
+#define DELTA_CONN_ENABLED     0x10 /* Enabled flag changed; its value is DELTA_CONN_ENABLED_SET */
+#define DELTA_CONN_ENABLED_SET 0x20
+#define DELTA_CONN_ALL         0x1F
+
+/* Real-valued genome fields, each coded as zero, unchanged from the base, or raw */
+#define DELTA_REAL_COUNT 5
+enum { DELTA_REAL_ZERO = 0, DELTA_REAL_BASE = 1, DELTA_REAL_RAW = 2 };
+
+/* Growable output buffer */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} delta_buffer_t;
+
+/* Bounded input cursor; `ok` turns false on the first overrun */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
+} delta_reader_t;
+
+/* Genome ID to table index, sorted by ID */
+typedef struct {
+    int32_t id;
+    uint64_t index;
+} delta_id_t;
+
+/* The parts of a genome a delta is computed over, from an image or a live genome */
+typedef struct {
+    const neat_node_t *nodes;
+    size_t node_count;
+    const neat_connection_t *connections;
+    size_t connection_count;
+    double reals[DELTA_REAL_COUNT];
+} delta_genome_view_t;
+
+static uint8_t* delta_reserve(delta_buffer_t *b, size_t size) {
+    if (b->size + size > b->capacity) {
+        b->capacity = (b->size + size) * 2;
+        b->data = (uint8_t*)neat_realloc(b->data, b->capacity);
+    }
+    return b->data + b->size;
+}
+
+static void delta_put(delta_buffer_t *b, const void *data, size_t size) {
+    memcpy(delta_reserve(b, size), data, size);
+    b->size += size;
+}
+
+static void delta_put_varint(delta_buffer_t *b, uint64_t v) {
+    uint8_t *p = delta_reserve(b, 10);
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    b->size = (size_t)(p - b->data);
+}
+
+static void delta_put_int(delta_buffer_t *b, int64_t v) {
+    delta_put_varint(b, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void delta_get(delta_reader_t *r, void *out, size_t size) {
+    if (!r->ok || (size_t)(r->end - r->p) < size) {
+        r->ok = false;
+        memset(out, 0, size);
+        return;
+    }
+    memcpy(out, r->p, size);
+    r->p += size;
+}
+
+static uint64_t delta_get_varint(delta_reader_t *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64 && r->ok && r->p < r->end; shift += 7) {
+        uint8_t byte = *r->p++;
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return v;
+    }
+    r->ok = false;
+    return 0;
+}
+
+static int64_t delta_get_int(delta_reader_t *r) {
+    uint64_t v = delta_get_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static bool same_real(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    int32_t ia = ((const delta_id_t*)a)->id;
+    int32_t ib = ((const delta_id_t*)b)->id;
+    return (ia > ib) - (ia < ib);
+}
+
+static int64_t find_id(const delta_id_t *ids, size_t count, int32_t id) {
+    delta_id_t key = { id, 0 };
+    const delta_id_t *found = (const delta_id_t*)bsearch(&key, ids, count, sizeof(delta_id_t), compare_ids);
+    return found ? (int64_t)found->index : -1;
+}
+
+/* Node fields present in `mask`, one bit per field in declaration order */
+static uint8_t node_diff(const neat_node_t *a, const neat_node_t *b) {
+    uint8_t mask = 0;
+    if (a->id != b->id) mask |= 0x01;
+    if (a->type != b->type) mask |= 0x02;
+    if (a->placement != b->placement) mask |= 0x04;
+    if (a->activation_type != b->activation_type) mask |= 0x08;
+    if (!same_real(a->value, b->value)) mask |= 0x10;
+    if (!same_real(a->bias, b->bias)) mask |= 0x20;
+    if (a->active != b->active) mask |= 0x40;
+    if (a->x_pos != b->x_pos) mask |= 0x80;
+    return mask;
+}
+
+static void node_put(delta_buffer_t *b, const neat_node_t *node, uint8_t mask) {
+    if (mask & 0x01) delta_put_int(b, node->id);
+    if (mask & 0x02) delta_put_varint(b, (uint64_t)node->type);
+    if (mask & 0x04) delta_put_varint(b, (uint64_t)node->placement);
+    if (mask & 0x08) delta_put_varint(b, (uint64_t)node->activation_type);
+    if (mask & 0x10) delta_put(b, &node->value, sizeof(double));
+    if (mask & 0x20) delta_put(b, &node->bias, sizeof(double));
+    if (mask & 0x40) delta_put_varint(b, node->active ? 1 : 0);
+    if (mask & 0x80) delta_put_int(b, node->x_pos);
+}
+
+static void node_get(delta_reader_t *r, neat_node_t *node, uint8_t mask) {
+    if (mask & 0x01) node->id = (int)delta_get_int(r);
+    if (mask & 0x02) node->type = (neat_node_type_t)delta_get_varint(r);
+    if (mask & 0x04) node->placement = (neat_node_placement_t)delta_get_varint(r);
+    if (mask & 0x08) node->activation_type = (neat_activation_type_t)delta_get_varint(r);
+    if (mask & 0x10) delta_get(r, &node->value, sizeof(double));
+    if (mask & 0x20) delta_get(r, &node->bias, sizeof(double));
+    if (mask & 0x40) node->active = delta_get_varint(r) != 0;
+    if (mask & 0x80) node->x_pos = (int)delta_get_int(r);
+}
+
+static uint8_t connection_diff(const neat_connection_t *a, const neat_connection_t *b) {
+    uint8_t mask = 0;
+    if (a->innovation != b->innovation) mask |= DELTA_CONN_INNOVATION;
+    if (a->in_node != b->in_node) mask |= DELTA_CONN_IN;
+    if (a->out_node != b->out_node) mask |= DELTA_CONN_OUT;
+    if (!same_real(a->weight, b->weight)) mask |= DELTA_CONN_WEIGHT;
+    if (a->enabled != b->enabled) mask |= DELTA_CONN_ENABLED;
+    return mask;
+}
+
+static void connection_put(delta_buffer_t *b, const neat_connection_t *conn, uint8_t mask) {
+    if (mask & DELTA_CONN_INNOVATION) delta_put_int(b, conn->innovation);
+    if (mask & DELTA_CONN_IN) delta_put_int(b, conn->in_node);
+    if (mask & DELTA_CONN_OUT) delta_put_int(b, conn->out_node);
+    if (mask & DELTA_CONN_WEIGHT) delta_put(b, &conn->weight, sizeof(double));
+}
+
+static void connection_get(delta_reader_t *r, neat_connection_t *conn, uint8_t mask) {
+    if (mask & DELTA_CONN_INNOVATION) conn->innovation = (int)delta_get_int(r);
+    if (mask & DELTA_CONN_IN) conn->in_node = (int)delta_get_int(r);
+    if (mask & DELTA_CONN_OUT) conn->out_node = (int)delta_get_int(r);
+    if (mask & DELTA_CONN_WEIGHT) delta_get(r, &conn->weight, sizeof(double));
+    if (mask & DELTA_CONN_ENABLED) conn->enabled = (mask & DELTA_CONN_ENABLED_SET) != 0;
+}
+
+/*
+ * Gene encoding against a base (NULL = none): the count, the edits to the
+ * genes both share, then the genes past the base's length in full.
+ */
+static void delta_put_genes(delta_buffer_t *b, const delta_genome_view_t *genome, const delta_genome_view_t *base) {
+    size_t base_nodes = base ? base->node_count : 0;
+    size_t shared = genome->node_count < base_nodes ? genome->node_count : base_nodes;
+    size_t edits = 0;
+    for (size_t i = 0; i < shared; i++) {
+        if (node_diff(&genome->nodes[i], &base->nodes[i])) edits++;
+    }
+    delta_put_varint(b, genome->node_count);
+    delta_put_varint(b, edits);
+    size_t last = 0;
+    for (size_t i = 0; i < shared; i++) {
+        uint8_t mask = node_diff(&genome->nodes[i], &base->nodes[i]);
+        if (!mask) continue;
+        delta_put_varint(b, i - last);
+        delta_put(b, &mask, 1);
+        node_put(b, &genome->nodes[i], mask);
+        last = i;
+    }
+    for (size_t i = shared; i < genome->node_count; i++) {
+        node_put(b, &genome->nodes[i], DELTA_NODE_ALL);
+    }
+
+    size_t base_connections = base ? base->connection_count : 0;
+    shared = genome->connection_count < base_connections ? genome->connection_count : base_connections;
+    edits = 0;
+    for (size_t i = 0; i < shared; i++) {
+        if (connection_diff(&genome->connections[i], &base->connections[i])) edits++;
+    }
+    delta_put_varint(b, genome->connection_count);
+    delta_put_varint(b, edits);
+    last = 0;
+    for (size_t i = 0; i < shared; i++) {
+        const neat_connection_t *conn = &genome->connections[i];
+        uint8_t mask = connection_diff(conn, &base->connections[i]);
+        if (!mask) continue;
+        if (conn->enabled) mask |= DELTA_CONN_ENABLED_SET;
+        delta_put_varint(b, i - last);
+        delta_put(b, &mask, 1);
+        connection_put(b, conn, mask);
+        last = i;
+    }
+    for (size_t i = shared; i < genome->connection_count; i++) {
+        uint8_t mask = genome->connections[i].enabled ? DELTA_CONN_ENABLED_SET : 0;
+        delta_put(b, &mask, 1);
+        connection_put(b, &genome->connections[i], DELTA_CONN_ALL);
+    }
+}
+
+/* Inverse of delta_put_genes into freshly allocated arrays of `genome` */
+static void delta_get_genes(delta_reader_t *r, neat_genome_t *genome, const delta_genome_view_t *base) {
+    size_t base_nodes = base ? base->node_count : 0;
+    uint64_t count = delta_get_varint(r);
+    uint64_t edits = delta_get_varint(r);
+    size_t shared = count < base_nodes ? (size_t)count : base_nodes;
+    /* Every edit and appended gene takes at least one byte */
+    if (!r->ok || edits > shared || count - shared > (uint64_t)(r->end - r->p)) {
+        r->ok = false;
+        return;
+    }
+    genome->node_count = (size_t)count;
+    genome->node_capacity = count > 0 ? (size_t)count : 1;
+    genome->nodes = (neat_node_t*)neat_calloc_tagged(NEAT_MEM_GENOMES, genome->node_capacity, sizeof(neat_node_t));
+    if (shared > 0) memcpy(genome->nodes, base->nodes, shared * sizeof(neat_node_t));
+    size_t index = 0;
+    for (uint64_t e = 0; e < edits && r->ok; e++) {
+        index += (size_t)delta_get_varint(r);
+        uint8_t mask = 0;
+        delta_get(r, &mask, 1);
+        if (index >= shared) {
+            r->ok = false;
+            return;
+        }
+        node_get(r, &genome->nodes[index], mask);
+    }
+    for (size_t i = shared; i < genome->node_count && r->ok; i++) {
+        node_get(r, &genome->nodes[i], DELTA_NODE_ALL);
+    }
+
+    size_t base_connections = base ? base->connection_count : 0;
+    count = delta_get_varint(r);
+    edits = delta_get_varint(r);
+    shared = count < base_connections ? (size_t)count : base_connections;
+    if (!r->ok || edits > shared || count - shared > (uint64_t)(r->end - r->p)) {
+        r->ok = false;
+        return;
+    }
+    genome->connection_count = (size_t)count;
+    genome->connection_capacity = count > 0 ? (size_t)count : 1;
+    genome->connections = (neat_connection_t*)neat_calloc_tagged(NEAT_MEM_GENOMES, genome->connection_capacity, sizeof(neat_connection_t));
+    if (shared > 0) memcpy(genome->connections, base->connections, shared * sizeof(neat_connection_t));
+    index = 0;
+    for (uint64_t e = 0; e < edits && r->ok; e++) {
+        index += (size_t)delta_get_varint(r);
+        uint8_t mask = 0;
+        delta_get(r, &mask, 1);
+        if (index >= shared) {
+            r->ok = false;
+            return;
+        }
+        connection_get(r, &genome->connections[index], mask);
+    }
+    for (size_t i = shared; i < genome->connection_count && r->ok; i++) {
+        uint8_t mask = 0;
+        delta_get(r, &mask, 1);
+        connection_get(r, &genome->connections[i], (uint8_t)(DELTA_CONN_ALL | (mask & DELTA_CONN_ENABLED_SET)));
+    }
+}
+
+static void delta_view_from_record(delta_genome_view_t *view, const uint8_t *image,
+                                   const checkpoint_header_t *h, const checkpoint_genome_t *rec) {
+    view->nodes = (const neat_node_t*)(image + h->node_offset) + rec->node_index;
+    view->node_count = rec->node_count;
+    view->connections = (const neat_connection_t*)(image + h->connection_offset) + rec->connection_index;
+    view->connection_count = rec->connection_count;
+    view->reals[0] = rec->fitness;
+    view->reals[1] = rec->adjusted_fitness;
+    view->reals[2] = rec->eval_time;
+    view->reals[3] = rec->parent_eval_time;
+    view->reals[4] = rec->parent_fitness;
+}
+
+static void delta_view_from_genome(delta_genome_view_t *view, const neat_genome_t *genome) {
+    view->nodes = genome->nodes;
+    view->node_count = genome->node_count;
+    view->connections = genome->connections;
+    view->connection_count = genome->connection_count;
+    view->reals[0] = genome->fitness;
+    view->reals[1] = genome->adjusted_fitness;
+    view->reals[2] = genome->eval_time;
+    view->reals[3] = genome->parent_eval_time;
+    view->reals[4] = genome->parent_fitness;
+}
+
+/* One genome record against `base` (NULL = stored whole) */
+static void delta_put_genome(delta_buffer_t *b, const checkpoint_genome_t *rec, int32_t expected_id,
+                             const delta_genome_view_t *view, const delta_genome_view_t *base, bool base_is_parent2) {
+    uint8_t flags = 0;
+    if (rec->evaluated) flags |= DELTA_GENOME_EVALUATED;
+    if (rec->elite) flags |= DELTA_GENOME_ELITE;
+    if (base) flags |= DELTA_GENOME_HAS_BASE;
+    if (base && base_is_parent2) flags |= DELTA_GENOME_PARENT2;
+
+    delta_put_int(b, (int64_t)rec->id - expected_id);
+    delta_put(b, &flags, 1);
+    delta_put_int(b, (int64_t)rec->parent1_id - rec->id);
+    delta_put_int(b, (int64_t)rec->parent2_id - rec->id);
+    delta_put_int(b, rec->species_id);
+    delta_put_int(b, rec->global_rank);
+    delta_put_int(b, rec->fidelity);
+
+    uint16_t codes = 0;
+    for (int k = 0; k < DELTA_REAL_COUNT; k++) {
+        unsigned code = DELTA_REAL_RAW;
+        if (same_real(view->reals[k], 0.0)) code = DELTA_REAL_ZERO;
+        else if (base && same_real(view->reals[k], base->reals[k])) code = DELTA_REAL_BASE;
+        codes |= (uint16_t)(code << (2 * k));
+    }
+    delta_put(b, &codes, sizeof(codes));
+    for (int k = 0; k < DELTA_REAL_COUNT; k++) {
+        if (((codes >> (2 * k)) & 3) == DELTA_REAL_RAW) delta_put(b, &view->reals[k], sizeof(double));
+    }
+
+    delta_put_genes(b, view, base);
+}
+
+/* Sorted ID index of an image's genome table */
+static delta_id_t* delta_image_ids(const uint8_t *image, const checkpoint_header_t *h) {
+    const checkpoint_genome_t *table = (const checkpoint_genome_t*)(image + h->genome_table_offset);
+    delta_id_t *ids = (delta_id_t*)neat_malloc((h->genome_count > 0 ? h->genome_count : 1) * sizeof(delta_id_t));
+    for (uint64_t i = 0; i < h->genome_count; i++) {
+        ids[i].id = table[i].id;
+        ids[i].index = i;
+    }
+    qsort(ids, h->genome_count, sizeof(delta_id_t), compare_ids);
+    return ids;
+}
+
+/* Encode `image` against `base` and write it to `path`; runs on the writer thread */
+static int checkpoint_delta_write(const neat_checkpoint_image_t *base, const neat_checkpoint_image_t *image,
+                                  const char *path, size_t *written) {
+    const checkpoint_header_t *bh = (const checkpoint_header_t*)base->data;
+    const checkpoint_header_t *h = (const checkpoint_header_t*)image->data;
+    const checkpoint_genome_t *base_table = (const checkpoint_genome_t*)(base->data + bh->genome_table_offset);
+    const checkpoint_genome_t *table = (const checkpoint_genome_t*)(image->data + h->genome_table_offset);
+    delta_id_t *base_ids = delta_image_ids(base->data, bh);
+
+    delta_buffer_t b = { NULL, 0, 0 };
+    checkpoint_delta_header_t dh;
+    memset(&dh, 0, sizeof(dh));
+    dh.magic = CHECKPOINT_DELTA_MAGIC;
+    dh.version = NEAT_CHECKPOINT_VERSION;
+    dh.generation = image->generation;
+    dh.base_generation = base->generation;
+    dh.state = *h;
+    delta_put(&b, &dh, sizeof(dh));
+
+    /* Innovation entries appended since the base; the whole table if it changed otherwise */
+    const neat_innovation_t *base_innovations = (const neat_innovation_t*)(base->data + bh->innovation_offset);
+    const neat_innovation_t *innovations = (const neat_innovation_t*)(image->data + h->innovation_offset);
+    uint64_t start = 0;
+    if (h->innovation_count >= bh->innovation_count &&
+        memcmp(innovations, base_innovations, bh->innovation_count * sizeof(neat_innovation_t)) == 0) {
+        start = bh->innovation_count;
+    }
+    delta_put_varint(&b, start);
+    delta_put(&b, innovations + start, (h->innovation_count - start) * sizeof(neat_innovation_t));
+
+    /* Species tables are small and stored as they are */
+    delta_put(&b, image->data + h->species_table_offset, h->species_count * sizeof(checkpoint_species_t));
+    delta_put(&b, image->data + h->member_offset, h->total_members * sizeof(uint64_t));
+
+    /* Genomes, each against whichever parent encodes shorter */
+    int32_t expected_id = 0;
+    for (uint64_t i = 0; i < h->genome_count; i++) {
+        const checkpoint_genome_t *rec = &table[i];
+        delta_genome_view_t view, first, second;
+        delta_view_from_record(&view, image->data, h, rec);
+
+        int64_t p1 = rec->parent1_id >= 0 ? find_id(base_ids, bh->genome_count, rec->parent1_id) : -1;
+        int64_t p2 = rec->parent2_id >= 0 ? find_id(base_ids, bh->genome_count, rec->parent2_id) : -1;
+        if (p1 >= 0) delta_view_from_record(&first, base->data, bh, &base_table[p1]);
+        size_t mark = b.size;
+        delta_put_genome(&b, rec, expected_id, &view, p1 >= 0 ? &first : NULL, false);
+        if (p2 >= 0) {
+            size_t first_size = b.size - mark;
+            b.size = mark;
+            delta_view_from_record(&second, base->data, bh, &base_table[p2]);
+            delta_put_genome(&b, rec, expected_id, &view, &second, true);
+            if (b.size - mark >= first_size) {
+                b.size = mark;
+                delta_put_genome(&b, rec, expected_id, &view, p1 >= 0 ? &first : NULL, false);
+            }
+        }
+        expected_id = rec->id + 1;
+    }
+
+    checkpoint_delta_header_t *out = (checkpoint_delta_header_t*)b.data;
+    out->payload_size = b.size - sizeof(checkpoint_delta_header_t);
+    uint32_t crc = neat_crc32c(0, b.data, b.size);
+    delta_put(&b, &crc, sizeof(crc));
+
+    char *tmp_path = checkpoint_tmp_path(path);
+    FILE *fp = fopen(tmp_path, "wb");
+    int ok = 0;
+    if (fp) {
+        bool all = fwrite(b.data, 1, b.size, fp) == b.size;
+        ok = checkpoint_commit(fp, all, tmp_path, path);
+    }
+    if (written) *written = b.size;
+
+    neat_free(tmp_path);
+    neat_free(b.data);
+    neat_free(base_ids);
+    return ok;
+}
+
+/*
+ * Replay a delta on top of the population it was written against. The new
+ * generation is decoded completely before the population is touched, so a
+ * corrupted or mismatched delta leaves it as it was. Returns 1 on success.
+ */
+static int checkpoint_delta_apply(neat_population_t *pop, const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    long file_size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) file_size = ftell(fp);
+    if (file_size < (long)(sizeof(checkpoint_delta_header_t) + sizeof(uint32_t)) || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return 0;
+    }
+    uint8_t *data = (uint8_t*)neat_malloc((size_t)file_size);
+    bool read_ok = fread(data, 1, (size_t)file_size, fp) == (size_t)file_size;
+    fclose(fp);
+
+    size_t body = (size_t)file_size - sizeof(uint32_t);
+    uint32_t crc;
+    memcpy(&crc, data + body, sizeof(crc));
+    checkpoint_delta_header_t dh;
+    memcpy(&dh, data, sizeof(dh));
+    const checkpoint_header_t *h = &dh.state;
+    if (!read_ok || neat_crc32c(0, data, body) != crc || dh.magic != CHECKPOINT_DELTA_MAGIC ||
+        dh.version != NEAT_CHECKPOINT_VERSION || dh.payload_size != body - sizeof(dh) ||
+        dh.base_generation != pop->generation || h->generation != dh.generation ||
+        !checkpoint_layout_valid(h)) {
+        neat_free(data);
+        return 0;
+    }
+
+    delta_reader_t r = { data + sizeof(dh), data + body, true };
+    neat_innovation_table_t *table = pop->innovation_table;
+
+    /* Innovation entries and species tables, bounded by the payload before use */
+    uint64_t start = delta_get_varint(&r);
+    uint64_t remaining = (uint64_t)(r.end - r.p);
+    if (!r.ok || start > table->count || start > h->innovation_count ||
+        !section_fits(0, h->innovation_count - start, sizeof(neat_innovation_t), remaining)) {
+        neat_free(data);
+        return 0;
+    }
+    const uint8_t *appended = r.p;
+    r.p += (h->innovation_count - start) * sizeof(neat_innovation_t);
+    remaining = (uint64_t)(r.end - r.p);
+    if (!section_fits(0, h->species_count, sizeof(checkpoint_species_t), remaining)) {
+        neat_free(data);
+        return 0;
+    }
+    checkpoint_species_t *species_table = (checkpoint_species_t*)neat_malloc((h->species_count > 0 ? h->species_count : 1) * sizeof(checkpoint_species_t));
+    delta_get(&r, species_table, h->species_count * sizeof(checkpoint_species_t));
+    remaining = (uint64_t)(r.end - r.p);
+    if (!section_fits(0, h->total_members, sizeof(uint64_t), remaining)) {
+        neat_free(species_table);
+        neat_free(data);
+        return 0;
+    }
+    uint64_t *members = (uint64_t*)neat_malloc((h->total_members > 0 ? h->total_members : 1) * sizeof(uint64_t));
+    delta_get(&r, members, h->total_members * sizeof(uint64_t));
+    bool ok = checkpoint_species_valid(species_table, h->species_count, members, h->total_members, h->genome_count) &&
+              h->genome_count <= (uint64_t)(r.end - r.p);
+
+    /* Genomes, resolved against the current generation */
+    delta_id_t *ids = (delta_id_t*)neat_malloc((pop->genome_count > 0 ? pop->genome_count : 1) * sizeof(delta_id_t));
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        ids[i].id = pop->genomes[i]->id;
+        ids[i].index = i;
+    }
+    qsort(ids, pop->genome_count, sizeof(delta_id_t), compare_ids);
+
+    uint64_t genome_count = ok ? h->genome_count : 0;
+    neat_genome_t **genomes = (neat_genome_t**)neat_calloc_tagged(NEAT_MEM_GENOMES, genome_count > 0 ? genome_count : 1, sizeof(neat_genome_t*));
+    int64_t expected_id = 0;
+    for (uint64_t i = 0; i < genome_count && r.ok; i++) {
+        neat_genome_t *genome = (neat_genome_t*)neat_calloc_tagged(NEAT_MEM_GENOMES, 1, sizeof(neat_genome_t));
+        genomes[i] = genome;
+        genome->id = (int)(expected_id + delta_get_int(&r));
+        uint8_t flags = 0;
+        delta_get(&r, &flags, 1);
+        genome->parent1_id = (int)(genome->id + delta_get_int(&r));
+        genome->parent2_id = (int)(genome->id + delta_get_int(&r));
+        genome->species_id = (int)delta_get_int(&r);
+        genome->global_rank = (int)delta_get_int(&r);
+        genome->fidelity = (int)delta_get_int(&r);
+        genome->evaluated = (flags & DELTA_GENOME_EVALUATED) != 0;
+        genome->elite = (flags & DELTA_GENOME_ELITE) != 0;
+
+        delta_genome_view_t base_view;
+        const delta_genome_view_t *base = NULL;
+        if (flags & DELTA_GENOME_HAS_BASE) {
+            int base_id = (flags & DELTA_GENOME_PARENT2) ? genome->parent2_id : genome->parent1_id;
+            int64_t index = find_id(ids, pop->genome_count, base_id);
+            if (index < 0) {
+                r.ok = false;
+                break;
+            }
+            delta_view_from_genome(&base_view, pop->genomes[index]);
+            base = &base_view;
+        }
+
+        uint16_t codes = 0;
+        double reals[DELTA_REAL_COUNT];
+        delta_get(&r, &codes, sizeof(codes));
+        for (int k = 0; k < DELTA_REAL_COUNT; k++) {
+            unsigned code = (codes >> (2 * k)) & 3;
+            reals[k] = 0.0;
+            if (code == DELTA_REAL_RAW) delta_get(&r, &reals[k], sizeof(double));
+            else if (code == DELTA_REAL_BASE && base) reals[k] = base->reals[k];
+            else if (code != DELTA_REAL_ZERO) r.ok = false;
+        }
+        genome->fitness = reals[0];
+        genome->adjusted_fitness = reals[1];
+        genome->eval_time = reals[2];
+        genome->parent_eval_time = reals[3];
+        genome->parent_fitness = reals[4];
+
+        delta_get_genes(&r, genome, base);
+        expected_id = (int64_t)genome->id + 1;
+    }
+    ok = ok && r.ok && r.p == r.end;
+    neat_free(ids);
+
+    if (!ok) {
+        for (uint64_t i = 0; i < genome_count; i++) {
+            neat_free_genome(genomes[i]);
+        }
+        neat_free(genomes);
+        neat_free(members);
+        neat_free(species_table);
+        neat_free(data);
+        return 0;
+    }
+
+    /* Swap the generation in */
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        neat_free_genome(pop->genomes[i]);
+    }
+    for (size_t s = 0; s < pop->species_count; s++) {
+        neat_free_species(pop->species[s]);
+    }
+    neat_free(pop->species);
+    if (genome_count > pop->genome_capacity) {
+        pop->genome_capacity = genome_count;
+        pop->genomes = (neat_genome_t**)neat_realloc(pop->genomes, pop->genome_capacity * sizeof(neat_genome_t*));
+    }
+    memcpy(pop->genomes, genomes, genome_count * sizeof(neat_genome_t*));
+    pop->genome_count = genome_count;
+    checkpoint_restore_species(pop, species_table, h->species_count, members);
+
+    if (h->innovation_count > table->capacity) {
+        table->capacity = h->innovation_count;
+        table->innovations = (neat_innovation_t*)neat_realloc(table->innovations, table->capacity * sizeof(neat_innovation_t));
+    }
+    memcpy(table->innovations + start, appended, (h->innovation_count - start) * sizeof(neat_innovation_t));
+    table->count = h->innovation_count;
+    table->next_innovation = (int)h->next_innovation;
+    table->next_node_id = (int)h->next_node_id;
+    table->next_species_id = (int)h->next_species_id;
+    checkpoint_apply_state(pop, h);
+
+    neat_free(genomes);
+    neat_free(members);
+    neat_free(species_table);
+    neat_free(data);
+    return 1;
+}
+
+static void checkpoint_file_path(const char *dir, int generation, bool delta, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/neat_gen_%06d.%s", dir, generation, delta ? "delta" : "ckpt");
+}
+
+static int compare_generations_desc(const void *a, const void *b) {
+    int ga = *(const int*)a;
+    int gb = *(const int*)b;
+    return (ga < gb) - (ga > gb);
+}
+
+/*
+ * Restore the newest state in a checkpoint directory: load the newest
+ * readable keyframe, then replay the deltas of the generations after it for
+ * as long as they follow on. Returns NULL if no keyframe can be loaded.
+ */
+neat_population_t* neat_checkpoint_restore(const char *dir) {
+    if (!dir) return NULL;
+
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+    int *keyframes = NULL;
+    size_t keyframe_count = 0, keyframe_capacity = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        int generation;
+        char ext[8];
+        if (sscanf(entry->d_name, "neat_gen_%d.%7s", &generation, ext) != 2 || strcmp(ext, "ckpt") != 0) continue;
+        if (keyframe_count == keyframe_capacity) {
+            keyframe_capacity = keyframe_capacity ? keyframe_capacity * 2 : 8;
+            keyframes = (int*)neat_realloc(keyframes, keyframe_capacity * sizeof(int));
+        }
+        keyframes[keyframe_count++] = generation;
+    }
+    closedir(d);
+    qsort(keyframes, keyframe_count, sizeof(int), compare_generations_desc);
+
+    char path[4096];
+    neat_population_t *pop = NULL;
+    for (size_t k = 0; k < keyframe_count && !pop; k++) {
+        checkpoint_file_path(dir, keyframes[k], false, path, sizeof(path));
+        pop = neat_population_load(path);
+    }
+    neat_free(keyframes);
+    if (!pop) return NULL;
+
+    for (;;) {
+        checkpoint_file_path(dir, pop->generation + 1, true, path, sizeof(path));
+        if (!checkpoint_delta_apply(pop, path)) break;
+    }
+    return pop;
+}
+
+/* Background checkpointing */
+neat_checkpoint_config_t neat_checkpoint_default_config(void) {
+    neat_checkpoint_config_t config;
+    config.save_frequency = 1;
+    config.checkpoint_dir = "checkpoints";
+    config.keep_count = 3;
+    config.keyframe_interval = 10;
+    return config;
+}
+
+/* Copy the population into a file image, reusing `image` if given; runs on the evolution thread */
+static neat_checkpoint_image_t* checkpoint_snapshot(const neat_population_t *pop, neat_checkpoint_image_t *image) {
+    checkpoint_ref_t *refs = checkpoint_refs_build(pop);
+    checkpoint_header_t header;
+
+    /* Size the image, then fill it */
+    checkpoint_writer_t sizer = { NULL, NULL, 0, 0, true };
+    checkpoint_emit(pop, refs, &sizer, &header);
+
+    if (!image) {
+        image = (neat_checkpoint_image_t*)neat_calloc(1, sizeof(neat_checkpoint_image_t));
+    }
+    if (image->capacity < header.file_size) {
+        neat_free(image->data);
+        image->capacity = header.file_size + header.file_size / 8;
+        image->data = (uint8_t*)neat_malloc(image->capacity);
+    }
+    image->size = header.file_size;
+    image->generation = pop->generation;
+
+    checkpoint_writer_t w = { NULL, image->data, 0, 0, true };
+    checkpoint_emit(pop, refs, &w, &header);
+    memcpy(image->data, &header, sizeof(header));
+
+    neat_free(refs);
+    return image;
+}
+
+static void checkpoint_image_free(neat_checkpoint_image_t *image) {
+    if (!image) return;
+    neat_free(image->data);
+    neat_free(image);
+}
+
+/* Checksum and write an image; runs on the writer thread */
+static int checkpoint_image_write(neat_checkpoint_image_t *image, const char *path) {
+    checkpoint_header_t header;
+    memcpy(&header, image->data, sizeof(header));
+    header.body_crc = neat_crc32c(0, image->data + header.genome_table_offset,
+                                  image->size - header.genome_table_offset);
+    checkpoint_seal(&header);
+    memcpy(image->data, &header, sizeof(header));
+
+    char *tmp_path = checkpoint_tmp_path(path);
+    FILE *fp = fopen(tmp_path, "wb");
+    int ok = 0;
+    if (fp) {
+        bool written = fwrite(image->data, 1, image->size, fp) == image->size;
+        ok = checkpoint_commit(fp, written, tmp_path, path);
+    }
+    neat_free(tmp_path);
+    return ok;
+}
+
+/* Remember a new checkpoint; drop the oldest keyframes beyond keep_count with their deltas */
+static void checkpointer_rotate(neat_checkpointer_t *cp, const char *path, bool keyframe) {
+    if (cp->written_count == cp->written_capacity) {
+        cp->written_capacity = cp->written_capacity ? cp->written_capacity * 2 : cp->config.keep_count + 1;
+        cp->written = (neat_checkpoint_file_t*)neat_realloc(cp->written, cp->written_capacity * sizeof(neat_checkpoint_file_t));
+    }
+    size_t len = strlen(path) + 1;
+    neat_checkpoint_file_t *file = &cp->written[cp->written_count++];
+    file->path = (char*)neat_malloc(len);
+    memcpy(file->path, path, len);
+    file->keyframe = keyframe;
+
+    int keyframes = 0;
+    for (int i = 0; i < cp->written_count; i++) {
+        if (cp->written[i].keyframe) keyframes++;
+    }
+    while (keyframes > cp->config.keep_count) {
+        int drop = 1;
+        while (drop < cp->written_count && !cp->written[drop].keyframe) drop++;
+        for (int i = 0; i < drop; i++) {
+            remove(cp->written[i].path);
+            neat_free(cp->written[i].path);
+        }
+        memmove(cp->written, cp->written + drop, (cp->written_count - drop) * sizeof(neat_checkpoint_file_t));
+        cp->written_count -= drop;
+        keyframes--;
+    }
+}
+
+static void* checkpointer_thread(void *arg) {
+    neat_checkpointer_t *cp = (neat_checkpointer_t*)arg;
+    char path[4096];
+
+    pthread_mutex_lock(&cp->lock);
+    for (;;) {
+        while (!cp->pending && !cp->stop) {
+            pthread_cond_wait(&cp->cond, &cp->lock);
+        }
+        /* Pending snapshots are still written on shutdown */
+        if (!cp->pending) break;
+
+        neat_checkpoint_image_t *image = cp->pending;
+        cp->pending = NULL;
+        cp->writing = true;
+        pthread_mutex_unlock(&cp->lock);
+
+        /* A delta needs the previous generation on disk and room left in the keyframe run */
+        double start = neat_get_time();
+        bool delta = cp->base && cp->config.keyframe_interval > 1 &&
+                     cp->delta_run < cp->config.keyframe_interval - 1 &&
+                     cp->base->generation == image->generation - 1;
+        checkpoint_file_path(cp->checkpoint_dir, image->generation, delta, path, sizeof(path));
+        size_t size = image->size;
+        int ok = delta ? checkpoint_delta_write(cp->base, image, path, &size) : checkpoint_image_write(image, path);
+        neat_checkpoint_image_t *retired = image;
+        if (ok) {
+            checkpointer_rotate(cp, path, !delta);
+            cp->delta_run = delta ? cp->delta_run + 1 : 0;
+            if (cp->config.keyframe_interval > 1) {
+                retired = cp->base;
+                cp->base = image;
+            }
+        }
+        double elapsed = neat_get_time() - start;
+
+        pthread_mutex_lock(&cp->lock);
+        cp->writing = false;
+        cp->last_write_time = elapsed;
+        if (ok) {
+            cp->checkpoint_count++;
+            if (delta) cp->delta_count++;
+            cp->last_write_size = size;
+            cp->last_generation = image->generation;
+            cp->last_delta = delta;
+        } else {
+            cp->failed_count++;
+        }
+        if (!cp->spare) {
+            cp->spare = retired;
+        } else {
+            checkpoint_image_free(retired);
+        }
+        pthread_cond_broadcast(&cp->cond);
+    }
+    pthread_mutex_unlock(&cp->lock);
+    return NULL;
+}
+
+neat_checkpointer_t* neat_checkpointer_create(const neat_checkpoint_config_t *config) {
+    neat_checkpointer_t *cp = (neat_checkpointer_t*)neat_calloc(1, sizeof(neat_checkpointer_t));
+    cp->config = config ? *config : neat_checkpoint_default_config();
+    if (cp->config.keep_count < 1) cp->config.keep_count = 1;
+    /* Deltas only chain consecutive generations, so sparser schedules write keyframes only */
+    if (cp->config.keyframe_interval < 1 || cp->config.save_frequency != 1) cp->config.keyframe_interval = 1;
+
+    const char *dir = cp->config.checkpoint_dir ? cp->config.checkpoint_dir : ".";
+    size_t len = strlen(dir) + 1;
+    cp->checkpoint_dir = (char*)neat_malloc(len);
+    memcpy(cp->checkpoint_dir, dir, len);
+    cp->config.checkpoint_dir = cp->checkpoint_dir;
+    mkdir(cp->checkpoint_dir, 0755);
+
+    cp->last_generation = -1;
+
+    pthread_mutex_init(&cp->lock, NULL);
+    pthread_cond_init(&cp->cond, NULL);
+    if (pthread_create(&cp->thread, NULL, checkpointer_thread, cp) != 0) {
+        pthread_cond_destroy(&cp->cond);
+        pthread_mutex_destroy(&cp->lock);
+        neat_free(cp->checkpoint_dir);
+        neat_free(cp);
+        return NULL;
+    }
+    return cp;
+}
+
+/* Write any pending snapshot, stop the writer thread and release everything */
+void neat_checkpointer_free(neat_checkpointer_t *cp) {
+    if (!cp) return;
+
+    pthread_mutex_lock(&cp->lock);
+    cp->stop = true;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+    pthread_join(cp->thread, NULL);
+
+    checkpoint_image_free(cp->spare);
+    checkpoint_image_free(cp->base);
+    for (int i = 0; i < cp->written_count; i++) {
+        neat_free(cp->written[i].path);
+    }
+    neat_free(cp->written);
+    neat_free(cp->checkpoint_dir);
+    pthread_cond_destroy(&cp->cond);
+    pthread_mutex_destroy(&cp->lock);
+    neat_free(cp);
+}
+
+/* Snapshot the population now and queue it for writing; returns 1 if queued */
+int neat_checkpointer_submit(neat_checkpointer_t *cp, const neat_population_t *pop) {
+    if (!cp || !pop) return 0;
+
+    double start = neat_get_time();
+    pthread_mutex_lock(&cp->lock);
+    neat_checkpoint_image_t *image = cp->spare;
+    cp->spare = NULL;
+    pthread_mutex_unlock(&cp->lock);
+
+    image = checkpoint_snapshot(pop, image);
+    double elapsed = neat_get_time() - start;
+
+    pthread_mutex_lock(&cp->lock);
+    if (cp->pending) {
+        checkpoint_image_free(cp->pending);
+        cp->dropped_count++;
+    }
+    cp->pending = image;
+    cp->last_snapshot_time = elapsed;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+    return 1;
+}
+
+/* Generation-boundary hook: submit when the generation is due under save_frequency */
+int neat_checkpointer_step(neat_checkpointer_t *cp, const neat_population_t *pop) {
+    if (!cp || !pop || cp->config.save_frequency <= 0) return 0;
+    if (pop->generation % cp->config.save_frequency != 0) return 0;
+    return neat_checkpointer_submit(cp, pop);
+}
+
+/* Block until every queued snapshot is on disk */
+void neat_checkpointer_flush(neat_checkpointer_t *cp) {
+    if (!cp) return;
+
+    pthread_mutex_lock(&cp->lock);
+    while (cp->pending || cp->writing) {
+        pthread_cond_wait(&cp->cond, &cp->lock);
+    }
+    pthread_mutex_unlock(&cp->lock);
+}
+
+/* Path of the newest checkpoint file (keyframe or delta); returns 0 if none was written yet */
+int neat_checkpointer_latest_path(neat_checkpointer_t *cp, char *buffer, size_t size) {
+    if (!cp || !buffer || size == 0) return 0;
+
+    pthread_mutex_lock(&cp->lock);
+    int generation = cp->last_generation;
+    bool delta = cp->last_delta;
+    pthread_mutex_unlock(&cp->lock);
+
+    if (generation < 0) return 0;
+    checkpoint_file_path(cp->checkpoint_dir, generation, delta, buffer, size);
+    return 1;
+}
@@ -0,0 +1,594 @@
+#include <immintrin.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/envs.h"
+
+/* Local xorshift so environments stay reentrant across evaluation threads */
+static uint32_t env_rand(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float env_rand_uniform(uint32_t* state, float min, float max) {
+    return min + (max - min) * ((float)env_rand(state) / (float)UINT32_MAX);
+}
+
+/*
+ * Polynomial sin/cos for the pole dynamics. With AVX every instance, the
+ * tail included, is stepped through the same SIMD sequence, so results do
+ * not depend on where an instance lands in the batch. Pole angles never leave
+ * [-fail_angle - overshoot, fail_angle + overshoot], where the truncated
+ * series is accurate to well below float precision.
+ */
+static inline float env_sin(float x) {
+    float x2 = x * x;
+    return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f +
+           x2 * (-1.0f / 5040.0f + x2 * (1.0f / 362880.0f)))));
+}
+
+static inline float env_cos(float x) {
+    float x2 = x * x;
+    return 1.0f + x2 * (-0.5f + x2 * (1.0f / 24.0f +
+           x2 * (-1.0f / 720.0f + x2 * (1.0f / 40320.0f))));
+}
+
+#ifdef __AVX__
+static inline __m256 env_sin_ps(__m256 x) {
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(1.0f / 362880.0f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.0f / 5040.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f / 120.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.0f / 6.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f));
+    return _mm256_mul_ps(p, x);
+}
+
+static inline __m256 env_cos_ps(__m256 x) {
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(1.0f / 40320.0f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-1.0f / 720.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f / 24.0f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(-0.5f));
+    return _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f));
+}
+#endif
+
+/* Dataset functions */
+static neat_env_dataset_t* env_dataset_alloc(size_t num_inputs, size_t case_count) {
+    neat_env_dataset_t* data = (neat_env_dataset_t*)neat_malloc(sizeof(neat_env_dataset_t));
+    data->num_inputs = num_inputs;
+    data->case_count = case_count;
+    data->inputs = (float*)neat_calloc(num_inputs * case_count, sizeof(float));
+    data->targets = (float*)neat_calloc(case_count, sizeof(float));
+    return data;
+}
+
+neat_env_dataset_t* neat_env_parity_create(size_t bits) {
+    if (bits < 2 || bits > 20) {
+        return NULL;
+    }
+
+    size_t case_count = (size_t)1 << bits;
+    neat_env_dataset_t* data = env_dataset_alloc(bits, case_count);
+
+    for (size_t c = 0; c < case_count; c++) {
+        int ones = 0;
+        for (size_t i = 0; i < bits; i++) {
+            int bit = (int)((c >> (bits - 1 - i)) & 1);
+            data->inputs[i * case_count + c] = (float)bit;
+            ones += bit;
+        }
+        data->targets[c] = (float)(ones & 1);
+    }
+
+    return data;
+}
+
+neat_env_dataset_t* neat_env_xor_create(void) {
+    return neat_env_parity_create(2);
+}
+
+neat_env_dataset_t* neat_env_multiplexer_create(size_t address_bits) {
+    if (address_bits < 1 || address_bits > 4) {
+        return NULL;
+    }
+
+    size_t data_bits = (size_t)1 << address_bits;
+    size_t num_inputs = address_bits + data_bits;
+    size_t case_count = (size_t)1 << num_inputs;
+    neat_env_dataset_t* data = env_dataset_alloc(num_inputs, case_count);
+
+    for (size_t c = 0; c < case_count; c++) {
+        /* Address bits come first, then the data register */
+        size_t address = 0;
+        for (size_t i = 0; i < num_inputs; i++) {
+            int bit = (int)((c >> (num_inputs - 1 - i)) & 1);
+            data->inputs[i * case_count + c] = (float)bit;
+            if (i < address_bits) {
+                address = (address << 1) | (size_t)bit;
+            }
+        }
+        data->targets[c] = data->inputs[(address_bits + address) * case_count + c];
+    }
+
+    return data;
+}
+
+void neat_env_dataset_free(neat_env_dataset_t* data) {
+    if (data) {
+        neat_free(data->inputs);
+        neat_free(data->targets);
+        neat_free(data);
+    }
+}
+
+/* Sum of squared differences between outputs and targets */
+static float env_squared_error(const float* outputs, const float* targets, size_t count) {
+    float error = 0.0f;
+    size_t i = 0;
+
+    #ifdef __AVX__
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 7 < count; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(outputs + i), _mm256_loadu_ps(targets + i));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    for (int j = 0; j < 8; j++) {
+        error += lanes[j];
+    }
+    #endif
+
+    for (; i < count; i++) {
+        float d = outputs[i] - targets[i];
+        error += d * d;
+    }
+
+    return error;
+}
+
+/* Fitness is case_count minus the summed squared error (4.0 is a perfect XOR) */
+double neat_env_dataset_fitness(neat_genome_t* genome, void* user_data) {
+    const neat_env_dataset_t* data = (const neat_env_dataset_t*)user_data;
+    if (!genome || !data) {
+        return 0.0;
+    }
+
+    double* inputs = (double*)neat_malloc(data->num_inputs * sizeof(double));
+    float* outputs = (float*)neat_malloc(data->case_count * sizeof(float));
+    double out[NEAT_MAX_OUTPUTS];
+
+    for (size_t c = 0; c < data->case_count; c++) {
+        for (size_t i = 0; i < data->num_inputs; i++) {
+            inputs[i] = data->inputs[i * data->case_count + c];
+        }
+        neat_evaluate(genome, inputs, out);
+        outputs[c] = (float)out[0];
+    }
+
+    double fitness = (double)data->case_count -
+                     env_squared_error(outputs, data->targets, data->case_count);
+
+    neat_free(inputs);
+    neat_free(outputs);
+    return fitness > 0.0 ? fitness : 0.0;
+}
+
+/* Pole balancing batch functions */
+neat_pole_batch_t* neat_pole_batch_create(size_t count, int num_poles, bool velocities) {
+    if (count == 0 || (num_poles != 1 && num_poles != 2)) {
+        return NULL;
+    }
+
+    neat_pole_batch_t* batch = (neat_pole_batch_t*)neat_calloc(1, sizeof(neat_pole_batch_t));
+    batch->count = count;
+    batch->num_poles = num_poles;
+    batch->velocities = velocities;
+    batch->tau = (num_poles == 1) ? NEAT_ENV_SINGLE_TAU : NEAT_ENV_DOUBLE_TAU;
+    batch->fail_angle = (num_poles == 1) ? NEAT_ENV_SINGLE_FAIL_ANGLE : NEAT_ENV_DOUBLE_FAIL_ANGLE;
+
+    batch->x = (float*)neat_calloc(count, sizeof(float));
+    batch->x_dot = (float*)neat_calloc(count, sizeof(float));
+    batch->theta1 = (float*)neat_calloc(count, sizeof(float));
+    batch->theta1_dot = (float*)neat_calloc(count, sizeof(float));
+    if (num_poles == 2) {
+        batch->theta2 = (float*)neat_calloc(count, sizeof(float));
+        batch->theta2_dot = (float*)neat_calloc(count, sizeof(float));
+    }
+    batch->alive = (float*)neat_calloc(count, sizeof(float));
+    batch->steps = (int*)neat_calloc(count, sizeof(int));
+
+    neat_pole_batch_reset(batch, 1, 0.0f);
+    return batch;
+}
+
+void neat_pole_batch_free(neat_pole_batch_t* batch) {
+    if (!batch) return;
+
+    neat_free(batch->x);
+    neat_free(batch->x_dot);
+    neat_free(batch->theta1);
+    neat_free(batch->theta1_dot);
+    neat_free(batch->theta2);
+    neat_free(batch->theta2_dot);
+    neat_free(batch->alive);
+    neat_free(batch->steps);
+    neat_free(batch);
+}
+
+/* Reset all instances to the standard start state plus uniform noise */
+void neat_pole_batch_reset(neat_pole_batch_t* batch, uint32_t seed, float noise) {
+    if (!batch) return;
+
+    uint32_t state = seed ? seed : 1;
+
+    /* Double pole starts with the long pole at 4.5 degrees (Wieland 1991) */
+    float theta1_start = (batch->num_poles == 2) ? 0.07854f : 0.0f;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        batch->x[i] = noise * env_rand_uniform(&state, -1.0f, 1.0f);
+        batch->x_dot[i] = noise * env_rand_uniform(&state, -1.0f, 1.0f);
+        batch->theta1[i] = theta1_start + noise * env_rand_uniform(&state, -0.05f, 0.05f);
+        batch->theta1_dot[i] = noise * env_rand_uniform(&state, -0.1f, 0.1f);
+        if (batch->num_poles == 2) {
+            batch->theta2[i] = 0.0f;
+            batch->theta2_dot[i] = 0.0f;
+        }
+        batch->alive[i] = 1.0f;
+        batch->steps[i] = 0;
+    }
+
+    batch->alive_count = batch->count;
+}
+
+#ifdef __AVX__
+/*
+ * Run the last count - i (< 8) instances through a full SIMD lane on padded
+ * copies, so every instance goes through the same instruction sequence.
+ * Padding lanes are dead and their results are discarded.
+ */
+static void pole_step_padded(neat_pole_batch_t* batch, const float* forces, size_t i,
+                             void (*lanes)(neat_pole_batch_t*, const float*, size_t)) {
+    size_t n = batch->count - i;
+    float x[8] = {0}, x_dot[8] = {0}, t1[8] = {0}, t1_dot[8] = {0};
+    float t2[8] = {0}, t2_dot[8] = {0}, alive[8] = {0}, f[8] = {0};
+    float* src[6] = {batch->x, batch->x_dot, batch->theta1, batch->theta1_dot, batch->theta2, batch->theta2_dot};
+    float* dst[6] = {x, x_dot, t1, t1_dot, t2, t2_dot};
+    int arrays = batch->num_poles == 2 ? 6 : 4;
+
+    for (int a = 0; a < arrays; a++) {
+        memcpy(dst[a], src[a] + i, n * sizeof(float));
+    }
+    memcpy(alive, batch->alive + i, n * sizeof(float));
+    memcpy(f, forces + i, n * sizeof(float));
+
+    neat_pole_batch_t tail = *batch;
+    tail.x = x;
+    tail.x_dot = x_dot;
+    tail.theta1 = t1;
+    tail.theta1_dot = t1_dot;
+    tail.theta2 = t2;
+    tail.theta2_dot = t2_dot;
+    tail.alive = alive;
+    lanes(&tail, f, 0);
+
+    for (int a = 0; a < arrays; a++) {
+        memcpy(src[a] + i, dst[a], n * sizeof(float));
+    }
+}
+#endif
+
+/* Single pole, Euler integration (Barto, Sutton & Anderson 1983) */
+#ifdef __AVX__
+/* Advance the eight instances starting at index i */
+static inline void pole_single_lanes(neat_pole_batch_t* batch, const float* forces, size_t i) {
+    const float total_mass = NEAT_ENV_CART_MASS + NEAT_ENV_POLE1_MASS;
+    const __m256 v_total_mass = _mm256_set1_ps(total_mass);
+    const __m256 v_inv_total_mass = _mm256_set1_ps(1.0f / total_mass);
+    const __m256 v_pml = _mm256_set1_ps(NEAT_ENV_POLE1_MASS * NEAT_ENV_POLE1_HALF_LEN);
+    const __m256 v_gravity = _mm256_set1_ps(NEAT_ENV_GRAVITY);
+    const __m256 v_four_thirds = _mm256_set1_ps(4.0f / 3.0f);
+    const __m256 v_pole_mass = _mm256_set1_ps(NEAT_ENV_POLE1_MASS);
+    const __m256 v_half_len = _mm256_set1_ps(NEAT_ENV_POLE1_HALF_LEN);
+    const __m256 v_tau = _mm256_set1_ps(batch->tau);
+    float* restrict x = batch->x;
+    float* restrict x_dot = batch->x_dot;
+    float* restrict theta = batch->theta1;
+    float* restrict theta_dot = batch->theta1_dot;
+
+    __m256 vx = _mm256_loadu_ps(x + i);
+    __m256 vxd = _mm256_loadu_ps(x_dot + i);
+    __m256 vt = _mm256_loadu_ps(theta + i);
+    __m256 vtd = _mm256_loadu_ps(theta_dot + i);
+    __m256 mask = _mm256_cmp_ps(_mm256_loadu_ps(batch->alive + i), _mm256_setzero_ps(), _CMP_GT_OQ);
+    __m256 f = _mm256_loadu_ps(forces + i);
+
+    __m256 s = env_sin_ps(vt);
+    __m256 c = env_cos_ps(vt);
+
+    __m256 temp = _mm256_mul_ps(
+        _mm256_add_ps(f, _mm256_mul_ps(v_pml, _mm256_mul_ps(_mm256_mul_ps(vtd, vtd), s))),
+        v_inv_total_mass);
+    __m256 denom = _mm256_mul_ps(v_half_len,
+        _mm256_sub_ps(v_four_thirds,
+            _mm256_mul_ps(v_pole_mass, _mm256_mul_ps(_mm256_mul_ps(c, c), v_inv_total_mass))));
+    __m256 theta_acc = _mm256_div_ps(
+        _mm256_sub_ps(_mm256_mul_ps(v_gravity, s), _mm256_mul_ps(c, temp)), denom);
+    __m256 x_acc = _mm256_sub_ps(temp,
+        _mm256_div_ps(_mm256_mul_ps(v_pml, _mm256_mul_ps(theta_acc, c)), v_total_mass));
+
+    __m256 nx = _mm256_add_ps(vx, _mm256_mul_ps(v_tau, vxd));
+    __m256 nxd = _mm256_add_ps(vxd, _mm256_mul_ps(v_tau, x_acc));
+    __m256 nt = _mm256_add_ps(vt, _mm256_mul_ps(v_tau, vtd));
+    __m256 ntd = _mm256_add_ps(vtd, _mm256_mul_ps(v_tau, theta_acc));
+
+    /* Failed instances keep their final state */
+    _mm256_storeu_ps(x + i, _mm256_blendv_ps(vx, nx, mask));
+    _mm256_storeu_ps(x_dot + i, _mm256_blendv_ps(vxd, nxd, mask));
+    _mm256_storeu_ps(theta + i, _mm256_blendv_ps(vt, nt, mask));
+    _mm256_storeu_ps(theta_dot + i, _mm256_blendv_ps(vtd, ntd, mask));
+}
+#endif
+
+static void pole_step_single(neat_pole_batch_t* batch, const float* forces) {
+    #ifdef __AVX__
+    size_t i = 0;
+    for (; i + 7 < batch->count; i += 8) {
+        pole_single_lanes(batch, forces, i);
+    }
+    if (i < batch->count) {
+        pole_step_padded(batch, forces, i, pole_single_lanes);
+    }
+    #else
+    const float total_mass = NEAT_ENV_CART_MASS + NEAT_ENV_POLE1_MASS;
+    const float pole_mass_length = NEAT_ENV_POLE1_MASS * NEAT_ENV_POLE1_HALF_LEN;
+    const float tau = batch->tau;
+    float* restrict x = batch->x;
+    float* restrict x_dot = batch->x_dot;
+    float* restrict theta = batch->theta1;
+    float* restrict theta_dot = batch->theta1_dot;
+    const float* restrict alive = batch->alive;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        if (alive[i] <= 0.0f) continue;
+
+        float s = env_sin(theta[i]);
+        float c = env_cos(theta[i]);
+        float temp = (forces[i] + pole_mass_length * theta_dot[i] * theta_dot[i] * s) / total_mass;
+        float theta_acc = (NEAT_ENV_GRAVITY * s - c * temp) /
+            (NEAT_ENV_POLE1_HALF_LEN * (4.0f / 3.0f - NEAT_ENV_POLE1_MASS * c * c / total_mass));
+        float x_acc = temp - pole_mass_length * theta_acc * c / total_mass;
+
+        x[i] += tau * x_dot[i];
+        x_dot[i] += tau * x_acc;
+        theta[i] += tau * theta_dot[i];
+        theta_dot[i] += tau * theta_acc;
+    }
+    #endif
+}
+
+/*
+ * Double pole without friction, Euler integration (Wieland 1991):
+ *   F_i = m_i l_i w_i^2 sin(t_i) - 3/4 m_i g cos(t_i) sin(t_i)
+ *   M_i = m_i (1 - 3/4 cos^2(t_i))
+ *   x'' = (F + F_1 + F_2) / (M + M_1 + M_2)
+ *   t_i'' = 3/4 (g sin(t_i) - x'' cos(t_i)) / l_i
+ */
+#ifdef __AVX__
+/* Advance the eight instances starting at index i */
+static inline void pole_double_lanes(neat_pole_batch_t* batch, const float* forces, size_t i) {
+    const __m256 v_m1 = _mm256_set1_ps(NEAT_ENV_POLE1_MASS), v_l1 = _mm256_set1_ps(NEAT_ENV_POLE1_HALF_LEN);
+    const __m256 v_m2 = _mm256_set1_ps(NEAT_ENV_POLE2_MASS), v_l2 = _mm256_set1_ps(NEAT_ENV_POLE2_HALF_LEN);
+    const __m256 v_g = _mm256_set1_ps(NEAT_ENV_GRAVITY);
+    const __m256 v_cart = _mm256_set1_ps(NEAT_ENV_CART_MASS);
+    const __m256 v_one = _mm256_set1_ps(1.0f);
+    const __m256 v_three_quarters = _mm256_set1_ps(0.75f);
+    const __m256 v_tau = _mm256_set1_ps(batch->tau);
+    float* restrict x = batch->x;
+    float* restrict x_dot = batch->x_dot;
+    float* restrict t1 = batch->theta1;
+    float* restrict t1_dot = batch->theta1_dot;
+    float* restrict t2 = batch->theta2;
+    float* restrict t2_dot = batch->theta2_dot;
+
+    __m256 vx = _mm256_loadu_ps(x + i);
+    __m256 vxd = _mm256_loadu_ps(x_dot + i);
+    __m256 va = _mm256_loadu_ps(t1 + i);
+    __m256 vad = _mm256_loadu_ps(t1_dot + i);
+    __m256 vb = _mm256_loadu_ps(t2 + i);
+    __m256 vbd = _mm256_loadu_ps(t2_dot + i);
+    __m256 mask = _mm256_cmp_ps(_mm256_loadu_ps(batch->alive + i), _mm256_setzero_ps(), _CMP_GT_OQ);
+    __m256 f = _mm256_loadu_ps(forces + i);
+
+    __m256 sa = env_sin_ps(va), ca = env_cos_ps(va);
+    __m256 sb = env_sin_ps(vb), cb = env_cos_ps(vb);
+
+    __m256 fa = _mm256_sub_ps(
+        _mm256_mul_ps(_mm256_mul_ps(v_m1, v_l1), _mm256_mul_ps(_mm256_mul_ps(vad, vad), sa)),
+        _mm256_mul_ps(_mm256_mul_ps(v_three_quarters, _mm256_mul_ps(v_m1, v_g)), _mm256_mul_ps(ca, sa)));
+    __m256 fb = _mm256_sub_ps(
+        _mm256_mul_ps(_mm256_mul_ps(v_m2, v_l2), _mm256_mul_ps(_mm256_mul_ps(vbd, vbd), sb)),
+        _mm256_mul_ps(_mm256_mul_ps(v_three_quarters, _mm256_mul_ps(v_m2, v_g)), _mm256_mul_ps(cb, sb)));
+    __m256 ma = _mm256_mul_ps(v_m1, _mm256_sub_ps(v_one, _mm256_mul_ps(v_three_quarters, _mm256_mul_ps(ca, ca))));
+    __m256 mb = _mm256_mul_ps(v_m2, _mm256_sub_ps(v_one, _mm256_mul_ps(v_three_quarters, _mm256_mul_ps(cb, cb))));
+
+    __m256 x_acc = _mm256_div_ps(_mm256_add_ps(f, _mm256_add_ps(fa, fb)),
+                                 _mm256_add_ps(v_cart, _mm256_add_ps(ma, mb)));
+    __m256 a_acc = _mm256_div_ps(_mm256_mul_ps(v_three_quarters,
+        _mm256_sub_ps(_mm256_mul_ps(v_g, sa), _mm256_mul_ps(x_acc, ca))), v_l1);
+    __m256 b_acc = _mm256_div_ps(_mm256_mul_ps(v_three_quarters,
+        _mm256_sub_ps(_mm256_mul_ps(v_g, sb), _mm256_mul_ps(x_acc, cb))), v_l2);
+
+    _mm256_storeu_ps(x + i, _mm256_blendv_ps(vx, _mm256_add_ps(vx, _mm256_mul_ps(v_tau, vxd)), mask));
+    _mm256_storeu_ps(x_dot + i, _mm256_blendv_ps(vxd, _mm256_add_ps(vxd, _mm256_mul_ps(v_tau, x_acc)), mask));
+    _mm256_storeu_ps(t1 + i, _mm256_blendv_ps(va, _mm256_add_ps(va, _mm256_mul_ps(v_tau, vad)), mask));
+    _mm256_storeu_ps(t1_dot + i, _mm256_blendv_ps(vad, _mm256_add_ps(vad, _mm256_mul_ps(v_tau, a_acc)), mask));
+    _mm256_storeu_ps(t2 + i, _mm256_blendv_ps(vb, _mm256_add_ps(vb, _mm256_mul_ps(v_tau, vbd)), mask));
+    _mm256_storeu_ps(t2_dot + i, _mm256_blendv_ps(vbd, _mm256_add_ps(vbd, _mm256_mul_ps(v_tau, b_acc)), mask));
+}
+#endif
+
+static void pole_step_double(neat_pole_batch_t* batch, const float* forces) {
+    #ifdef __AVX__
+    size_t i = 0;
+    for (; i + 7 < batch->count; i += 8) {
+        pole_double_lanes(batch, forces, i);
+    }
+    if (i < batch->count) {
+        pole_step_padded(batch, forces, i, pole_double_lanes);
+    }
+    #else
+    const float m1 = NEAT_ENV_POLE1_MASS, l1 = NEAT_ENV_POLE1_HALF_LEN;
+    const float m2 = NEAT_ENV_POLE2_MASS, l2 = NEAT_ENV_POLE2_HALF_LEN;
+    const float g = NEAT_ENV_GRAVITY;
+    const float tau = batch->tau;
+    float* restrict x = batch->x;
+    float* restrict x_dot = batch->x_dot;
+    float* restrict t1 = batch->theta1;
+    float* restrict t1_dot = batch->theta1_dot;
+    float* restrict t2 = batch->theta2;
+    float* restrict t2_dot = batch->theta2_dot;
+    const float* restrict alive = batch->alive;
+
+    for (size_t i = 0; i < batch->count; i++) {
+        if (alive[i] <= 0.0f) continue;
+
+        float sa = env_sin(t1[i]), ca = env_cos(t1[i]);
+        float sb = env_sin(t2[i]), cb = env_cos(t2[i]);
+        float fa = m1 * l1 * t1_dot[i] * t1_dot[i] * sa - 0.75f * m1 * g * ca * sa;
+        float fb = m2 * l2 * t2_dot[i] * t2_dot[i] * sb - 0.75f * m2 * g * cb * sb;
+        float ma = m1 * (1.0f - 0.75f * ca * ca);
+        float mb = m2 * (1.0f - 0.75f * cb * cb);
+        float x_acc = (forces[i] + fa + fb) / (NEAT_ENV_CART_MASS + ma + mb);
+        float a_acc = 0.75f * (g * sa - x_acc * ca) / l1;
+        float b_acc = 0.75f * (g * sb - x_acc * cb) / l2;
+
+        x[i] += tau * x_dot[i];
+        x_dot[i] += tau * x_acc;
+        t1[i] += tau * t1_dot[i];
+        t1_dot[i] += tau * a_acc;
+        t2[i] += tau * t2_dot[i];
+        t2_dot[i] += tau * b_acc;
+    }
+    #endif
+}
+
+/* Advance every live instance by one timestep; returns the number still balancing */
+size_t neat_pole_batch_step(neat_pole_batch_t* batch, const float* forces) {
+    if (!batch || !forces) return 0;
+
+    if (batch->num_poles == 1) {
+        pole_step_single(batch, forces);
+    } else {
+        pole_step_double(batch, forces);
+    }
+
+    /* Failure detection and step counting */
+    size_t alive_count = 0;
+    for (size_t i = 0; i < batch->count; i++) {
+        if (batch->alive[i] <= 0.0f) continue;
+
+        bool failed = fabsf(batch->x[i]) > NEAT_ENV_TRACK_LIMIT ||
+                      fabsf(batch->theta1[i]) > batch->fail_angle;
+        if (batch->num_poles == 2) {
+            failed = failed || fabsf(batch->theta2[i]) > batch->fail_angle;
+        }
+
+        if (failed) {
+            batch->alive[i] = 0.0f;
+        } else {
+            batch->steps[i]++;
+            alive_count++;
+        }
+    }
+
+    batch->alive_count = alive_count;
+    return alive_count;
+}
+
+size_t neat_pole_batch_observation_size(const neat_pole_batch_t* batch) {
+    if (!batch) return 0;
+    size_t per_body = batch->velocities ? 2 : 1;
+    return per_body * (size_t)(1 + batch->num_poles);
+}
+
+/* Write the scaled observation of one instance into obs */
+void neat_pole_batch_observe(const neat_pole_batch_t* batch, size_t index, double* obs) {
+    if (!batch || !obs || index >= batch->count) return;
+
+    size_t k = 0;
+    obs[k++] = batch->x[index] / NEAT_ENV_TRACK_LIMIT;
+    if (batch->velocities) obs[k++] = batch->x_dot[index] / 2.0;
+    obs[k++] = batch->theta1[index] / batch->fail_angle;
+    if (batch->velocities) obs[k++] = batch->theta1_dot[index] / 2.0;
+    if (batch->num_poles == 2) {
+        obs[k++] = batch->theta2[index] / batch->fail_angle;
+        if (batch->velocities) obs[k++] = batch->theta2_dot[index] / 2.0;
+    }
+}
+
+/* Pole balancing task */
+neat_pole_task_t neat_pole_task_default(int num_poles, bool velocities) {
+    neat_pole_task_t task;
+    task.num_poles = num_poles;
+    task.velocities = velocities;
+    task.instances = NEAT_ENV_DEFAULT_INSTANCES;
+    task.max_steps = NEAT_ENV_DEFAULT_MAX_STEPS;
+    task.seed = 12345;
+    return task;
+}
+
+/*
+ * Run one genome on task->instances start states in lockstep.
+ * The first output (sigmoid, [0, 1]) maps to a force in [-F, F].
+ * Fitness is the mean number of steps balanced. Under an evaluation
+ * timeout, episodes stop when cancelled and a retry runs the reduced
+ * budget of steps.
+ */
+double neat_env_pole_fitness(neat_genome_t* genome, void* user_data) {
+    const neat_pole_task_t* task = (const neat_pole_task_t*)user_data;
+    if (!genome || !task || task->instances == 0) {
+        return 0.0;
+    }
+
+    neat_pole_batch_t* batch = neat_pole_batch_create(task->instances, task->num_poles,
+                                                      task->velocities);
+    if (!batch) {
+        return 0.0;
+    }
+    neat_pole_batch_reset(batch, task->seed, task->instances > 1 ? 1.0f : 0.0f);
+
+    float* forces = (float*)neat_calloc(batch->count, sizeof(float));
+    double obs[6];
+    double out[NEAT_MAX_OUTPUTS];
+
+    int max_steps = (int)(task->max_steps * neat_eval_budget());
+    for (int step = 0; step < max_steps && batch->alive_count > 0 && !neat_eval_cancelled(); step++) {
+        for (size_t i = 0; i < batch->count; i++) {
+            if (batch->alive[i] <= 0.0f) {
+                forces[i] = 0.0f;
+                continue;
+            }
+            neat_pole_batch_observe(batch, i, obs);
+            neat_evaluate(genome, obs, out);
+            forces[i] = (float)((2.0 * out[0] - 1.0) * NEAT_ENV_FORCE_MAG);
+        }
+        neat_pole_batch_step(batch, forces);
+    }
+
+    double total_steps = 0.0;
+    for (size_t i = 0; i < batch->count; i++) {
+        total_steps += batch->steps[i];
+    }
+
+    neat_free(forces);
+    neat_pole_batch_free(batch);
+
+    return total_steps / (double)task->instances;
+}
@@ -0,0 +1,227 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/eval_profile.h"
+
+#define EVAL_PROFILE_BAR_WIDTH 40
+
+/* Histograms */
+
+size_t neat_eval_histogram_bucket(double seconds) {
+    double micros = seconds * 1e6;
+    if (!(micros >= 1.0)) return 0;
+    int exponent;
+    frexp(micros, &exponent);   /* micros in [2^(exponent-1), 2^exponent) */
+    return exponent < NEAT_EVAL_PROFILE_BUCKETS ? (size_t)exponent : NEAT_EVAL_PROFILE_BUCKETS - 1;
+}
+
+/* Exclusive upper bound of a bucket in seconds */
+double neat_eval_histogram_upper_bound(size_t bucket) {
+    if (bucket >= NEAT_EVAL_PROFILE_BUCKETS - 1) return INFINITY;
+    return ldexp(1e-6, (int)bucket);
+}
+
+static void histogram_add(neat_eval_histogram_t *histogram, double seconds) {
+    histogram->counts[neat_eval_histogram_bucket(seconds)]++;
+    histogram->count++;
+    histogram->total_time += seconds;
+    if (seconds > histogram->max_time) histogram->max_time = seconds;
+}
+
+static void histogram_merge(neat_eval_histogram_t *into, const neat_eval_histogram_t *from) {
+    for (size_t b = 0; b < NEAT_EVAL_PROFILE_BUCKETS; b++) {
+        into->counts[b] += from->counts[b];
+    }
+    into->count += from->count;
+    into->total_time += from->total_time;
+    if (from->max_time > into->max_time) into->max_time = from->max_time;
+}
+
+/* Upper estimate of a percentile: the bound of the bucket it falls in, capped at the maximum */
+double neat_eval_histogram_percentile(const neat_eval_histogram_t *histogram, double fraction) {
+    if (!histogram || histogram->count == 0) return 0.0;
+    size_t rank = (size_t)ceil(fraction * (double)histogram->count);
+    if (rank < 1) rank = 1;
+    size_t seen = 0;
+    for (size_t b = 0; b < NEAT_EVAL_PROFILE_BUCKETS; b++) {
+        seen += histogram->counts[b];
+        if (seen >= rank) {
+            return fmin(neat_eval_histogram_upper_bound(b), histogram->max_time);
+        }
+    }
+    return histogram->max_time;
+}
+
+/* Lifecycle */
+
+neat_eval_profile_t* neat_eval_profile_create(double outlier_percentile) {
+    if (!(outlier_percentile > 0.0 && outlier_percentile <= 1.0)) return NULL;
+
+    neat_eval_profile_t *profile = (neat_eval_profile_t*)neat_calloc(1, sizeof(neat_eval_profile_t));
+    profile->outlier_percentile = outlier_percentile;
+    profile->max_outliers = NEAT_EVAL_PROFILE_MAX_OUTLIERS;
+    return profile;
+}
+
+void neat_eval_profile_free(neat_eval_profile_t *profile) {
+    if (!profile) return;
+    neat_free(profile->species);
+    neat_free(profile->outliers);
+    neat_free(profile->scratch);
+    neat_free(profile);
+}
+
+/* Recording */
+
+static int compare_times(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void outlier_describe(neat_eval_outlier_t *outlier, const neat_genome_t *genome) {
+    size_t disabled = 0;
+    for (size_t j = 0; j < genome->connection_count; j++) {
+        if (!genome->connections[j].enabled) disabled++;
+    }
+    outlier->genome_id = genome->id;
+    outlier->species_id = genome->species_id;
+    outlier->eval_time = genome->eval_time;
+    outlier->node_count = genome->node_count;
+    outlier->connection_count = genome->connection_count;
+    outlier->disabled_ratio = genome->connection_count > 0
+                            ? (double)disabled / (double)genome->connection_count : 0.0;
+}
+
+/* Profile the evaluated, speciated generation */
+void neat_eval_profile_capture(neat_eval_profile_t *profile, const neat_population_t *pop) {
+    if (!profile || !pop) return;
+
+    size_t n = pop->genome_count;
+    profile->generation = pop->generation;
+    memset(&profile->histogram, 0, sizeof(profile->histogram));
+    profile->outlier_count = 0;
+    profile->threshold = 0.0;
+    profile->time_per_connection = 0.0;
+    if (n == 0) return;
+
+    if (profile->scratch_capacity < n) {
+        neat_free(profile->scratch);
+        profile->scratch = (double*)neat_malloc(n * sizeof(double));
+        profile->scratch_capacity = n;
+    }
+    size_t connections = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_genome_t *genome = pop->genomes[i];
+        histogram_add(&profile->histogram, genome->eval_time);
+        profile->scratch[i] = genome->eval_time;
+        connections += genome->connection_count;
+    }
+    if (profile->outlier_capacity < profile->max_outliers) {
+        neat_free(profile->outliers);
+        profile->outlier_capacity = profile->max_outliers;
+        profile->outliers = (neat_eval_outlier_t*)neat_malloc(profile->outlier_capacity * sizeof(neat_eval_outlier_t));
+    }
+    if (connections > 0) {
+        profile->time_per_connection = profile->histogram.total_time / (double)connections;
+    }
+    histogram_merge(&profile->run_histogram, &profile->histogram);
+    profile->generations++;
+
+    /* Per species, in population species order */
+    if (profile->species_capacity < pop->species_count) {
+        neat_free(profile->species);
+        profile->species_capacity = pop->species_count;
+        profile->species = (neat_eval_species_profile_t*)neat_malloc(
+            profile->species_capacity * sizeof(neat_eval_species_profile_t));
+    }
+    profile->species_count = pop->species_count;
+    for (size_t s = 0; s < pop->species_count; s++) {
+        const neat_species_t *species = pop->species[s];
+        neat_eval_species_profile_t *entry = &profile->species[s];
+        entry->species_id = species->id;
+        memset(&entry->histogram, 0, sizeof(entry->histogram));
+        for (size_t m = 0; m < species->member_count; m++) {
+            histogram_add(&entry->histogram, species->members[m]->eval_time);
+        }
+    }
+
+    /* Outliers: strictly slower than the percentile, slowest kept first */
+    qsort(profile->scratch, n, sizeof(double), compare_times);
+    size_t rank = (size_t)ceil(profile->outlier_percentile * (double)n);
+    profile->threshold = profile->scratch[rank > 0 ? rank - 1 : 0];
+    for (size_t i = 0; i < n; i++) {
+        const neat_genome_t *genome = pop->genomes[i];
+        if (!(genome->eval_time > profile->threshold)) continue;
+        profile->total_outliers++;
+
+        size_t slot = profile->outlier_count;
+        if (slot == profile->max_outliers) {
+            if (slot == 0 || genome->eval_time <= profile->outliers[slot - 1].eval_time) continue;
+            slot--;
+        } else {
+            profile->outlier_count++;
+        }
+        while (slot > 0 && profile->outliers[slot - 1].eval_time < genome->eval_time) {
+            profile->outliers[slot] = profile->outliers[slot - 1];
+            slot--;
+        }
+        outlier_describe(&profile->outliers[slot], genome);
+    }
+}
+
+/* Reporting */
+
+static void print_histogram(const neat_eval_histogram_t *histogram, FILE *fp) {
+    uint32_t peak = 0;
+    for (size_t b = 0; b < NEAT_EVAL_PROFILE_BUCKETS; b++) {
+        if (histogram->counts[b] > peak) peak = histogram->counts[b];
+    }
+    for (size_t b = 0; b < NEAT_EVAL_PROFILE_BUCKETS; b++) {
+        if (histogram->counts[b] == 0) continue;
+        int width = (int)((double)histogram->counts[b] / peak * EVAL_PROFILE_BAR_WIDTH + 0.5);
+        char bar[EVAL_PROFILE_BAR_WIDTH + 1];
+        memset(bar, '#', (size_t)width);
+        bar[width] = '\0';
+        double upper = neat_eval_histogram_upper_bound(b);
+        if (isinf(upper)) {
+            fprintf(fp, "  %10s+ us %8u %s\n", "", histogram->counts[b], bar);
+        } else {
+            fprintf(fp, "  < %10.0f us %8u %s\n", upper * 1e6, histogram->counts[b], bar);
+        }
+    }
+}
+
+void neat_eval_profile_print(const neat_eval_profile_t *profile, FILE *fp) {
+    if (!profile || !fp) return;
+
+    const neat_eval_histogram_t *h = &profile->histogram;
+    fprintf(fp, "Evaluation cost, generation %d: %zu genomes, mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            profile->generation, h->count,
+            h->count > 0 ? h->total_time / (double)h->count * 1e6 : 0.0,
+            neat_eval_histogram_percentile(h, 0.5) * 1e6,
+            neat_eval_histogram_percentile(h, 0.99) * 1e6, h->max_time * 1e6);
+    fprintf(fp, "  %.3f us per connection\n", profile->time_per_connection * 1e6);
+    print_histogram(h, fp);
+
+    fprintf(fp, "By species:\n");
+    for (size_t s = 0; s < profile->species_count; s++) {
+        const neat_eval_histogram_t *sh = &profile->species[s].histogram;
+        fprintf(fp, "  species %-6d %6zu genomes, mean %10.1f us, max %10.1f us, total %6.1f%%\n",
+                profile->species[s].species_id, sh->count,
+                sh->count > 0 ? sh->total_time / (double)sh->count * 1e6 : 0.0, sh->max_time * 1e6,
+                h->total_time > 0.0 ? 100.0 * sh->total_time / h->total_time : 0.0);
+    }
+
+    fprintf(fp, "Outliers above p%g (%.1f us):\n", profile->outlier_percentile * 100.0, profile->threshold * 1e6);
+    for (size_t i = 0; i < profile->outlier_count; i++) {
+        const neat_eval_outlier_t *o = &profile->outliers[i];
+        fprintf(fp, "  genome %-8d species %-6d %10.1f us %6zu nodes %6zu connections %5.1f%% disabled\n",
+                o->genome_id, o->species_id, o->eval_time * 1e6, o->node_count, o->connection_count,
+                o->disabled_ratio * 100.0);
+    }
+    fprintf(fp, "Run: %zu generations, %zu evaluations, %zu outliers, p99 %.1f us, max %.1f us\n",
+            profile->generations, profile->run_histogram.count, profile->total_outliers,
+            neat_eval_histogram_percentile(&profile->run_histogram, 0.99) * 1e6,
+            profile->run_histogram.max_time * 1e6);
+}
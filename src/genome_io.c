@@ -0,0 +1,570 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+#include "../include/genome_io.h"
+
+/* Worst-case encoded sizes */
+#define VARINT_MAX_BYTES 10
+#define NODE_MAX_BYTES   (VARINT_MAX_BYTES + 2 + 8)
+#define CONN_MAX_BYTES   (3 * VARINT_MAX_BYTES + 8)
+
+/* CRC-32C (Castagnoli), hardware accelerated when SSE4.2 is available */
+uint32_t neat_crc32c(uint32_t crc, const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t*)data;
+    crc = ~crc;
+
+#ifdef __SSE4_2__
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = (uint32_t)_mm_crc32_u64(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+        size--;
+    }
+#else
+    while (size > 0) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+        }
+        size--;
+    }
+#endif
+
+    return ~crc;
+}
+
+/* Encoding helpers */
+static uint8_t* put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint8_t* put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+    return p + 8;
+}
+
+static uint8_t* put_varint(uint8_t *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t* put_real(uint8_t *p, double v, bool float32) {
+    if (float32) {
+        float f = (float)v;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return put_u32(p, bits);
+    }
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return put_u64(p, bits);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+ * Bounded reader over one record's payload. Bytes are pulled from the file
+ * in chunks that never cross the end of the record, so the stream is left
+ * positioned at the next record; the checksum is updated as bytes arrive.
+ */
+typedef struct {
+    FILE *fp;
+    uint8_t buf[4096];
+    size_t pos;
+    size_t len;
+    size_t remaining;           /* Payload bytes not yet pulled from the file */
+    uint32_t crc;
+    bool error;
+} genome_reader_t;
+
+static bool reader_fill(genome_reader_t *r) {
+    size_t want = r->remaining < sizeof(r->buf) ? r->remaining : sizeof(r->buf);
+    if (want == 0 || fread(r->buf, 1, want, r->fp) != want) {
+        r->error = true;
+        return false;
+    }
+    r->crc = neat_crc32c(r->crc, r->buf, want);
+    r->remaining -= want;
+    r->pos = 0;
+    r->len = want;
+    return true;
+}
+
+static uint8_t read_u8(genome_reader_t *r) {
+    if (r->pos == r->len && !reader_fill(r)) return 0;
+    return r->buf[r->pos++];
+}
+
+static uint64_t read_varint(genome_reader_t *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = read_u8(r);
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->error = true;
+    return 0;
+}
+
+static double read_real(genome_reader_t *r, bool float32) {
+    uint64_t bits = 0;
+    int bytes = float32 ? 4 : 8;
+    for (int i = 0; i < bytes; i++) {
+        bits |= (uint64_t)read_u8(r) << (8 * i);
+    }
+    if (float32) {
+        uint32_t bits32 = (uint32_t)bits;
+        float f;
+        memcpy(&f, &bits32, sizeof(f));
+        return f;
+    }
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/* Write one genome record; returns 1 on success, 0 on failure */
+int neat_save_genome(FILE* fp, const neat_genome_t *genome, neat_weight_format_t format) {
+    if (!fp || !genome) return 0;
+
+    bool float32 = (format == NEAT_WEIGHTS_FLOAT32);
+    size_t bound = NEAT_GENOME_HEADER_SIZE + 4 * VARINT_MAX_BYTES + 8 +
+                   genome->node_count * NODE_MAX_BYTES +
+                   genome->connection_count * CONN_MAX_BYTES + 4;
+    uint8_t *record = (uint8_t*)neat_malloc(bound);
+
+    /* Payload */
+    uint8_t *p = record + NEAT_GENOME_HEADER_SIZE;
+    p = put_varint(p, zigzag(genome->id));
+    p = put_varint(p, zigzag(genome->species_id));
+    p = put_real(p, genome->fitness, false);
+    p = put_varint(p, genome->node_count);
+    p = put_varint(p, genome->connection_count);
+
+    int64_t prev_id = -1;
+    for (size_t i = 0; i < genome->node_count; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        p = put_varint(p, zigzag((int64_t)node->id - prev_id));
+        prev_id = node->id;
+        *p++ = (uint8_t)((node->type & 0x0F) | ((node->placement & 0x0F) << 4));
+        *p++ = (uint8_t)node->activation_type;
+        p = put_real(p, node->bias, float32);
+    }
+
+    int64_t prev_innov = 0, prev_in = 0, prev_out = 0;
+    for (size_t i = 0; i < genome->connection_count; i++) {
+        const neat_connection_t *conn = &genome->connections[i];
+        p = put_varint(p, zigzag((int64_t)conn->innovation - prev_innov));
+        p = put_varint(p, zigzag((int64_t)conn->in_node - prev_in));
+        p = put_varint(p, (zigzag((int64_t)conn->out_node - prev_out) << 1) | (conn->enabled ? 1u : 0u));
+        prev_innov = conn->innovation;
+        prev_in = conn->in_node;
+        prev_out = conn->out_node;
+        p = put_real(p, conn->weight, float32);
+    }
+
+    /* Header and checksum */
+    size_t payload = (size_t)(p - record) - NEAT_GENOME_HEADER_SIZE;
+    uint8_t *h = put_u32(record, NEAT_GENOME_FORMAT_MAGIC);
+    *h++ = NEAT_GENOME_FORMAT_VERSION;
+    *h++ = float32 ? NEAT_GENOME_FLAG_FLOAT32 : 0;
+    *h++ = 0;
+    *h++ = 0;
+    put_u32(h, (uint32_t)payload);
+    p = put_u32(p, neat_crc32c(0, record, NEAT_GENOME_HEADER_SIZE + payload));
+
+    size_t total = (size_t)(p - record);
+    int ok = payload <= NEAT_GENOME_MAX_PAYLOAD && fwrite(record, 1, total, fp) == total;
+    neat_free(record);
+    return ok;
+}
+
+/*
+ * Read the next genome record from the stream. Returns NULL at end of file or
+ * on a malformed, truncated or corrupted record. Genes are decoded in a single
+ * pass straight into exactly sized arrays.
+ */
+neat_genome_t* neat_load_genome(FILE* fp) {
+    if (!fp) return NULL;
+
+    uint8_t header[NEAT_GENOME_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) return NULL;
+
+    uint8_t version = header[4];
+    uint8_t flags = header[5];
+    uint32_t payload = get_u32(header + 8);
+    if (get_u32(header) != NEAT_GENOME_FORMAT_MAGIC || version != NEAT_GENOME_FORMAT_VERSION ||
+        (flags & ~NEAT_GENOME_FLAG_FLOAT32) || payload > NEAT_GENOME_MAX_PAYLOAD) {
+        return NULL;
+    }
+    bool float32 = (flags & NEAT_GENOME_FLAG_FLOAT32) != 0;
+
+    genome_reader_t r;
+    r.fp = fp;
+    r.pos = r.len = 0;
+    r.remaining = payload;
+    r.crc = neat_crc32c(0, header, sizeof(header));
+    r.error = false;
+
+    int id = (int)unzigzag(read_varint(&r));
+    int species_id = (int)unzigzag(read_varint(&r));
+    double fitness = read_real(&r, false);
+    uint64_t node_count = read_varint(&r);
+    uint64_t connection_count = read_varint(&r);
+
+    /* Every gene takes at least 4 bytes, which bounds the counts before allocating */
+    if (r.error || node_count > NEAT_MAX_NODES || connection_count > NEAT_MAX_CONNECTIONS ||
+        (node_count + connection_count) * 4 > payload) {
+        return NULL;
+    }
+
+    neat_genome_t *genome = (neat_genome_t*)neat_calloc_tagged(NEAT_MEM_GENOMES, 1, sizeof(neat_genome_t));
+    genome->id = id;
+    genome->species_id = species_id;
+    genome->fitness = fitness;
+    genome->parent1_id = -1;
+    genome->parent2_id = -1;
+    genome->node_capacity = node_count > 0 ? node_count : 1;
+    genome->nodes = (neat_node_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->node_capacity * sizeof(neat_node_t));
+    genome->connection_capacity = connection_count > 0 ? connection_count : 1;
+    genome->connections = (neat_connection_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->connection_capacity * sizeof(neat_connection_t));
+
+    int64_t prev_id = -1;
+    for (size_t i = 0; i < node_count; i++) {
+        int64_t node_id = prev_id + unzigzag(read_varint(&r));
+        uint8_t kind = read_u8(&r);
+        uint8_t activation = read_u8(&r);
+        double bias = read_real(&r, float32);
+        prev_id = node_id;
+
+        neat_node_t node = neat_create_node((int)node_id, (neat_node_type_t)(kind & 0x0F),
+                                            (neat_node_placement_t)(kind >> 4));
+        node.activation_type = (neat_activation_type_t)activation;
+        node.bias = bias;
+        genome->nodes[i] = node;
+
+        if (activation > NEAT_ACTIVATION_ABS || (kind & 0x0F) > NEAT_NODE_BIAS ||
+            (kind >> 4) > NEAT_PLACEMENT_OUTPUT) {
+            r.error = true;
+        }
+    }
+    genome->node_count = node_count;
+
+    int64_t prev_innov = 0, prev_in = 0, prev_out = 0;
+    for (size_t i = 0; i < connection_count; i++) {
+        int64_t innovation = prev_innov + unzigzag(read_varint(&r));
+        int64_t in_node = prev_in + unzigzag(read_varint(&r));
+        uint64_t out_field = read_varint(&r);
+        int64_t out_node = prev_out + unzigzag(out_field >> 1);
+        double weight = read_real(&r, float32);
+        prev_innov = innovation;
+        prev_in = in_node;
+        prev_out = out_node;
+
+        genome->connections[i] = neat_create_connection((int)innovation, (int)in_node, (int)out_node,
+                                                        weight, (out_field & 1) != 0);
+    }
+    genome->connection_count = connection_count;
+
+    /* The whole payload must have been consumed, followed by a matching checksum */
+    uint8_t trailer[4];
+    if (r.error || r.remaining != 0 || r.pos != r.len ||
+        fread(trailer, 1, sizeof(trailer), fp) != sizeof(trailer) ||
+        get_u32(trailer) != r.crc) {
+        neat_free_genome(genome);
+        return NULL;
+    }
+
+    return genome;
+}
+
+/* Write all genomes to a new file; returns 1 on success, 0 on failure */
+int neat_save_genomes(const char *filename, neat_genome_t **genomes, size_t count,
+                      neat_weight_format_t format) {
+    if (!filename || (count > 0 && !genomes)) return 0;
+
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) return 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!neat_save_genome(fp, genomes[i], format)) {
+            fclose(fp);
+            return 0;
+        }
+    }
+
+    return fclose(fp) == 0;
+}
+
+/* Read every genome of a file; returns NULL if the file is missing or any record is bad */
+neat_genome_t** neat_load_genomes(const char *filename, size_t *count) {
+    if (!filename || !count) return NULL;
+    *count = 0;
+
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+
+    size_t capacity = NEAT_DEFAULT_ALLOC_SIZE;
+    neat_genome_t **genomes = (neat_genome_t**)neat_malloc_tagged(NEAT_MEM_GENOMES, capacity * sizeof(neat_genome_t*));
+    size_t n = 0;
+
+    /* Stopping anywhere but at a record boundary at end of file means a bad record */
+    bool ok = true;
+    int c;
+    while ((c = getc(fp)) != EOF) {
+        ungetc(c, fp);
+        neat_genome_t *genome = neat_load_genome(fp);
+        if (!genome) {
+            ok = false;
+            break;
+        }
+        if (n >= capacity) {
+            capacity *= NEAT_GROWTH_FACTOR;
+            genomes = (neat_genome_t**)neat_realloc(genomes, capacity * sizeof(neat_genome_t*));
+        }
+        genomes[n++] = genome;
+    }
+
+    if (ferror(fp)) ok = false;
+    fclose(fp);
+    if (!ok) {
+        for (size_t i = 0; i < n; i++) {
+            neat_free_genome(genomes[i]);
+        }
+        neat_free(genomes);
+        return NULL;
+    }
+
+    *count = n;
+    return genomes;
+}
+
+/* Standalone header export */
+
+/* C source of each activation, matching the library's evaluation */
+static const char *export_activation_body(neat_activation_type_t type) {
+    switch (type) {
+        case NEAT_ACTIVATION_TANH: return "return tanh(x);";
+        case NEAT_ACTIVATION_RELU: return "return x > 0.0 ? x : 0.0;";
+        case NEAT_ACTIVATION_LEAKY_RELU: return "return x > 0.0 ? x : 0.01 * x;";
+        case NEAT_ACTIVATION_LINEAR: return "return x;";
+        case NEAT_ACTIVATION_STEP: return "return x > 0.0 ? 1.0 : 0.0;";
+        case NEAT_ACTIVATION_SOFTSIGN: return "return x / (1.0 + fabs(x));";
+        case NEAT_ACTIVATION_SIN: return "return sin(x);";
+        case NEAT_ACTIVATION_GAUSSIAN: return "return exp(-(x * x));";
+        case NEAT_ACTIVATION_ABS: return "return fabs(x);";
+        default: return "return 1.0 / (1.0 + exp(-x));";
+    }
+}
+
+/* Activations outside the enum evaluate as sigmoid, so they share its function */
+static neat_activation_type_t export_activation(neat_activation_type_t type) {
+    return (unsigned)type <= NEAT_ACTIVATION_ABS ? type : NEAT_ACTIVATION_SIGMOID;
+}
+
+static bool export_name_valid(const char *name) {
+    if (!name || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return false;
+    for (const char *p = name; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '_') return false;
+    }
+    return true;
+}
+
+/* Doubles print so they read back exactly */
+static void export_real(FILE *fp, double v) {
+    if (isnan(v)) fputs("NAN", fp);
+    else if (isinf(v)) fputs(v > 0 ? "INFINITY" : "-INFINITY", fp);
+    else fprintf(fp, "%.17g", v);
+}
+
+/* Separator before the k-th initializer element, wrapping every per_line elements */
+static const char *export_separator(size_t k, size_t per_line) {
+    if (k == 0) return "\n    ";
+    return k % per_line ? ", " : ",\n    ";
+}
+
+/*
+ * Write `genome` as a self-contained C header. The network is unrolled in
+ * the order neat_evaluate runs it: each non-input node sums its enabled
+ * incoming connections from active nodes in gene order, adds its bias and
+ * applies its activation. Sources and weights live in static const arrays
+ * laid out in that order, and <name>_forward calls the activation of each
+ * node directly. The forward function keeps node values on the stack and
+ * needs only <math.h>. Returns 1 on success, 0 on failure.
+ */
+int neat_export_header(const neat_genome_t *genome, const char *name, const char *path) {
+    if (!genome || !path || !export_name_valid(name) || genome->node_count == 0) return 0;
+
+    size_t n = genome->node_count;
+    for (size_t c = 0; c < genome->connection_count; c++) {
+        int in = genome->connections[c].in_node;
+        if (genome->connections[c].enabled && (in < 0 || (size_t)in >= n)) return 0;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) return 0;
+
+    size_t input_count = 0, output_count = 0, computed = 0, weight_count = 0;
+    bool used[NEAT_ACTIVATION_ABS + 1] = { false };
+    for (size_t i = 0; i < n; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        if (node->type == NEAT_NODE_INPUT) {
+            input_count++;
+            continue;
+        }
+        if (node->type == NEAT_NODE_OUTPUT) output_count++;
+        used[export_activation(node->activation_type)] = true;
+        computed++;
+        for (size_t c = 0; c < genome->connection_count; c++) {
+            const neat_connection_t *conn = &genome->connections[c];
+            if (conn->out_node == node->id && conn->enabled && genome->nodes[conn->in_node].active) {
+                weight_count++;
+            }
+        }
+    }
+    if (input_count > NEAT_MAX_INPUTS) input_count = NEAT_MAX_INPUTS;
+    if (output_count > NEAT_MAX_OUTPUTS) output_count = NEAT_MAX_OUTPUTS;
+
+    char upper[256];
+    size_t len = strlen(name);
+    if (len >= sizeof(upper)) len = sizeof(upper) - 1;
+    for (size_t i = 0; i < len; i++) upper[i] = (char)toupper((unsigned char)name[i]);
+    upper[len] = '\0';
+
+    fprintf(fp, "/* Generated by neat_export_header from genome %d: %zu nodes, %zu weights */\n",
+            genome->id, n, weight_count);
+    fprintf(fp, "#ifndef %s_H\n#define %s_H\n\n#include <math.h>\n\n", upper, upper);
+    fprintf(fp, "#define %s_INPUTS %zu\n#define %s_OUTPUTS %zu\n#define %s_NODES %zu\n\n",
+            upper, input_count, upper, output_count, upper, n);
+
+    /* Connections in evaluation order: source node and weight */
+    fprintf(fp, "static const int %s_sources[%zu] = {", name, weight_count > 0 ? weight_count : 1);
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        if (node->type == NEAT_NODE_INPUT) continue;
+        for (size_t c = 0; c < genome->connection_count; c++) {
+            const neat_connection_t *conn = &genome->connections[c];
+            if (conn->out_node == node->id && conn->enabled && genome->nodes[conn->in_node].active) {
+                fprintf(fp, "%s%d", export_separator(k++, 16), conn->in_node);
+            }
+        }
+    }
+    fprintf(fp, "%s};\n", weight_count > 0 ? "\n" : "0");
+
+    fprintf(fp, "static const double %s_weights[%zu] = {", name, weight_count > 0 ? weight_count : 1);
+    k = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        if (node->type == NEAT_NODE_INPUT) continue;
+        for (size_t c = 0; c < genome->connection_count; c++) {
+            const neat_connection_t *conn = &genome->connections[c];
+            if (conn->out_node == node->id && conn->enabled && genome->nodes[conn->in_node].active) {
+                fputs(export_separator(k++, 4), fp);
+                export_real(fp, conn->weight);
+            }
+        }
+    }
+    fprintf(fp, "%s};\n", weight_count > 0 ? "\n" : "0.0");
+
+    /* Biases of the computed nodes, in evaluation order */
+    fprintf(fp, "static const double %s_biases[%zu] = {", name, computed > 0 ? computed : 1);
+    k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (genome->nodes[i].type == NEAT_NODE_INPUT) continue;
+        fputs(export_separator(k++, 4), fp);
+        export_real(fp, genome->nodes[i].bias);
+    }
+    fprintf(fp, "%s};\n\n", computed > 0 ? "\n" : "0.0");
+
+    /* Only the activations this network uses */
+    static const char *activation_names[] = {
+        "sigmoid", "tanh", "relu", "leaky_relu", "linear", "step", "softsign", "sin", "gaussian", "abs"
+    };
+    for (int a = 0; a <= NEAT_ACTIVATION_ABS; a++) {
+        if (!used[a]) continue;
+        fprintf(fp, "static inline double %s_%s(double x) { %s }\n",
+                name, activation_names[a], export_activation_body((neat_activation_type_t)a));
+    }
+
+    /* Forward pass */
+    fprintf(fp, "\n/* inputs[%s_INPUTS] -> outputs[%s_OUTPUTS] */\n", upper, upper);
+    fprintf(fp, "static inline void %s_forward(const double *inputs, double *outputs) {\n", name);
+    fprintf(fp, "    double v[%s_NODES];\n    double s;\n    int i;\n", upper);
+    if (weight_count == 0) fputs("    (void)i;\n", fp);
+    if (computed == 0) fputs("    (void)s;\n", fp);
+    size_t input_index = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        if (node->type == NEAT_NODE_INPUT && input_index < NEAT_MAX_INPUTS) {
+            fprintf(fp, "    v[%zu] = inputs[%zu];\n", i, input_index++);
+        } else {
+            fprintf(fp, "    v[%zu] = %s;\n", i, node->type == NEAT_NODE_BIAS ? "1.0" : "0.0");
+        }
+    }
+    if (input_index == 0) fputs("    (void)inputs;\n", fp);
+
+    size_t offset = 0, bias_index = 0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_node_t *node = &genome->nodes[i];
+        if (node->type == NEAT_NODE_INPUT) continue;
+        size_t fan_in = 0;
+        for (size_t c = 0; c < genome->connection_count; c++) {
+            const neat_connection_t *conn = &genome->connections[c];
+            if (conn->out_node == node->id && conn->enabled && genome->nodes[conn->in_node].active) fan_in++;
+        }
+        fputs("    s = 0.0;\n", fp);
+        if (fan_in > 0) {
+            fprintf(fp, "    for (i = 0; i < %zu; i++) s += v[%s_sources[%zu + i]] * %s_weights[%zu + i];\n",
+                    fan_in, name, offset, name, offset);
+        }
+        fprintf(fp, "    v[%zu] = %s_%s(s + %s_biases[%zu]);\n", i, name,
+                activation_names[export_activation(node->activation_type)], name, bias_index++);
+        offset += fan_in;
+    }
+
+    size_t output_index = 0;
+    for (size_t i = 0; i < n && output_index < NEAT_MAX_OUTPUTS; i++) {
+        if (genome->nodes[i].type == NEAT_NODE_OUTPUT) {
+            fprintf(fp, "    outputs[%zu] = v[%zu];\n", output_index++, i);
+        }
+    }
+    if (output_index == 0) fputs("    (void)outputs;\n", fp);
+    fprintf(fp, "}\n\n#endif /* %s_H */\n", upper);
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) remove(path);
+    return ok ? 1 : 0;
+}
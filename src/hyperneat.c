@@ -1,6 +1,7 @@
 #include "../include/hyperneat.h"
 #include "../include/neat.h"
 #include "../include/simd_math.h"
+#include "../include/trace.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -70,7 +71,7 @@ substrate_node_t substrate_node_create(float x, float y, float z, int layer, int
 void substrate_node_free(substrate_node_t* node) {
     if (node) {
         if (node->activations) {
-            free(node->activations);
+            neat_free(node->activations);
             node->activations = NULL;
         }
     }
@@ -100,16 +101,19 @@ substrate_t substrate_create(int num_layers, const int* layer_sizes,
     }
     
     /* Allocate memory for nodes */
-    substrate.nodes = (substrate_node_t*)calloc(total_nodes, sizeof(substrate_node_t));
+    NEAT_TRACE_BEGIN("substrate_create", total_nodes);
+    substrate.nodes = (substrate_node_t*)neat_calloc_tagged(NEAT_MEM_SUBSTRATE, total_nodes, sizeof(substrate_node_t));
     if (!substrate.nodes) {
+        NEAT_TRACE_END();
         return substrate;  /* Return empty substrate on allocation failure */
     }
     substrate.node_count = total_nodes;
     
     /* Allocate memory for layer sizes */
-    substrate.layer_sizes = (int*)calloc(num_layers, sizeof(int));
+    substrate.layer_sizes = (int*)neat_calloc_tagged(NEAT_MEM_SUBSTRATE, num_layers, sizeof(int));
     if (!substrate.layer_sizes) {
-        free(substrate.nodes);
+        neat_free(substrate.nodes);
+        NEAT_TRACE_END();
         return substrate;
     }
     memcpy(substrate.layer_sizes, layer_sizes, num_layers * sizeof(int));
@@ -152,6 +156,7 @@ substrate_t substrate_create(int num_layers, const int* layer_sizes,
     substrate.max_y = max_y;
     substrate.min_z = min_z;
     substrate.max_z = max_z;
+    NEAT_TRACE_END();
     
     return substrate;
 }
@@ -165,19 +170,19 @@ void substrate_free(substrate_t* substrate) {
         for (int i = 0; i < substrate->node_count; i++) {
             substrate_node_free(&substrate->nodes[i]);
         }
-        free(substrate->nodes);
+        neat_free(substrate->nodes);
         substrate->nodes = NULL;
     }
     
     /* Free connections */
     if (substrate->connections) {
-        free(substrate->connections);
+        neat_free(substrate->connections);
         substrate->connections = NULL;
     }
     
     /* Free layer sizes */
     if (substrate->layer_sizes) {
-        free(substrate->layer_sizes);
+        neat_free(substrate->layer_sizes);
         substrate->layer_sizes = NULL;
     }
     
@@ -231,6 +236,7 @@ void substrate_connect_layers(substrate_t* substrate, int from_layer, int to_lay
     }
     
     /* Create connections */
+    NEAT_TRACE_BEGIN("substrate_connect", num_connections);
     for (int i = 0; i < num_connections; i++) {
         /* Simple strategy: connect random nodes */
         int from_idx = from_start + (rand() % from_count);
@@ -256,10 +262,12 @@ void substrate_connect_layers(substrate_t* substrate, int from_layer, int to_lay
             
             /* Add to connections array */
             substrate->connection_count++;
-            substrate_connection_t* new_connections = (substrate_connection_t*)realloc(
-                substrate->connections, 
-                substrate->connection_count * sizeof(substrate_connection_t)
-            );
+            substrate_connection_t* new_connections = substrate->connections ?
+                (substrate_connection_t*)neat_realloc(
+                    substrate->connections, 
+                    substrate->connection_count * sizeof(substrate_connection_t)
+                ) :
+                (substrate_connection_t*)neat_malloc_tagged(NEAT_MEM_SUBSTRATE, sizeof(substrate_connection_t));
             
             if (new_connections) {
                 substrate->connections = new_connections;
@@ -269,6 +277,7 @@ void substrate_connect_layers(substrate_t* substrate, int from_layer, int to_lay
             }
         }
     }
+    NEAT_TRACE_END();
 }
 
 /* Create a population of HyperNEAT individuals */
@@ -276,7 +285,7 @@ hyperneat_population_t* hyperneat_create_population(const hyperneat_config_t* co
                                                    size_t population_size) {
     if (!config || population_size == 0) return NULL;
 
-    hyperneat_population_t* pop = (hyperneat_population_t*)calloc(1, sizeof(hyperneat_population_t));
+    hyperneat_population_t* pop = (hyperneat_population_t*)neat_calloc(1, sizeof(hyperneat_population_t));
     if (!pop) return NULL;
 
     /* Create NEAT population for CPPNs */
@@ -287,15 +296,15 @@ hyperneat_population_t* hyperneat_create_population(const hyperneat_config_t* co
     );
 
     if (!pop->cppn_population) {
-        free(pop);
+        neat_free(pop);
         return NULL;
     }
 
     /* Allocate memory for individuals */
-    pop->individuals = (hyperneat_individual_t*)calloc(population_size, sizeof(hyperneat_individual_t));
+    pop->individuals = (hyperneat_individual_t*)neat_calloc(population_size, sizeof(hyperneat_individual_t));
     if (!pop->individuals) {
         neat_free_population(pop->cppn_population);
-        free(pop);
+        neat_free(pop);
         return NULL;
     }
 
@@ -312,34 +321,34 @@ hyperneat_population_t* hyperneat_create_population(const hyperneat_config_t* co
         pop->individuals[i].pattern_size = 0;
 
         /* Create substrate for the individual */
-        pop->individuals[i].substrate = (substrate_t*)calloc(1, sizeof(substrate_t));
+        pop->individuals[i].substrate = (substrate_t*)neat_calloc_tagged(NEAT_MEM_SUBSTRATE, 1, sizeof(substrate_t));
         if (!pop->individuals[i].substrate) {
             /* Clean up */
             for (size_t j = 0; j < i; j++) {
                 if (pop->individuals[j].substrate) {
                     substrate_free(pop->individuals[j].substrate);
-                    free(pop->individuals[j].substrate);
+                    neat_free(pop->individuals[j].substrate);
                 }
             }
-            free(pop->individuals);
+            neat_free(pop->individuals);
             neat_free_population(pop->cppn_population);
-            free(pop);
+            neat_free(pop);
             return NULL;
         }
 
         /* Initialize substrate */
         int num_layers = 2 + config->substrate_hidden_layers;
-        int* layer_sizes = (int*)calloc(num_layers, sizeof(int));
+        int* layer_sizes = (int*)neat_calloc_tagged(NEAT_MEM_SUBSTRATE, num_layers, sizeof(int));
         if (!layer_sizes) {
             for (size_t j = 0; j <= i; j++) {
                 if (pop->individuals[j].substrate) {
                     substrate_free(pop->individuals[j].substrate);
-                    free(pop->individuals[j].substrate);
+                    neat_free(pop->individuals[j].substrate);
                 }
             }
-            free(pop->individuals);
+            neat_free(pop->individuals);
             neat_free_population(pop->cppn_population);
-            free(pop);
+            neat_free(pop);
             return NULL;
         }
 
@@ -356,7 +365,7 @@ hyperneat_population_t* hyperneat_create_population(const hyperneat_config_t* co
                                                          -1.0f, 1.0f,  /* y range */
                                                          0.0f, (float)(num_layers - 1));  /* z range */
 
-        free(layer_sizes);
+        neat_free(layer_sizes);
     }
 
     /* Initialize population fields */
@@ -383,21 +392,21 @@ void hyperneat_free_individual(hyperneat_individual_t* individual) {
     /* Free substrate */
     if (individual->substrate) {
         substrate_free(individual->substrate);
-        free(individual->substrate);
+        neat_free(individual->substrate);
         individual->substrate = NULL;
     }
     
     /* Free other fields */
     if (individual->objectives) {
-        free(individual->objectives);
+        neat_free(individual->objectives);
         individual->objectives = NULL;
     }
     if (individual->novelty) {
-        free(individual->novelty);
+        neat_free(individual->novelty);
         individual->novelty = NULL;
     }
     if (individual->activation_pattern) {
-        free(individual->activation_pattern);
+        neat_free(individual->activation_pattern);
         individual->activation_pattern = NULL;
     }
     
@@ -416,14 +425,14 @@ void hyperneat_free_population(hyperneat_population_t* pop) {
     for (int i = 0; i < pop->population_size; i++) {
         hyperneat_free_individual(&pop->individuals[i]);
     }
-    free(pop->individuals);
+    neat_free(pop->individuals);
 
     /* Free NEAT population */
     neat_free_population(pop->cppn_population);
 
     /* Free other fields */
     if (pop->archive) {
-        free(pop->archive);
+        neat_free(pop->archive);
         pop->archive = NULL;
     }
 
@@ -0,0 +1,427 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "../include/metrics.h"
+
+#define METRICS_FRESH           4u      /* Set in middle while its snapshot is unread */
+#define METRICS_INDEX_MASK      3u
+#define METRICS_REQUEST_MAX     4096
+#define METRICS_REQUEST_TIMEOUT 1000    /* Milliseconds a client gets to send its request */
+
+/* Upper bounds of the phase latency buckets, in seconds */
+static const double metrics_bounds[NEAT_METRICS_BUCKETS] = {
+    1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3,
+    0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+static const char *metrics_phase_names[NEAT_METRICS_PHASE_COUNT] = {
+    "evaluate", "speciate", "adjust_fitness", "remove_stale", "remove_weak", "reproduce", "epoch"
+};
+
+/* Recording */
+
+static void histogram_observe(neat_metrics_histogram_t *histogram, double seconds) {
+    size_t bucket = 0;
+    while (bucket < NEAT_METRICS_BUCKETS && seconds > metrics_bounds[bucket]) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->sum += seconds;
+}
+
+/* Record the evaluated generation before reproduction replaces it */
+void neat_metrics_capture(neat_metrics_t *metrics, const neat_population_t *pop) {
+    if (!metrics || !pop) return;
+
+    neat_metrics_snapshot_t *snap = &metrics->pending;
+    size_t n = pop->genome_count;
+    double sum = 0.0;
+    double best = n > 0 ? -INFINITY : 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double fitness = pop->genomes[i]->fitness;
+        sum += fitness;
+        if (fitness > best) best = fitness;
+    }
+    snap->genome_count = n;
+    snap->species_count = pop->species_count;
+    snap->best_fitness = best;
+    snap->mean_fitness = n > 0 ? sum / (double)n : 0.0;
+    snap->evaluations_total += n;
+}
+
+/* Finish the generation and hand it to the server */
+void neat_metrics_publish(neat_metrics_t *metrics, const neat_population_t *pop) {
+    if (!metrics || !pop) return;
+
+    neat_metrics_snapshot_t *snap = &metrics->pending;
+    const neat_generation_stats_t *stats = &pop->stats;
+    snap->sequence++;
+    snap->generation = pop->generation;
+    snap->innovation_count = pop->innovation_table ? pop->innovation_table->count : 0;
+    snap->max_fitness_achieved = pop->max_fitness_achieved;
+    snap->archive_size = atomic_load_explicit(&metrics->archive_size, memory_order_relaxed);
+
+    /* Throughput over the whole generation, including time outside the library */
+    double now = neat_get_time();
+    double elapsed = metrics->last_publish > 0.0 ? now - metrics->last_publish
+                                                 : stats->evaluate_time + stats->epoch_time;
+    snap->evaluations_per_second = elapsed > 0.0 ? (double)snap->genome_count / elapsed : 0.0;
+    metrics->last_publish = now;
+
+    snap->has_memory = pop->allocator != NULL;
+    if (pop->allocator) {
+        neat_allocator_stats(pop->allocator, &snap->memory);
+    }
+
+    /* Phase times are all zero when statistics are off */
+    if (pop->stats_level != NEAT_STATS_OFF) {
+        const double times[NEAT_METRICS_PHASE_COUNT] = {
+            stats->evaluate_time, stats->speciate_time, stats->adjust_time,
+            stats->remove_stale_time, stats->remove_weak_time, stats->reproduce_time,
+            stats->epoch_time
+        };
+        for (int phase = 0; phase < NEAT_METRICS_PHASE_COUNT; phase++) {
+            histogram_observe(&snap->phases[phase], times[phase]);
+        }
+    }
+
+    memcpy(&metrics->buffers[metrics->back], snap, sizeof(*snap));
+    unsigned previous = atomic_exchange_explicit(&metrics->middle, metrics->back | METRICS_FRESH,
+                                                 memory_order_acq_rel);
+    metrics->back = previous & METRICS_INDEX_MASK;
+}
+
+void neat_metrics_set_archive_size(neat_metrics_t *metrics, size_t size) {
+    if (!metrics) return;
+    atomic_store_explicit(&metrics->archive_size, size, memory_order_relaxed);
+}
+
+/* Reading */
+
+/* Copy the newest published generation */
+void neat_metrics_read(neat_metrics_t *metrics, neat_metrics_snapshot_t *snapshot) {
+    pthread_mutex_lock(&metrics->read_lock);
+    if (atomic_load_explicit(&metrics->middle, memory_order_relaxed) & METRICS_FRESH) {
+        unsigned previous = atomic_exchange_explicit(&metrics->middle, metrics->front,
+                                                     memory_order_acq_rel);
+        metrics->front = previous & METRICS_INDEX_MASK;
+    }
+    memcpy(snapshot, &metrics->buffers[metrics->front], sizeof(*snapshot));
+    pthread_mutex_unlock(&metrics->read_lock);
+}
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} metrics_text_t;
+
+static void text_printf(metrics_text_t *text, const char *format, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(text->data + text->length, text->capacity - text->length, format, args);
+        va_end(args);
+        if (written < 0) return;
+        if ((size_t)written < text->capacity - text->length) {
+            text->length += (size_t)written;
+            return;
+        }
+        text->capacity = text->capacity * 2 + (size_t)written;
+        text->data = (char*)neat_realloc(text->data, text->capacity);
+    }
+}
+
+static void text_metric(metrics_text_t *text, const char *name, const char *type, const char *help) {
+    text_printf(text, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Render the newest generation in the Prometheus text format; free with neat_free */
+char* neat_metrics_render(neat_metrics_t *metrics, size_t *length) {
+    neat_metrics_snapshot_t *snap = (neat_metrics_snapshot_t*)neat_malloc(sizeof(*snap));
+    neat_metrics_read(metrics, snap);
+
+    metrics_text_t text;
+    text.capacity = 8192;
+    text.length = 0;
+    text.data = (char*)neat_malloc(text.capacity);
+    text.data[0] = '\0';
+
+    text_metric(&text, "neat_generation", "gauge", "Generations completed");
+    text_printf(&text, "neat_generation %d\n", snap->generation);
+    text_metric(&text, "neat_evaluations_total", "counter", "Genomes evaluated");
+    text_printf(&text, "neat_evaluations_total %llu\n", (unsigned long long)snap->evaluations_total);
+    text_metric(&text, "neat_evaluations_per_second", "gauge", "Genomes evaluated per second over the last generation");
+    text_printf(&text, "neat_evaluations_per_second %.17g\n", snap->evaluations_per_second);
+    text_metric(&text, "neat_best_fitness", "gauge", "Best fitness of the last evaluated generation");
+    text_printf(&text, "neat_best_fitness %.17g\n", snap->best_fitness);
+    text_metric(&text, "neat_mean_fitness", "gauge", "Mean fitness of the last evaluated generation");
+    text_printf(&text, "neat_mean_fitness %.17g\n", snap->mean_fitness);
+    text_metric(&text, "neat_max_fitness_achieved", "gauge", "Best fitness of the run so far");
+    text_printf(&text, "neat_max_fitness_achieved %.17g\n", snap->max_fitness_achieved);
+    text_metric(&text, "neat_genomes", "gauge", "Genomes in the last evaluated generation");
+    text_printf(&text, "neat_genomes %zu\n", snap->genome_count);
+    text_metric(&text, "neat_species", "gauge", "Species in the last evaluated generation");
+    text_printf(&text, "neat_species %zu\n", snap->species_count);
+    text_metric(&text, "neat_innovations", "gauge", "Entries in the innovation table");
+    text_printf(&text, "neat_innovations %zu\n", snap->innovation_count);
+    text_metric(&text, "neat_archive_size", "gauge", "Entries in the novelty archive");
+    text_printf(&text, "neat_archive_size %zu\n", snap->archive_size);
+    text_metric(&text, "neat_eval_queue_depth", "gauge", "Genomes waiting for an evaluation worker");
+    text_printf(&text, "neat_eval_queue_depth %zu\n",
+                atomic_load_explicit(&metrics->queue_depth, memory_order_relaxed));
+
+    if (snap->has_memory) {
+        text_metric(&text, "neat_memory_live_bytes", "gauge", "Bytes allocated by subsystem");
+        for (int tag = 0; tag < NEAT_MEM_TAG_COUNT; tag++) {
+            text_printf(&text, "neat_memory_live_bytes{subsystem=\"%s\"} %zu\n",
+                        neat_mem_tag_name((neat_mem_tag_t)tag), snap->memory.live_bytes[tag]);
+        }
+        text_metric(&text, "neat_memory_peak_bytes", "gauge", "Peak bytes allocated by subsystem");
+        for (int tag = 0; tag < NEAT_MEM_TAG_COUNT; tag++) {
+            text_printf(&text, "neat_memory_peak_bytes{subsystem=\"%s\"} %zu\n",
+                        neat_mem_tag_name((neat_mem_tag_t)tag), snap->memory.peak_bytes[tag]);
+        }
+    }
+
+    text_metric(&text, "neat_phase_seconds", "histogram", "Wall time of each generation phase");
+    for (int phase = 0; phase < NEAT_METRICS_PHASE_COUNT; phase++) {
+        const neat_metrics_histogram_t *histogram = &snap->phases[phase];
+        const char *name = metrics_phase_names[phase];
+        uint64_t cumulative = 0;
+        for (int bucket = 0; bucket < NEAT_METRICS_BUCKETS; bucket++) {
+            cumulative += histogram->buckets[bucket];
+            text_printf(&text, "neat_phase_seconds_bucket{phase=\"%s\",le=\"%g\"} %llu\n",
+                        name, metrics_bounds[bucket], (unsigned long long)cumulative);
+        }
+        text_printf(&text, "neat_phase_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n",
+                    name, (unsigned long long)histogram->count);
+        text_printf(&text, "neat_phase_seconds_sum{phase=\"%s\"} %.17g\n", name, histogram->sum);
+        text_printf(&text, "neat_phase_seconds_count{phase=\"%s\"} %llu\n",
+                    name, (unsigned long long)histogram->count);
+    }
+
+    text_metric(&text, "neat_metrics_scrapes_total", "counter", "Requests served by the metrics server");
+    text_printf(&text, "neat_metrics_scrapes_total %llu\n",
+                (unsigned long long)atomic_load_explicit(&metrics->scrapes, memory_order_relaxed));
+
+    neat_free(snap);
+    if (length) *length = text.length;
+    return text.data;
+}
+
+/* Server */
+
+static bool write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+/* Read one request and answer it; every connection carries a single request */
+static void serve_client(neat_metrics_t *metrics, int fd) {
+    char request[METRICS_REQUEST_MAX];
+    size_t size = 0;
+    while (size < sizeof(request) - 1) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, METRICS_REQUEST_TIMEOUT) <= 0) return;
+        ssize_t got = recv(fd, request + size, sizeof(request) - 1 - size, 0);
+        if (got <= 0) return;
+        size += (size_t)got;
+        request[size] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[size] = '\0';
+
+    char header[256];
+    if (strncmp(request, "GET /metrics", 12) != 0 && strncmp(request, "GET / ", 6) != 0) {
+        const char *body = "Not found; metrics are at /metrics\n";
+        int header_size = snprintf(header, sizeof(header),
+                                   "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n"
+                                   "Content-Length: %zu\r\nConnection: close\r\n\r\n", strlen(body));
+        if (write_all(fd, header, (size_t)header_size)) write_all(fd, body, strlen(body));
+        return;
+    }
+
+    atomic_fetch_add_explicit(&metrics->scrapes, 1, memory_order_relaxed);
+    size_t body_size;
+    char *body = neat_metrics_render(metrics, &body_size);
+    int header_size = snprintf(header, sizeof(header),
+                               "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: %zu\r\nConnection: close\r\n\r\n", body_size);
+    if (write_all(fd, header, (size_t)header_size)) write_all(fd, body, body_size);
+    neat_free(body);
+}
+
+static void* metrics_thread(void *arg) {
+    neat_metrics_t *metrics = (neat_metrics_t*)arg;
+    struct pollfd fds[2] = {
+        { metrics->listen_fd, POLLIN, 0 },
+        { metrics->wake_pipe[0], POLLIN, 0 }
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        int client = accept4(metrics->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        serve_client(metrics, client);
+        close(client);
+    }
+    return NULL;
+}
+
+/*
+ * Open the listening socket described by address; returns -1 on failure.
+ * The server has no authentication, so TCP hosts must be loopback unless
+ * the address carries the "public:" opt-in.
+ */
+static int metrics_listen(neat_metrics_t *metrics, const char *address) {
+    int fd;
+    bool public_host = strncmp(address, "public:", 7) == 0;
+    if (public_host) address += 7;
+    if (!public_host && strncmp(address, "unix:", 5) == 0) {
+        const char *path = address + 5;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path)) return -1;
+        strcpy(addr.sun_path, path);
+
+        /* Only a stale socket from an earlier run is replaced; any other file is left alone */
+        struct stat existing;
+        if (lstat(path, &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode) || unlink(path) != 0) return -1;
+        } else if (errno != ENOENT) {
+            return -1;
+        }
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+            close(fd);
+            return -1;
+        }
+        strcpy(metrics->unix_path, path);
+        return fd;
+    }
+
+    char host[64] = "127.0.0.1";
+    const char *port_text = address;
+    const char *colon = strrchr(address, ':');
+    if (colon) {
+        size_t host_length = (size_t)(colon - address);
+        if (host_length == 0 || host_length >= sizeof(host)) return -1;
+        memcpy(host, address, host_length);
+        host[host_length] = '\0';
+        port_text = colon + 1;
+    }
+    if (strcmp(host, "localhost") == 0) strcpy(host, "127.0.0.1");
+
+    char *end;
+    long port = strtol(port_text, &end, 10);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (end == port_text || *end != '\0' || port < 0 || port > 65535 ||
+        inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        return -1;
+    }
+    if (!public_host && (ntohl(addr.sin_addr.s_addr) >> 24) != 127) return -1;
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    socklen_t addr_size = sizeof(addr);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addr_size) != 0) {
+        close(fd);
+        return -1;
+    }
+    metrics->port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/* Lifecycle */
+
+neat_metrics_t* neat_metrics_start(const char *address) {
+    if (!address) return NULL;
+
+    neat_metrics_t *metrics = (neat_metrics_t*)neat_calloc(1, sizeof(neat_metrics_t));
+    metrics->listen_fd = metrics_listen(metrics, address);
+    if (metrics->listen_fd < 0) {
+        neat_free(metrics);
+        return NULL;
+    }
+    if (pipe2(metrics->wake_pipe, O_CLOEXEC) != 0) {
+        close(metrics->listen_fd);
+        if (metrics->unix_path[0]) unlink(metrics->unix_path);
+        neat_free(metrics);
+        return NULL;
+    }
+
+    metrics->back = 0;
+    atomic_init(&metrics->middle, 1);
+    metrics->front = 2;
+    atomic_init(&metrics->queue_depth, 0);
+    atomic_init(&metrics->archive_size, 0);
+    atomic_init(&metrics->scrapes, 0);
+    pthread_mutex_init(&metrics->read_lock, NULL);
+    if (pthread_create(&metrics->thread, NULL, metrics_thread, metrics) != 0) {
+        pthread_mutex_destroy(&metrics->read_lock);
+        close(metrics->wake_pipe[0]);
+        close(metrics->wake_pipe[1]);
+        close(metrics->listen_fd);
+        if (metrics->unix_path[0]) unlink(metrics->unix_path);
+        neat_free(metrics);
+        return NULL;
+    }
+    return metrics;
+}
+
+void neat_metrics_stop(neat_metrics_t *metrics) {
+    if (!metrics) return;
+
+    char wake = 1;
+    while (write(metrics->wake_pipe[1], &wake, 1) < 0 && errno == EINTR) {
+    }
+    pthread_join(metrics->thread, NULL);
+
+    close(metrics->listen_fd);
+    close(metrics->wake_pipe[0]);
+    close(metrics->wake_pipe[1]);
+    if (metrics->unix_path[0]) unlink(metrics->unix_path);
+    pthread_mutex_destroy(&metrics->read_lock);
+    neat_free(metrics);
+}
+
+int neat_metrics_port(const neat_metrics_t *metrics) {
+    return metrics ? metrics->port : 0;
+}
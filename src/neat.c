@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,8 +6,15 @@
 #include <assert.h>
 #include <time.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include "neat.h"
 #include "config.h"
+#include "surrogate.h"
+#include "checkpoint.h"
+#include "runlog.h"
+#include "metrics.h"
+#include "eval_profile.h"
+#include "trace.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -20,37 +28,183 @@
 /* Global random seed for deterministic behavior */
 static unsigned long g_random_seed = 1;
 
-/* Memory management */
-void* neat_malloc(size_t size) {
-    void *ptr = malloc(size);
-    if (!ptr) {
-        fprintf(stderr, "Memory allocation failed!\n");
-        exit(EXIT_FAILURE);
+/*
+ * Memory management. Each block starts with a header naming its allocator,
+ * tag and requested size, padded to keep the caller's pointer at the
+ * platform's maximum alignment.
+ */
+typedef struct {
+    neat_allocator_t *allocator;
+    size_t size_tag;            /* Requested size << 8 | tag */
+} neat_mem_header_t;
+
+#define NEAT_MEM_ALIGN       _Alignof(max_align_t)
+#define NEAT_MEM_HEADER_SIZE ((sizeof(neat_mem_header_t) + NEAT_MEM_ALIGN - 1) & ~(NEAT_MEM_ALIGN - 1))
+
+static void* neat_libc_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* neat_libc_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void neat_libc_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static neat_allocator_t g_default_allocator = {
+    neat_libc_alloc, neat_libc_realloc, neat_libc_free, NULL, {0}, {0}, {0}
+};
+static _Thread_local neat_allocator_t *g_thread_allocator = NULL;
+
+static const char *const neat_mem_tag_names[NEAT_MEM_TAG_COUNT] = {
+    "general", "genomes", "species", "innovation", "archive", "substrate", "visualization"
+};
+
+void neat_allocator_init(neat_allocator_t *allocator,
+                         void* (*alloc)(void *ctx, size_t size),
+                         void* (*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size),
+                         void (*free)(void *ctx, void *ptr, size_t size),
+                         void *ctx) {
+    allocator->alloc = alloc;
+    allocator->realloc = realloc;
+    allocator->free = free;
+    allocator->ctx = ctx;
+    for (int i = 0; i < NEAT_MEM_TAG_COUNT; i++) {
+        atomic_init(&allocator->live_bytes[i], 0);
+        atomic_init(&allocator->peak_bytes[i], 0);
+        atomic_init(&allocator->allocations[i], 0);
     }
-    return ptr;
 }
 
-void* neat_calloc(size_t nmemb, size_t size) {
-    void *ptr = calloc(nmemb, size);
-    if (!ptr) {
-        fprintf(stderr, "Memory allocation failed!\n");
-        exit(EXIT_FAILURE);
+neat_allocator_t* neat_default_allocator(void) {
+    return &g_default_allocator;
+}
+
+neat_allocator_t* neat_current_allocator(void) {
+    return g_thread_allocator ? g_thread_allocator : &g_default_allocator;
+}
+
+/* Make an allocator current on this thread (NULL = default); returns the previous one for restoring */
+neat_allocator_t* neat_use_allocator(neat_allocator_t *allocator) {
+    neat_allocator_t *previous = g_thread_allocator;
+    g_thread_allocator = allocator;
+    return previous;
+}
+
+void neat_allocator_stats(const neat_allocator_t *allocator, neat_mem_stats_t *stats) {
+    if (!allocator) allocator = &g_default_allocator;
+    stats->total_live_bytes = 0;
+    for (int i = 0; i < NEAT_MEM_TAG_COUNT; i++) {
+        stats->live_bytes[i] = atomic_load_explicit(&allocator->live_bytes[i], memory_order_relaxed);
+        stats->peak_bytes[i] = atomic_load_explicit(&allocator->peak_bytes[i], memory_order_relaxed);
+        stats->allocations[i] = atomic_load_explicit(&allocator->allocations[i], memory_order_relaxed);
+        stats->total_live_bytes += stats->live_bytes[i];
+    }
+}
+
+const char* neat_mem_tag_name(neat_mem_tag_t tag) {
+    return (unsigned)tag < NEAT_MEM_TAG_COUNT ? neat_mem_tag_names[tag] : "unknown";
+}
+
+static void neat_mem_account(neat_allocator_t *allocator, int tag, size_t added, size_t removed) {
+    if (removed > 0) {
+        atomic_fetch_sub_explicit(&allocator->live_bytes[tag], removed, memory_order_relaxed);
+    }
+    if (added > 0) {
+        size_t live = atomic_fetch_add_explicit(&allocator->live_bytes[tag], added, memory_order_relaxed) + added;
+        size_t peak = atomic_load_explicit(&allocator->peak_bytes[tag], memory_order_relaxed);
+        while (live > peak &&
+               !atomic_compare_exchange_weak_explicit(&allocator->peak_bytes[tag], &peak, live,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+        }
     }
+}
+
+static void neat_mem_exhausted(void) {
+    fprintf(stderr, "Memory allocation failed!\n");
+    exit(EXIT_FAILURE);
+}
+
+static void* neat_mem_alloc(neat_mem_tag_t tag, size_t size, bool zero) {
+    neat_allocator_t *allocator = neat_current_allocator();
+    if ((unsigned)tag >= NEAT_MEM_TAG_COUNT) tag = NEAT_MEM_GENERAL;
+    if (size > (SIZE_MAX >> 8) - NEAT_MEM_HEADER_SIZE) neat_mem_exhausted();
+    
+    neat_mem_header_t *header = (neat_mem_header_t*)allocator->alloc(allocator->ctx, NEAT_MEM_HEADER_SIZE + size);
+    if (!header) neat_mem_exhausted();
+    header->allocator = allocator;
+    header->size_tag = size << 8 | (size_t)tag;
+    
+    void *ptr = (uint8_t*)header + NEAT_MEM_HEADER_SIZE;
+    if (zero) memset(ptr, 0, size);
+    atomic_fetch_add_explicit(&allocator->allocations[tag], 1, memory_order_relaxed);
+    neat_mem_account(allocator, tag, size, 0);
     return ptr;
 }
 
+void* neat_malloc(size_t size) {
+    return neat_mem_alloc(NEAT_MEM_GENERAL, size, false);
+}
+
+void* neat_calloc(size_t nmemb, size_t size) {
+    if (size > 0 && nmemb > SIZE_MAX / size) neat_mem_exhausted();
+    return neat_mem_alloc(NEAT_MEM_GENERAL, nmemb * size, true);
+}
+
+void* neat_malloc_tagged(neat_mem_tag_t tag, size_t size) {
+    return neat_mem_alloc(tag, size, false);
+}
+
+void* neat_calloc_tagged(neat_mem_tag_t tag, size_t nmemb, size_t size) {
+    if (size > 0 && nmemb > SIZE_MAX / size) neat_mem_exhausted();
+    return neat_mem_alloc(tag, nmemb * size, true);
+}
+
+/* Resize a block in place of its allocator, keeping its tag */
 void* neat_realloc(void *ptr, size_t size) {
-    void *new_ptr = realloc(ptr, size);
-    if (!new_ptr && size > 0) {
-        fprintf(stderr, "Memory reallocation failed!\n");
-        exit(EXIT_FAILURE);
-    }
-    return new_ptr;
+    if (!ptr) return neat_mem_alloc(NEAT_MEM_GENERAL, size, false);
+    if (size > (SIZE_MAX >> 8) - NEAT_MEM_HEADER_SIZE) neat_mem_exhausted();
+    
+    neat_mem_header_t *header = (neat_mem_header_t*)((uint8_t*)ptr - NEAT_MEM_HEADER_SIZE);
+    neat_allocator_t *allocator = header->allocator;
+    int tag = (int)(header->size_tag & 0xFF);
+    size_t old_size = header->size_tag >> 8;
+    
+    neat_mem_header_t *resized;
+    if (allocator->realloc) {
+        resized = (neat_mem_header_t*)allocator->realloc(allocator->ctx, header, NEAT_MEM_HEADER_SIZE + old_size,
+                                                         NEAT_MEM_HEADER_SIZE + size);
+        if (!resized) neat_mem_exhausted();
+    } else {
+        resized = (neat_mem_header_t*)allocator->alloc(allocator->ctx, NEAT_MEM_HEADER_SIZE + size);
+        if (!resized) neat_mem_exhausted();
+        memcpy(resized, header, NEAT_MEM_HEADER_SIZE + (old_size < size ? old_size : size));
+        allocator->free(allocator->ctx, header, NEAT_MEM_HEADER_SIZE + old_size);
+    }
+    resized->size_tag = size << 8 | (size_t)tag;
+    neat_mem_account(allocator, tag, size, old_size);
+    return (uint8_t*)resized + NEAT_MEM_HEADER_SIZE;
+}
+
+/* Allocator a block came from */
+static neat_allocator_t* neat_mem_owner(const void *ptr) {
+    return ((const neat_mem_header_t*)((const uint8_t*)ptr - NEAT_MEM_HEADER_SIZE))->allocator;
 }
 
 void neat_free(void *ptr) {
     if (ptr) {
-        free(ptr);
+        neat_mem_header_t *header = (neat_mem_header_t*)((uint8_t*)ptr - NEAT_MEM_HEADER_SIZE);
+        neat_allocator_t *allocator = header->allocator;
+        size_t size = header->size_tag >> 8;
+        neat_mem_account(allocator, (int)(header->size_tag & 0xFF), 0, size);
+        allocator->free(allocator->ctx, header, NEAT_MEM_HEADER_SIZE + size);
     }
 }
 
@@ -59,9 +213,19 @@ void neat_srand(unsigned long seed) {
     g_random_seed = seed;
 }
 
+/* Generator state, for checkpointing */
+unsigned long neat_get_random_state(void) {
+    return g_random_seed;
+}
+
+void neat_set_random_state(unsigned long state) {
+    g_random_seed = state;
+}
+
 /* Simple XOR shift random number generator */
 static unsigned long xorshift32() {
-    unsigned long x = g_random_seed;
+    /* Keep the state to 32 bits; unsigned long is 64-bit on LP64 targets */
+    uint32_t x = (uint32_t)g_random_seed;
     x ^= x << 13;
     x ^= x >> 17;
     x ^= x << 5;
@@ -85,6 +249,42 @@ int neat_random_int(int min, int max) {
     return min + (xorshift32() % (max - min + 1));
 }
 
+/* Monotonic wall clock in seconds */
+double neat_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Clock for phase statistics; reads 0 when statistics are off so callers need no branch */
+double neat_stats_clock(const neat_population_t *pop) {
+#if NEAT_ENABLE_STATS
+    if (pop && pop->stats_level != NEAT_STATS_OFF) {
+        return neat_get_time();
+    }
+#else
+    (void)pop;
+#endif
+    return 0.0;
+}
+
+/*
+ * Sub-phase statistics. The epoch points neat_detail at the population's
+ * statistics while it runs at NEAT_STATS_DETAILED, so the hooks in
+ * speciation, reproduction and the innovation table cost one test of a
+ * thread-local pointer otherwise.
+ */
+#if NEAT_ENABLE_STATS
+static _Thread_local neat_generation_stats_t *neat_detail = NULL;
+#define NEAT_DETAIL_COUNT(field, n) do { if (neat_detail) neat_detail->field += (n); } while (0)
+#define NEAT_DETAIL_START(var) double var = neat_detail ? neat_get_time() : 0.0
+#define NEAT_DETAIL_STOP(field, var) do { if (neat_detail) neat_detail->field += neat_get_time() - (var); } while (0)
+#else
+#define NEAT_DETAIL_COUNT(field, n) ((void)0)
+#define NEAT_DETAIL_START(var) ((void)0)
+#define NEAT_DETAIL_STOP(field, var) ((void)0)
+#endif
+
 /* Activation functions */
 static double neat_activation(neat_activation_type_t type, double x) {
     switch (type) {
@@ -210,20 +410,29 @@ void neat_free_connection(neat_connection_t *conn) {
 
 /* Genome functions */
 neat_genome_t* neat_create_genome(int id) {
-    neat_genome_t* genome = (neat_genome_t*)neat_malloc(sizeof(neat_genome_t));
+    neat_genome_t* genome = (neat_genome_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, sizeof(neat_genome_t));
     genome->id = id;
     genome->node_count = 0;
     genome->node_capacity = NEAT_DEFAULT_ALLOC_SIZE;
-    genome->nodes = (neat_node_t*)neat_malloc(genome->node_capacity * sizeof(neat_node_t));
+    genome->nodes = (neat_node_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->node_capacity * sizeof(neat_node_t));
     
     genome->connection_count = 0;
     genome->connection_capacity = NEAT_DEFAULT_ALLOC_SIZE;
-    genome->connections = (neat_connection_t*)neat_malloc(genome->connection_capacity * sizeof(neat_connection_t));
+    genome->connections = (neat_connection_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->connection_capacity * sizeof(neat_connection_t));
     
     genome->fitness = 0.0;
     genome->adjusted_fitness = 0.0;
     genome->global_rank = 0;
     genome->species_id = -1;
+    genome->evaluated = false;
+    genome->elite = false;
+    genome->eval_time = 0.0;
+    genome->parent_eval_time = 0.0;
+    genome->parent_fitness = 0.0;
+    genome->fidelity = 0;
+    genome->parent1_id = -1;
+    genome->parent2_id = -1;
+    genome->mapped = false;
     
     genome->evaluation_order = NULL;
     genome->evaluation_order_size = 0;
@@ -238,11 +447,15 @@ void neat_free_genome(neat_genome_t *genome) {
     for (size_t i = 0; i < genome->node_count; i++) {
         // No need to free individual nodes as they're part of the array
     }
-    neat_free(genome->nodes);
     
     /* Free connections */
     // No need to free individual connections as they're part of the array
-    neat_free(genome->connections);
+    
+    /* Gene arrays restored from a checkpoint belong to the population's mapping */
+    if (!genome->mapped) {
+        neat_free(genome->nodes);
+        neat_free(genome->connections);
+    }
     
     /* Free evaluation order */
     neat_free(genome->evaluation_order);
@@ -251,9 +464,86 @@ void neat_free_genome(neat_genome_t *genome) {
     neat_free(genome);
 }
 
+neat_genome_t* neat_clone_genome(const neat_genome_t *genome) {
+    if (!genome) return NULL;
+    
+    neat_genome_t *clone = (neat_genome_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, sizeof(neat_genome_t));
+    *clone = *genome;
+    
+    /* Deep copy the gene arrays at the same capacity; the evaluation order is rebuilt lazily */
+    clone->nodes = (neat_node_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, clone->node_capacity * sizeof(neat_node_t));
+    memcpy(clone->nodes, genome->nodes, genome->node_count * sizeof(neat_node_t));
+    
+    clone->connections = (neat_connection_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, clone->connection_capacity * sizeof(neat_connection_t));
+    memcpy(clone->connections, genome->connections, genome->connection_count * sizeof(neat_connection_t));
+    
+    clone->evaluation_order = NULL;
+    clone->evaluation_order_size = 0;
+    clone->mapped = false;
+    
+    return clone;
+}
+
+/* Copy gene arrays that live in a checkpoint mapping to the heap before they grow */
+static void neat_genome_own_genes(neat_genome_t *genome) {
+    neat_node_t *nodes = genome->nodes;
+    neat_connection_t *connections = genome->connections;
+    
+    if (genome->node_capacity == 0) genome->node_capacity = 1;
+    if (genome->connection_capacity == 0) genome->connection_capacity = 1;
+    
+    genome->nodes = (neat_node_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->node_capacity * sizeof(neat_node_t));
+    memcpy(genome->nodes, nodes, genome->node_count * sizeof(neat_node_t));
+    genome->connections = (neat_connection_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->connection_capacity * sizeof(neat_connection_t));
+    memcpy(genome->connections, connections, genome->connection_count * sizeof(neat_connection_t));
+    genome->mapped = false;
+}
+
+/*
+ * Move a genome's gene arrays and evaluation order into blocks from the
+ * current allocator, e.g. a NUMA node's arena. Blocks that already come from
+ * it are left alone, so a genome that is already in place costs three
+ * header reads. The genome itself stays put. Returns 1 if anything was
+ * copied, 0 otherwise.
+ */
+int neat_genome_relocate(neat_genome_t *genome) {
+    if (!genome) return 0;
+    
+    neat_allocator_t *target = neat_current_allocator();
+    bool genes_placed = !genome->mapped && neat_mem_owner(genome->nodes) == target &&
+                        neat_mem_owner(genome->connections) == target;
+    bool order_placed = !genome->evaluation_order || neat_mem_owner(genome->evaluation_order) == target;
+    if (genes_placed && order_placed) return 0;
+    
+    if (genome->mapped) {
+        neat_genome_own_genes(genome);
+    } else if (!genes_placed) {
+        neat_node_t *nodes = genome->nodes;
+        neat_connection_t *connections = genome->connections;
+        genome->nodes = (neat_node_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->node_capacity * sizeof(neat_node_t));
+        memcpy(genome->nodes, nodes, genome->node_count * sizeof(neat_node_t));
+        genome->connections = (neat_connection_t*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->connection_capacity * sizeof(neat_connection_t));
+        memcpy(genome->connections, connections, genome->connection_count * sizeof(neat_connection_t));
+        neat_free(nodes);
+        neat_free(connections);
+    }
+    
+    /* The order only depends on the genes, so it moves with them instead of being rebuilt */
+    if (!order_placed) {
+        int *order = (int*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->evaluation_order_size * sizeof(int));
+        memcpy(order, genome->evaluation_order, genome->evaluation_order_size * sizeof(int));
+        neat_free(genome->evaluation_order);
+        genome->evaluation_order = order;
+    }
+    return 1;
+}
+
 /* Genome manipulation functions */
 int neat_add_node(neat_genome_t *genome, neat_node_type_t type, neat_node_placement_t placement) {
     /* Check if we need to grow the nodes array */
+    if (genome->mapped && genome->node_count >= genome->node_capacity) {
+        neat_genome_own_genes(genome);
+    }
     if (genome->node_count >= genome->node_capacity) {
         genome->node_capacity *= NEAT_GROWTH_FACTOR;
         genome->nodes = (neat_node_t*)neat_realloc(
@@ -296,6 +586,9 @@ int neat_add_connection(neat_genome_t *genome, int in_node, int out_node,
     }
     
     /* Check if we need to grow the connections array */
+    if (genome->mapped && genome->connection_count >= genome->connection_capacity) {
+        neat_genome_own_genes(genome);
+    }
     if (genome->connection_count >= genome->connection_capacity) {
         genome->connection_capacity *= NEAT_GROWTH_FACTOR;
         genome->connections = (neat_connection_t*)neat_realloc(
@@ -420,8 +713,11 @@ void neat_mutate_add_node(neat_genome_t *genome, neat_innovation_table_t *table)
         return;  /* Couldn't find a suitable connection to split */
     }
     
-    /* Disable the original connection */
+    /* Disable the original connection; copy what we need since adding genes may move the array */
     conn_to_split->enabled = false;
+    int split_in = conn_to_split->in_node;
+    int split_out = conn_to_split->out_node;
+    double split_weight = conn_to_split->weight;
     
     /* Create a new node */
     neat_node_type_t new_node_type = NEAT_NODE_HIDDEN;
@@ -430,20 +726,20 @@ void neat_mutate_add_node(neat_genome_t *genome, neat_innovation_table_t *table)
     
     /* Create new connections */
     double weight1 = 1.0;  /* Weight from input to new node */
-    double weight2 = conn_to_split->weight;  /* Weight from new node to output */
+    double weight2 = split_weight;  /* Weight from new node to output */
     
     /* Get innovation numbers if table is provided */
     int innovation1 = -1;
     int innovation2 = -1;
     
     if (table) {
-        innovation1 = neat_get_innovation(table, conn_to_split->in_node, new_node_id, false, -1, weight1);
-        innovation2 = neat_get_innovation(table, new_node_id, conn_to_split->out_node, false, -1, weight2);
+        innovation1 = neat_get_innovation(table, split_in, new_node_id, false, -1, weight1);
+        innovation2 = neat_get_innovation(table, new_node_id, split_out, false, -1, weight2);
     }
     
     /* Add the new connections */
-    neat_add_connection(genome, conn_to_split->in_node, new_node_id, weight1, true);
-    neat_add_connection(genome, new_node_id, conn_to_split->out_node, weight2, true);
+    neat_add_connection(genome, split_in, new_node_id, weight1, true);
+    neat_add_connection(genome, new_node_id, split_out, weight2, true);
     
     /* Set the innovation numbers if we have them */
     if (innovation1 != -1 && genome->connection_count > 1) {
@@ -576,11 +872,13 @@ neat_genome_t* neat_crossover(const neat_genome_t *parent1, const neat_genome_t
             inherited_conn = matching_conn;
         }
         
-        /* Add the connection to the child */
-        neat_add_connection(child, inherited_conn.in_node, 
-                          inherited_conn.out_node, 
-                          inherited_conn.weight,
-                          inherited_conn.enabled);
+        /* Add the connection to the child, keeping its historical marking */
+        if (neat_add_connection(child, inherited_conn.in_node, 
+                                inherited_conn.out_node, 
+                                inherited_conn.weight,
+                                inherited_conn.enabled) == 0) {
+            child->connections[child->connection_count - 1].innovation = inherited_conn.innovation;
+        }
         connection_added[i] = 1;
     }
     
@@ -597,10 +895,17 @@ neat_genome_t* neat_crossover(const neat_genome_t *parent1, const neat_genome_t
             }
         }
         
+        /* Skip genes whose endpoints the child did not inherit */
+        if (conn.in_node >= (int)child->node_count || conn.out_node >= (int)child->node_count) {
+            continue;
+        }
+        
         /* If not in fitter parent, maybe include it (50% chance) */
         if (!exists && neat_random_uniform(0, 1) < 0.5) {
-            neat_add_connection(child, conn.in_node, conn.out_node, 
-                              conn.weight, conn.enabled);
+            if (neat_add_connection(child, conn.in_node, conn.out_node, 
+                                    conn.weight, conn.enabled) == 0) {
+                child->connections[child->connection_count - 1].innovation = conn.innovation;
+            }
         }
     }
     
@@ -663,7 +968,7 @@ void neat_update_network(neat_genome_t *genome) {
         /* Simple implementation: evaluate nodes in order of their IDs */
         /* In a more complete implementation, this would perform a topological sort */
         genome->evaluation_order_size = genome->node_count;
-        genome->evaluation_order = (int*)neat_malloc(genome->node_count * sizeof(int));
+        genome->evaluation_order = (int*)neat_malloc_tagged(NEAT_MEM_GENOMES, genome->node_count * sizeof(int));
         
         for (size_t i = 0; i < genome->node_count; i++) {
             genome->evaluation_order[i] = i;
@@ -745,10 +1050,10 @@ void neat_evaluate(neat_genome_t *genome, const double *inputs, double *outputs)
 
 /* Innovation table functions */
 neat_innovation_table_t* neat_create_innovation_table(void) {
-    neat_innovation_table_t* table = (neat_innovation_table_t*)neat_malloc(sizeof(neat_innovation_table_t));
+    neat_innovation_table_t* table = (neat_innovation_table_t*)neat_malloc_tagged(NEAT_MEM_INNOVATION, sizeof(neat_innovation_table_t));
     table->count = 0;
     table->capacity = NEAT_DEFAULT_ALLOC_SIZE;
-    table->innovations = (neat_innovation_t*)neat_malloc(table->capacity * sizeof(neat_innovation_t));
+    table->innovations = (neat_innovation_t*)neat_malloc_tagged(NEAT_MEM_INNOVATION, table->capacity * sizeof(neat_innovation_t));
     table->next_innovation = 1;
     table->next_node_id = 1;  /* Start node IDs from 1 */
     table->next_species_id = 1;
@@ -765,6 +1070,9 @@ void neat_free_innovation_table(neat_innovation_table_t *table) {
 /* Innovation table functions */
 int neat_get_innovation(neat_innovation_table_t *table, int in_node, int out_node, 
                        bool is_new_node, int node_id, double weight) {
+    NEAT_DETAIL_START(lookup_start);
+    NEAT_DETAIL_COUNT(innovation_lookups, 1);
+    
     /* Check if this innovation already exists */
     for (size_t i = 0; i < table->count; i++) {
         neat_innovation_t *innov = &table->innovations[i];
@@ -772,9 +1080,13 @@ int neat_get_innovation(neat_innovation_table_t *table, int in_node, int out_nod
         if (innov->in_node == in_node && 
             innov->out_node == out_node && 
             innov->is_new_node == is_new_node) {
+            NEAT_DETAIL_COUNT(innovation_scanned, i + 1);
+            NEAT_DETAIL_STOP(innovation_time, lookup_start);
             return innov->innovation_number;
         }
     }
+    NEAT_DETAIL_COUNT(innovation_scanned, table->count);
+    NEAT_DETAIL_COUNT(innovations_created, 1);
     
     /* If not, create a new innovation */
     if (table->count >= table->capacity) {
@@ -800,21 +1112,23 @@ int neat_get_innovation(neat_innovation_table_t *table, int in_node, int out_nod
         innov->innovation_number = table->next_innovation++;
     }
     
+    NEAT_DETAIL_STOP(innovation_time, lookup_start);
     return innov->innovation_number;
 }
 
 /* Species functions */
 neat_species_t* neat_create_species(int id) {
-    neat_species_t *species = (neat_species_t*)neat_malloc(sizeof(neat_species_t));
+    neat_species_t *species = (neat_species_t*)neat_malloc_tagged(NEAT_MEM_SPECIES, sizeof(neat_species_t));
     species->id = id;
     species->member_count = 0;
     species->member_capacity = NEAT_DEFAULT_ALLOC_SIZE;
-    species->members = (neat_genome_t**)neat_malloc(species->member_capacity * sizeof(neat_genome_t*));
+    species->members = (neat_genome_t**)neat_malloc_tagged(NEAT_MEM_SPECIES, species->member_capacity * sizeof(neat_genome_t*));
     species->best_fitness = -1e10;
     species->average_fitness = 0.0;
     species->staleness = 0;
     species->age = 0;
     species->representative = NULL;
+    species->champion = NULL;
     return species;
 }
 
@@ -837,6 +1151,7 @@ void neat_add_genome_to_species(neat_species_t *species, neat_genome_t *genome)
     
     /* Add the genome to the species */
     species->members[species->member_count++] = genome;
+    genome->species_id = species->id;
     
     /* Update best fitness if needed */
     if (genome->fitness > species->best_fitness) {
@@ -894,16 +1209,38 @@ neat_population_t* neat_create_population(size_t input_size, size_t output_size,
     neat_population_t *pop = (neat_population_t*)neat_malloc(sizeof(neat_population_t));
     pop->genome_count = 0;
     pop->genome_capacity = population_size;
-    pop->genomes = (neat_genome_t**)neat_malloc(population_size * sizeof(neat_genome_t*));
+    pop->genomes = (neat_genome_t**)neat_malloc_tagged(NEAT_MEM_GENOMES, population_size * sizeof(neat_genome_t*));
     
     pop->species_count = 0;
     pop->species_capacity = NEAT_DEFAULT_ALLOC_SIZE;
-    pop->species = (neat_species_t**)neat_malloc(pop->species_capacity * sizeof(neat_species_t*));
+    pop->species = (neat_species_t**)neat_malloc_tagged(NEAT_MEM_SPECIES, pop->species_capacity * sizeof(neat_species_t*));
     
     pop->innovation_table = neat_create_innovation_table();
     pop->population_size = population_size;
     pop->generation = 0;
     pop->max_fitness_achieved = -1e10;
+    pop->next_genome_id = (int)population_size;
+    pop->ask_batch_size = 0;
+    pop->ask_cursor = 0;
+    pop->tell_count = 0;
+    neat_cost_model_init(&pop->cost_model);
+    pop->numa = NULL;
+    neat_eval_timeout_init(&pop->eval_timeout);
+    pop->surrogate = NULL;
+    pop->fidelity_levels = 1;
+    pop->fidelity_promote_fraction = NEAT_DEFAULT_FIDELITY_PROMOTE;
+    pop->evaluate_fidelity = NULL;
+    pop->checkpointer = NULL;
+    pop->runlog = NULL;
+    pop->metrics = NULL;
+    pop->eval_profile = NULL;
+    pop->stats_level = NEAT_STATS_PHASES;
+    memset(&pop->stats, 0, sizeof(pop->stats));
+    pop->on_generation = NULL;
+    pop->on_generation_user_data = NULL;
+    pop->allocator = neat_current_allocator();
+    pop->mapping = NULL;
+    pop->mapping_size = 0;
     pop->evaluate_genome = NULL;
     pop->evaluate_user_data = NULL;
     
@@ -965,6 +1302,11 @@ void neat_free_population(neat_population_t *pop) {
     /* Free innovation table */
     neat_free_innovation_table(pop->innovation_table);
     
+    /* Release a checkpoint mapping once no genome can reference it */
+    if (pop->mapping) {
+        munmap(pop->mapping, pop->mapping_size);
+    }
+    
     neat_free(pop);
 }
 
@@ -987,6 +1329,7 @@ void neat_speciate(neat_population_t *pop) {
     pop->species[pop->species_count++] = first_species;
     
     /* For each remaining genome, find a compatible species or create a new one */
+    NEAT_DETAIL_START(distance_start);
     for (size_t i = 1; i < pop->genome_count; i++) {
         neat_genome_t *genome = pop->genomes[i];
         int found_species = 0;
@@ -997,6 +1340,7 @@ void neat_speciate(neat_population_t *pop) {
             
             if (species->member_count > 0 && species->representative) {
                 double distance = neat_compatibility_distance(genome, species->representative);
+                NEAT_DETAIL_COUNT(distance_count, 1);
                 
                 if (distance < NEAT_COMPATIBILITY_THRESHOLD) {
                     /* Add to this species */
@@ -1023,6 +1367,7 @@ void neat_speciate(neat_population_t *pop) {
             pop->species[pop->species_count++] = new_species;
         }
     }
+    NEAT_DETAIL_STOP(distance_time, distance_start);
     
     /* Remove empty species */
     size_t i = 0;
@@ -1043,6 +1388,7 @@ void neat_speciate(neat_population_t *pop) {
 }
 
 void neat_remove_stale_species(neat_population_t *pop) {
+    int top = neat_top_fidelity(pop);
     size_t i = 0;
     while (i < pop->species_count) {
         neat_species_t *species = pop->species[i];
@@ -1050,13 +1396,21 @@ void neat_remove_stale_species(neat_population_t *pop) {
         /* Increment staleness */
         species->staleness++;
         
+        /* Only full-fidelity scores count as progress */
+        species->best_fitness = -1e10;
+        for (size_t j = 0; j < species->member_count; j++) {
+            neat_genome_t *member = species->members[j];
+            if (member->fidelity == top && member->fitness > species->best_fitness) {
+                species->best_fitness = member->fitness;
+            }
+        }
+        
         /* Check if this species has improved */
         if (species->best_fitness > pop->max_fitness_achieved) {
             species->staleness = 0;
             pop->max_fitness_achieved = species->best_fitness;
-        } else {
-            i++;
         }
+        i++;
     }
 }
 
@@ -1077,8 +1431,8 @@ void neat_remove_weak_species(neat_population_t *pop) {
         double fitness_ratio = fabs(species->average_fitness) / total_avg_fitness;
         int offspring_count = (int)(fitness_ratio * pop->population_size);
         
-        /* Remove species with no offspring */
-        if (offspring_count < 1) {
+        /* Remove species with no offspring, but never the last one */
+        if (offspring_count < 1 && pop->species_count > 1) {
             neat_free_species(species);
             
             /* Shift remaining species */
@@ -1093,7 +1447,17 @@ void neat_remove_weak_species(neat_population_t *pop) {
     }
 }
 
+/* Selection order: a higher fidelity level wins, then higher fitness */
+static bool neat_genome_ranks_above(const neat_genome_t *a, const neat_genome_t *b) {
+    if (a->fidelity != b->fidelity) {
+        return a->fidelity > b->fidelity;
+    }
+    return a->fitness > b->fitness;
+}
+
 void neat_reproduce(neat_population_t *pop) {
+    int top_fidelity = neat_top_fidelity(pop);
+    
     /* Calculate total average fitness */
     double total_avg_fitness = 0.0;
     for (size_t i = 0; i < pop->species_count; i++) {
@@ -1102,7 +1466,7 @@ void neat_reproduce(neat_population_t *pop) {
     }
     
     /* Create new population */
-    neat_genome_t **new_genomes = (neat_genome_t**)neat_malloc(pop->population_size * sizeof(neat_genome_t*));
+    neat_genome_t **new_genomes = (neat_genome_t**)neat_malloc_tagged(NEAT_MEM_GENOMES, pop->population_size * sizeof(neat_genome_t*));
     size_t new_genome_count = 0;
     
     /* Carry over elites */
@@ -1112,7 +1476,7 @@ void neat_reproduce(neat_population_t *pop) {
         /* Sort species by fitness (descending) */
         for (size_t j = 0; j < species->member_count - 1; j++) {
             for (size_t k = j + 1; k < species->member_count; k++) {
-                if (species->members[j]->fitness < species->members[k]->fitness) {
+                if (neat_genome_ranks_above(species->members[k], species->members[j])) {
                     neat_genome_t *temp = species->members[j];
                     species->members[j] = species->members[k];
                     species->members[k] = temp;
@@ -1120,9 +1484,17 @@ void neat_reproduce(neat_population_t *pop) {
             }
         }
         
-        /* Carry over the best genome as elite */
-        if (species->member_count > 0 && new_genome_count < pop->population_size) {
-            new_genomes[new_genome_count++] = neat_clone_genome(species->members[0]);
+        /* Carry over the best genome as elite, but only on a full-fidelity score */
+        if (species->member_count > 0 && new_genome_count < pop->population_size &&
+            species->members[0]->fidelity == top_fidelity) {
+            new_genomes[new_genome_count] = neat_clone_genome(species->members[0]);
+            new_genomes[new_genome_count]->parent_eval_time = species->members[0]->eval_time;
+            new_genomes[new_genome_count]->parent_fitness = species->members[0]->fitness;
+            new_genomes[new_genome_count]->parent1_id = species->members[0]->id;
+            new_genomes[new_genome_count]->parent2_id = -1;
+            new_genomes[new_genome_count]->elite = true;
+            new_genome_count++;
+            NEAT_DETAIL_COUNT(elite_count, 1);
         }
     }
     
@@ -1153,7 +1525,7 @@ void neat_reproduce(neat_population_t *pop) {
         /* Select first parent (tournament selection) */
         for (int i = 0; i < 3; i++) {
             int idx = neat_random_int(0, selected_species->member_count - 1);
-            if (!parent1 || selected_species->members[idx]->fitness > parent1->fitness) {
+            if (!parent1 || neat_genome_ranks_above(selected_species->members[idx], parent1)) {
                 parent1 = selected_species->members[idx];
             }
         }
@@ -1162,7 +1534,7 @@ void neat_reproduce(neat_population_t *pop) {
         if (neat_random_uniform(0, 1) < 0.3) {  /* 30% chance of sexual reproduction */
             for (int i = 0; i < 3; i++) {
                 int idx = neat_random_int(0, selected_species->member_count - 1);
-                if (!parent2 || selected_species->members[idx]->fitness > parent2->fitness) {
+                if (!parent2 || neat_genome_ranks_above(selected_species->members[idx], parent2)) {
                     /* Make sure we don't select the same parent twice */
                     if (selected_species->members[idx] != parent1) {
                         parent2 = selected_species->members[idx];
@@ -1174,16 +1546,31 @@ void neat_reproduce(neat_population_t *pop) {
         /* Create offspring */
         neat_genome_t *offspring = NULL;
         
+        NEAT_DETAIL_START(offspring_start);
         if (parent2) {
             /* Sexual reproduction */
             offspring = neat_crossover(parent1, parent2);
+            NEAT_DETAIL_COUNT(crossover_count, 1);
+            NEAT_DETAIL_STOP(crossover_time, offspring_start);
         } else {
             /* Asexual reproduction */
             offspring = neat_clone_genome(parent1);
+            NEAT_DETAIL_COUNT(clone_count, 1);
+            NEAT_DETAIL_STOP(clone_time, offspring_start);
         }
         
         /* Mutate the offspring */
+        NEAT_DETAIL_START(mutate_start);
         neat_mutate(offspring, pop->innovation_table);
+        NEAT_DETAIL_COUNT(mutation_count, 1);
+        NEAT_DETAIL_STOP(mutation_time, mutate_start);
+        offspring->parent_eval_time = parent1->eval_time;
+        offspring->parent_fitness = (parent2 && neat_genome_ranks_above(parent2, parent1)) ?
+                                    parent2->fitness : parent1->fitness;
+        offspring->parent1_id = parent1->id;
+        offspring->parent2_id = parent2 ? parent2->id : -1;
+        offspring->species_id = selected_species->id;
+        offspring->elite = false;
         
         /* Add to new population */
         if (new_genome_count < pop->population_size) {
@@ -1199,41 +1586,355 @@ void neat_reproduce(neat_population_t *pop) {
     }
     neat_free(pop->genomes);
     
+    /* Species memberships referred to the old generation; the next epoch re-speciates */
+    for (size_t i = 0; i < pop->species_count; i++) {
+        pop->species[i]->member_count = 0;
+        pop->species[i]->representative = NULL;
+        pop->species[i]->champion = NULL;
+    }
+    
+    /* Every member of the new generation gets a fresh ID and awaits evaluation */
+    for (size_t i = 0; i < new_genome_count; i++) {
+        new_genomes[i]->id = pop->next_genome_id++;
+        new_genomes[i]->evaluated = false;
+        new_genomes[i]->fidelity = 0;
+        new_genomes[i]->fitness = 0.0;
+        new_genomes[i]->adjusted_fitness = 0.0;
+        new_genomes[i]->eval_time = 0.0;
+    }
+    
     /* Update population */
     pop->genomes = new_genomes;
     pop->genome_count = new_genome_count;
+    pop->ask_cursor = 0;
+    pop->tell_count = 0;
     
     /* Increment generation */
     pop->generation++;
 }
 
-void neat_evolve(neat_population_t *pop) {
-    /* Evaluate all genomes */
-    if (pop->evaluate_genome) {
-        for (size_t i = 0; i < pop->genome_count; i++) {
-            pop->genomes[i]->fitness = pop->evaluate_genome(pop->genomes[i], pop->evaluate_user_data);
-            
-            /* Update max fitness */
-            if (pop->genomes[i]->fitness > pop->max_fitness_achieved) {
-                pop->max_fitness_achieved = pop->genomes[i]->fitness;
-            }
-        }
-    }
+/* Speciate, share fitness, cull and reproduce once every genome has a fitness */
+void neat_evolve_epoch(neat_population_t *pop) {
+    /* Statistics start fresh, keeping the evaluation time the caller measured */
+    neat_generation_stats_t *stats = &pop->stats;
+    double evaluate_time = stats->evaluate_time;
+    memset(stats, 0, sizeof(*stats));
+    stats->generation = pop->generation;
+    stats->evaluate_time = evaluate_time;
+    neat_allocator_t *outer_allocator = neat_use_allocator(pop->allocator);
+#if NEAT_ENABLE_STATS
+    neat_generation_stats_t *outer_detail = neat_detail;
+    neat_detail = pop->stats_level == NEAT_STATS_DETAILED ? stats : NULL;
+#endif
+    double epoch_start = neat_stats_clock(pop);
+    NEAT_TRACE_BEGIN("epoch", pop->generation);
     
     /* Speciate */
+    double phase_start = epoch_start;
+    NEAT_TRACE_BEGIN("speciate", NEAT_TRACE_NO_ARG);
     neat_speciate(pop);
+    NEAT_TRACE_END();
+    double phase_end = neat_stats_clock(pop);
+    stats->speciate_time = phase_end - phase_start;
     
     /* Adjust fitness within species */
+    phase_start = phase_end;
+    NEAT_TRACE_BEGIN("adjust_fitness", NEAT_TRACE_NO_ARG);
     for (size_t i = 0; i < pop->species_count; i++) {
         neat_adjust_fitness(pop->species[i]);
     }
+    NEAT_TRACE_END();
+    phase_end = neat_stats_clock(pop);
+    stats->adjust_time = phase_end - phase_start;
+    
+    /* Record the evaluated generation before reproduction replaces it */
+    if (pop->runlog) {
+        NEAT_TRACE_BEGIN("runlog_capture", NEAT_TRACE_NO_ARG);
+        neat_runlog_capture(pop->runlog, pop);
+        NEAT_TRACE_END();
+        phase_end = neat_stats_clock(pop);
+    }
+    if (pop->metrics) {
+        neat_metrics_capture(pop->metrics, pop);
+        phase_end = neat_stats_clock(pop);
+    }
+    if (pop->eval_profile) {
+        NEAT_TRACE_BEGIN("eval_profile", NEAT_TRACE_NO_ARG);
+        neat_eval_profile_capture(pop->eval_profile, pop);
+        NEAT_TRACE_END();
+        phase_end = neat_stats_clock(pop);
+    }
     
     /* Remove stale species */
+    phase_start = phase_end;
+    NEAT_TRACE_BEGIN("remove_stale", NEAT_TRACE_NO_ARG);
     neat_remove_stale_species(pop);
+    NEAT_TRACE_END();
+    phase_end = neat_stats_clock(pop);
+    stats->remove_stale_time = phase_end - phase_start;
     
     /* Remove weak species */
+    phase_start = phase_end;
+    NEAT_TRACE_BEGIN("remove_weak", NEAT_TRACE_NO_ARG);
     neat_remove_weak_species(pop);
+    NEAT_TRACE_END();
+    phase_end = neat_stats_clock(pop);
+    stats->remove_weak_time = phase_end - phase_start;
     
     /* Reproduce to create next generation */
+    phase_start = phase_end;
+    NEAT_TRACE_BEGIN("reproduce", NEAT_TRACE_NO_ARG);
     neat_reproduce(pop);
+    NEAT_TRACE_END();
+    phase_end = neat_stats_clock(pop);
+    stats->reproduce_time = phase_end - phase_start;
+    
+    if (pop->runlog) {
+        NEAT_TRACE_BEGIN("runlog_commit", NEAT_TRACE_NO_ARG);
+        neat_runlog_commit(pop->runlog, pop);
+        NEAT_TRACE_END();
+    }
+    
+    /* Snapshot the new generation for the background checkpoint writer */
+    if (pop->checkpointer) {
+        NEAT_TRACE_BEGIN("checkpoint", NEAT_TRACE_NO_ARG);
+        neat_checkpointer_step(pop->checkpointer, pop);
+        NEAT_TRACE_END();
+    }
+    NEAT_TRACE_END();
+    
+    stats->epoch_time = neat_stats_clock(pop) - epoch_start;
+#if NEAT_ENABLE_STATS
+    neat_detail = outer_detail;
+#endif
+    
+    if (pop->on_generation) {
+        pop->on_generation(pop, stats, pop->on_generation_user_data);
+    }
+    if (pop->metrics) {
+        neat_metrics_publish(pop->metrics, pop);
+    }
+    
+    /* Generation boundary: hand the buffered trace spans to the trace file */
+    neat_trace_flush();
+    neat_use_allocator(outer_allocator);
+}
+
+/* Fidelity level whose scores count for elitism and the best-fitness record */
+int neat_top_fidelity(const neat_population_t *pop) {
+    return pop->fidelity_levels > 1 ? pop->fidelity_levels - 1 : 0;
+}
+
+static void neat_evaluate_at_fidelity(neat_population_t *pop, neat_genome_t *genome, int level) {
+    NEAT_TRACE_BEGIN("evaluate", genome->id);
+    double start = neat_get_time();
+    genome->fitness = pop->evaluate_fidelity(genome, level, pop->evaluate_user_data);
+    genome->eval_time += neat_get_time() - start;
+    NEAT_TRACE_END();
+    genome->fidelity = level;
+    genome->evaluated = true;
+    
+    if (level == neat_top_fidelity(pop) && genome->fitness > pop->max_fitness_achieved) {
+        pop->max_fitness_achieved = genome->fitness;
+    }
+}
+
+/* Group by species, best fitness first within each species */
+static int compare_species_fitness(const void *a, const void *b) {
+    const neat_genome_t *ga = *(neat_genome_t* const*)a;
+    const neat_genome_t *gb = *(neat_genome_t* const*)b;
+    if (ga->species_id != gb->species_id) return (ga->species_id > gb->species_id) - (ga->species_id < gb->species_id);
+    return (ga->fitness < gb->fitness) - (ga->fitness > gb->fitness);
+}
+
+/*
+ * Successive halving within species. Every genome is scored at level 0, then
+ * each species promotes the best ceil(q * n) of its n members at the current
+ * level, and at least one, to the next level until the top level is reached.
+ * Ranking inside species keeps a new structure from being culled at low
+ * fidelity by an established species. Species are those of the parents
+ * (species_id as set by neat_reproduce), so the ladder does not speciate;
+ * neat_evolve_epoch does that once afterwards. The initial population has no
+ * species yet and is ranked as one group. Scores of all levels should be on a
+ * comparable scale (e.g. per step or per case), since species fitness sharing
+ * mixes them; elitism and the best-fitness record use top-level scores only.
+ */
+void neat_evaluate_fidelity_ladder(neat_population_t *pop) {
+    if (!pop->evaluate_fidelity || pop->genome_count == 0) return;
+    
+    int top = neat_top_fidelity(pop);
+    double q = pop->fidelity_promote_fraction;
+    if (q <= 0.0 || q > 1.0) q = NEAT_DEFAULT_FIDELITY_PROMOTE;
+    
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        pop->genomes[i]->eval_time = 0.0;
+        neat_evaluate_at_fidelity(pop, pop->genomes[i], 0);
+    }
+    if (top == 0) return;
+    
+    neat_genome_t **rung = (neat_genome_t**)neat_malloc(pop->genome_count * sizeof(neat_genome_t*));
+    for (int level = 1; level <= top; level++) {
+        size_t count = 0;
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            if (pop->genomes[i]->fidelity == level - 1) {
+                rung[count++] = pop->genomes[i];
+            }
+        }
+        qsort(rung, count, sizeof(neat_genome_t*), compare_species_fitness);
+        
+        /* Promote the head of each run of equal species IDs */
+        for (size_t start = 0; start < count; ) {
+            size_t end = start + 1;
+            while (end < count && rung[end]->species_id == rung[start]->species_id) end++;
+            
+            size_t n = end - start;
+            size_t promote = (size_t)ceil(q * n);
+            if (promote < 1) promote = 1;
+            if (promote > n) promote = n;
+            
+            for (size_t j = 0; j < promote; j++) {
+                neat_evaluate_at_fidelity(pop, rung[start + j], level);
+            }
+            start = end;
+        }
+    }
+    neat_free(rung);
+}
+
+void neat_evolve(neat_population_t *pop) {
+    neat_allocator_t *outer_allocator = neat_use_allocator(pop->allocator);
+    
+    /* Evaluate all genomes, through the fidelity ladder or the surrogate if configured */
+    double eval_start = neat_stats_clock(pop);
+    NEAT_TRACE_BEGIN("evaluate_population", pop->generation);
+    if (pop->evaluate_fidelity) {
+        neat_evaluate_fidelity_ladder(pop);
+    } else if (pop->evaluate_genome && pop->surrogate) {
+        neat_surrogate_evaluate(pop, pop->surrogate);
+    } else if (pop->evaluate_genome && pop->eval_timeout.timeout > 0.0) {
+        /* Deadlines are enforced by the evaluation pool's watchdog */
+        neat_evaluate_parallel(pop, pop->evaluate_genome, pop->evaluate_user_data, 1);
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            if (pop->genomes[i]->fitness > pop->max_fitness_achieved) {
+                pop->max_fitness_achieved = pop->genomes[i]->fitness;
+            }
+        }
+    } else if (pop->evaluate_genome) {
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            if (pop->metrics) {
+                atomic_store_explicit(&pop->metrics->queue_depth, pop->genome_count - i - 1, memory_order_relaxed);
+            }
+            NEAT_TRACE_BEGIN("evaluate", pop->genomes[i]->id);
+            double start = neat_get_time();
+            pop->genomes[i]->fitness = pop->evaluate_genome(pop->genomes[i], pop->evaluate_user_data);
+            pop->genomes[i]->eval_time = neat_get_time() - start;
+            pop->genomes[i]->evaluated = true;
+            NEAT_TRACE_END();
+            
+            /* Update max fitness */
+            if (pop->genomes[i]->fitness > pop->max_fitness_achieved) {
+                pop->max_fitness_achieved = pop->genomes[i]->fitness;
+            }
+        }
+    }
+    NEAT_TRACE_END();
+    pop->stats.evaluate_time = neat_stats_clock(pop) - eval_start;
+    
+    neat_evolve_epoch(pop);
+    neat_use_allocator(outer_allocator);
+}
+
+/* Look up a genome of the current generation by ID */
+neat_genome_t* neat_find_genome(const neat_population_t *pop, int id) {
+    if (!pop || pop->genome_count == 0) return NULL;
+    
+    /* IDs are assigned sequentially per generation, so try the direct offset first */
+    long idx = (long)id - (long)pop->genomes[0]->id;
+    if (idx >= 0 && (size_t)idx < pop->genome_count && pop->genomes[idx]->id == id) {
+        return pop->genomes[idx];
+    }
+    
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->id == id) {
+            return pop->genomes[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Hand out the next batch of unevaluated genomes of the current generation.
+ * A batch is a run of consecutive genomes without a result, so after
+ * neat_requeue it can be shorter than ask_batch_size. The returned handles
+ * point into the population and stay valid until the generation is
+ * replaced, i.e. until the last result is told. A count of 0 means every
+ * genome is out and the population is waiting for results.
+ */
+int neat_ask(neat_population_t *pop, neat_genome_t ***genomes, size_t *count) {
+    if (!pop || !genomes || !count) return -1;
+    
+    while (pop->ask_cursor < pop->genome_count && pop->genomes[pop->ask_cursor]->evaluated) {
+        pop->ask_cursor++;
+    }
+    size_t batch = 0;
+    while (pop->ask_cursor + batch < pop->genome_count &&
+           !pop->genomes[pop->ask_cursor + batch]->evaluated &&
+           (pop->ask_batch_size == 0 || batch < pop->ask_batch_size)) {
+        batch++;
+    }
+    
+    *genomes = batch > 0 ? &pop->genomes[pop->ask_cursor] : NULL;
+    *count = batch;
+    pop->ask_cursor += batch;
+    
+    return 0;
+}
+
+/*
+ * Hand out again every genome of the current generation that has no result
+ * yet, e.g. after a worker was lost: subsequent neat_ask calls return them.
+ * Results for both copies are fine, the first one told wins. Returns the
+ * number of genomes still waiting for a result, or -1 on invalid arguments.
+ */
+int neat_requeue(neat_population_t *pop) {
+    if (!pop) return -1;
+    
+    pop->ask_cursor = 0;
+    return (int)(pop->genome_count - pop->tell_count);
+}
+
+/*
+ * Report fitnesses for previously asked genomes, in any order. Results for
+ * unknown IDs (e.g. late arrivals from an earlier generation) and duplicates
+ * are ignored. Once every genome of the generation has a result, the
+ * population reproduces and the next neat_ask returns the new generation.
+ * Returns the number of results accepted, or -1 on invalid arguments.
+ */
+int neat_tell(neat_population_t *pop, const int *ids, const double *fitnesses, size_t count) {
+    if (!pop || (count > 0 && (!ids || !fitnesses))) return -1;
+    
+    int accepted = 0;
+    for (size_t i = 0; i < count; i++) {
+        neat_genome_t *genome = neat_find_genome(pop, ids[i]);
+        if (!genome || genome->evaluated) {
+            continue;
+        }
+        
+        genome->fitness = fitnesses[i];
+        genome->evaluated = true;
+        pop->tell_count++;
+        accepted++;
+        
+        if (genome->fitness > pop->max_fitness_achieved) {
+            pop->max_fitness_achieved = genome->fitness;
+        }
+    }
+    
+    if (pop->genome_count > 0 && pop->tell_count >= pop->genome_count) {
+        /* Evaluation happened outside the library and is not timed */
+        pop->stats.evaluate_time = 0.0;
+        neat_evolve_epoch(pop);
+    }
+    
+    return accepted;
 }
@@ -1,6 +1,7 @@
 #include "../include/novelty.h"
 #include "../include/neat.h"
 #include "../include/simd_math.h"
+#include "../include/trace.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -147,12 +148,12 @@ static distance_func_t get_distance_function(novelty_search_t* ns) {
 
 /* Create a new behavior */
 behavior_t* behavior_create(size_t size) {
-    behavior_t* behavior = (behavior_t*)calloc(1, sizeof(behavior_t));
+    behavior_t* behavior = (behavior_t*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, 1, sizeof(behavior_t));
     if (!behavior) return NULL;
     
-    behavior->data = (float*)calloc(size, sizeof(float));
+    behavior->data = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, size, sizeof(float));
     if (!behavior->data) {
-        free(behavior);
+        neat_free(behavior);
         return NULL;
     }
     
@@ -171,10 +172,10 @@ void behavior_free(behavior_t* behavior) {
     if (!behavior) return;
     
     if (behavior->data) {
-        free(behavior->data);
+        neat_free(behavior->data);
     }
     
-    free(behavior);
+    neat_free(behavior);
 }
 
 /* Copy behavior from src to dest */
@@ -219,37 +220,37 @@ novelty_archive_t* novelty_archive_create(size_t capacity, size_t behavior_size)
         return NULL;
     }
     
-    novelty_archive_t* archive = (novelty_archive_t*)calloc(1, sizeof(novelty_archive_t));
+    novelty_archive_t* archive = (novelty_archive_t*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, 1, sizeof(novelty_archive_t));
     if (!archive) {
         return NULL;
     }
     
-    archive->items = (behavior_t**)calloc(capacity, sizeof(behavior_t*));
+    archive->items = (behavior_t**)neat_calloc_tagged(NEAT_MEM_ARCHIVE, capacity, sizeof(behavior_t*));
     if (!archive->items) {
-        free(archive);
+        neat_free(archive);
         return NULL;
     }
     
-    archive->recent_additions = (size_t*)calloc(capacity, sizeof(size_t));
+    archive->recent_additions = (size_t*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, capacity, sizeof(size_t));
     if (!archive->recent_additions) {
-        free(archive->items);
-        free(archive);
+        neat_free(archive->items);
+        neat_free(archive);
         return NULL;
     }
     
-    archive->min_bounds = (float*)calloc(behavior_size, sizeof(float));
-    archive->max_bounds = (float*)calloc(behavior_size, sizeof(float));
-    archive->mean = (float*)calloc(behavior_size, sizeof(float));
-    archive->std_dev = (float*)calloc(behavior_size, sizeof(float));
+    archive->min_bounds = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, behavior_size, sizeof(float));
+    archive->max_bounds = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, behavior_size, sizeof(float));
+    archive->mean = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, behavior_size, sizeof(float));
+    archive->std_dev = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, behavior_size, sizeof(float));
     
     if (!archive->min_bounds || !archive->max_bounds || !archive->mean || !archive->std_dev) {
-        free(archive->min_bounds);
-        free(archive->max_bounds);
-        free(archive->mean);
-        free(archive->std_dev);
-        free(archive->recent_additions);
-        free(archive->items);
-        free(archive);
+        neat_free(archive->min_bounds);
+        neat_free(archive->max_bounds);
+        neat_free(archive->mean);
+        neat_free(archive->std_dev);
+        neat_free(archive->recent_additions);
+        neat_free(archive->items);
+        neat_free(archive);
         return NULL;
     }
     
@@ -284,16 +285,16 @@ void novelty_archive_free(novelty_archive_t* archive) {
                 behavior_free(archive->items[i]);
             }
         }
-        free(archive->items);
+        neat_free(archive->items);
     }
     
-    if (archive->min_bounds) free(archive->min_bounds);
-    if (archive->max_bounds) free(archive->max_bounds);
-    if (archive->mean) free(archive->mean);
-    if (archive->std_dev) free(archive->std_dev);
-    if (archive->recent_additions) free(archive->recent_additions);
+    if (archive->min_bounds) neat_free(archive->min_bounds);
+    if (archive->max_bounds) neat_free(archive->max_bounds);
+    if (archive->mean) neat_free(archive->mean);
+    if (archive->std_dev) neat_free(archive->std_dev);
+    if (archive->recent_additions) neat_free(archive->recent_additions);
     
-    free(archive);
+    neat_free(archive);
 }
 
 /* Add a behavior to the archive if it's novel enough */
@@ -497,13 +498,15 @@ float calculate_novelty(const behavior_t* behavior, const novelty_archive_t* arc
     }
     
     /* Find k-nearest neighbors */
+    NEAT_TRACE_BEGIN("novelty_knn", (int64_t)archive->size);
     size_t num_neighbors = (k < archive->size) ? k : archive->size;
-    float* distances = (float*)calloc(archive->size, sizeof(float));
-    size_t* indices = (size_t*)calloc(archive->size, sizeof(size_t));
+    float* distances = (float*)neat_calloc(archive->size, sizeof(float));
+    size_t* indices = (size_t*)neat_calloc(archive->size, sizeof(size_t));
     
     if (!distances || !indices) {
-        if (distances) free(distances);
-        if (indices) free(indices);
+        if (distances) neat_free(distances);
+        if (indices) neat_free(indices);
+        NEAT_TRACE_END();
         return 0.0f;
     }
     
@@ -542,8 +545,9 @@ float calculate_novelty(const behavior_t* behavior, const novelty_archive_t* arc
         sum += distances[i];
     }
     
-    free(distances);
-    free(indices);
+    neat_free(distances);
+    neat_free(indices);
+    NEAT_TRACE_END();
     
     return sum / num_neighbors;
 }
@@ -554,7 +558,7 @@ float* calculate_novelty_batch(const behavior_t* behaviors, size_t count,
                               distance_func_t dist_func, void* user_data) {
     if (!behaviors || count == 0 || !archive) return NULL;
     
-    float* scores = (float*)calloc(count, sizeof(float));
+    float* scores = (float*)neat_calloc(count, sizeof(float));
     if (!scores) return NULL;
     
     for (size_t i = 0; i < count; i++) {
@@ -569,6 +573,7 @@ void update_novelty_scores(novelty_search_t* ns, behavior_t* behaviors, size_t c
     if (!ns || !behaviors || count == 0) return;
     
     distance_func_t dist_func = get_distance_function(ns);
+    NEAT_TRACE_BEGIN("novelty_scores", (int64_t)count);
     
     /* Calculate novelty for each behavior */
     for (size_t i = 0; i < count; i++) {
@@ -586,6 +591,7 @@ void update_novelty_scores(novelty_search_t* ns, behavior_t* behaviors, size_t c
             behaviors[i].combined_score = behaviors[i].novelty;
         }
     }
+    NEAT_TRACE_END();
 }
 
 /* Update population statistics */
@@ -596,22 +602,22 @@ void update_population_stats(novelty_search_t* ns, const behavior_t* behaviors,
     
     /* Initialize stats if needed */
     if (!ns->stats) {
-        ns->stats = (population_stats_t*)calloc(1, sizeof(population_stats_t));
+        ns->stats = (population_stats_t*)neat_calloc(1, sizeof(population_stats_t));
         if (!ns->stats) return;
         
-        ns->stats->centroid = (float*)calloc(dims, sizeof(float));
-        ns->stats->std_dev = (float*)calloc(dims, sizeof(float));
-        ns->stats->min_bounds = (float*)calloc(dims, sizeof(float));
-        ns->stats->max_bounds = (float*)calloc(dims, sizeof(float));
+        ns->stats->centroid = (float*)neat_calloc(dims, sizeof(float));
+        ns->stats->std_dev = (float*)neat_calloc(dims, sizeof(float));
+        ns->stats->min_bounds = (float*)neat_calloc(dims, sizeof(float));
+        ns->stats->max_bounds = (float*)neat_calloc(dims, sizeof(float));
         ns->stats->size = dims;
         
         if (!ns->stats->centroid || !ns->stats->std_dev || 
             !ns->stats->min_bounds || !ns->stats->max_bounds) {
-            if (ns->stats->centroid) free(ns->stats->centroid);
-            if (ns->stats->std_dev) free(ns->stats->std_dev);
-            if (ns->stats->min_bounds) free(ns->stats->min_bounds);
-            if (ns->stats->max_bounds) free(ns->stats->max_bounds);
-            free(ns->stats);
+            if (ns->stats->centroid) neat_free(ns->stats->centroid);
+            if (ns->stats->std_dev) neat_free(ns->stats->std_dev);
+            if (ns->stats->min_bounds) neat_free(ns->stats->min_bounds);
+            if (ns->stats->max_bounds) neat_free(ns->stats->max_bounds);
+            neat_free(ns->stats);
             ns->stats = NULL;
             return;
         }
@@ -815,7 +821,7 @@ void fitness_novelty_selection(novelty_search_t* ns, const behavior_t* behaviors
     if (novelty_range < 1e-10f) novelty_range = 1.0f;
     
     /* Calculate combined scores */
-    float* combined_scores = (float*)malloc(count * sizeof(float));
+    float* combined_scores = (float*)neat_malloc(count * sizeof(float));
     if (!combined_scores) return;
     
     for (size_t i = 0; i < count; i++) {
@@ -846,7 +852,7 @@ void fitness_novelty_selection(novelty_search_t* ns, const behavior_t* behaviors
         selected[i] = best_idx;
     }
     
-    free(combined_scores);
+    neat_free(combined_scores);
 }
 
 /* Tournament selection */
@@ -874,11 +880,39 @@ void tournament_selection(const behavior_t* behaviors, size_t count,
     }
 }
 
+/* Allocator hooks that forward to the user's allocation callbacks */
+static void* novelty_user_alloc(void* ctx, size_t size) {
+    return ((novelty_search_t*)ctx)->user_alloc_func(size);
+}
+
+static void novelty_user_free(void* ctx, void* ptr, size_t size) {
+    (void)size;
+    ((novelty_search_t*)ctx)->user_free_func(ptr);
+}
+
+/* Allocator for memory made while the search runs: the user's callbacks if set, else the caller's */
+static neat_allocator_t* novelty_allocator(novelty_search_t* ns) {
+    return ns->user_alloc_func && ns->user_free_func ? &ns->allocator : neat_current_allocator();
+}
+
+void* novelty_alloc(novelty_search_t* ns, size_t size) {
+    neat_allocator_t* outer_allocator = neat_use_allocator(novelty_allocator(ns));
+    void* ptr = neat_malloc_tagged(NEAT_MEM_ARCHIVE, size);
+    neat_use_allocator(outer_allocator);
+    return ptr;
+}
+
+/* Blocks record the allocator that made them, so this reaches the same callbacks */
+void novelty_free(novelty_search_t* ns, void* ptr) {
+    (void)ns;
+    neat_free(ptr);
+}
+
 /* Create a new novelty search context */
 novelty_search_t* novelty_search_create(const novelty_config_t* config, size_t behavior_size) {
     if (!config || behavior_size == 0) return NULL;
     
-    novelty_search_t* ns = (novelty_search_t*)calloc(1, sizeof(novelty_search_t));
+    novelty_search_t* ns = (novelty_search_t*)neat_calloc(1, sizeof(novelty_search_t));
     if (!ns) return NULL;
     
     /* Copy configuration */
@@ -887,7 +921,7 @@ novelty_search_t* novelty_search_create(const novelty_config_t* config, size_t b
     /* Create archive */
     ns->archive = novelty_archive_create(config->max_archive_size, behavior_size);
     if (!ns->archive) {
-        free(ns);
+        neat_free(ns);
         return NULL;
     }
     
@@ -898,12 +932,12 @@ novelty_search_t* novelty_search_create(const novelty_config_t* config, size_t b
     ns->user_distance_func = NULL;
     
     /* Allocate distance cache */
-    ns->distance_cache = (float*)calloc(behavior_size * behavior_size, sizeof(float));
+    ns->distance_cache = (float*)neat_calloc(behavior_size * behavior_size, sizeof(float));
     ns->cache_size = behavior_size * behavior_size;
     
     if (!ns->distance_cache) {
         novelty_archive_free(ns->archive);
-        free(ns);
+        neat_free(ns);
         return NULL;
     }
     
@@ -922,23 +956,23 @@ void novelty_search_free(novelty_search_t* ns) {
     }
     
     if (ns->stats) {
-        if (ns->stats->centroid) free(ns->stats->centroid);
-        if (ns->stats->std_dev) free(ns->stats->std_dev);
-        if (ns->stats->min_bounds) free(ns->stats->min_bounds);
-        if (ns->stats->max_bounds) free(ns->stats->max_bounds);
-        free(ns->stats);
-    }
-    
-    if (ns->distance_cache) free(ns->distance_cache);
-    if (ns->distance_matrix) free(ns->distance_matrix);
-    if (ns->nearest_neighbors) free(ns->nearest_neighbors);
-    if (ns->neighbor_distances) free(ns->neighbor_distances);
-    if (ns->selection_pool) free(ns->selection_pool);
-    if (ns->behavior_buffer) free(ns->behavior_buffer);
-    if (ns->behavior_indices) free(ns->behavior_indices);
-    if (ns->temp_distances) free(ns->temp_distances);
-    
-    free(ns);
+        if (ns->stats->centroid) neat_free(ns->stats->centroid);
+        if (ns->stats->std_dev) neat_free(ns->stats->std_dev);
+        if (ns->stats->min_bounds) neat_free(ns->stats->min_bounds);
+        if (ns->stats->max_bounds) neat_free(ns->stats->max_bounds);
+        neat_free(ns->stats);
+    }
+    
+    if (ns->distance_cache) neat_free(ns->distance_cache);
+    if (ns->distance_matrix) neat_free(ns->distance_matrix);
+    if (ns->nearest_neighbors) neat_free(ns->nearest_neighbors);
+    if (ns->neighbor_distances) neat_free(ns->neighbor_distances);
+    if (ns->selection_pool) neat_free(ns->selection_pool);
+    if (ns->behavior_buffer) neat_free(ns->behavior_buffer);
+    if (ns->behavior_indices) neat_free(ns->behavior_indices);
+    if (ns->temp_distances) neat_free(ns->temp_distances);
+    
+    neat_free(ns);
 }
 
 /* Run one step of novelty search */
@@ -946,14 +980,14 @@ void novelty_search_step(novelty_search_t* ns, void** population,
                         size_t population_size, evaluation_func_t eval_func, 
                         void* user_data) {
     if (!ns || !population || population_size == 0 || !eval_func) return;
+    neat_allocator_t* outer_allocator = neat_use_allocator(novelty_allocator(ns));
     
     /* Evaluate all individuals to get behaviors */
-    behavior_t* behaviors = (behavior_t*)calloc(population_size, sizeof(behavior_t));
-    if (!behaviors) return;
+    behavior_t* behaviors = (behavior_t*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, population_size, sizeof(behavior_t));
     
     /* Initialize behaviors */
     for (size_t i = 0; i < population_size; i++) {
-        behaviors[i].data = (float*)calloc(ns->archive->dimensions, sizeof(float));
+        behaviors[i].data = (float*)neat_calloc_tagged(NEAT_MEM_ARCHIVE, ns->archive->dimensions, sizeof(float));
         behaviors[i].size = ns->archive->dimensions;
         behaviors[i].extra_data = population[i];
     }
@@ -985,12 +1019,13 @@ void novelty_search_step(novelty_search_t* ns, void** population,
     
     /* Cleanup */
     for (size_t i = 0; i < population_size; i++) {
-        if (behaviors[i].data) free(behaviors[i].data);
+        if (behaviors[i].data) neat_free(behaviors[i].data);
     }
-    free(behaviors);
+    neat_free(behaviors);
     
     /* Update generation counter */
     ns->generation++;
+    neat_use_allocator(outer_allocator);
 }
 
 /* Run novelty search for multiple generations */
@@ -1029,6 +1064,7 @@ void novelty_search_set_callbacks(novelty_search_t* ns,
     
     ns->user_alloc_func = alloc_func;
     ns->user_free_func = free_func;
+    neat_allocator_init(&ns->allocator, novelty_user_alloc, NULL, novelty_user_free, ns);
     ns->user_distance_func = distance_func;
     ns->user_behavior_func = behavior_func;
     ns->user_fitness_func = fitness_func;
@@ -1,38 +1,777 @@
+#define _GNU_SOURCE
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include "../include/neat.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
 
-/* Thread data structure */
+/* Genome scheduled for evaluation, ordered by predicted cost */
+typedef struct {
+    size_t index;
+    double cost;
+} eval_job_t;
+
+/* Deadline watchdog for one parallel evaluation; tokens are per worker */
+typedef struct {
+    const neat_eval_timeout_t* config;
+    neat_eval_token_t* tokens;
+    int token_count;
+    double tick;                /* Seconds between deadline checks */
+    pthread_t thread;
+    bool running;               /* Watchdog thread was started */
+    pthread_mutex_t lock;       /* Guards the token deadlines and stop */
+    pthread_cond_t cond;
+    bool stop;
+    atomic_size_t timed_out;
+    atomic_size_t retried;
+    atomic_size_t penalized;
+} eval_watchdog_t;
+
+/* Shared work queue: workers pull jobs longest-predicted-first */
+typedef struct {
+    neat_genome_t** genomes;
+    const eval_job_t* jobs;
+    size_t job_count;
+    atomic_size_t next_job;
+    atomic_size_t* queue_depth; /* Metrics gauge of jobs not yet taken (NULL = none) */
+    eval_watchdog_t* watchdog;  /* NULL without a timeout */
+    atomic_int next_slot;       /* Watchdog token of the next worker to start */
+    neat_allocator_t* allocator; /* Population allocator, installed in every worker */
+    void* user_data;
+    neat_evaluate_func_t evaluate_func;
+} eval_queue_t;
+
+/* One NUMA node's share of the jobs */
+typedef struct {
+    eval_job_t* jobs;           /* Longest predicted first */
+    size_t job_count;
+    atomic_size_t next_job;
+} eval_shard_t;
+
+/* Per-node queues for sharded evaluation */
 typedef struct {
     neat_genome_t** genomes;
-    size_t start_idx;
-    size_t end_idx;
+    eval_shard_t* shards;
+    int shard_count;
+    neat_numa_t* numa;
+    neat_allocator_t* allocator; /* Population allocator, current outside the node arenas */
+    atomic_size_t* queue_depth; /* Metrics gauge of jobs not yet taken (NULL = none) */
+    eval_watchdog_t* watchdog;  /* NULL without a timeout */
     void* user_data;
     neat_evaluate_func_t evaluate_func;
-    pthread_mutex_t* mutex;
-    int result;
-} thread_data_t;
+    atomic_size_t local_jobs;
+    atomic_size_t stolen_jobs;
+    atomic_size_t relocated;
+    atomic_size_t resident;
+} shard_queue_t;
+
+typedef struct {
+    shard_queue_t* queue;
+    int node;
+    int slot;                   /* Watchdog token */
+} shard_worker_t;
+
+/* Cost model */
+void neat_cost_model_init(neat_cost_model_t* model) {
+    memset(model, 0, sizeof(*model));
+    model->decay = 0.9;
+}
+
+static void cost_model_features(const neat_genome_t* genome, double* x) {
+    size_t enabled = 0;
+    for (size_t i = 0; i < genome->connection_count; i++) {
+        if (genome->connections[i].enabled) enabled++;
+    }
+    x[0] = 1.0;
+    x[1] = (double)genome->node_count;
+    x[2] = (double)enabled;
+    x[3] = genome->parent_eval_time;
+}
+
+/* Predicted evaluation time in seconds (arbitrary units before the first fit) */
+double neat_cost_model_predict(const neat_cost_model_t* model, const neat_genome_t* genome) {
+    double x[NEAT_COST_FEATURES];
+    cost_model_features(genome, x);
+
+    /* Until there is enough data, rank by parent time, then by size */
+    if (model->samples < 2 * NEAT_COST_FEATURES) {
+        return x[3] > 0.0 ? x[3] : 1e-9 * (x[1] + x[2]);
+    }
+
+    double cost = 0.0;
+    for (int i = 0; i < NEAT_COST_FEATURES; i++) {
+        cost += model->coef[i] * x[i];
+    }
+    return cost;
+}
+
+/* Solve the ridge-regularized normal equations by Gaussian elimination */
+static void cost_model_solve(neat_cost_model_t* model) {
+    const int n = NEAT_COST_FEATURES;
+    double a[NEAT_COST_FEATURES][NEAT_COST_FEATURES + 1];
+    double trace = 0.0;
+
+    for (int i = 0; i < n; i++) trace += model->xtx[i][i];
+    double ridge = 1e-9 * (trace > 0.0 ? trace : 1.0);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            a[i][j] = model->xtx[i][j] + (i == j ? ridge : 0.0);
+        }
+        a[i][n] = model->xty[i];
+    }
+
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < n; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+        }
+        if (fabs(a[pivot][col]) < 1e-300) return;  /* Keep the previous fit */
+        if (pivot != col) {
+            for (int k = 0; k <= n; k++) {
+                double tmp = a[col][k];
+                a[col][k] = a[pivot][k];
+                a[pivot][k] = tmp;
+            }
+        }
+        for (int row = col + 1; row < n; row++) {
+            double f = a[row][col] / a[col][col];
+            for (int k = col; k <= n; k++) a[row][k] -= f * a[col][k];
+        }
+    }
+
+    double coef[NEAT_COST_FEATURES];
+    for (int i = n - 1; i >= 0; i--) {
+        double sum = a[i][n];
+        for (int k = i + 1; k < n; k++) sum -= a[i][k] * coef[k];
+        coef[i] = sum / a[i][i];
+    }
+    memcpy(model->coef, coef, sizeof(coef));
+}
+
+/* Fold one generation of measured times into the model and refit */
+void neat_cost_model_update(neat_cost_model_t* model, neat_genome_t** genomes, size_t count) {
+    for (int i = 0; i < NEAT_COST_FEATURES; i++) {
+        model->xty[i] *= model->decay;
+        for (int j = 0; j < NEAT_COST_FEATURES; j++) {
+            model->xtx[i][j] *= model->decay;
+        }
+    }
+
+    for (size_t g = 0; g < count; g++) {
+        if (!genomes[g] || !genomes[g]->evaluated) continue;
+
+        double x[NEAT_COST_FEATURES];
+        cost_model_features(genomes[g], x);
+        for (int i = 0; i < NEAT_COST_FEATURES; i++) {
+            model->xty[i] += x[i] * genomes[g]->eval_time;
+            for (int j = 0; j < NEAT_COST_FEATURES; j++) {
+                model->xtx[i][j] += x[i] * x[j];
+            }
+        }
+        model->samples++;
+    }
+
+    cost_model_solve(model);
+}
+
+static int compare_jobs_desc(const void* a, const void* b) {
+    double ca = ((const eval_job_t*)a)->cost;
+    double cb = ((const eval_job_t*)b)->cost;
+    return (ca < cb) - (ca > cb);
+}
+
+/* Evaluation timeouts */
+
+static _Thread_local neat_eval_token_t* tl_token = NULL;
+
+void neat_eval_timeout_init(neat_eval_timeout_t* timeout) {
+    memset(timeout, 0, sizeof(*timeout));
+    timeout->policy = NEAT_TIMEOUT_PENALTY;
+    timeout->max_retries = 1;
+    timeout->retry_budget = 0.5;
+}
+
+const neat_eval_token_t* neat_eval_token(void) {
+    return tl_token;
+}
+
+bool neat_eval_cancelled(void) {
+    return tl_token && atomic_load_explicit(&tl_token->cancelled, memory_order_relaxed);
+}
+
+double neat_eval_budget(void) {
+    return tl_token ? tl_token->budget : 1.0;
+}
+
+static void* watchdog_thread(void* arg) {
+    eval_watchdog_t* watchdog = (eval_watchdog_t*)arg;
+    neat_trace_thread_name("evaluation watchdog");
+
+    pthread_mutex_lock(&watchdog->lock);
+    while (!watchdog->stop) {
+        double now = neat_get_time();
+        for (int i = 0; i < watchdog->token_count; i++) {
+            neat_eval_token_t* token = &watchdog->tokens[i];
+            if (token->deadline > 0.0 && now >= token->deadline) {
+                atomic_store_explicit(&token->cancelled, true, memory_order_relaxed);
+            }
+        }
+
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        long nanos = wake.tv_nsec + (long)(watchdog->tick * 1e9);
+        wake.tv_sec += nanos / 1000000000L;
+        wake.tv_nsec = nanos % 1000000000L;
+        pthread_cond_timedwait(&watchdog->cond, &watchdog->lock, &wake);
+    }
+    pthread_mutex_unlock(&watchdog->lock);
+    return NULL;
+}
+
+static void watchdog_start(eval_watchdog_t* watchdog, const neat_eval_timeout_t* config, int workers) {
+    watchdog->config = config;
+    watchdog->token_count = workers;
+    watchdog->tokens = (neat_eval_token_t*)neat_calloc((size_t)workers, sizeof(neat_eval_token_t));
+    for (int i = 0; i < workers; i++) {
+        atomic_init(&watchdog->tokens[i].cancelled, false);
+    }
+
+    /* A few checks per timeout bounds the overrun; the callback's own clock is exact */
+    watchdog->tick = config->timeout / 4.0;
+    if (watchdog->tick < 0.001) watchdog->tick = 0.001;
+    if (watchdog->tick > 0.1) watchdog->tick = 0.1;
+    watchdog->stop = false;
+    atomic_init(&watchdog->timed_out, 0);
+    atomic_init(&watchdog->retried, 0);
+    atomic_init(&watchdog->penalized, 0);
+    pthread_mutex_init(&watchdog->lock, NULL);
+    pthread_cond_init(&watchdog->cond, NULL);
+    /* Without the thread nothing is cancelled early, but overruns are still caught by their own clock */
+    watchdog->running = pthread_create(&watchdog->thread, NULL, watchdog_thread, watchdog) == 0;
+}
+
+static void watchdog_stop(eval_watchdog_t* watchdog, neat_eval_timeout_t* results) {
+    pthread_mutex_lock(&watchdog->lock);
+    watchdog->stop = true;
+    pthread_cond_signal(&watchdog->cond);
+    pthread_mutex_unlock(&watchdog->lock);
+    if (watchdog->running) pthread_join(watchdog->thread, NULL);
+
+    results->timed_out = atomic_load(&watchdog->timed_out);
+    results->retried = atomic_load(&watchdog->retried);
+    results->penalized = atomic_load(&watchdog->penalized);
+    pthread_cond_destroy(&watchdog->cond);
+    pthread_mutex_destroy(&watchdog->lock);
+    neat_free(watchdog->tokens);
+}
+
+/* Run attempts under the worker's token until one finishes in time or the policy gives up */
+static double evaluate_with_deadline(neat_genome_t* genome, neat_evaluate_func_t evaluate_func,
+                                     void* user_data, eval_watchdog_t* watchdog, neat_eval_token_t* token) {
+    const neat_eval_timeout_t* config = watchdog->config;
+    double retry_budget = config->retry_budget > 0.0 ? config->retry_budget : 0.5;
+    token->budget = 1.0;
+
+    for (int attempt = 0;; attempt++) {
+        token->attempt = attempt;
+        atomic_store_explicit(&token->cancelled, false, memory_order_relaxed);
+        double start = neat_get_time();
+        pthread_mutex_lock(&watchdog->lock);
+        token->deadline = start + config->timeout;
+        pthread_mutex_unlock(&watchdog->lock);
+
+        tl_token = token;
+        double fitness = evaluate_func(genome, user_data);
+        tl_token = NULL;
+
+        pthread_mutex_lock(&watchdog->lock);
+        token->deadline = 0.0;
+        pthread_mutex_unlock(&watchdog->lock);
+        bool overdue = atomic_load_explicit(&token->cancelled, memory_order_relaxed) ||
+                       neat_get_time() - start > config->timeout;
+        if (!overdue) {
+            return fitness;
+        }
+
+        atomic_fetch_add_explicit(&watchdog->timed_out, 1, memory_order_relaxed);
+        if (config->policy == NEAT_TIMEOUT_RETRY && attempt < config->max_retries) {
+            atomic_fetch_add_explicit(&watchdog->retried, 1, memory_order_relaxed);
+            token->budget *= retry_budget;
+            continue;
+        }
+        atomic_fetch_add_explicit(&watchdog->penalized, 1, memory_order_relaxed);
+        return config->penalty_fitness;
+    }
+}
+
+/* Evaluate one genome; slot picks the worker's watchdog token */
+static void evaluate_one(neat_genome_t* genome, neat_evaluate_func_t evaluate_func, void* user_data,
+                         eval_watchdog_t* watchdog, int slot) {
+    NEAT_TRACE_BEGIN("evaluate", genome->id);
+    double start = neat_get_time();
+    if (watchdog) {
+        genome->fitness = evaluate_with_deadline(genome, evaluate_func, user_data, watchdog,
+                                                 &watchdog->tokens[slot]);
+    } else {
+        genome->fitness = evaluate_func(genome, user_data);
+    }
+    genome->eval_time = neat_get_time() - start;
+    genome->evaluated = true;
+    NEAT_TRACE_END();
+}
 
 /* Thread worker function */
 static void* evaluate_worker(void* arg) {
-    thread_data_t* data = (thread_data_t*)arg;
+    eval_queue_t* queue = (eval_queue_t*)arg;
+    int slot = atomic_fetch_add_explicit(&queue->next_slot, 1, memory_order_relaxed);
+    neat_allocator_t* outer_allocator = neat_use_allocator(queue->allocator);
+    neat_trace_thread_name("evaluate worker");
     
-    for (size_t i = data->start_idx; i < data->end_idx; i++) {
-        if (data->genomes[i]) {
-            double fitness = data->evaluate_func(data->genomes[i], data->user_data);
-            
-            /* Safely update the genome's fitness */
-            pthread_mutex_lock(data->mutex);
-            data->genomes[i]->fitness = fitness;
-            pthread_mutex_unlock(data->mutex);
+    for (;;) {
+        size_t job = atomic_fetch_add_explicit(&queue->next_job, 1, memory_order_relaxed);
+        if (job >= queue->job_count) {
+            break;
         }
+        if (queue->queue_depth) {
+            atomic_store_explicit(queue->queue_depth, queue->job_count - job - 1, memory_order_relaxed);
+        }
+        
+        /* Each genome is owned by exactly one worker, so no locking is needed */
+        evaluate_one(queue->genomes[queue->jobs[job].index], queue->evaluate_func, queue->user_data,
+                     queue->watchdog, slot);
     }
     
+    neat_use_allocator(outer_allocator);
     return NULL;
 }
 
-/* Evaluate a population in parallel */
+/* NUMA topology */
+
+/* Parse a sysfs cpulist such as "0-3,8-11"; returns the number of CPUs written */
+static size_t parse_cpulist(const char* text, int* cpus, size_t max) {
+    size_t count = 0;
+    while (*text && *text != '\n') {
+        char* end;
+        long first = strtol(text, &end, 10);
+        if (end == text) break;
+        long last = first;
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (cpus && count < max) cpus[count] = (int)cpu;
+            count++;
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count < max ? count : max;
+}
+
+/*
+ * Per-node gene arenas. Size-classed blocks are carved from mmap'd slabs
+ * that are bound to the node with mbind before anything touches them; where
+ * the kernel refuses (no NUMA support, seccomp), the fresh pages still land
+ * on the node of the pinned worker that first writes them. Blocks above the
+ * largest class get their own mapping. An arena outlives neat_numa_free
+ * until the last gene array in it is freed.
+ */
+#define NUMA_ARENA_SLAB    ((size_t)2 << 20)
+#define NUMA_ARENA_MIN     ((size_t)64)
+#define NUMA_ARENA_CLASSES 14  /* 64 B .. 512 KiB */
+
+typedef struct numa_free_block {
+    struct numa_free_block* next;
+} numa_free_block_t;
+
+struct neat_numa_arena {
+    neat_allocator_t allocator;
+    int node;                   /* Kernel node number */
+    pthread_mutex_t lock;
+    numa_free_block_t* free_lists[NUMA_ARENA_CLASSES];
+    void* slabs;                /* Linked through each slab's first word */
+    uint8_t* cursor;            /* Uncarved part of the newest slab */
+    size_t remaining;
+    size_t live_blocks;
+    bool mapped;                /* Some memory has been mapped */
+    bool bound;                 /* Every mapping so far was bound with mbind */
+    bool closed;                /* The topology is gone; the last free releases the arena */
+};
+
+static int numa_arena_class(size_t size) {
+    size_t block = NUMA_ARENA_MIN;
+    for (int c = 0; c < NUMA_ARENA_CLASSES; c++, block <<= 1) {
+        if (size <= block) return c;
+    }
+    return -1;
+}
+
+static size_t numa_page_round(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+/* Map fresh pages preferring `node`; records in the arena whether the binding took */
+static void* numa_arena_map(struct neat_numa_arena* arena, size_t size) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+    bool bound = false;
+#ifdef SYS_mbind
+    if (arena->node >= 0 && arena->node < NEAT_NUMA_MAX_NODES) {
+        unsigned long mask[(NEAT_NUMA_MAX_NODES + 63) / 64] = {0};
+        mask[arena->node / 64] |= 1UL << (arena->node % 64);
+        /* MPOL_PREFERRED: fall back to other nodes rather than fail when this one is full */
+        bound = syscall(SYS_mbind, memory, size, 1, mask, (unsigned long)NEAT_NUMA_MAX_NODES + 1, 0) == 0;
+    }
+#endif
+    arena->bound = (arena->bound || !arena->mapped) && bound;
+    arena->mapped = true;
+    return memory;
+}
+
+static void numa_arena_destroy(struct neat_numa_arena* arena) {
+    while (arena->slabs) {
+        void* next = *(void**)arena->slabs;
+        munmap(arena->slabs, NUMA_ARENA_SLAB);
+        arena->slabs = next;
+    }
+    pthread_mutex_destroy(&arena->lock);
+    neat_free(arena);
+}
+
+static void* numa_arena_alloc(void* ctx, size_t size) {
+    struct neat_numa_arena* arena = (struct neat_numa_arena*)ctx;
+    int c = numa_arena_class(size);
+    void* block = NULL;
+
+    pthread_mutex_lock(&arena->lock);
+    if (c < 0) {
+        block = numa_arena_map(arena, numa_page_round(size));
+    } else if (arena->free_lists[c]) {
+        block = arena->free_lists[c];
+        arena->free_lists[c] = arena->free_lists[c]->next;
+    } else {
+        size_t block_size = NUMA_ARENA_MIN << c;
+        if (arena->remaining < block_size) {
+            uint8_t* slab = (uint8_t*)numa_arena_map(arena, NUMA_ARENA_SLAB);
+            if (slab) {
+                *(void**)slab = arena->slabs;
+                arena->slabs = slab;
+                arena->cursor = slab + NUMA_ARENA_MIN;
+                arena->remaining = NUMA_ARENA_SLAB - NUMA_ARENA_MIN;
+            }
+        }
+        if (arena->remaining >= block_size) {
+            block = arena->cursor;
+            arena->cursor += block_size;
+            arena->remaining -= block_size;
+        }
+    }
+    if (block) arena->live_blocks++;
+    pthread_mutex_unlock(&arena->lock);
+    return block;
+}
+
+static void numa_arena_free(void* ctx, void* ptr, size_t size) {
+    struct neat_numa_arena* arena = (struct neat_numa_arena*)ctx;
+    int c = numa_arena_class(size);
+    if (c < 0) munmap(ptr, numa_page_round(size));
+
+    pthread_mutex_lock(&arena->lock);
+    if (c >= 0) {
+        numa_free_block_t* block = (numa_free_block_t*)ptr;
+        block->next = arena->free_lists[c];
+        arena->free_lists[c] = block;
+    }
+    bool release = --arena->live_blocks == 0 && arena->closed;
+    pthread_mutex_unlock(&arena->lock);
+    if (release) numa_arena_destroy(arena);
+}
+
+static struct neat_numa_arena* numa_arena_create(int node) {
+    struct neat_numa_arena* arena = (struct neat_numa_arena*)neat_calloc(1, sizeof(struct neat_numa_arena));
+    neat_allocator_init(&arena->allocator, numa_arena_alloc, NULL, numa_arena_free, arena);
+    arena->node = node;
+    pthread_mutex_init(&arena->lock, NULL);
+    return arena;
+}
+
+/* Detach an arena from its topology; it is released now or with its last block */
+static void numa_arena_close(struct neat_numa_arena* arena) {
+    pthread_mutex_lock(&arena->lock);
+    arena->closed = true;
+    bool release = arena->live_blocks == 0;
+    pthread_mutex_unlock(&arena->lock);
+    if (release) numa_arena_destroy(arena);
+}
+
+/*
+ * Discover the NUMA topology from /sys/devices/system/node. Without it (other
+ * platforms, restricted containers) the result is one node with every online
+ * CPU, so sharded evaluation still works and degenerates to a single queue.
+ */
+neat_numa_t* neat_numa_create(void) {
+    neat_numa_t* numa = (neat_numa_t*)neat_calloc(1, sizeof(neat_numa_t));
+    numa->pin_workers = true;
+    numa->place_genes = true;
+
+    long online = sysconf(_SC_NPROCESSORS_CONF);
+    size_t max_cpus = online > 0 ? (size_t)online : 1;
+    numa->cpus = (int*)neat_malloc(max_cpus * sizeof(int));
+
+    size_t total = 0;
+    for (int node = 0; node < NEAT_NUMA_MAX_NODES && numa->node_count < NEAT_NUMA_MAX_NODES; node++) {
+        char path[64];
+        char line[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* fp = fopen(path, "r");
+        if (!fp) continue;
+        if (fgets(line, sizeof(line), fp)) {
+            size_t count = parse_cpulist(line, numa->cpus + total, max_cpus - total);
+            if (count > 0) {
+                numa->node_ids[numa->node_count] = node;
+                numa->cpu_offsets[numa->node_count] = total;
+                total += count;
+                numa->node_count++;
+            }
+        }
+        fclose(fp);
+    }
+
+    if (numa->node_count == 0) {
+        for (size_t cpu = 0; cpu < max_cpus; cpu++) numa->cpus[cpu] = (int)cpu;
+        total = max_cpus;
+        numa->node_count = 1;
+    }
+    numa->cpu_offsets[numa->node_count] = total;
+    return numa;
+}
+
+void neat_numa_free(neat_numa_t* numa) {
+    if (numa) {
+        for (int node = 0; node < NEAT_NUMA_MAX_NODES; node++) {
+            if (numa->arenas[node]) numa_arena_close(numa->arenas[node]);
+        }
+        neat_free(numa->cpus);
+        neat_free(numa);
+    }
+}
+
+/* Node that owns a CPU, or -1 */
+int neat_numa_node_of_cpu(const neat_numa_t* numa, int cpu) {
+    for (int node = 0; numa && node < numa->node_count; node++) {
+        for (size_t i = numa->cpu_offsets[node]; i < numa->cpu_offsets[node + 1]; i++) {
+            if (numa->cpus[i] == cpu) return node;
+        }
+    }
+    return -1;
+}
+
+static bool shard_take(shard_queue_t* queue, eval_shard_t* shard, size_t* index) {
+    size_t job = atomic_fetch_add_explicit(&shard->next_job, 1, memory_order_relaxed);
+    if (job >= shard->job_count) return false;
+    *index = shard->jobs[job].index;
+    if (queue->queue_depth) {
+        atomic_fetch_sub_explicit(queue->queue_depth, 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+/* Drain the local shard, then steal from the other nodes in ring order */
+static void* shard_worker(void* arg) {
+    shard_worker_t* worker = (shard_worker_t*)arg;
+    shard_queue_t* queue = worker->queue;
+    neat_allocator_t* outer_allocator = neat_use_allocator(queue->allocator);
+    neat_trace_thread_name("evaluate worker");
+
+    /* Local genomes move into the node's arena, and their evaluation order is built there */
+    struct neat_numa_arena* arena = queue->numa->place_genes ? queue->numa->arenas[worker->node] : NULL;
+    if (arena) neat_use_allocator(&arena->allocator);
+
+    size_t index;
+    size_t local = 0, relocated = 0, resident = 0;
+    while (shard_take(queue, &queue->shards[worker->node], &index)) {
+        neat_genome_t* genome = queue->genomes[index];
+        if (arena) {
+            if (neat_genome_relocate(genome)) {
+                relocated++;
+            } else {
+                resident++;
+            }
+        }
+        evaluate_one(genome, queue->evaluate_func, queue->user_data, queue->watchdog, worker->slot);
+        local++;
+    }
+    if (arena) neat_use_allocator(queue->allocator);
+
+    size_t stolen = 0;
+    for (int k = 1; k < queue->shard_count; k++) {
+        eval_shard_t* victim = &queue->shards[(worker->node + k) % queue->shard_count];
+        while (shard_take(queue, victim, &index)) {
+            evaluate_one(queue->genomes[index], queue->evaluate_func, queue->user_data,
+                         queue->watchdog, worker->slot);
+            stolen++;
+        }
+    }
+
+    atomic_fetch_add_explicit(&queue->local_jobs, local, memory_order_relaxed);
+    atomic_fetch_add_explicit(&queue->stolen_jobs, stolen, memory_order_relaxed);
+    atomic_fetch_add_explicit(&queue->relocated, relocated, memory_order_relaxed);
+    atomic_fetch_add_explicit(&queue->resident, resident, memory_order_relaxed);
+    neat_use_allocator(outer_allocator);
+    return NULL;
+}
+
+/* Sharded evaluation: contiguous genome ranges per node, workers spread and pinned across nodes */
+static void evaluate_sharded(neat_population_t* pop, const eval_job_t* jobs, size_t job_count,
+                             neat_evaluate_func_t evaluate_func, void* user_data, int num_threads,
+                             eval_watchdog_t* watchdog) {
+    neat_numa_t* numa = pop->numa;
+    int shard_count = numa->node_count > 0 ? numa->node_count : 1;
+    if (shard_count > NEAT_NUMA_MAX_NODES) shard_count = NEAT_NUMA_MAX_NODES;
+
+    /* Split the cost-ordered jobs by the shard of their genome index, keeping the order */
+    eval_shard_t* shards = (eval_shard_t*)neat_calloc((size_t)shard_count, sizeof(eval_shard_t));
+    eval_job_t* shard_jobs = (eval_job_t*)neat_malloc((job_count > 0 ? job_count : 1) * sizeof(eval_job_t));
+    size_t counts[NEAT_NUMA_MAX_NODES] = {0};
+    for (size_t j = 0; j < job_count; j++) {
+        counts[jobs[j].index * (size_t)shard_count / pop->genome_count]++;
+    }
+    size_t offset = 0;
+    for (int s = 0; s < shard_count; s++) {
+        shards[s].jobs = shard_jobs + offset;
+        atomic_init(&shards[s].next_job, 0);
+        offset += counts[s];
+    }
+    for (size_t j = 0; j < job_count; j++) {
+        eval_shard_t* shard = &shards[jobs[j].index * (size_t)shard_count / pop->genome_count];
+        shard->jobs[shard->job_count++] = jobs[j];
+    }
+
+    shard_queue_t queue;
+    queue.genomes = pop->genomes;
+    queue.shards = shards;
+    queue.shard_count = shard_count;
+    queue.numa = numa;
+    queue.allocator = pop->allocator;
+    queue.queue_depth = pop->metrics ? &pop->metrics->queue_depth : NULL;
+    if (queue.queue_depth) atomic_store(queue.queue_depth, job_count);
+    queue.watchdog = watchdog;
+    queue.user_data = user_data;
+    queue.evaluate_func = evaluate_func;
+    atomic_init(&queue.local_jobs, 0);
+    atomic_init(&queue.stolen_jobs, 0);
+    atomic_init(&queue.relocated, 0);
+    atomic_init(&queue.resident, 0);
+    for (int s = 0; numa->place_genes && s < shard_count; s++) {
+        if (!numa->arenas[s]) numa->arenas[s] = numa_arena_create(numa->node_ids[s]);
+    }
+
+    pthread_t* threads = (pthread_t*)neat_malloc(num_threads * sizeof(pthread_t));
+    shard_worker_t* workers = (shard_worker_t*)neat_malloc(num_threads * sizeof(shard_worker_t));
+    bool* started = (bool*)neat_calloc(num_threads, sizeof(bool));
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].queue = &queue;
+        workers[i].node = i % shard_count;
+        workers[i].slot = i;
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        size_t first = numa->cpu_offsets[workers[i].node];
+        size_t last = numa->cpu_offsets[workers[i].node + 1];
+        if (numa->pin_workers && numa->cpus && last > first) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (size_t c = first; c < last; c++) {
+                if (numa->cpus[c] >= 0 && numa->cpus[c] < CPU_SETSIZE) CPU_SET(numa->cpus[c], &set);
+            }
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        started[i] = pthread_create(&threads[i], &attr, shard_worker, &workers[i]) == 0;
+        if (!started[i]) {
+            /* Pinning can be refused (e.g. CPUs outside the cgroup); run unpinned instead */
+            started[i] = pthread_create(&threads[i], NULL, shard_worker, &workers[i]) == 0;
+        }
+        pthread_attr_destroy(&attr);
+    }
+    
+    /* A worker the system refused runs here, on its own node's shard and watchdog token */
+    for (int i = 0; i < num_threads; i++) {
+        if (!started[i]) shard_worker(&workers[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+
+    numa->local_jobs = atomic_load(&queue.local_jobs);
+    numa->stolen_jobs = atomic_load(&queue.stolen_jobs);
+    numa->relocated = atomic_load(&queue.relocated);
+    numa->resident = atomic_load(&queue.resident);
+    numa->bound_nodes = 0;
+    for (int s = 0; s < shard_count; s++) {
+        if (numa->arenas[s] && numa->arenas[s]->mapped && numa->arenas[s]->bound) numa->bound_nodes++;
+    }
+
+    neat_free(started);
+    neat_free(workers);
+    neat_free(threads);
+    neat_free(shard_jobs);
+    neat_free(shards);
+}
+
+/* Shared-queue evaluation */
+static void evaluate_queued(neat_population_t* pop, const eval_job_t* jobs, size_t job_count,
+                            neat_evaluate_func_t evaluate_func, void* user_data, int num_threads,
+                            eval_watchdog_t* watchdog) {
+    eval_queue_t queue;
+    queue.genomes = pop->genomes;
+    queue.jobs = jobs;
+    queue.job_count = job_count;
+    atomic_init(&queue.next_job, 0);
+    queue.queue_depth = pop->metrics ? &pop->metrics->queue_depth : NULL;
+    queue.watchdog = watchdog;
+    atomic_init(&queue.next_slot, 0);
+    queue.allocator = pop->allocator;
+    queue.user_data = user_data;
+    queue.evaluate_func = evaluate_func;
+    
+    /* Create threads */
+    pthread_t* threads = (pthread_t*)neat_malloc(num_threads * sizeof(pthread_t));
+    int started = 0;
+    while (started < num_threads &&
+           pthread_create(&threads[started], NULL, evaluate_worker, &queue) == 0) {
+        started++;
+    }
+    
+    /* If the system refused a thread, drain the rest of the queue here with its token */
+    if (started < num_threads) {
+        evaluate_worker(&queue);
+    }
+    
+    /* Wait for all threads to complete */
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    neat_free(threads);
+}
+
+/*
+ * Evaluate a population in parallel.
+ * Genomes are dispatched longest-predicted-first (LPT) from a shared queue,
+ * using the population's cost model, and the measured times refine the model.
+ * With pop->numa set, the queue is split into per-node shards, and with
+ * pop->eval_timeout set every evaluation runs under a deadline (see neat.h).
+ */
 void neat_evaluate_parallel(neat_population_t* pop, 
                            neat_evaluate_func_t evaluate_func, 
                            void* user_data, 
@@ -46,49 +785,46 @@ void neat_evaluate_parallel(neat_population_t* pop,
         num_threads = (int)pop->genome_count;
     }
     
+    /* Overdue evaluations are watched for while any worker runs */
+    eval_watchdog_t watchdog_state;
+    eval_watchdog_t* watchdog = NULL;
+    if (pop->eval_timeout.timeout > 0.0 && pop->genome_count > 0) {
+        watchdog = &watchdog_state;
+        watchdog_start(watchdog, &pop->eval_timeout, num_threads > 1 ? num_threads : 1);
+    }
+    
     /* If single-threaded or only one genome, just evaluate directly */
     if (num_threads <= 1 || pop->genome_count == 1) {
         for (size_t i = 0; i < pop->genome_count; i++) {
             if (pop->genomes[i]) {
-                pop->genomes[i]->fitness = evaluate_func(pop->genomes[i], user_data);
+                evaluate_one(pop->genomes[i], evaluate_func, user_data, watchdog, 0);
             }
         }
-        return;
-    }
-    
-    /* Initialize thread data */
-    pthread_t* threads = (pthread_t*)neat_malloc(num_threads * sizeof(pthread_t));
-    thread_data_t* thread_data = (thread_data_t*)neat_malloc(num_threads * sizeof(thread_data_t));
-    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-    
-    /* Calculate genomes per thread */
-    size_t genomes_per_thread = pop->genome_count / num_threads;
-    size_t remaining = pop->genome_count % num_threads;
-    size_t current_idx = 0;
-    
-    /* Create threads */
-    for (int i = 0; i < num_threads; i++) {
-        thread_data[i].genomes = pop->genomes;
-        thread_data[i].start_idx = current_idx;
-        thread_data[i].end_idx = current_idx + genomes_per_thread + (i < remaining ? 1 : 0);
-        thread_data[i].evaluate_func = evaluate_func;
-        thread_data[i].user_data = user_data;
-        thread_data[i].mutex = &mutex;
-        
-        pthread_create(&threads[i], NULL, evaluate_worker, &thread_data[i]);
+    } else {
+        /* Order the work by predicted cost, longest first */
+        eval_job_t* jobs = (eval_job_t*)neat_malloc(pop->genome_count * sizeof(eval_job_t));
+        size_t job_count = 0;
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            if (pop->genomes[i]) {
+                jobs[job_count].index = i;
+                jobs[job_count].cost = neat_cost_model_predict(&pop->cost_model, pop->genomes[i]);
+                job_count++;
+            }
+        }
+        qsort(jobs, job_count, sizeof(eval_job_t), compare_jobs_desc);
         
-        current_idx = thread_data[i].end_idx;
+        if (pop->numa) {
+            evaluate_sharded(pop, jobs, job_count, evaluate_func, user_data, num_threads, watchdog);
+        } else {
+            evaluate_queued(pop, jobs, job_count, evaluate_func, user_data, num_threads, watchdog);
+        }
+        neat_free(jobs);
     }
     
-    /* Wait for all threads to complete */
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
+    if (watchdog) {
+        watchdog_stop(watchdog, &pop->eval_timeout);
     }
-    
-    /* Clean up */
-    neat_free(threads);
-    neat_free(thread_data);
-    pthread_mutex_destroy(&mutex);
+    neat_cost_model_update(&pop->cost_model, pop->genomes, pop->genome_count);
 }
 
 /* Parallel population evolution */
@@ -97,142 +833,22 @@ void neat_evolve_parallel(neat_population_t* pop, int num_threads) {
         return;
     }
     
+    neat_allocator_t* outer_allocator = neat_use_allocator(pop->allocator);
+    
     /* Evaluate all genomes in parallel */
+    double eval_start = neat_stats_clock(pop);
+    NEAT_TRACE_BEGIN("evaluate_population", pop->generation);
     neat_evaluate_parallel(pop, pop->evaluate_genome, pop->evaluate_user_data, num_threads);
+    NEAT_TRACE_END();
+    pop->stats.evaluate_time = neat_stats_clock(pop) - eval_start;
     
-    /* The rest of the evolution process remains single-threaded for simplicity */
-    /* You could parallelize more of this if needed */
-    
-    /* Update species fitness */
-    for (size_t i = 0; i < pop->species_count; i++) {
-        neat_species_t* species = pop->species[i];
-        
-        /* Sort species members by fitness (descending) */
-        qsort(species->members, species->member_count, sizeof(neat_genome_t*), 
-              neat_compare_genomes);
-        
-        /* Update species stats */
-        if (species->member_count > 0) {
-            species->max_fitness = species->members[0]->fitness;
-            
-            /* If this is a new best for the species, reset the staleness counter */
-            if (species->max_fitness > species->max_fitness_ever) {
-                species->max_fitness_ever = species->max_fitness;
-                species->staleness = 0;
-            } else {
-                species->staleness++;
-            }
-        }
-    }
-    
-    /* Sort species by best fitness (descending) */
-    qsort(pop->species, pop->species_count, sizeof(neat_species_t*), 
-          neat_compare_species);
-    
-    /* Remove stale/weak species */
-    neat_remove_stale_species(pop);
-    
-    /* Calculate total average fitness for the entire population */
-    double total_avg_fitness = 0.0;
-    for (size_t i = 0; i < pop->species_count; i++) {
-        neat_species_t* species = pop->species[i];
-        
-        /* Calculate average fitness for this species */
-        double species_avg_fitness = 0.0;
-        for (size_t j = 0; j < species->member_count; j++) {
-            species_avg_fitness += species->members[j]->fitness;
-        }
-        species_avg_fitness /= species->member_count;
-        
-        total_avg_fitness += species_avg_fitness;
-    }
-    
-    /* Create the next generation */
-    neat_genome_t** next_gen = (neat_genome_t**)neat_calloc(pop->genome_count, sizeof(neat_genome_t*));
-    size_t next_gen_count = 0;
-    
-    /* Elitism: keep the best genome from each species */
-    for (size_t i = 0; i < pop->species_count && next_gen_count < pop->genome_count; i++) {
-        neat_species_t* species = pop->species[i];
-        
-        if (species->member_count > 0) {
-            next_gen[next_gen_count++] = neat_clone_genome(species->members[0]);
-        }
-    }
-    
-    /* Fill the rest of the next generation with offspring */
-    while (next_gen_count < pop->genome_count) {
-        /* Select a species using fitness-proportionate selection */
-        double r = neat_rand_double() * total_avg_fitness;
-        neat_species_t* selected_species = NULL;
-        double sum = 0.0;
-        
-        for (size_t i = 0; i < pop->species_count; i++) {
-            neat_species_t* species = pop->species[i];
-            
-            /* Calculate average fitness for this species */
-            double species_avg_fitness = 0.0;
-            for (size_t j = 0; j < species->member_count; j++) {
-                species_avg_fitness += species->members[j]->fitness;
-            }
-            species_avg_fitness /= species->member_count;
-            
-            sum += species_avg_fitness;
-            if (sum >= r) {
-                selected_species = species;
-                break;
-            }
-        }
-        
-        /* If no species was selected (shouldn't happen), use the first one */
-        if (!selected_species && pop->species_count > 0) {
-            selected_species = pop->species[0];
-        }
-        
-        /* Create an offspring */
-        if (selected_species && selected_species->member_count > 0) {
-            neat_genome_t* offspring = NULL;
-            
-            /* 75% chance of crossover, 25% chance of mutation */
-            if (selected_species->member_count >= 2 && neat_rand_double() < 0.75) {
-                /* Select two parents using tournament selection */
-                neat_genome_t* parent1 = neat_tournament_select(selected_species);
-                neat_genome_t* parent2 = neat_tournament_select(selected_species);
-                
-                /* Create offspring through crossover */
-                offspring = neat_crossover(parent1, parent2);
-                
-                /* Mutate the offspring */
-                neat_mutate(offspring, pop->innovation_table);
-            } else {
-                /* Select a single parent and mutate it */
-                neat_genome_t* parent = neat_tournament_select(selected_species);
-                offspring = neat_clone_genome(parent);
-                
-                /* Apply multiple mutations */
-                for (int i = 0; i < 3; i++) {
-                    neat_mutate(offspring, pop->innovation_table);
-                }
-            }
-            
-            /* Add the offspring to the next generation */
-            if (offspring && next_gen_count < pop->genome_count) {
-                next_gen[next_gen_count++] = offspring;
-            }
-        }
-    }
-    
-    /* Replace the old generation with the new one */
     for (size_t i = 0; i < pop->genome_count; i++) {
-        if (pop->genomes[i]) {
-            neat_free_genome(pop->genomes[i]);
+        if (pop->genomes[i]->fitness > pop->max_fitness_achieved) {
+            pop->max_fitness_achieved = pop->genomes[i]->fitness;
         }
     }
-    neat_free(pop->genomes);
-    
-    pop->genomes = next_gen;
-    pop->generation++;
     
-    /* Re-speciate the population */
-    neat_speciate(pop);
+    /* The rest of the evolution process remains single-threaded */
+    neat_evolve_epoch(pop);
+    neat_use_allocator(outer_allocator);
 }
@@ -0,0 +1,569 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/runlog.h"
+#include "../include/genome_io.h"
+
+#define RUNLOG_ENDIAN_TAG   0x01020304u
+#define RUNLOG_CHUNK_HEADER 24          /* magic, kind, count, payload size, generation */
+#define RUNLOG_BLOCK_MIN    (64 * 1024)
+#define RUNLOG_STREAM_BUFFER (1 << 20)
+
+/* File header */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t reserved;
+} runlog_file_header_t;
+
+/* One column: a field of a record struct */
+typedef struct {
+    const char *name;
+    size_t offset;
+    size_t size;
+    char format;                /* 'i' int32, 'u' uint32, 'd' double */
+} runlog_column_t;
+
+#define RUNLOG_COLUMN(type, field, format) \
+    { #field, offsetof(type, field), sizeof(((type*)0)->field), format }
+
+static const runlog_column_t generation_columns[] = {
+    RUNLOG_COLUMN(neat_runlog_generation_t, generation, 'i'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, genome_count, 'u'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, species_count, 'u'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, innovation_count, 'u'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, best_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, mean_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, min_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, stddev_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, max_fitness_achieved, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, mean_nodes, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, mean_connections, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, max_nodes, 'u'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, max_connections, 'u'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, eval_time, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, eval_cpu_time, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, speciate_time, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, reproduce_time, 'd'),
+    RUNLOG_COLUMN(neat_runlog_generation_t, log_time, 'd'),
+};
+
+static const runlog_column_t species_columns[] = {
+    RUNLOG_COLUMN(neat_runlog_species_t, id, 'i'),
+    RUNLOG_COLUMN(neat_runlog_species_t, size, 'u'),
+    RUNLOG_COLUMN(neat_runlog_species_t, best_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_species_t, average_fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_species_t, staleness, 'i'),
+};
+
+static const runlog_column_t genome_columns[] = {
+    RUNLOG_COLUMN(neat_runlog_genome_t, id, 'i'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, parent1_id, 'i'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, parent2_id, 'i'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, species_id, 'i'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, fitness, 'd'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, node_count, 'u'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, connection_count, 'u'),
+    RUNLOG_COLUMN(neat_runlog_genome_t, eval_time, 'd'),
+};
+
+#define COLUMN_COUNT(columns) (sizeof(columns) / sizeof((columns)[0]))
+
+/* Record layout of a chunk kind */
+typedef struct {
+    const runlog_column_t *columns;
+    size_t column_count;
+    size_t record_size;         /* Size of the struct */
+    size_t packed_size;         /* Bytes per record on disk */
+} runlog_layout_t;
+
+static runlog_layout_t runlog_layout(uint32_t kind) {
+    runlog_layout_t layout = { NULL, 0, 0, 0 };
+    switch (kind) {
+        case NEAT_RUNLOG_GENERATION:
+            layout.columns = generation_columns;
+            layout.column_count = COLUMN_COUNT(generation_columns);
+            layout.record_size = sizeof(neat_runlog_generation_t);
+            break;
+        case NEAT_RUNLOG_SPECIES:
+            layout.columns = species_columns;
+            layout.column_count = COLUMN_COUNT(species_columns);
+            layout.record_size = sizeof(neat_runlog_species_t);
+            break;
+        case NEAT_RUNLOG_GENOMES:
+            layout.columns = genome_columns;
+            layout.column_count = COLUMN_COUNT(genome_columns);
+            layout.record_size = sizeof(neat_runlog_genome_t);
+            break;
+        default:
+            return layout;
+    }
+    for (size_t c = 0; c < layout.column_count; c++) {
+        layout.packed_size += layout.columns[c].size;
+    }
+    return layout;
+}
+
+static uint8_t* runlog_put_u32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+/* Transpose `count` records into a chunk at `dst`; the checksum is left to the writer thread */
+static size_t runlog_encode_chunk(uint8_t *dst, uint32_t kind, int64_t generation,
+                                  const void *records, size_t count) {
+    runlog_layout_t layout = runlog_layout(kind);
+    size_t payload = layout.packed_size * count;
+
+    uint8_t *p = dst;
+    p = runlog_put_u32(p, NEAT_RUNLOG_CHUNK_MAGIC);
+    p = runlog_put_u32(p, kind);
+    p = runlog_put_u32(p, (uint32_t)count);
+    p = runlog_put_u32(p, (uint32_t)payload);
+    memcpy(p, &generation, sizeof(generation));
+    p += sizeof(generation);
+
+    const uint8_t *rows = (const uint8_t*)records;
+    for (size_t c = 0; c < layout.column_count; c++) {
+        const runlog_column_t *column = &layout.columns[c];
+        const uint8_t *src = rows + column->offset;
+        /* Fixed-size copies so the compiler turns them into plain loads and stores */
+        if (column->size == 8) {
+            for (size_t r = 0; r < count; r++, p += 8) memcpy(p, src + r * layout.record_size, 8);
+        } else {
+            for (size_t r = 0; r < count; r++, p += 4) memcpy(p, src + r * layout.record_size, 4);
+        }
+    }
+
+    p = runlog_put_u32(p, 0);
+    return (size_t)(p - dst);
+}
+
+/* Fill in the checksum of every chunk of a block */
+static void runlog_seal_block(neat_runlog_block_t *block) {
+    size_t offset = 0;
+    while (offset + RUNLOG_CHUNK_HEADER <= block->size) {
+        uint32_t payload;
+        memcpy(&payload, block->data + offset + 12, sizeof(payload));
+        size_t body = RUNLOG_CHUNK_HEADER + (size_t)payload;
+        uint32_t crc = neat_crc32c(0, block->data + offset, body);
+        memcpy(block->data + offset + body, &crc, sizeof(crc));
+        offset += body + sizeof(uint32_t);
+    }
+}
+
+static size_t runlog_chunk_size(uint32_t kind, size_t count) {
+    return RUNLOG_CHUNK_HEADER + runlog_layout(kind).packed_size * count + sizeof(uint32_t);
+}
+
+/* Append a chunk to the current block, growing it if needed */
+static void runlog_append(neat_runlog_t *log, uint32_t kind, int64_t generation,
+                          const void *records, size_t count) {
+    neat_runlog_block_t *block = log->current;
+    size_t size = runlog_chunk_size(kind, count);
+    if (block->size + size > block->capacity) {
+        block->capacity = (block->size + size) * 2;
+        block->data = (uint8_t*)neat_realloc(block->data, block->capacity);
+    }
+    block->size += runlog_encode_chunk(block->data + block->size, kind, generation, records, count);
+}
+
+static void* runlog_scratch(neat_runlog_t *log, size_t size) {
+    if (size > log->scratch_capacity) {
+        neat_free(log->scratch);
+        log->scratch_capacity = size * 2;
+        log->scratch = neat_malloc(log->scratch_capacity);
+    }
+    return log->scratch;
+}
+
+/*
+ * Read and verify the next chunk from `fp` into `*chunk` (grown as needed).
+ * Returns the chunk size, or 0 at the end of the file or at the first
+ * incomplete or corrupted chunk.
+ */
+static size_t runlog_read_chunk(FILE *fp, uint8_t **chunk, size_t *capacity) {
+    uint8_t head[RUNLOG_CHUNK_HEADER];
+    if (fread(head, sizeof(head), 1, fp) != 1) return 0;
+
+    uint32_t magic, kind, count, payload;
+    memcpy(&magic, head, 4);
+    memcpy(&kind, head + 4, 4);
+    memcpy(&count, head + 8, 4);
+    memcpy(&payload, head + 12, 4);
+    runlog_layout_t layout = runlog_layout(kind);
+    if (magic != NEAT_RUNLOG_CHUNK_MAGIC || !layout.columns ||
+        (uint64_t)layout.packed_size * count != payload) {
+        return 0;
+    }
+
+    size_t size = RUNLOG_CHUNK_HEADER + (size_t)payload + sizeof(uint32_t);
+    if (size > *capacity) {
+        *capacity = size;
+        *chunk = (uint8_t*)neat_realloc(*chunk, *capacity);
+    }
+    memcpy(*chunk, head, sizeof(head));
+    if (fread(*chunk + RUNLOG_CHUNK_HEADER, 1, size - RUNLOG_CHUNK_HEADER, fp) != size - RUNLOG_CHUNK_HEADER) {
+        return 0;
+    }
+    uint32_t crc;
+    memcpy(&crc, *chunk + size - sizeof(uint32_t), sizeof(crc));
+    if (neat_crc32c(0, *chunk, size - sizeof(uint32_t)) != crc) return 0;
+    return size;
+}
+
+/*
+ * Offset just past the last complete generation (its species chunk closes
+ * it) in a run log positioned after its file header
+ */
+static long runlog_valid_end(FILE *fp) {
+    long end = ftell(fp);
+    long offset = end;
+    uint8_t *chunk = NULL;
+    size_t capacity = 0;
+    size_t size;
+    while ((size = runlog_read_chunk(fp, &chunk, &capacity)) > 0) {
+        offset += (long)size;
+        uint32_t kind;
+        memcpy(&kind, chunk + 4, sizeof(kind));
+        if (kind == NEAT_RUNLOG_SPECIES) end = offset;
+    }
+    neat_free(chunk);
+    return end;
+}
+
+static void* runlog_thread(void *arg) {
+    neat_runlog_t *log = (neat_runlog_t*)arg;
+
+    pthread_mutex_lock(&log->lock);
+    for (;;) {
+        while (!log->queue && !log->stop) {
+            pthread_cond_wait(&log->cond, &log->lock);
+        }
+        /* Queued blocks are still written on shutdown */
+        if (!log->queue) break;
+
+        neat_runlog_block_t *block = log->queue;
+        log->queue = block->next;
+        if (!log->queue) log->queue_tail = NULL;
+        log->writing = true;
+        pthread_mutex_unlock(&log->lock);
+
+        /* Buffered write; the stream is flushed whenever the queue runs dry */
+        runlog_seal_block(block);
+        bool ok = fwrite(block->data, 1, block->size, log->fp) == block->size;
+
+        pthread_mutex_lock(&log->lock);
+        bool idle = log->queue == NULL;
+        pthread_mutex_unlock(&log->lock);
+        if (idle && fflush(log->fp) != 0) ok = false;
+
+        pthread_mutex_lock(&log->lock);
+        if (ok) {
+            log->bytes_written += block->size;
+        } else {
+            log->failed_writes++;
+        }
+        block->size = 0;
+        block->next = log->free_blocks;
+        log->free_blocks = block;
+        log->writing = false;
+        pthread_cond_broadcast(&log->cond);
+    }
+    pthread_mutex_unlock(&log->lock);
+    return NULL;
+}
+
+/*
+ * Open a run log for appending; a new file gets a file header. An existing
+ * log is cut back to its last complete generation first, so the tail torn
+ * by a crash does not hide everything appended after it. Returns NULL if
+ * the file cannot be opened or already holds something that is not a
+ * compatible run log.
+ */
+neat_runlog_t* neat_runlog_open(const char *path) {
+    if (!path) return NULL;
+
+    FILE *fp = fopen(path, "a+b");
+    if (!fp) return NULL;
+
+    runlog_file_header_t header;
+    bool ok = fseek(fp, 0, SEEK_END) == 0;
+    long size = ok ? ftell(fp) : -1;
+    if (size == 0) {
+        header.magic = NEAT_RUNLOG_MAGIC;
+        header.version = NEAT_RUNLOG_VERSION;
+        header.endian_tag = RUNLOG_ENDIAN_TAG;
+        header.reserved = 0;
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fflush(fp) == 0;
+    } else {
+        ok = size >= (long)sizeof(header) && fseek(fp, 0, SEEK_SET) == 0 &&
+             fread(&header, sizeof(header), 1, fp) == 1 &&
+             header.magic == NEAT_RUNLOG_MAGIC && header.version == NEAT_RUNLOG_VERSION &&
+             header.endian_tag == RUNLOG_ENDIAN_TAG;
+        if (ok) {
+            long end = runlog_valid_end(fp);
+            ok = end == size || (fflush(fp) == 0 && ftruncate(fileno(fp), (off_t)end) == 0);
+        }
+        ok = ok && fseek(fp, 0, SEEK_END) == 0;
+    }
+    if (!ok) {
+        fclose(fp);
+        return NULL;
+    }
+    setvbuf(fp, NULL, _IOFBF, RUNLOG_STREAM_BUFFER);
+
+    neat_runlog_t *log = (neat_runlog_t*)neat_calloc(1, sizeof(neat_runlog_t));
+    log->fp = fp;
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->cond, NULL);
+    if (pthread_create(&log->thread, NULL, runlog_thread, log) != 0) {
+        pthread_cond_destroy(&log->cond);
+        pthread_mutex_destroy(&log->lock);
+        fclose(fp);
+        neat_free(log);
+        return NULL;
+    }
+    return log;
+}
+
+static void runlog_block_free(neat_runlog_block_t *block) {
+    while (block) {
+        neat_runlog_block_t *next = block->next;
+        neat_free(block->data);
+        neat_free(block);
+        block = next;
+    }
+}
+
+/* Write everything queued, stop the writer thread and close the file */
+void neat_runlog_close(neat_runlog_t *log) {
+    if (!log) return;
+
+    pthread_mutex_lock(&log->lock);
+    log->stop = true;
+    pthread_cond_broadcast(&log->cond);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->thread, NULL);
+
+    fclose(log->fp);
+    runlog_block_free(log->current);
+    runlog_block_free(log->free_blocks);
+    neat_free(log->scratch);
+    pthread_cond_destroy(&log->cond);
+    pthread_mutex_destroy(&log->lock);
+    neat_free(log);
+}
+
+/* Block until every committed generation is in the file */
+void neat_runlog_flush(neat_runlog_t *log) {
+    if (!log) return;
+
+    pthread_mutex_lock(&log->lock);
+    while (log->queue || log->writing) {
+        pthread_cond_wait(&log->cond, &log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+}
+
+/*
+ * Record the evaluated, speciated generation: the summary, species and
+ * genome chunks go into the current block. The summary chunk is rewritten
+ * in place by neat_runlog_commit once reproduction has been timed.
+ */
+void neat_runlog_capture(neat_runlog_t *log, const neat_population_t *pop) {
+    if (!log || !pop) return;
+
+    double start = neat_get_time();
+    if (!log->current) {
+        pthread_mutex_lock(&log->lock);
+        log->current = log->free_blocks;
+        if (log->current) log->free_blocks = log->current->next;
+        pthread_mutex_unlock(&log->lock);
+        if (!log->current) {
+            log->current = (neat_runlog_block_t*)neat_calloc(1, sizeof(neat_runlog_block_t));
+            log->current->capacity = RUNLOG_BLOCK_MIN;
+            log->current->data = (uint8_t*)neat_malloc(log->current->capacity);
+        }
+        log->current->next = NULL;
+    }
+
+    /* Summary */
+    neat_runlog_generation_t *rec = &log->record;
+    memset(rec, 0, sizeof(*rec));
+    size_t n = pop->genome_count;
+    rec->generation = pop->generation;
+    rec->genome_count = (uint32_t)n;
+    rec->species_count = (uint32_t)pop->species_count;
+    rec->innovation_count = pop->innovation_table ? (uint32_t)pop->innovation_table->count : 0;
+    rec->max_fitness_achieved = pop->max_fitness_achieved;
+    rec->eval_time = pop->stats.evaluate_time;
+    rec->speciate_time = pop->stats.speciate_time + pop->stats.adjust_time;
+
+    neat_runlog_genome_t *genomes = (neat_runlog_genome_t*)runlog_scratch(log, (n > 0 ? n : 1) * sizeof(neat_runlog_genome_t));
+    double sum = 0.0, sum_sq = 0.0;
+    rec->best_fitness = n > 0 ? -INFINITY : 0.0;
+    rec->min_fitness = n > 0 ? INFINITY : 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const neat_genome_t *genome = pop->genomes[i];
+        neat_runlog_genome_t *row = &genomes[i];
+        row->id = genome->id;
+        row->parent1_id = genome->parent1_id;
+        row->parent2_id = genome->parent2_id;
+        row->species_id = genome->species_id;
+        row->fitness = genome->fitness;
+        row->node_count = (uint32_t)genome->node_count;
+        row->connection_count = (uint32_t)genome->connection_count;
+        row->eval_time = genome->eval_time;
+
+        sum += genome->fitness;
+        sum_sq += genome->fitness * genome->fitness;
+        if (genome->fitness > rec->best_fitness) rec->best_fitness = genome->fitness;
+        if (genome->fitness < rec->min_fitness) rec->min_fitness = genome->fitness;
+        rec->mean_nodes += (double)genome->node_count;
+        rec->mean_connections += (double)genome->connection_count;
+        if (row->node_count > rec->max_nodes) rec->max_nodes = row->node_count;
+        if (row->connection_count > rec->max_connections) rec->max_connections = row->connection_count;
+        rec->eval_cpu_time += genome->eval_time;
+    }
+    if (n > 0) {
+        rec->mean_fitness = sum / (double)n;
+        double variance = sum_sq / (double)n - rec->mean_fitness * rec->mean_fitness;
+        rec->stddev_fitness = variance > 0.0 ? sqrt(variance) : 0.0;
+        rec->mean_nodes /= (double)n;
+        rec->mean_connections /= (double)n;
+    }
+
+    /* Chunks: summary placeholder, genomes (from the scratch rows), species */
+    log->record_offset = log->current->size;
+    runlog_append(log, NEAT_RUNLOG_GENERATION, pop->generation, rec, 1);
+    runlog_append(log, NEAT_RUNLOG_GENOMES, pop->generation, genomes, n);
+
+    size_t species_count = pop->species_count;
+    neat_runlog_species_t *species = (neat_runlog_species_t*)runlog_scratch(log, (species_count > 0 ? species_count : 1) * sizeof(neat_runlog_species_t));
+    for (size_t s = 0; s < species_count; s++) {
+        const neat_species_t *sp = pop->species[s];
+        species[s].id = sp->id;
+        species[s].size = (uint32_t)sp->member_count;
+        species[s].best_fitness = sp->best_fitness;
+        species[s].average_fitness = sp->average_fitness;
+        species[s].staleness = sp->staleness;
+    }
+    runlog_append(log, NEAT_RUNLOG_SPECIES, pop->generation, species, species_count);
+
+    log->record.log_time = neat_get_time() - start;
+}
+
+/* Finish the captured generation with the reproduction time and queue it for writing */
+void neat_runlog_commit(neat_runlog_t *log, const neat_population_t *pop) {
+    if (!log || !pop || !log->current) return;
+
+    double start = neat_get_time();
+    neat_runlog_block_t *block = log->current;
+    log->current = NULL;
+    log->record.reproduce_time = pop->stats.remove_stale_time + pop->stats.remove_weak_time +
+                                 pop->stats.reproduce_time;
+    log->record.log_time += neat_get_time() - start;
+    runlog_encode_chunk(block->data + log->record_offset, NEAT_RUNLOG_GENERATION,
+                        log->record.generation, &log->record, 1);
+
+    pthread_mutex_lock(&log->lock);
+    if (log->queue_tail) {
+        log->queue_tail->next = block;
+    } else {
+        log->queue = block;
+    }
+    log->queue_tail = block;
+    pthread_cond_broadcast(&log->cond);
+    pthread_mutex_unlock(&log->lock);
+}
+
+/* CSV export */
+static void runlog_print_header(FILE *fp, const runlog_layout_t *layout) {
+    fprintf(fp, "generation");
+    for (size_t c = 0; c < layout->column_count; c++) {
+        /* The summary's own generation column is the leading one */
+        if (layout->columns == generation_columns && c == 0) continue;
+        fprintf(fp, ",%s", layout->columns[c].name);
+    }
+    fputc('\n', fp);
+}
+
+static void runlog_print_rows(FILE *fp, const runlog_layout_t *layout, int64_t generation,
+                              const uint8_t *payload, uint32_t count) {
+    for (uint32_t r = 0; r < count; r++) {
+        fprintf(fp, "%lld", (long long)generation);
+        const uint8_t *column = payload;
+        for (size_t c = 0; c < layout->column_count; c++) {
+            const runlog_column_t *col = &layout->columns[c];
+            const uint8_t *value = column + (size_t)r * col->size;
+            column += (size_t)count * col->size;
+            if (layout->columns == generation_columns && c == 0) continue;
+
+            if (col->format == 'd') {
+                double v;
+                memcpy(&v, value, sizeof(v));
+                fprintf(fp, ",%.17g", v);
+            } else if (col->format == 'u') {
+                uint32_t v;
+                memcpy(&v, value, sizeof(v));
+                fprintf(fp, ",%u", v);
+            } else {
+                int32_t v;
+                memcpy(&v, value, sizeof(v));
+                fprintf(fp, ",%d", v);
+            }
+        }
+        fputc('\n', fp);
+    }
+}
+
+/*
+ * Convert a run log to CSV, one stream per chunk kind (NULL streams are
+ * skipped). Reading stops at the first incomplete or corrupted chunk.
+ * Returns 1 if the file is a run log, 0 otherwise.
+ */
+int neat_runlog_export_csv(const char *path, FILE *generations, FILE *species, FILE *genomes) {
+    if (!path) return 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    runlog_file_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != NEAT_RUNLOG_MAGIC ||
+        header.version != NEAT_RUNLOG_VERSION || header.endian_tag != RUNLOG_ENDIAN_TAG) {
+        fclose(fp);
+        return 0;
+    }
+
+    FILE *outputs[4] = { NULL, generations, species, genomes };
+    for (uint32_t kind = NEAT_RUNLOG_GENERATION; kind <= NEAT_RUNLOG_GENOMES; kind++) {
+        if (outputs[kind]) {
+            runlog_layout_t layout = runlog_layout(kind);
+            runlog_print_header(outputs[kind], &layout);
+        }
+    }
+
+    uint8_t *chunk = NULL;
+    size_t chunk_capacity = 0;
+    while (runlog_read_chunk(fp, &chunk, &chunk_capacity) > 0) {
+        uint32_t kind, count;
+        int64_t generation;
+        memcpy(&kind, chunk + 4, 4);
+        memcpy(&count, chunk + 8, 4);
+        memcpy(&generation, chunk + 16, 8);
+        if (outputs[kind]) {
+            runlog_layout_t layout = runlog_layout(kind);
+            runlog_print_rows(outputs[kind], &layout, generation, chunk + RUNLOG_CHUNK_HEADER, count);
+        }
+    }
+
+    neat_free(chunk);
+    fclose(fp);
+    return 1;
+}
@@ -0,0 +1,268 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/surrogate.h"
+
+/* Candidate offspring with its predicted fitness */
+typedef struct {
+    size_t index;
+    double predicted;
+} surrogate_candidate_t;
+
+neat_surrogate_config_t neat_surrogate_default_config(void) {
+    neat_surrogate_config_t config;
+    config.k = 5;
+    config.capacity = 512;
+    config.min_samples = 64;
+    config.top_fraction = 0.5;
+    config.explore_fraction = 0.1;
+    config.parent_weight = 0.3;
+    config.size_coeff = 1.0;
+    return config;
+}
+
+neat_surrogate_t* neat_surrogate_create(const neat_surrogate_config_t* config) {
+    neat_surrogate_t* surrogate = (neat_surrogate_t*)neat_calloc(1, sizeof(neat_surrogate_t));
+    surrogate->config = config ? *config : neat_surrogate_default_config();
+    if (surrogate->config.capacity == 0) surrogate->config.capacity = 1;
+    if (surrogate->config.k == 0) surrogate->config.k = 1;
+
+    surrogate->samples = (neat_genome_t**)neat_calloc(surrogate->config.capacity, sizeof(neat_genome_t*));
+    surrogate->sample_fitness = (double*)neat_calloc(surrogate->config.capacity, sizeof(double));
+    return surrogate;
+}
+
+void neat_surrogate_free(neat_surrogate_t* surrogate) {
+    if (!surrogate) return;
+
+    for (size_t i = 0; i < surrogate->sample_count; i++) {
+        neat_free_genome(surrogate->samples[i]);
+    }
+    neat_free(surrogate->samples);
+    neat_free(surrogate->sample_fitness);
+    neat_free(surrogate);
+}
+
+static double surrogate_distance(const neat_surrogate_t* surrogate,
+                                 const neat_genome_t* a, const neat_genome_t* b) {
+    double size_a = (double)(a->node_count + a->connection_count);
+    double size_b = (double)(b->node_count + b->connection_count);
+    double size_term = (size_a + size_b) > 0.0 ? fabs(size_a - size_b) / (size_a + size_b) : 0.0;
+    return neat_compatibility_distance(a, b) + surrogate->config.size_coeff * size_term;
+}
+
+/* Inverse-distance weighted kNN estimate blended with the parent's fitness */
+double neat_surrogate_predict(const neat_surrogate_t* surrogate, const neat_genome_t* genome) {
+    if (!surrogate || !genome || surrogate->sample_count == 0) {
+        return genome ? genome->parent_fitness : 0.0;
+    }
+
+    size_t k = surrogate->config.k;
+    if (k > surrogate->sample_count) k = surrogate->sample_count;
+
+    /* Keep the k closest samples in a small sorted buffer */
+    double best_dist[32];
+    double best_fit[32];
+    if (k > 32) k = 32;
+    size_t found = 0;
+
+    for (size_t i = 0; i < surrogate->sample_count; i++) {
+        double d = surrogate_distance(surrogate, genome, surrogate->samples[i]);
+        if (found == k && d >= best_dist[k - 1]) continue;
+
+        size_t pos = (found < k) ? found++ : k - 1;
+        while (pos > 0 && best_dist[pos - 1] > d) {
+            best_dist[pos] = best_dist[pos - 1];
+            best_fit[pos] = best_fit[pos - 1];
+            pos--;
+        }
+        best_dist[pos] = d;
+        best_fit[pos] = surrogate->sample_fitness[i];
+    }
+
+    double weight_sum = 0.0;
+    double estimate = 0.0;
+    for (size_t i = 0; i < found; i++) {
+        double w = 1.0 / (best_dist[i] + 1e-6);
+        estimate += w * best_fit[i];
+        weight_sum += w;
+    }
+    estimate /= weight_sum;
+
+    double pw = surrogate->config.parent_weight;
+    return (1.0 - pw) * estimate + pw * genome->parent_fitness;
+}
+
+/* Add a real evaluation to the training set, replacing the oldest sample */
+void neat_surrogate_train(neat_surrogate_t* surrogate, const neat_genome_t* genome, double fitness) {
+    if (!surrogate || !genome) return;
+
+    size_t slot = surrogate->next_slot;
+    if (surrogate->sample_count < surrogate->config.capacity) {
+        surrogate->sample_count++;
+    } else {
+        neat_free_genome(surrogate->samples[slot]);
+    }
+
+    surrogate->samples[slot] = neat_clone_genome(genome);
+    surrogate->sample_fitness[slot] = fitness;
+    surrogate->next_slot = (slot + 1) % surrogate->config.capacity;
+}
+
+static int compare_candidates_desc(const void* a, const void* b) {
+    double pa = ((const surrogate_candidate_t*)a)->predicted;
+    double pb = ((const surrogate_candidate_t*)b)->predicted;
+    return (pa < pb) - (pa > pb);
+}
+
+static void surrogate_real_evaluate(neat_population_t* pop, neat_genome_t* genome) {
+    double start = neat_get_time();
+    genome->fitness = pop->evaluate_genome(genome, pop->evaluate_user_data);
+    genome->eval_time = neat_get_time() - start;
+    genome->evaluated = true;
+
+    if (genome->fitness > pop->max_fitness_achieved) {
+        pop->max_fitness_achieved = genome->fitness;
+    }
+}
+
+static void surrogate_accumulate(neat_surrogate_stats_t* total, const neat_surrogate_stats_t* gen) {
+    total->candidates += gen->candidates;
+    total->elites += gen->elites;
+    total->evaluated += gen->evaluated;
+    total->skipped += gen->skipped;
+    total->true_positives += gen->true_positives;
+    total->false_positives += gen->false_positives;
+    total->false_negatives += gen->false_negatives;
+    total->explored += gen->explored;
+
+    size_t promoted = total->true_positives + total->false_positives;
+    total->precision = promoted > 0 ? (double)total->true_positives / promoted : 0.0;
+    double rejected_scale = total->explored > 0 ?
+        (double)(total->skipped + total->explored) / total->explored : 0.0;
+    double fn = total->false_negatives * rejected_scale;
+    total->recall = (total->true_positives + fn) > 0.0 ?
+        total->true_positives / (total->true_positives + fn) : 0.0;
+}
+
+void neat_surrogate_evaluate(neat_population_t* pop, neat_surrogate_t* surrogate) {
+    if (!pop || !surrogate || !pop->evaluate_genome || pop->genome_count == 0) return;
+
+    neat_surrogate_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+
+    /* Warm-up: evaluate everything until the model has enough data */
+    if (surrogate->sample_count < surrogate->config.min_samples) {
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            neat_genome_t* genome = pop->genomes[i];
+            surrogate_real_evaluate(pop, genome);
+            neat_surrogate_train(surrogate, genome, genome->fitness);
+            if (genome->elite) stats.elites++; else stats.candidates++;
+        }
+        stats.evaluated = stats.candidates;
+        surrogate->last_stats = stats;
+        surrogate_accumulate(&surrogate->total_stats, &stats);
+        return;
+    }
+
+    /* Elites are evaluated for real; everything else is predicted and ranked */
+    double min_real = INFINITY;
+    surrogate_candidate_t* cands = (surrogate_candidate_t*)neat_malloc(pop->genome_count * sizeof(surrogate_candidate_t));
+    size_t n = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        neat_genome_t* genome = pop->genomes[i];
+        if (genome->elite) {
+            surrogate_real_evaluate(pop, genome);
+            if (genome->fitness < min_real) min_real = genome->fitness;
+            stats.elites++;
+            continue;
+        }
+        cands[n].index = i;
+        cands[n].predicted = neat_surrogate_predict(surrogate, genome);
+        n++;
+    }
+    stats.candidates = n;
+    if (n == 0) {
+        surrogate->last_stats = stats;
+        surrogate_accumulate(&surrogate->total_stats, &stats);
+        neat_free(cands);
+        return;
+    }
+    qsort(cands, n, sizeof(surrogate_candidate_t), compare_candidates_desc);
+
+    size_t top = (size_t)ceil(surrogate->config.top_fraction * n);
+    size_t explore = (size_t)ceil(surrogate->config.explore_fraction * n);
+    if (top < 1) top = 1;
+    if (top > n) top = n;
+    if (explore > n - top) explore = n - top;
+
+    /* Pick the exploration quota uniformly from the rejected tail */
+    for (size_t e = 0; e < explore; e++) {
+        size_t pick = top + e + (size_t)neat_random_int(0, (int)(n - top - e - 1));
+        surrogate_candidate_t tmp = cands[top + e];
+        cands[top + e] = cands[pick];
+        cands[pick] = tmp;
+    }
+
+    /* Real evaluations: promoted first, then explored */
+    double abs_error = 0.0;
+    for (size_t r = 0; r < top + explore; r++) {
+        neat_genome_t* genome = pop->genomes[cands[r].index];
+        surrogate_real_evaluate(pop, genome);
+
+        abs_error += fabs(cands[r].predicted - genome->fitness);
+        if (genome->fitness < min_real) min_real = genome->fitness;
+
+        bool good = genome->fitness >= genome->parent_fitness;
+        if (r < top) {
+            if (good) stats.true_positives++; else stats.false_positives++;
+        } else if (good) {
+            stats.false_negatives++;
+        }
+    }
+
+    /* Train on the real results only after all predictions were made */
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->elite) {
+            neat_surrogate_train(surrogate, pop->genomes[i], pop->genomes[i]->fitness);
+        }
+    }
+    for (size_t r = 0; r < top + explore; r++) {
+        neat_genome_t* genome = pop->genomes[cands[r].index];
+        neat_surrogate_train(surrogate, genome, genome->fitness);
+    }
+
+    /* Skipped offspring never outrank a real score of this generation */
+    for (size_t r = top + explore; r < n; r++) {
+        neat_genome_t* genome = pop->genomes[cands[r].index];
+        double estimate = cands[r].predicted;
+        genome->fitness = estimate < min_real ? estimate : min_real;
+        genome->eval_time = 0.0;
+        genome->evaluated = true;
+    }
+
+    stats.evaluated = top + explore;
+    stats.explored = explore;
+    stats.skipped = n - top - explore;
+    stats.mean_abs_error = abs_error / (double)(top + explore);
+    stats.precision = top > 0 ? (double)stats.true_positives / top : 0.0;
+    double fn = explore > 0 ? stats.false_negatives * (double)(n - top) / explore : 0.0;
+    stats.recall = (stats.true_positives + fn) > 0.0 ?
+        stats.true_positives / (stats.true_positives + fn) : 0.0;
+
+    surrogate->last_stats = stats;
+    surrogate_accumulate(&surrogate->total_stats, &stats);
+    neat_free(cands);
+}
+
+void neat_surrogate_print_stats(const neat_surrogate_t* surrogate, FILE* fp) {
+    if (!surrogate || !fp) return;
+
+    const neat_surrogate_stats_t* s = &surrogate->last_stats;
+    const neat_surrogate_stats_t* t = &surrogate->total_stats;
+    fprintf(fp, "Surrogate: evaluated %zu/%zu (skipped %zu) plus %zu elites, precision %.3f, recall %.3f, MAE %.4f\n",
+            s->evaluated, s->candidates, s->skipped, s->elites, s->precision, s->recall, s->mean_abs_error);
+    fprintf(fp, "  Run total: evaluated %zu/%zu, precision %.3f, recall %.3f\n",
+            t->evaluated, t->candidates, t->precision, t->recall);
+}
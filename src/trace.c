@@ -0,0 +1,320 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/trace.h"
+#include "../include/neat.h"
+
+/* Completed span */
+typedef struct {
+    const char *name;
+    int64_t arg;
+    uint64_t start;             /* Monotonic nanoseconds */
+    uint64_t duration;
+} trace_event_t;
+
+/*
+ * Single-producer ring of events. The owning thread advances head, the
+ * flush advances tail. Buffers are never freed: a thread that exits hands
+ * its buffer back and the next new thread claims it, so the per-generation
+ * worker threads of neat_evaluate_parallel reuse the same few buffers.
+ */
+typedef struct trace_buffer {
+    trace_event_t *events;
+    size_t capacity;            /* Power of two */
+    atomic_size_t head;
+    atomic_size_t tail;
+    atomic_size_t dropped;      /* Spans lost to a full buffer */
+    atomic_uint session;        /* Trace the buffer is recording for */
+    atomic_bool owned;          /* Claimed by a live thread */
+    _Atomic(const char*) name;  /* Thread name shown in the viewer (NULL = default) */
+    unsigned named_session;     /* Last trace given this thread's name (flush) */
+    const char *named;          /* Name written in that trace (flush) */
+    int tid;
+    struct trace_buffer *next;
+} trace_buffer_t;
+
+/* Open span on the calling thread's stack */
+typedef struct {
+    const char *name;
+    int64_t arg;
+    uint64_t start;
+    unsigned session;
+} trace_frame_t;
+
+static atomic_uint g_session;   /* Running trace (0 = none) */
+static _Atomic(trace_buffer_t*) g_buffers;
+static atomic_int g_next_tid;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER; /* Guards the output state below */
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key;
+static unsigned g_last_session;
+static size_t g_capacity;
+static uint64_t g_origin;
+static FILE *g_fp;
+static int g_pid;
+static size_t g_last_dropped;   /* Spans dropped by the last finished trace */
+
+static _Thread_local trace_buffer_t *tl_buffer;
+static _Thread_local unsigned tl_session;
+static _Thread_local trace_frame_t tl_stack[NEAT_TRACE_MAX_DEPTH];
+static _Thread_local int tl_depth;
+
+static uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void trace_release_buffer(void *arg) {
+    atomic_store_explicit(&((trace_buffer_t*)arg)->owned, false, memory_order_release);
+}
+
+static void trace_create_key(void) {
+    pthread_key_create(&g_key, trace_release_buffer);
+}
+
+/* Claim a released buffer or allocate a new one */
+static trace_buffer_t* trace_claim_buffer(void) {
+    for (trace_buffer_t *buf = atomic_load_explicit(&g_buffers, memory_order_acquire); buf; buf = buf->next) {
+        bool expected = false;
+        if (!atomic_load_explicit(&buf->owned, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&buf->owned, &expected, true,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            atomic_store_explicit(&buf->name, NULL, memory_order_relaxed);
+            return buf;
+        }
+    }
+
+    trace_buffer_t *buf = (trace_buffer_t*)neat_calloc(1, sizeof(trace_buffer_t));
+    atomic_init(&buf->owned, true);
+    buf->tid = atomic_fetch_add_explicit(&g_next_tid, 1, memory_order_relaxed) + 1;
+    buf->next = atomic_load_explicit(&g_buffers, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&g_buffers, &buf->next, buf,
+                                                  memory_order_release, memory_order_relaxed)) {
+    }
+    return buf;
+}
+
+/* Calling thread's buffer, ready for the given trace */
+static trace_buffer_t* trace_thread_buffer(unsigned session) {
+    if (tl_session == session) return tl_buffer;
+
+    /* Buffers outlive any population, so they never come from a population's allocator */
+    neat_allocator_t *outer_allocator = neat_use_allocator(NULL);
+    if (!tl_buffer) {
+        pthread_once(&g_key_once, trace_create_key);
+        tl_buffer = trace_claim_buffer();
+        pthread_setspecific(g_key, tl_buffer);
+    }
+
+    /* A buffer left over from an earlier trace starts empty; the flush ignores it until then */
+    trace_buffer_t *buf = tl_buffer;
+    if (atomic_load_explicit(&buf->session, memory_order_relaxed) != session) {
+        if (buf->capacity != g_capacity) {
+            neat_free(buf->events);
+            buf->events = (trace_event_t*)neat_malloc(g_capacity * sizeof(trace_event_t));
+            buf->capacity = g_capacity;
+        }
+        atomic_store_explicit(&buf->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&buf->tail, 0, memory_order_relaxed);
+        atomic_store_explicit(&buf->dropped, 0, memory_order_relaxed);
+        atomic_store_explicit(&buf->session, session, memory_order_release);
+    }
+    neat_use_allocator(outer_allocator);
+    tl_session = session;
+    return buf;
+}
+
+/* Lifecycle */
+int neat_trace_start(const char *path, size_t buffer_events) {
+    if (!path) return 0;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_fp) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+
+    size_t capacity = 1;
+    if (buffer_events == 0) buffer_events = NEAT_TRACE_BUFFER_EVENTS;
+    while (capacity < buffer_events) capacity <<= 1;
+
+    g_fp = fp;
+    g_pid = (int)getpid();
+    g_capacity = capacity;
+    g_origin = trace_now();
+    if (++g_last_session == 0) g_last_session = 1;
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"neat\"}}",
+            g_pid);
+    atomic_store_explicit(&g_session, g_last_session, memory_order_release);
+    pthread_mutex_unlock(&g_lock);
+    return 1;
+}
+
+bool neat_trace_enabled(void) {
+    return atomic_load_explicit(&g_session, memory_order_relaxed) != 0;
+}
+
+/* Recording */
+void neat_trace_begin(const char *name, int64_t arg) {
+    unsigned session = atomic_load_explicit(&g_session, memory_order_relaxed);
+    if (!session) return;
+
+    if (tl_depth < NEAT_TRACE_MAX_DEPTH) {
+        trace_frame_t *frame = &tl_stack[tl_depth];
+        frame->name = name;
+        frame->arg = arg;
+        frame->session = session;
+        frame->start = trace_now();
+    }
+    tl_depth++;
+}
+
+void neat_trace_end(void) {
+    if (tl_depth == 0) return;  /* Span began while no trace was running */
+    tl_depth--;
+    if (tl_depth >= NEAT_TRACE_MAX_DEPTH) return;
+
+    const trace_frame_t *frame = &tl_stack[tl_depth];
+    unsigned session = atomic_load_explicit(&g_session, memory_order_acquire);
+    if (session != frame->session) return;
+
+    uint64_t end = trace_now();
+    trace_buffer_t *buf = trace_thread_buffer(session);
+    size_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    if (head - tail >= buf->capacity) {
+        atomic_fetch_add_explicit(&buf->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    trace_event_t *event = &buf->events[head & (buf->capacity - 1)];
+    event->name = frame->name;
+    event->arg = frame->arg;
+    event->start = frame->start;
+    event->duration = end - frame->start;
+    atomic_store_explicit(&buf->head, head + 1, memory_order_release);
+}
+
+void neat_trace_thread_name(const char *name) {
+    unsigned session = atomic_load_explicit(&g_session, memory_order_acquire);
+    if (!session) return;
+    trace_buffer_t *buf = trace_thread_buffer(session);
+    atomic_store_explicit(&buf->name, name, memory_order_relaxed);
+}
+
+/* Output */
+static void trace_write_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', fp);
+            fputc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+/* Write every buffered event of the given trace (caller holds g_lock) */
+static void trace_flush_locked(unsigned session) {
+    FILE *fp = g_fp;
+    for (trace_buffer_t *buf = atomic_load_explicit(&g_buffers, memory_order_acquire); buf; buf = buf->next) {
+        if (atomic_load_explicit(&buf->session, memory_order_acquire) != session) continue;
+
+        const char *name = atomic_load_explicit(&buf->name, memory_order_relaxed);
+        if (buf->named_session != session || buf->named != name) {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                    g_pid, buf->tid);
+            if (name) {
+                trace_write_string(fp, name);
+            } else {
+                fprintf(fp, "\"thread %d\"", buf->tid);
+            }
+            fputs("}}", fp);
+            buf->named_session = session;
+            buf->named = name;
+        }
+
+        size_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            const trace_event_t *event = &buf->events[tail & (buf->capacity - 1)];
+            fputs(",\n{\"name\":", fp);
+            trace_write_string(fp, event->name);
+            fprintf(fp, ",\"cat\":\"neat\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    g_pid, buf->tid, (double)(int64_t)(event->start - g_origin) / 1000.0,
+                    (double)event->duration / 1000.0);
+            if (event->arg != NEAT_TRACE_NO_ARG) {
+                fprintf(fp, ",\"args\":{\"arg\":%lld}", (long long)event->arg);
+            }
+            fputc('}', fp);
+        }
+        atomic_store_explicit(&buf->tail, tail, memory_order_release);
+    }
+    fflush(fp);
+}
+
+void neat_trace_flush(void) {
+    if (!atomic_load_explicit(&g_session, memory_order_relaxed)) return;
+
+    pthread_mutex_lock(&g_lock);
+    unsigned session = atomic_load_explicit(&g_session, memory_order_acquire);
+    if (session && g_fp) {
+        trace_flush_locked(session);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void neat_trace_stop(void) {
+    pthread_mutex_lock(&g_lock);
+    unsigned session = atomic_load_explicit(&g_session, memory_order_acquire);
+    if (!session || !g_fp) {
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+
+    atomic_store_explicit(&g_session, 0, memory_order_release);
+    trace_flush_locked(session);
+    g_last_dropped = 0;
+    for (trace_buffer_t *buf = atomic_load_explicit(&g_buffers, memory_order_acquire); buf; buf = buf->next) {
+        if (atomic_load_explicit(&buf->session, memory_order_acquire) == session) {
+            g_last_dropped += atomic_load_explicit(&buf->dropped, memory_order_relaxed);
+        }
+    }
+    fputs("\n]}\n", g_fp);
+    fclose(g_fp);
+    g_fp = NULL;
+    pthread_mutex_unlock(&g_lock);
+}
+
+/* Spans dropped by the running trace, or by the last one once it has stopped */
+size_t neat_trace_dropped(void) {
+    pthread_mutex_lock(&g_lock);
+    unsigned session = atomic_load_explicit(&g_session, memory_order_acquire);
+    size_t dropped = session ? 0 : g_last_dropped;
+    if (session) {
+        for (trace_buffer_t *buf = atomic_load_explicit(&g_buffers, memory_order_acquire); buf; buf = buf->next) {
+            if (atomic_load_explicit(&buf->session, memory_order_acquire) == session) {
+                dropped += atomic_load_explicit(&buf->dropped, memory_order_relaxed);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return dropped;
+}
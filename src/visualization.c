@@ -7,6 +7,13 @@
 #include "../include/visualization.h"
 #include "../include/neat.h"
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void batch_free(neat_vis_batch_t* batch);
+static void atlases_free(neat_visualizer_t* vis);
+
 /* Default colors */
 static const neat_color_t COLOR_BLACK = {0, 0, 0, 255};
 static const neat_color_t COLOR_WHITE = {255, 255, 255, 255};
@@ -14,79 +21,118 @@ static const neat_color_t COLOR_RED = {255, 0, 0, 255};
 static const neat_color_t COLOR_GREEN = {0, 255, 0, 255};
 static const neat_color_t COLOR_BLUE = {0, 0, 255, 255};
 static const neat_color_t COLOR_YELLOW = {255, 255, 0, 255};
-static const neat_color_t COLOR_CYAN = {0, 255, 255, 255};
-static const neat_color_t COLOR_MAGENTA = {255, 0, 255, 255};
 static const neat_color_t COLOR_GRAY = {128, 128, 128, 255};
 static const neat_color_t COLOR_LIGHT_GRAY = {200, 200, 200, 255};
-static const neat_color_t COLOR_DARK_GRAY = {50, 50, 50, 255};
 
-/* Create a new visualizer */
+/* Create a visualizer with a window */
 neat_visualizer_t* neat_visualizer_create(const char* title, int width, int height) {
-    /* Initialize SDL */
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
-        return NULL;
-    }
-    
-    /* Initialize SDL_ttf */
-    if (TTF_Init() == -1) {
-        fprintf(stderr, "SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
-        SDL_Quit();
-        return NULL;
+    return neat_visualizer_create_with_backend(title, width, height, NEAT_VIS_WINDOW);
+}
+
+/* Open a window and its renderer; returns 0 if there is no usable display */
+static int visualizer_open_window(neat_visualizer_t* vis, const char* title) {
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0) {
+        return 0;
     }
     
     /* Create window */
-    SDL_Window* window = SDL_CreateWindow(
+    vis->window = SDL_CreateWindow(
         title,
         SDL_WINDOWPOS_UNDEFINED,
         SDL_WINDOWPOS_UNDEFINED,
-        width,
-        height,
+        vis->width,
+        vis->height,
         SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
     );
     
-    if (!window) {
-        fprintf(stderr, "Window could not be created! SDL_Error: %s\n", SDL_GetError());
-        TTF_Quit();
-        SDL_Quit();
-        return NULL;
+    if (!vis->window) {
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        return 0;
     }
     
     /* Create renderer */
-    SDL_Renderer* renderer = SDL_CreateRenderer(
-        window,
+    vis->renderer = SDL_CreateRenderer(
+        vis->window,
         -1,
         SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
     
-    if (!renderer) {
-        fprintf(stderr, "Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window);
-        TTF_Quit();
-        SDL_Quit();
-        return NULL;
+    if (!vis->renderer) {
+        SDL_DestroyWindow(vis->window);
+        vis->window = NULL;
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+        return 0;
     }
     
-    /* Set renderer draw blend mode */
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    vis->backend = NEAT_VIS_WINDOW;
+    return 1;
+}
+
+/* Render into an in-memory RGBA framebuffer with the software renderer; needs no video subsystem */
+static int visualizer_open_headless(neat_visualizer_t* vis) {
+    vis->framebuffer = SDL_CreateRGBSurfaceWithFormat(0, vis->width, vis->height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!vis->framebuffer) {
+        return 0;
+    }
     
-    /* Create visualizer */
-    neat_visualizer_t* vis = (neat_visualizer_t*)malloc(sizeof(neat_visualizer_t));
-    if (!vis) {
-        fprintf(stderr, "Failed to allocate memory for visualizer\n");
-        SDL_DestroyRenderer(renderer);
-        SDL_DestroyWindow(window);
-        TTF_Quit();
+    vis->renderer = SDL_CreateSoftwareRenderer(vis->framebuffer);
+    if (!vis->renderer) {
+        SDL_FreeSurface(vis->framebuffer);
+        vis->framebuffer = NULL;
+        return 0;
+    }
+    
+    vis->backend = NEAT_VIS_HEADLESS;
+    return 1;
+}
+
+/* Create a new visualizer on the given backend */
+neat_visualizer_t* neat_visualizer_create_with_backend(const char* title, int width, int height,
+                                                       neat_vis_backend_t backend) {
+    if (width <= 0 || height <= 0) return NULL;
+    
+    /* Initialize SDL; video is initialized with the window */
+    if (SDL_Init(0) < 0) {
+        fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+        return NULL;
+    }
+    
+    /* Initialize SDL_ttf */
+    if (TTF_Init() == -1) {
+        fprintf(stderr, "SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
         SDL_Quit();
         return NULL;
     }
     
-    vis->window = window;
-    vis->renderer = renderer;
+    /* Create visualizer */
+    neat_visualizer_t* vis = (neat_visualizer_t*)neat_calloc_tagged(NEAT_MEM_VISUALIZATION, 1, sizeof(neat_visualizer_t));
     vis->width = width;
     vis->height = height;
     vis->is_running = 1;
     
+    int opened = 0;
+    if (backend != NEAT_VIS_HEADLESS) {
+        opened = visualizer_open_window(vis, title);
+        if (!opened && backend == NEAT_VIS_WINDOW) {
+            fprintf(stderr, "Window could not be created! SDL_Error: %s\n", SDL_GetError());
+        }
+    }
+    if (!opened && backend != NEAT_VIS_WINDOW) {
+        opened = visualizer_open_headless(vis);
+        if (!opened) {
+            fprintf(stderr, "Framebuffer could not be created! SDL_Error: %s\n", SDL_GetError());
+        }
+    }
+    if (!opened) {
+        neat_free(vis);
+        TTF_Quit();
+        SDL_Quit();
+        return NULL;
+    }
+    
+    /* Set renderer draw blend mode */
+    SDL_SetRenderDrawBlendMode(vis->renderer, SDL_BLENDMODE_BLEND);
+    
     return vis;
 }
 
@@ -94,11 +140,14 @@ neat_visualizer_t* neat_visualizer_create(const char* title, int width, int heig
 void neat_visualizer_destroy(neat_visualizer_t* vis) {
     if (!vis) return;
     
+    batch_free(&vis->batch);
+    atlases_free(vis);
     SDL_DestroyRenderer(vis->renderer);
-    SDL_DestroyWindow(vis->window);
+    if (vis->window) SDL_DestroyWindow(vis->window);
+    if (vis->framebuffer) SDL_FreeSurface(vis->framebuffer);
     TTF_Quit();
     SDL_Quit();
-    free(vis);
+    neat_free(vis);
 }
 
 /* Check if visualizer is running */
@@ -108,7 +157,7 @@ int neat_visualizer_is_running(neat_visualizer_t* vis) {
 
 /* Handle SDL events */
 void neat_visualizer_handle_events(neat_visualizer_t* vis) {
-    if (!vis) return;
+    if (!vis || vis->backend == NEAT_VIS_HEADLESS) return;
     
     SDL_Event e;
     while (SDL_PollEvent(&e) != 0) {
@@ -127,10 +176,106 @@ void neat_visualizer_handle_events(neat_visualizer_t* vis) {
     }
 }
 
-/* Clear the screen */
+/* Geometry batch */
+
+#define VIS_BATCH_MAX_VERTICES 65536   /* Flush before the batch grows past this */
+
+/* Draw everything queued in the batch with one call and empty it */
+void neat_visualizer_flush(neat_visualizer_t* vis) {
+    if (!vis || vis->batch.index_count == 0) return;
+    
+    SDL_RenderGeometry(vis->renderer, vis->batch.texture,
+                       vis->batch.vertices, vis->batch.vertex_count,
+                       vis->batch.indices, vis->batch.index_count);
+    vis->batch.vertex_count = 0;
+    vis->batch.index_count = 0;
+}
+
+/* Make room for vertices and indices; returns the index of the first new vertex */
+static int batch_reserve(neat_visualizer_t* vis, int vertices, int indices) {
+    neat_vis_batch_t* batch = &vis->batch;
+    if (batch->vertex_count + vertices > VIS_BATCH_MAX_VERTICES) {
+        neat_visualizer_flush(vis);
+    }
+    
+    if (batch->vertex_count + vertices > batch->vertex_capacity) {
+        int capacity = batch->vertex_capacity ? batch->vertex_capacity * 2 : 1024;
+        while (capacity < batch->vertex_count + vertices) capacity *= 2;
+        batch->vertices = batch->vertices
+            ? (SDL_Vertex*)neat_realloc(batch->vertices, capacity * sizeof(SDL_Vertex))
+            : (SDL_Vertex*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, capacity * sizeof(SDL_Vertex));
+        batch->vertex_capacity = capacity;
+    }
+    if (batch->index_count + indices > batch->index_capacity) {
+        int capacity = batch->index_capacity ? batch->index_capacity * 2 : 2048;
+        while (capacity < batch->index_count + indices) capacity *= 2;
+        batch->indices = batch->indices
+            ? (int*)neat_realloc(batch->indices, capacity * sizeof(int))
+            : (int*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, capacity * sizeof(int));
+        batch->index_capacity = capacity;
+    }
+    
+    return batch->vertex_count;
+}
+
+static void batch_vertex_uv(neat_visualizer_t* vis, float x, float y, SDL_Color color, float u, float v) {
+    /* The software renderer truncates positions to whole pixels; round so shapes are not pulled up-left */
+    if (vis->framebuffer) {
+        x = floorf(x + 0.5f);
+        y = floorf(y + 0.5f);
+    }
+    SDL_Vertex* vertex = &vis->batch.vertices[vis->batch.vertex_count++];
+    vertex->position.x = x;
+    vertex->position.y = y;
+    vertex->color = color;
+    vertex->tex_coord.x = u;
+    vertex->tex_coord.y = v;
+}
+
+/* Untextured vertex: samples the white texel of whatever atlas is bound */
+static void batch_vertex(neat_visualizer_t* vis, float x, float y, SDL_Color color) {
+    batch_vertex_uv(vis, x, y, color, vis->batch.white.x, vis->batch.white.y);
+}
+
+/* Sample a different texture from here on; queued geometry is drawn first */
+static void batch_use_texture(neat_visualizer_t* vis, SDL_Texture* texture, SDL_FPoint white) {
+    if (vis->batch.texture == texture) return;
+    neat_visualizer_flush(vis);
+    vis->batch.texture = texture;
+    vis->batch.white = white;
+}
+
+static void batch_triangle(neat_visualizer_t* vis, int a, int b, int c) {
+    int* index = &vis->batch.indices[vis->batch.index_count];
+    index[0] = a;
+    index[1] = b;
+    index[2] = c;
+    vis->batch.index_count += 3;
+}
+
+/* Queue a quad given its corners in order around the edge */
+static void batch_quad(neat_visualizer_t* vis, const float* xs, const float* ys, neat_color_t color) {
+    SDL_Color sdl_color = {color.r, color.g, color.b, color.a};
+    int base = batch_reserve(vis, 4, 6);
+    for (int i = 0; i < 4; i++) {
+        batch_vertex(vis, xs[i], ys[i], sdl_color);
+    }
+    batch_triangle(vis, base, base + 1, base + 2);
+    batch_triangle(vis, base, base + 2, base + 3);
+}
+
+static void batch_free(neat_vis_batch_t* batch) {
+    neat_free(batch->vertices);
+    neat_free(batch->indices);
+    memset(batch, 0, sizeof(*batch));
+}
+
+/* Clear the screen; queued geometry would be covered, so it is dropped */
 void neat_visualizer_clear(neat_visualizer_t* vis, neat_color_t color) {
     if (!vis) return;
     
+    vis->batch.vertex_count = 0;
+    vis->batch.index_count = 0;
     SDL_SetRenderDrawColor(vis->renderer, color.r, color.g, color.b, color.a);
     SDL_RenderClear(vis->renderer);
 }
@@ -138,137 +283,252 @@ void neat_visualizer_clear(neat_visualizer_t* vis, neat_color_t color) {
 /* Present the rendered content */
 void neat_visualizer_present(neat_visualizer_t* vis) {
     if (vis) {
+        neat_visualizer_flush(vis);
         SDL_RenderPresent(vis->renderer);
     }
 }
 
 /* Draw a rectangle */
 void neat_draw_rect(neat_visualizer_t* vis, int x, int y, int w, int h, neat_color_t color) {
-    if (!vis) return;
+    if (!vis || w <= 0 || h <= 0) return;
     
-    SDL_Rect rect = {x, y, w, h};
-    SDL_SetRenderDrawColor(vis->renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderFillRect(vis->renderer, &rect);
+    float xs[4] = {(float)x, (float)(x + w), (float)(x + w), (float)x};
+    float ys[4] = {(float)y, (float)y, (float)(y + h), (float)(y + h)};
+    batch_quad(vis, xs, ys, color);
 }
 
-/* Draw a circle */
+/* Draw a filled circle as one pixel-aligned quad per row */
 void neat_draw_circle(neat_visualizer_t* vis, int x, int y, int radius, neat_color_t color) {
-    if (!vis) return;
-    
-    SDL_SetRenderDrawColor(vis->renderer, color.r, color.g, color.b, color.a);
-    
-    int diameter = radius * 2;
-    int x_pos = radius - 1;
-    int y_pos = 0;
-    int tx = 1;
-    int ty = 1;
-    int error = tx - diameter;
-    
-    while (x_pos >= y_pos) {
-        /* Draw eight points for each octant */
-        SDL_RenderDrawPoint(vis->renderer, x + x_pos, y - y_pos);
-        SDL_RenderDrawPoint(vis->renderer, x + x_pos, y + y_pos);
-        SDL_RenderDrawPoint(vis->renderer, x - x_pos, y - y_pos);
-        SDL_RenderDrawPoint(vis->renderer, x - x_pos, y + y_pos);
-        SDL_RenderDrawPoint(vis->renderer, x + y_pos, y - x_pos);
-        SDL_RenderDrawPoint(vis->renderer, x + y_pos, y + x_pos);
-        SDL_RenderDrawPoint(vis->renderer, x - y_pos, y - x_pos);
-        SDL_RenderDrawPoint(vis->renderer, x - y_pos, y + x_pos);
-        
-        if (error <= 0) {
-            y_pos++;
-            error += ty;
-            ty += 2;
-        }
-        
-        if (error > 0) {
-            x_pos--;
-            tx += 2;
-            error += (tx - diameter);
-        }
-    }
+    if (!vis || radius <= 0) return;
     
-    /* Fill the circle */
+    /*
+     * Pixel centers within radius are covered, as with the per-pixel fill.
+     * Whole-pixel edges rasterize the same on every renderer, where a fan's
+     * sub-pixel vertices would be snapped differently by each.
+     */
     for (int dy = -radius; dy <= radius; dy++) {
-        for (int dx = -radius; dx <= radius; dx++) {
-            if (dx*dx + dy*dy <= radius*radius) {
-                SDL_RenderDrawPoint(vis->renderer, x + dx, y + dy);
-            }
-        }
+        int half = (int)sqrtf((float)(radius * radius - dy * dy));
+        float xs[4] = {(float)(x - half), (float)(x + half + 1), (float)(x + half + 1), (float)(x - half)};
+        float ys[4] = {(float)(y + dy), (float)(y + dy), (float)(y + dy + 1), (float)(y + dy + 1)};
+        batch_quad(vis, xs, ys, color);
     }
 }
 
-/* Draw a line */
+/* Draw a line as a quad of the given width, centered on the pixel centers it joins */
 void neat_draw_line(neat_visualizer_t* vis, int x1, int y1, int x2, int y2, neat_color_t color, int width) {
     if (!vis) return;
     
-    SDL_SetRenderDrawColor(vis->renderer, color.r, color.g, color.b, color.a);
-    
-    if (width <= 1) {
-        SDL_RenderDrawLine(vis->renderer, x1, y1, x2, y2);
-    } else {
-        /* Draw a thick line using multiple parallel lines */
-        float dx = x2 - x1;
-        float dy = y2 - y1;
-        float length = sqrtf(dx*dx + dy*dy);
-        float nx = -dy / length;
-        float ny = dx / length;
-        
-        for (int i = -width/2; i <= width/2; i++) {
-            int offset_x = (int)(nx * i);
-            int offset_y = (int)(ny * i);
-            SDL_RenderDrawLine(vis->renderer, 
-                              x1 + offset_x, y1 + offset_y, 
-                              x2 + offset_x, y2 + offset_y);
-        }
-    }
+    float half = (width > 1 ? width : 1) * 0.5f;
+    float dx = (float)(x2 - x1);
+    float dy = (float)(y2 - y1);
+    float length = sqrtf(dx*dx + dy*dy);
+    
+    /* Unit direction, or a square dot for a zero-length line */
+    float ux = length > 0.0f ? dx / length : 1.0f;
+    float uy = length > 0.0f ? dy / length : 0.0f;
+    float nx = -uy * half;
+    float ny = ux * half;
+    
+    /* Extend by half a pixel so the end pixels are covered like SDL_RenderDrawLine's */
+    float ax = x1 + 0.5f - ux * 0.5f, ay = y1 + 0.5f - uy * 0.5f;
+    float bx = x2 + 0.5f + ux * 0.5f, by = y2 + 0.5f + uy * 0.5f;
+    float xs[4] = {ax + nx, bx + nx, bx - nx, ax - nx};
+    float ys[4] = {ay + ny, by + ny, by - ny, ay - ny};
+    batch_quad(vis, xs, ys, color);
 }
 
-/* Draw text */
-void neat_draw_text(neat_visualizer_t* vis, const char* text, int x, int y, neat_color_t color, int size) {
-    if (!vis || !text) return;
-    
-    static TTF_Font* font = NULL;
+/* Glyph atlases */
+
+#define VIS_ATLAS_WIDTH 512
+#define VIS_ATLAS_WHITE 4               /* Side of the white block at the atlas origin */
+
+static TTF_Font* open_font(const char* path, int size) {
+    /* Prefer the caller's font, then try a default one */
+    TTF_Font* font = path ? TTF_OpenFont(path, size) : NULL;
     if (!font) {
-        /* Try to load a default font */
         font = TTF_OpenFont("Arial.ttf", size);
-        if (!font) {
-            /* Try a common Linux font */
-            font = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", size);
-        }
-        if (!font) {
-            /* Try a common macOS font */
-            font = TTF_OpenFont("/System/Library/Fonts/SFNS.ttf", size);
+    }
+    if (!font) {
+        /* Try a common Linux font */
+        font = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", size);
+    }
+    if (!font) {
+        /* Try a common macOS font */
+        font = TTF_OpenFont("/System/Library/Fonts/SFNS.ttf", size);
+    }
+    if (!font) {
+        /* Last resort: use the first available font */
+        font = TTF_OpenFont("*", size);
+    }
+    return font;
+}
+
+/* Render the printable ASCII glyphs of one size into a texture */
+static void atlas_build(neat_visualizer_t* vis, neat_vis_atlas_t* atlas) {
+    TTF_Font* font = open_font(vis->font_path, atlas->size);
+    if (!font) {
+        fprintf(stderr, "Failed to load font at size %d: %s\n", atlas->size, TTF_GetError());
+        return;
+    }
+    
+    /* Render every glyph and shelf-pack them in rows after the white block */
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface* rendered[NEAT_VIS_GLYPH_COUNT];
+    int line_height = TTF_FontHeight(font);
+    int pen_x = VIS_ATLAS_WHITE + 1;
+    int pen_y = 0;
+    for (int i = 0; i < NEAT_VIS_GLYPH_COUNT; i++) {
+        neat_vis_glyph_t* glyph = &atlas->glyphs[i];
+        Uint16 ch = (Uint16)(NEAT_VIS_GLYPH_FIRST + i);
+        rendered[i] = TTF_RenderGlyph_Blended(font, ch, white);
+        int min_x = 0;
+        if (TTF_GlyphMetrics(font, ch, &min_x, NULL, NULL, NULL, &glyph->advance) != 0) {
+            glyph->advance = rendered[i] ? rendered[i]->w : 0;
         }
-        if (!font) {
-            /* Last resort: use the first available font */
-            font = TTF_OpenFont("*", size);
+        /* SDL_ttf starts the surface at a negative left bearing instead of clipping it */
+        glyph->offset_x = min_x < 0 ? min_x : 0;
+        if (!rendered[i]) continue;
+        
+        if (pen_x + rendered[i]->w > VIS_ATLAS_WIDTH) {
+            pen_x = 0;
+            pen_y += line_height + 1;
         }
-        if (!font) {
-            fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
-            return;
+        glyph->rect.x = pen_x;
+        glyph->rect.y = pen_y;
+        glyph->rect.w = rendered[i]->w;
+        glyph->rect.h = rendered[i]->h;
+        pen_x += rendered[i]->w + 1;
+    }
+    TTF_CloseFont(font);
+    
+    int height = pen_y + (line_height > VIS_ATLAS_WHITE ? line_height : VIS_ATLAS_WHITE);
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, VIS_ATLAS_WIDTH, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface) {
+        /* Opaque white is all ones in RGBA32 regardless of byte order */
+        SDL_Rect block = {0, 0, VIS_ATLAS_WHITE, VIS_ATLAS_WHITE};
+        SDL_FillRect(surface, &block, 0xFFFFFFFFu);
+        for (int i = 0; i < NEAT_VIS_GLYPH_COUNT; i++) {
+            if (!rendered[i]) continue;
+            SDL_Rect dst = atlas->glyphs[i].rect;   /* Blitting overwrites it with the clipped rect */
+            SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(rendered[i], NULL, surface, &dst);
         }
+        atlas->texture = SDL_CreateTextureFromSurface(vis->renderer, surface);
+        SDL_FreeSurface(surface);
     }
-    
-    SDL_Color sdl_color = {color.r, color.g, color.b, color.a};
-    SDL_Surface* surface = TTF_RenderText_Blended(font, text, sdl_color);
-    if (!surface) {
-        fprintf(stderr, "Failed to render text: %s\n", TTF_GetError());
+    for (int i = 0; i < NEAT_VIS_GLYPH_COUNT; i++) {
+        if (rendered[i]) SDL_FreeSurface(rendered[i]);
+    }
+    if (!atlas->texture) {
+        fprintf(stderr, "Failed to create glyph atlas: %s\n", SDL_GetError());
         return;
     }
     
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(vis->renderer, surface);
-    if (!texture) {
-        fprintf(stderr, "Failed to create texture: %s\n", SDL_GetError());
-        SDL_FreeSurface(surface);
-        return;
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+    atlas->width = VIS_ATLAS_WIDTH;
+    atlas->height = height;
+    atlas->white.x = (VIS_ATLAS_WHITE * 0.5f) / VIS_ATLAS_WIDTH;
+    atlas->white.y = (VIS_ATLAS_WHITE * 0.5f) / height;
+}
+
+/* Atlas for a font size, built on first use; a size whose font failed stays textureless */
+static neat_vis_atlas_t* atlas_get(neat_visualizer_t* vis, int size) {
+    for (int i = 0; i < vis->atlas_count; i++) {
+        if (vis->atlases[i].size == size) return &vis->atlases[i];
     }
     
-    SDL_Rect dst_rect = {x, y, surface->w, surface->h};
-    SDL_RenderCopy(vis->renderer, texture, NULL, &dst_rect);
+    if (vis->atlas_count == vis->atlas_capacity) {
+        int capacity = vis->atlas_capacity ? vis->atlas_capacity * 2 : 4;
+        vis->atlases = vis->atlases
+            ? (neat_vis_atlas_t*)neat_realloc(vis->atlases, capacity * sizeof(neat_vis_atlas_t))
+            : (neat_vis_atlas_t*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, capacity * sizeof(neat_vis_atlas_t));
+        vis->atlas_capacity = capacity;
+    }
+    neat_vis_atlas_t* atlas = &vis->atlases[vis->atlas_count++];
+    memset(atlas, 0, sizeof(*atlas));
+    atlas->size = size;
+    atlas_build(vis, atlas);
+    return atlas;
+}
+
+static void atlases_free(neat_visualizer_t* vis) {
+    for (int i = 0; i < vis->atlas_count; i++) {
+        if (vis->atlases[i].texture) SDL_DestroyTexture(vis->atlases[i].texture);
+    }
+    neat_free(vis->atlases);
+    vis->atlases = NULL;
+    vis->atlas_count = 0;
+    vis->atlas_capacity = 0;
+}
+
+/* Draw text as one atlas quad per character; characters outside printable ASCII show as '?' */
+void neat_draw_text(neat_visualizer_t* vis, const char* text, int x, int y, neat_color_t color, int size) {
+    if (!vis || !text || size <= 0) return;
     
-    SDL_DestroyTexture(texture);
-    SDL_FreeSurface(surface);
+    neat_vis_atlas_t* atlas = atlas_get(vis, size);
+    if (!atlas->texture) return;
+    
+    size_t length = strlen(text);
+    if (length == 0) return;
+    batch_use_texture(vis, atlas->texture, atlas->white);
+    
+    SDL_Color sdl_color = {color.r, color.g, color.b, color.a};
+    float scale_u = 1.0f / atlas->width;
+    float scale_v = 1.0f / atlas->height;
+    int pen_x = x;
+    for (size_t i = 0; i < length; i++) {
+        int ch = (unsigned char)text[i];
+        if (ch < NEAT_VIS_GLYPH_FIRST || ch >= NEAT_VIS_GLYPH_FIRST + NEAT_VIS_GLYPH_COUNT) ch = '?';
+        const neat_vis_glyph_t* glyph = &atlas->glyphs[ch - NEAT_VIS_GLYPH_FIRST];
+        const SDL_Rect* r = &glyph->rect;
+        
+        if (r->w > 0 && r->h > 0) {
+            float x0 = (float)(pen_x + glyph->offset_x), y0 = (float)y;
+            float x1 = x0 + r->w, y1 = y0 + r->h;
+            float u0 = r->x * scale_u, v0 = r->y * scale_v;
+            float u1 = (r->x + r->w) * scale_u, v1 = (r->y + r->h) * scale_v;
+            int base = batch_reserve(vis, 4, 6);
+            batch_vertex_uv(vis, x0, y0, sdl_color, u0, v0);
+            batch_vertex_uv(vis, x1, y0, sdl_color, u1, v0);
+            batch_vertex_uv(vis, x1, y1, sdl_color, u1, v1);
+            batch_vertex_uv(vis, x0, y1, sdl_color, u0, v1);
+            batch_triangle(vis, base, base + 1, base + 2);
+            batch_triangle(vis, base, base + 2, base + 3);
+        }
+        pen_x += glyph->advance;
+    }
+}
+
+/* Position of a node: one column per placement, nodes spread evenly down their column */
+static void genome_node_position(const neat_genome_t* genome, size_t index,
+                                 int x, int y, int width, int height, int* node_x, int* node_y) {
+    neat_node_placement_t placement = genome->nodes[index].placement;
+    size_t rank = 0, column_size = 0;
+    for (size_t i = 0; i < genome->node_count; i++) {
+        if (genome->nodes[i].placement != placement) continue;
+        if (i < index) rank++;
+        column_size++;
+    }
+    
+    switch (placement) {
+        case NEAT_PLACEMENT_HIDDEN:
+            *node_x = x + width / 2;
+            break;
+        case NEAT_PLACEMENT_OUTPUT:
+            *node_x = x + width - 50;
+            break;
+        default:
+            *node_x = x + 50;
+    }
+    *node_y = y + 50 + (int)((rank + 1) * (size_t)(height - 100) / (column_size + 1));
+}
+
+/* Index of the node with an id, or -1 */
+static long genome_node_index(const neat_genome_t* genome, int id) {
+    for (size_t i = 0; i < genome->node_count; i++) {
+        if (genome->nodes[i].id == id) return (long)i;
+    }
+    return -1;
 }
 
 /* Visualize a genome */
@@ -285,30 +545,41 @@ void neat_visualize_genome(neat_visualizer_t* vis, neat_genome_t* genome,
              genome->id, genome->fitness);
     neat_draw_text(vis, title, x + 10, y + 10, COLOR_BLACK, 16);
     
+    /* Draw connections first so the nodes cover their ends */
+    for (size_t i = 0; i < genome->connection_count; i++) {
+        const neat_connection_t* conn = &genome->connections[i];
+        if (!conn->enabled) continue;
+        
+        long from = genome_node_index(genome, conn->in_node);
+        long to = genome_node_index(genome, conn->out_node);
+        if (from < 0 || to < 0) continue;
+        
+        int from_x, from_y, to_x, to_y;
+        genome_node_position(genome, (size_t)from, x, y, width, height, &from_x, &from_y);
+        genome_node_position(genome, (size_t)to, x, y, width, height, &to_x, &to_y);
+        
+        /* Draw connection, more opaque for stronger weights */
+        neat_color_t conn_color = conn->weight > 0 ? COLOR_GREEN : COLOR_RED;
+        double strength = fabs(conn->weight);
+        conn_color.a = (Uint8)((strength < 1.0 ? strength : 1.0) * 255.0);
+        
+        neat_draw_line(vis, from_x, from_y, to_x, to_y, conn_color, 2);
+        
+        /* Draw weight */
+        char weight_str[16];
+        snprintf(weight_str, sizeof(weight_str), "%.2f", conn->weight);
+        neat_draw_text(vis, weight_str, 
+                      (from_x + to_x) / 2, 
+                      (from_y + to_y) / 2, 
+                      COLOR_BLACK, 10);
+    }
+    
     /* Draw nodes */
     for (size_t i = 0; i < genome->node_count; i++) {
-        neat_node_t* node = genome->nodes[i];
+        const neat_node_t* node = &genome->nodes[i];
         int node_x, node_y;
         int node_radius = 15;
-        
-        /* Calculate node position based on type */
-        switch (node->placement) {
-            case NEAT_PLACEMENT_INPUT:
-                node_x = x + 50;
-                node_y = y + 50 + (int)(i * (height - 100) / genome->node_count);
-                break;
-            case NEAT_PLACEMENT_HIDDEN:
-                node_x = x + width / 2;
-                node_y = y + 50 + (int)(i * (height - 100) / genome->node_count);
-                break;
-            case NEAT_PLACEMENT_OUTPUT:
-                node_x = x + width - 50;
-                node_y = y + 50 + (int)(i * (height - 100) / genome->node_count);
-                break;
-            default:
-                node_x = x + 50;
-                node_y = y + 50 + (int)(i * (height - 100) / genome->node_count);
-        }
+        genome_node_position(genome, i, x, y, width, height, &node_x, &node_y);
         
         /* Draw node */
         neat_color_t node_color;
@@ -336,58 +607,6 @@ void neat_visualize_genome(neat_visualizer_t* vis, neat_genome_t* genome,
         snprintf(node_id, sizeof(node_id), "%d", node->id);
         neat_draw_text(vis, node_id, node_x - 5, node_y - 8, COLOR_BLACK, 12);
     }
-    
-    /* Draw connections */
-    for (size_t i = 0; i < genome->connection_count; i++) {
-        neat_connection_t* conn = genome->connections[i];
-        if (!conn->enabled) continue;
-        
-        /* Find source and target nodes */
-        neat_node_t* from_node = NULL;
-        neat_node_t* to_node = NULL;
-        
-        for (size_t j = 0; j < genome->node_count; j++) {
-            if (genome->nodes[j]->id == conn->in_node) {
-                from_node = genome->nodes[j];
-            }
-            if (genome->nodes[j]->id == conn->out_node) {
-                to_node = genome->nodes[j];
-            }
-            if (from_node && to_node) break;
-        }
-        
-        if (!from_node || !to_node) continue;
-        
-        /* Calculate node positions */
-        int from_x = 0, from_y = 0, to_x = 0, to_y = 0;
-        
-        /* This is a simplified version - in a real implementation, 
-           you'd want to store node positions in the node structure */
-        for (size_t j = 0; j < genome->node_count; j++) {
-            if (genome->nodes[j] == from_node) {
-                from_x = x + 50 + (int)(j * 100) % (width - 100);
-                from_y = y + 50 + (int)(j * 50) % (height - 100);
-            }
-            if (genome->nodes[j] == to_node) {
-                to_x = x + 50 + (int)(j * 100) % (width - 100);
-                to_y = y + 50 + (int)(j * 50) % (height - 100);
-            }
-        }
-        
-        /* Draw connection */
-        neat_color_t conn_color = conn->weight > 0 ? COLOR_GREEN : COLOR_RED;
-        conn_color.a = (Uint8)(fabsf(conn->weight) * 255.0f);
-        
-        neat_draw_line(vis, from_x, from_y, to_x, to_y, conn_color, 2);
-        
-        /* Draw weight */
-        char weight_str[16];
-        snprintf(weight_str, sizeof(weight_str), "%.2f", conn->weight);
-        neat_draw_text(vis, weight_str, 
-                      (from_x + to_x) / 2, 
-                      (from_y + to_y) / 2, 
-                      COLOR_BLACK, 10);
-    }
 }
 
 /* Visualize a species */
@@ -408,12 +627,13 @@ void neat_visualize_species(neat_visualizer_t* vis, neat_species_t* species,
     /* Draw title */
     char title[256];
     snprintf(title, sizeof(title), "Species %d (Size: %zu, Staleness: %d, Best: %.2f)", 
-             species->id, species->member_count, species->staleness, species->max_fitness_ever);
+             species->id, species->member_count, species->staleness, species->best_fitness);
     neat_draw_text(vis, title, x + 10, y + 10, COLOR_BLACK, 14);
     
     /* Draw member genomes */
+    if (species->member_count == 0) return;
     int num_cols = 3;
-    int num_rows = (species->member_count + num_cols - 1) / num_cols;
+    int num_rows = (int)((species->member_count + num_cols - 1) / num_cols);
     int genome_width = (width - 40) / num_cols;
     int genome_height = (height - 50) / num_rows;
     
@@ -423,13 +643,15 @@ void neat_visualize_species(neat_visualizer_t* vis, neat_species_t* species,
         int gx = x + 10 + col * (genome_width + 10);
         int gy = y + 40 + row * (genome_height + 10);
         
-        neat_draw_rect(vis, gx, gy, genome_width, genome_height, COLOR_WHITE);
         neat_draw_rect(vis, gx, gy, genome_width, genome_height, COLOR_GRAY);
+        neat_draw_rect(vis, gx + 1, gy + 1, genome_width - 2, genome_height - 2, COLOR_WHITE);
         
+        /* Text is drawn one line at a time */
         char info[64];
-        snprintf(info, sizeof(info), "Genome %d\nFitness: %.2f", 
-                 species->members[i]->id, species->members[i]->fitness);
+        snprintf(info, sizeof(info), "Genome %d", species->members[i]->id);
         neat_draw_text(vis, info, gx + 10, gy + 10, COLOR_BLACK, 10);
+        snprintf(info, sizeof(info), "Fitness: %.2f", species->members[i]->fitness);
+        neat_draw_text(vis, info, gx + 10, gy + 24, COLOR_BLACK, 10);
     }
 }
 
@@ -442,7 +664,7 @@ void neat_visualize_population(neat_visualizer_t* vis, neat_population_t* pop) {
     
     /* Draw title */
     char title[256];
-    snprintf(title, sizeof(title), "NEAT Population (Generation: %zu, Species: %zu)", 
+    snprintf(title, sizeof(title), "NEAT Population (Generation: %d, Species: %zu)", 
              pop->generation, pop->species_count);
     neat_draw_text(vis, title, 10, 10, COLOR_BLACK, 20);
     
@@ -460,6 +682,16 @@ void neat_visualize_population(neat_visualizer_t* vis, neat_population_t* pop) {
         neat_visualize_species(vis, pop->species[i], x, y, species_width, species_height);
     }
     
+    /* Input and output counts come from the genomes; the population does not store them */
+    int inputs = 0, outputs = 0;
+    if (pop->genome_count > 0) {
+        const neat_genome_t* genome = pop->genomes[0];
+        for (size_t i = 0; i < genome->node_count; i++) {
+            if (genome->nodes[i].placement == NEAT_PLACEMENT_INPUT) inputs++;
+            else if (genome->nodes[i].placement == NEAT_PLACEMENT_OUTPUT) outputs++;
+        }
+    }
+    
     /* Draw stats */
     char stats[512];
     snprintf(stats, sizeof(stats), 
@@ -468,9 +700,9 @@ void neat_visualize_population(neat_visualizer_t* vis, neat_population_t* pop) {
              "Outputs: %d  |  "
              "Best Fitness: %.2f",
              pop->genome_count,
-             pop->input_size,
-             pop->output_size,
-             pop->best_fitness);
+             inputs,
+             outputs,
+             pop->max_fitness_achieved);
     
     neat_draw_text(vis, stats, 10, vis->height - 30, COLOR_BLACK, 14);
     
@@ -566,6 +798,7 @@ int neat_save_screenshot(neat_visualizer_t* vis, const char* filename) {
         return 0;
     }
     
+    neat_visualizer_flush(vis);
     if (SDL_RenderReadPixels(
         vis->renderer, 
         NULL, 
@@ -588,6 +821,40 @@ int neat_save_screenshot(neat_visualizer_t* vis, const char* filename) {
     return 1;
 }
 
+/* Pixels of the headless framebuffer, RGBA32 rows of *pitch bytes; NULL with a window */
+const Uint8* neat_visualizer_framebuffer(neat_visualizer_t* vis, int* pitch) {
+    if (!vis || !vis->framebuffer) return NULL;
+    
+    /* Let queued draw commands reach the surface */
+    neat_visualizer_flush(vis);
+    SDL_RenderFlush(vis->renderer);
+    if (pitch) *pitch = vis->framebuffer->pitch;
+    return (const Uint8*)vis->framebuffer->pixels;
+}
+
+/* Write the current frame to "<prefix>_frame_NNNN.bmp", numbering frames in order */
+int neat_visualizer_dump_frame(neat_visualizer_t* vis, const char* prefix) {
+    if (!vis || !prefix) return 0;
+    
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s_frame_%04d.bmp", prefix, vis->frames_dumped);
+    
+    int saved;
+    if (vis->framebuffer) {
+        neat_visualizer_flush(vis);
+        SDL_RenderFlush(vis->renderer);
+        saved = SDL_SaveBMP(vis->framebuffer, filename) == 0;
+        if (!saved) {
+            fprintf(stderr, "Failed to save frame: %s\n", SDL_GetError());
+        }
+    } else {
+        saved = neat_save_screenshot(vis, filename);
+    }
+    
+    if (saved) vis->frames_dumped++;
+    return saved;
+}
+
 /* Draw a graph */
 void neat_draw_graph(neat_visualizer_t* vis, float* values, int count, 
                     int x, int y, int w, int h,
@@ -648,12 +915,12 @@ void neat_draw_graph(neat_visualizer_t* vis, float* values, int count,
 
 /* Animation functions */
 neat_animation_t* neat_animation_create(int max_frames, int width, int height) {
-    neat_animation_t* anim = (neat_animation_t*)malloc(sizeof(neat_animation_t));
+    neat_animation_t* anim = (neat_animation_t*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, sizeof(neat_animation_t));
     if (!anim) return NULL;
     
-    anim->frames = (char**)calloc(max_frames, sizeof(char*));
+    anim->frames = (char**)neat_calloc_tagged(NEAT_MEM_VISUALIZATION, max_frames, sizeof(char*));
     if (!anim->frames) {
-        free(anim);
+        neat_free(anim);
         return NULL;
     }
     
@@ -668,15 +935,19 @@ neat_animation_t* neat_animation_create(int max_frames, int width, int height) {
 void neat_animation_add_frame(neat_animation_t* anim, neat_visualizer_t* vis) {
     if (!anim || !vis || anim->frame_count >= anim->max_frames) return;
     
-    /* Allocate memory for the frame */
-    size_t frame_size = anim->width * anim->height * 4;  /* 4 bytes per pixel (RGBA) */
-    anim->frames[anim->frame_count] = (char*)malloc(frame_size);
+    /* Allocate memory for the frame; what the visualizer does not cover stays transparent */
+    size_t frame_size = (size_t)anim->width * anim->height * 4;  /* 4 bytes per pixel (RGBA) */
+    anim->frames[anim->frame_count] = (char*)neat_calloc_tagged(NEAT_MEM_VISUALIZATION, 1, frame_size);
     if (!anim->frames[anim->frame_count]) return;
     
-    /* Read pixels from the renderer */
+    /* Read the part of the frame that fits the animation */
+    SDL_Rect area = {0, 0,
+                     vis->width < anim->width ? vis->width : anim->width,
+                     vis->height < anim->height ? vis->height : anim->height};
+    neat_visualizer_flush(vis);
     SDL_RenderReadPixels(
         vis->renderer,
-        NULL,
+        &area,
         SDL_PIXELFORMAT_RGBA32,
         anim->frames[anim->frame_count],
         anim->width * 4
@@ -689,10 +960,10 @@ int neat_animation_save(neat_animation_t* anim, const char* filename) {
     if (!anim || !filename || anim->frame_count == 0) return 0;
     
     /* In a real implementation, you would save the animation as a GIF or video */
-    /* For now, we'll just save the first frame as a PNG */
+    /* For now, we'll just save the first frame as a BMP, which SDL writes without SDL_image */
     if (anim->frame_count > 0) {
         char frame_filename[256];
-        snprintf(frame_filename, sizeof(frame_filename), "%s_frame_0000.png", filename);
+        snprintf(frame_filename, sizeof(frame_filename), "%s_frame_0000.bmp", filename);
         
         SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(
             anim->frames[0],
@@ -707,9 +978,12 @@ int neat_animation_save(neat_animation_t* anim, const char* filename) {
         );
         
         if (surface) {
-            IMG_SavePNG(surface, frame_filename);
+            int saved = SDL_SaveBMP(surface, frame_filename) == 0;
+            if (!saved) {
+                fprintf(stderr, "Failed to save animation frame: %s\n", SDL_GetError());
+            }
             SDL_FreeSurface(surface);
-            return 1;
+            return saved;
         }
     }
     
@@ -720,21 +994,21 @@ void neat_animation_destroy(neat_animation_t* anim) {
     if (!anim) return;
     
     for (int i = 0; i < anim->frame_count; i++) {
-        free(anim->frames[i]);
+        neat_free(anim->frames[i]);
     }
     
-    free(anim->frames);
-    free(anim);
+    neat_free(anim->frames);
+    neat_free(anim);
 }
 
 /* Plot functions */
 neat_plot_t* neat_plot_create(int capacity, neat_color_t color, const char* title) {
-    neat_plot_t* plot = (neat_plot_t*)malloc(sizeof(neat_plot_t));
+    neat_plot_t* plot = (neat_plot_t*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, sizeof(neat_plot_t));
     if (!plot) return NULL;
     
-    plot->values = (float*)malloc(capacity * sizeof(float));
+    plot->values = (float*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, capacity * sizeof(float));
     if (!plot->values) {
-        free(plot);
+        neat_free(plot);
         return NULL;
     }
     
@@ -743,7 +1017,13 @@ neat_plot_t* neat_plot_create(int capacity, neat_color_t color, const char* titl
     plot->min_val = 0.0f;
     plot->max_val = 1.0f;
     plot->color = color;
-    plot->title = title ? strdup(title) : NULL;
+    plot->title = NULL;
+    if (title) {
+        size_t len = strlen(title) + 1;
+        char* copy = (char*)neat_malloc_tagged(NEAT_MEM_VISUALIZATION, len);
+        memcpy(copy, title, len);
+        plot->title = copy;
+    }
     
     return plot;
 }
@@ -771,7 +1051,7 @@ void neat_plot_add_value(neat_plot_t* plot, float value) {
 void neat_plot_destroy(neat_plot_t* plot) {
     if (!plot) return;
     
-    free(plot->values);
-    if (plot->title) free((void*)plot->title);
-    free(plot);
+    neat_free(plot->values);
+    if (plot->title) neat_free((void*)plot->title);
+    neat_free(plot);
 }
@@ -1,8 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include "../include/neat.h"
+#include "../include/envs.h"
+#include "../include/genome_io.h"
+#include "../include/checkpoint.h"
+#include "../include/runlog.h"
+#include "../include/trace.h"
+#include "../include/metrics.h"
+#include "../include/eval_profile.h"
+#include "../include/surrogate.h"
 
 /* Global test data */
 static const double XOR_INPUTS[4][2] = {
@@ -543,3 +560,1664 @@ void test_performance() {
         neat_free_population(pop);
     }
 }
+
+/* Test built-in benchmark environments */
+void test_benchmark_envs() {
+    print_test_header("Testing Benchmark Environments");
+    
+    /* Datasets */
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    TEST_EQUAL(xor_data->case_count, 4, "XOR dataset should have 4 cases");
+    TEST_TRUE(xor_data->targets[0] == 0.0f && xor_data->targets[1] == 1.0f &&
+              xor_data->targets[2] == 1.0f && xor_data->targets[3] == 0.0f,
+              "XOR targets should match the truth table");
+    
+    neat_env_dataset_t* parity = neat_env_parity_create(4);
+    TEST_EQUAL(parity->case_count, 16, "4-bit parity should have 16 cases");
+    TEST_TRUE(parity->targets[7] == 1.0f, "Parity of 0111 should be 1");
+    
+    neat_env_dataset_t* mux = neat_env_multiplexer_create(2);
+    TEST_EQUAL(mux->num_inputs, 6, "6-multiplexer should have 6 inputs");
+    TEST_EQUAL(mux->case_count, 64, "6-multiplexer should have 64 cases");
+    
+    neat_population_t* pop = neat_create_population(2, 1, 10);
+    double fitness = neat_env_dataset_fitness(pop->genomes[0], xor_data);
+    TEST_TRUE(fitness >= 0.0 && fitness <= 4.0, "XOR dataset fitness should lie in [0, 4]");
+    neat_free_population(pop);
+    
+    neat_env_dataset_free(xor_data);
+    neat_env_dataset_free(parity);
+    neat_env_dataset_free(mux);
+    
+    /* Identical starts must give bit-identical trajectories: 11 instances cover one AVX block plus a tail */
+    for (int poles = 1; poles <= 2; poles++) {
+        neat_pole_batch_t* batch = neat_pole_batch_create(11, poles, true);
+        float forces[11];
+        bool identical = true;
+        
+        /* Bang-bang control on the pole angle keeps episodes long enough for rounding to show */
+        for (int step = 0; step < 5000 && identical; step++) {
+            for (int i = 0; i < 11; i++) {
+                forces[i] = batch->theta1[i] > 0.0f ? NEAT_ENV_FORCE_MAG : -NEAT_ENV_FORCE_MAG;
+            }
+            if (neat_pole_batch_step(batch, forces) == 0) break;
+            
+            for (int i = 1; i < 11; i++) {
+                identical = identical &&
+                    batch->x[i] == batch->x[0] && batch->x_dot[i] == batch->x_dot[0] &&
+                    batch->theta1[i] == batch->theta1[0] && batch->theta1_dot[i] == batch->theta1_dot[0] &&
+                    (poles == 1 || (batch->theta2[i] == batch->theta2[0] &&
+                                    batch->theta2_dot[i] == batch->theta2_dot[0]));
+            }
+        }
+        
+        TEST_GREATER(batch->steps[0], 0, "Pole should survive at least one step");
+        TEST_TRUE(identical, "Every instance, tail included, should follow exactly the same trajectory");
+        TEST_EQUAL(batch->steps[0], batch->steps[10], "SIMD block and tail should produce identical episodes");
+        neat_pole_batch_free(batch);
+    }
+    
+    /* Fitness on the non-Markovian double pole task */
+    neat_population_t* pole_pop = neat_create_population(3, 1, 5);
+    neat_pole_task_t task = neat_pole_task_default(2, false);
+    task.max_steps = 1000;
+    fitness = neat_env_pole_fitness(pole_pop->genomes[0], &task);
+    TEST_TRUE(fitness >= 0.0 && fitness <= task.max_steps, 
+             "Pole fitness should be bounded by the episode length");
+    neat_free_population(pole_pop);
+}
+
+/* Test ask/tell external evaluation */
+void test_ask_tell() {
+    print_test_header("Testing Ask/Tell Evaluation");
+    
+    neat_population_t* pop = neat_create_population(2, 1, 20);
+    pop->ask_batch_size = 8;
+    
+    neat_genome_t** batch = NULL;
+    size_t count = 0;
+    int ids[20];
+    double fitnesses[20];
+    size_t pending = 0;
+    
+    /* Collect every batch of the first generation */
+    while (neat_ask(pop, &batch, &count) == 0 && count > 0) {
+        TEST_TRUE(count <= 8, "Ask should respect the batch size");
+        for (size_t i = 0; i < count; i++) {
+            ids[pending] = batch[i]->id;
+            fitnesses[pending] = (double)batch[i]->id;
+            pending++;
+        }
+    }
+    TEST_EQUAL(pending, 20, "Ask should hand out the whole generation");
+    
+    /* Report in reverse order, with a duplicate and an unknown ID */
+    int reversed_ids[20];
+    double reversed_fitnesses[20];
+    for (size_t i = 0; i < 20; i++) {
+        reversed_ids[i] = ids[19 - i];
+        reversed_fitnesses[i] = fitnesses[19 - i];
+    }
+    int accepted = neat_tell(pop, reversed_ids, reversed_fitnesses, 10);
+    TEST_EQUAL(accepted, 10, "Tell should accept results in any order");
+    TEST_EQUAL(neat_tell(pop, reversed_ids, reversed_fitnesses, 1), 0, "Duplicate results should be ignored");
+    int unknown_id = 9999;
+    double unknown_fitness = 1.0;
+    TEST_EQUAL(neat_tell(pop, &unknown_id, &unknown_fitness, 1), 0, "Unknown IDs should be ignored");
+    TEST_EQUAL(pop->generation, 0, "Reproduction should wait for all results");
+    
+    accepted = neat_tell(pop, &reversed_ids[10], &reversed_fitnesses[10], 10);
+    TEST_EQUAL(accepted, 10, "Remaining results should be accepted");
+    TEST_EQUAL(pop->generation, 1, "The last result should trigger reproduction");
+    
+    neat_ask(pop, &batch, &count);
+    TEST_TRUE(count > 0 && !batch[0]->evaluated, "The new generation should be unevaluated");
+    TEST_TRUE(batch[0]->id >= 20, "The new generation should have fresh IDs");
+    
+    /* Lose five results, then requeue: only the lost genomes come back */
+    while (count > 0) {
+        neat_ask(pop, &batch, &count);
+    }
+    int lost_ids[5];
+    double lost_fitnesses[5];
+    size_t told = 0, lost = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        int id = pop->genomes[i]->id;
+        double fitness = 1.0;
+        if (i % 4 == 1) {
+            lost_ids[lost++] = id;
+        } else {
+            told += (size_t)neat_tell(pop, &id, &fitness, 1);
+        }
+    }
+    TEST_EQUAL(told, (size_t)15, "Results outside the lost set should be accepted");
+    neat_ask(pop, &batch, &count);
+    TEST_EQUAL(count, (size_t)0, "Without a requeue lost genomes are not handed out again");
+    TEST_EQUAL(neat_requeue(pop), 5, "Requeue should report the genomes still pending");
+    size_t reissued = 0;
+    bool only_lost = true;
+    while (neat_ask(pop, &batch, &count) == 0 && count > 0) {
+        for (size_t i = 0; i < count; i++) {
+            bool found = false;
+            for (size_t j = 0; j < lost; j++) found = found || lost_ids[j] == batch[i]->id;
+            only_lost = only_lost && found;
+            reissued++;
+        }
+    }
+    TEST_EQUAL(reissued, (size_t)5, "Every lost genome should be handed out again");
+    TEST_TRUE(only_lost, "Genomes with results should not be handed out again");
+    for (size_t j = 0; j < lost; j++) lost_fitnesses[j] = 1.0;
+    neat_tell(pop, lost_ids, lost_fitnesses, lost);
+    TEST_EQUAL(pop->generation, 2, "Results for requeued genomes should complete the generation");
+    
+    neat_free_population(pop);
+}
+
+/* Records the order in which evaluations start */
+typedef struct {
+    atomic_int next_ticket;
+    int tickets[64];            /* By genome index */
+    neat_population_t* pop;
+} dispatch_log_t;
+
+static double dispatch_test_evaluate(neat_genome_t* genome, void* user_data) {
+    dispatch_log_t* log = (dispatch_log_t*)user_data;
+    int ticket = atomic_fetch_add(&log->next_ticket, 1);
+    for (size_t i = 0; i < log->pop->genome_count; i++) {
+        if (log->pop->genomes[i] == genome) log->tickets[i] = ticket;
+    }
+    return 0.0;
+}
+
+/* Grow a genome by hidden nodes and connections; returns its enabled connection count */
+static size_t cost_test_grow(neat_genome_t* genome, int hidden, int connections) {
+    for (int n = 0; n < hidden; n++) {
+        neat_add_node(genome, NEAT_NODE_HIDDEN, NEAT_PLACEMENT_HIDDEN);
+    }
+    int nodes = (int)genome->node_count;
+    for (int c = 0; c < connections; c++) {
+        neat_add_connection(genome, c % nodes, (c / nodes + c + 1) % nodes, 0.5, true);
+    }
+    
+    size_t enabled = 0;
+    for (size_t i = 0; i < genome->connection_count; i++) {
+        if (genome->connections[i].enabled) enabled++;
+    }
+    genome->evaluated = true;
+    return enabled;
+}
+
+/* Test the evaluation cost model and longest-predicted-first dispatch */
+void test_cost_model() {
+    print_test_header("Testing Evaluation Cost Model");
+    
+    neat_cost_model_t model;
+    neat_cost_model_init(&model);
+    neat_population_t* pop = neat_create_population(2, 1, 42);
+    
+    /* Before any fit, predictions follow parent time, then genome size */
+    neat_genome_t* small = pop->genomes[40];
+    neat_genome_t* large = pop->genomes[41];
+    size_t large_enabled = cost_test_grow(large, 6, 12);
+    TEST_TRUE(neat_cost_model_predict(&model, large) > neat_cost_model_predict(&model, small),
+              "An unfitted model should rank larger genomes as costlier");
+    small->parent_eval_time = 1.0;
+    TEST_TRUE(neat_cost_model_predict(&model, small) == 1.0, "An unfitted model should use the parent time");
+    small->parent_eval_time = 0.0;
+    
+    /* Synthetic cost proportional to enabled connections, with node counts varied independently */
+    double actual[40];
+    for (int g = 0; g < 40; g++) {
+        actual[g] = 3e-6 * (double)cost_test_grow(pop->genomes[g], (g * 7) % 9, 1 + (g * 5) % 20);
+    }
+    for (int generation = 0; generation < 5; generation++) {
+        for (int g = 0; g < 40; g++) {
+            pop->genomes[g]->eval_time = actual[g];
+        }
+        neat_cost_model_update(&model, pop->genomes, 40);
+    }
+    TEST_EQUAL(model.samples, (size_t)200, "Every evaluated genome should be a sample");
+    
+    double worst = 0.0;
+    for (int g = 0; g < 40; g++) {
+        double error = fabs(neat_cost_model_predict(&model, pop->genomes[g]) - actual[g]) / actual[g];
+        if (error > worst) worst = error;
+    }
+    TEST_TRUE(worst < 1e-3, "The fit should converge on a cost proportional to connections");
+    TEST_TRUE(fabs(neat_cost_model_predict(&model, large) - 3e-6 * (double)large_enabled) < 1e-8,
+              "The fit should predict a genome it was not fitted on");
+    
+    /* Unevaluated genomes carry no timing and are skipped */
+    pop->genomes[0]->evaluated = false;
+    neat_cost_model_update(&model, pop->genomes, 1);
+    TEST_EQUAL(model.samples, (size_t)200, "Unevaluated genomes should not be samples");
+    neat_free_population(pop);
+    
+    /* Dispatch: predicted cost comes from parent time on a fresh model, scrambled across indices */
+    pop = neat_create_population(2, 1, 32);
+    dispatch_log_t log;
+    atomic_init(&log.next_ticket, 0);
+    log.pop = pop;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        pop->genomes[i]->parent_eval_time = (double)((i * 13) % pop->genome_count + 1);
+    }
+    neat_evaluate_parallel(pop, dispatch_test_evaluate, &log, 2);
+    
+    /* Two workers can swap neighbouring jobs, so compare the first starts and the halves */
+    double early = 0.0, late = 0.0;
+    int costliest_ticket = -1;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        size_t rank = pop->genome_count - (size_t)pop->genomes[i]->parent_eval_time;
+        if (rank == 0) costliest_ticket = log.tickets[i];
+        if (rank < pop->genome_count / 2) early += log.tickets[i];
+        else late += log.tickets[i];
+    }
+    TEST_EQUAL(atomic_load(&log.next_ticket), (int)pop->genome_count, "Every genome should be evaluated");
+    TEST_TRUE(costliest_ticket >= 0 && costliest_ticket < 2, "The costliest genome should start first");
+    TEST_TRUE(early < late, "Costlier genomes should start before cheaper ones");
+    
+    neat_free_population(pop);
+}
+
+/* Scores a genome by its ID and counts real evaluations per ID */
+static double surrogate_test_evaluate(neat_genome_t* genome, void* user_data) {
+    int* calls = (int*)user_data;
+    calls[genome->id]++;
+    return (double)genome->id;
+}
+
+/* Test surrogate prediction, warm-up, evaluation quotas and elite handling */
+void test_surrogate() {
+    print_test_header("Testing Surrogate Prescreening");
+    
+    neat_surrogate_config_t config = neat_surrogate_default_config();
+    config.k = 3;
+    config.capacity = 128;
+    config.min_samples = 40;
+    config.top_fraction = 0.25;
+    config.explore_fraction = 0.1;
+    config.parent_weight = 0.0;
+    neat_surrogate_t* surrogate = neat_surrogate_create(&config);
+    neat_population_t* pop = neat_create_population(2, 1, 40);
+    
+    /* Without samples the prediction falls back to the parent's fitness */
+    neat_genome_t* probe = pop->genomes[0];
+    probe->parent_fitness = 2.5;
+    TEST_TRUE(neat_surrogate_predict(surrogate, probe) == 2.5, "An untrained surrogate should predict the parent fitness");
+    
+    /* A trained genome predicts its own fitness, blended with the parent by weight */
+    neat_surrogate_train(surrogate, probe, 8.0);
+    TEST_EQUAL(surrogate->sample_count, (size_t)1, "Training should store a sample");
+    TEST_TRUE(fabs(neat_surrogate_predict(surrogate, probe) - 8.0) < 1e-3, "A sample should predict its own fitness");
+    surrogate->config.parent_weight = 0.5;
+    TEST_TRUE(fabs(neat_surrogate_predict(surrogate, probe) - 5.25) < 1e-3, "Parent weight should blend in the parent fitness");
+    neat_surrogate_free(surrogate);
+    probe->parent_fitness = 0.0;
+    
+    /* Warm-up: everything is evaluated until min_samples is reached */
+    surrogate = neat_surrogate_create(&config);
+    int calls[40] = {0};
+    pop->evaluate_genome = surrogate_test_evaluate;
+    pop->evaluate_user_data = calls;
+    neat_surrogate_evaluate(pop, surrogate);
+    TEST_EQUAL(surrogate->last_stats.evaluated, (size_t)40, "Warm-up should evaluate every genome");
+    TEST_EQUAL(surrogate->sample_count, (size_t)40, "Warm-up should train on every genome");
+    
+    /* Rank by parent fitness alone; the elite would rank last if it were prescreened */
+    surrogate->config.parent_weight = 1.0;
+    neat_genome_t* elite = pop->genomes[39];
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        pop->genomes[i]->parent_fitness = (double)i;
+        pop->genomes[i]->evaluated = false;
+        pop->genomes[i]->elite = false;
+    }
+    elite->elite = true;
+    elite->parent_fitness = -1000.0;
+    memset(calls, 0, sizeof(calls));
+    neat_surrogate_evaluate(pop, surrogate);
+    
+    const neat_surrogate_stats_t* gen_stats = &surrogate->last_stats;
+    TEST_EQUAL(gen_stats->elites, (size_t)1, "The elite should be counted separately");
+    TEST_EQUAL(gen_stats->candidates, (size_t)39, "Elites should not be prescreened");
+    TEST_EQUAL(gen_stats->evaluated, (size_t)14, "Top and exploration quotas should be ceil(25%) + ceil(10%)");
+    TEST_EQUAL(gen_stats->explored, (size_t)4, "The exploration quota should be evaluated");
+    TEST_EQUAL(gen_stats->skipped, (size_t)25, "The remainder should be skipped");
+    TEST_EQUAL(calls[39], 1, "The elite should be evaluated for real");
+    TEST_TRUE(elite->fitness == 39.0, "The elite should keep its real fitness");
+    
+    int real_count = 0;
+    double min_real = INFINITY, max_skipped = -INFINITY;
+    for (int i = 0; i < 39; i++) {
+        if (i >= 29) TEST_EQUAL(calls[i], 1, "The best-predicted quota should be evaluated");
+        TEST_TRUE(pop->genomes[i]->evaluated, "Every genome should end up with a fitness");
+        if (calls[i]) {
+            real_count++;
+            if (pop->genomes[i]->fitness < min_real) min_real = pop->genomes[i]->fitness;
+        } else if (pop->genomes[i]->fitness > max_skipped) {
+            max_skipped = pop->genomes[i]->fitness;
+        }
+    }
+    TEST_EQUAL(real_count, 14, "Only the quotas should reach the evaluator");
+    TEST_TRUE(max_skipped <= min_real && max_skipped <= elite->fitness,
+              "Skipped genomes should never outrank a real score");
+    
+    neat_surrogate_free(surrogate);
+    neat_free_population(pop);
+}
+
+/* Counts evaluations per level; only top-level scores exceed 100 */
+static double fidelity_test_evaluate(neat_genome_t* genome, int fidelity, void* user_data) {
+    int* calls = (int*)user_data;
+    calls[fidelity]++;
+    return (fidelity == 2 ? 100.0 : 0.0) + (double)(genome->id % 5);
+}
+
+void test_fidelity_ladder() {
+    print_test_header("Testing Multi-Fidelity Evaluation");
+    
+    neat_population_t* pop = neat_create_population(2, 1, 40);
+    int calls[3] = {0, 0, 0};
+    pop->fidelity_levels = 3;
+    pop->fidelity_promote_fraction = 0.25;
+    pop->evaluate_fidelity = fidelity_test_evaluate;
+    pop->evaluate_user_data = calls;
+    
+    /* The initial population has no species and is ranked as one group */
+    int next_species_id = pop->innovation_table->next_species_id;
+    neat_evaluate_fidelity_ladder(pop);
+    TEST_EQUAL(calls[0], 40, "Every genome should be scored at the lowest level");
+    TEST_EQUAL(calls[1], 10, "The top quarter should be promoted");
+    TEST_EQUAL(calls[2], 3, "Promotion should narrow at each level");
+    TEST_EQUAL(pop->innovation_table->next_species_id, next_species_id, "The ladder should not speciate");
+    TEST_TRUE(pop->max_fitness_achieved >= 100.0, "Best fitness should come from the top level");
+    
+    size_t top_count = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->fidelity == neat_top_fidelity(pop)) top_count++;
+    }
+    TEST_EQUAL(top_count, (size_t)calls[2], "Fidelity should record the highest level reached");
+    
+    neat_evolve_epoch(pop);
+    TEST_EQUAL(pop->generation, 1, "Reproduction should follow the ladder");
+    TEST_TRUE(pop->genomes[0]->fidelity == 0 && !pop->genomes[0]->evaluated, "Offspring should restart at the lowest level");
+    
+    /* Offspring are ranked within their parents' species, at least one promoted per species */
+    int species_groups = 0;
+    size_t unassigned = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->species_id <= 0) unassigned++;
+        bool seen = false;
+        for (size_t j = 0; j < i; j++) {
+            if (pop->genomes[j]->species_id == pop->genomes[i]->species_id) seen = true;
+        }
+        if (!seen) species_groups++;
+    }
+    TEST_EQUAL(unassigned, (size_t)0, "Offspring should carry their parent species");
+    memset(calls, 0, sizeof(calls));
+    next_species_id = pop->innovation_table->next_species_id;
+    neat_evaluate_fidelity_ladder(pop);
+    TEST_TRUE(calls[1] >= species_groups && calls[1] < (int)pop->genome_count, "Only the top of each species should be promoted");
+    TEST_EQUAL(pop->innovation_table->next_species_id, next_species_id, "The ladder should not speciate");
+    
+    neat_free_population(pop);
+}
+
+/* Create an empty scratch directory under $TMPDIR; returns 1 on success */
+static int make_test_dir(char* buffer, size_t size) {
+    const char* tmp = getenv("TMPDIR");
+    snprintf(buffer, size, "%s/neat_test_XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    return mkdtemp(buffer) != NULL;
+}
+
+/* Remove a scratch directory and the files in it */
+static void remove_test_dir(const char* dir) {
+    DIR* d = opendir(dir);
+    if (d) {
+        char path[512];
+        struct dirent* entry;
+        while ((entry = readdir(d)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            remove(path);
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+void test_genome_io() {
+    print_test_header("Testing Binary Genome Format");
+    
+    neat_population_t* pop = neat_create_population(3, 2, 10);
+    for (int round = 0; round < 20; round++) {
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            neat_mutate(pop->genomes[i], pop->innovation_table);
+        }
+    }
+    
+    /* Stream every genome to one file, alternating weight precision */
+    FILE* fp = tmpfile();
+    TEST_TRUE(fp != NULL, "Temporary file should open");
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        neat_weight_format_t format = (i % 2) ? NEAT_WEIGHTS_FLOAT32 : NEAT_WEIGHTS_FLOAT64;
+        TEST_EQUAL(neat_save_genome(fp, pop->genomes[i], format), 1, "Genome should save");
+    }
+    rewind(fp);
+    
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        const neat_genome_t* original = pop->genomes[i];
+        neat_genome_t* loaded = neat_load_genome(fp);
+        TEST_TRUE(loaded != NULL, "Genome should load");
+        if (!loaded) break;
+        
+        TEST_EQUAL(loaded->id, original->id, "Genome ID should round-trip");
+        TEST_EQUAL(loaded->node_count, original->node_count, "Node count should round-trip");
+        TEST_EQUAL(loaded->connection_count, original->connection_count, "Connection count should round-trip");
+        TEST_TRUE(loaded->parent1_id == -1 && loaded->parent2_id == -1, "A loaded genome should have no recorded parents");
+        
+        bool genes_match = true;
+        for (size_t c = 0; c < original->connection_count && c < loaded->connection_count; c++) {
+            const neat_connection_t* a = &original->connections[c];
+            const neat_connection_t* b = &loaded->connections[c];
+            double tolerance = (i % 2) ? 1e-6 * (1.0 + fabs(a->weight)) : 0.0;
+            if (a->innovation != b->innovation || a->in_node != b->in_node ||
+                a->out_node != b->out_node || a->enabled != b->enabled ||
+                fabs(a->weight - b->weight) > tolerance) {
+                genes_match = false;
+            }
+        }
+        TEST_TRUE(genes_match, "Connection genes should round-trip");
+        neat_free_genome(loaded);
+    }
+    TEST_TRUE(neat_load_genome(fp) == NULL, "Reading past the last record should return NULL");
+    
+    /* A flipped payload byte must fail the checksum */
+    rewind(fp);
+    TEST_EQUAL(neat_save_genome(fp, pop->genomes[0], NEAT_WEIGHTS_FLOAT64), 1, "Genome should save");
+    fseek(fp, NEAT_GENOME_HEADER_SIZE + 2, SEEK_SET);
+    int byte = fgetc(fp);
+    fseek(fp, NEAT_GENOME_HEADER_SIZE + 2, SEEK_SET);
+    fputc(byte ^ 0x10, fp);
+    rewind(fp);
+    TEST_TRUE(neat_load_genome(fp) == NULL, "Corrupted records should be rejected");
+    
+    fclose(fp);
+    neat_free_population(pop);
+}
+
+void test_population_checkpoint() {
+    print_test_header("Testing Population Checkpoints");
+    
+    char dir[256], path[320];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    snprintf(path, sizeof(path), "%s/population.ckpt", dir);
+    neat_population_t* pop = neat_create_population(2, 1, 30);
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        neat_mutate(pop->genomes[i], pop->innovation_table);
+        pop->genomes[i]->fitness = (double)i;
+    }
+    
+    TEST_EQUAL(neat_population_save(pop, path), 1, "Population should save");
+    unsigned long rng_state = neat_get_random_state();
+    neat_random_uniform(0, 1);
+    
+    neat_population_t* restored = neat_population_load(path);
+    TEST_TRUE(restored != NULL, "Population should load");
+    if (restored) {
+        TEST_EQUAL(restored->genome_count, pop->genome_count, "Genome count should be restored");
+        TEST_EQUAL(restored->species_count, pop->species_count, "Species should be restored");
+        TEST_EQUAL(restored->innovation_table->count, pop->innovation_table->count, "Innovations should be restored");
+        TEST_EQUAL(neat_get_random_state(), rng_state, "RNG state should be restored");
+        
+        bool genomes_match = true;
+        for (size_t i = 0; i < pop->genome_count; i++) {
+            const neat_genome_t* a = pop->genomes[i];
+            const neat_genome_t* b = restored->genomes[i];
+            if (a->id != b->id || a->fitness != b->fitness || a->connection_count != b->connection_count ||
+                memcmp(a->connections, b->connections, a->connection_count * sizeof(neat_connection_t)) != 0) {
+                genomes_match = false;
+            }
+        }
+        TEST_TRUE(genomes_match, "Genomes should be restored exactly");
+        
+        /* Restored genomes must still be able to grow */
+        neat_genome_t* genome = restored->genomes[0];
+        size_t nodes_before = genome->node_count;
+        neat_add_node(genome, NEAT_NODE_HIDDEN, NEAT_PLACEMENT_HIDDEN);
+        TEST_EQUAL(genome->node_count, nodes_before + 1, "Restored genomes should grow");
+        TEST_TRUE(!genome->mapped, "Growing should move genes off the mapping");
+        
+        neat_free_population(restored);
+    }
+    
+    remove_test_dir(dir);
+    neat_free_population(pop);
+}
+
+void test_delta_checkpoint() {
+    print_test_header("Testing Delta Checkpoints");
+    
+    char dir[256];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 50);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    
+    neat_checkpoint_config_t config = neat_checkpoint_default_config();
+    config.save_frequency = 1;
+    config.checkpoint_dir = dir;
+    config.keep_count = 1;
+    config.keyframe_interval = 4;
+    neat_checkpointer_t* cp = neat_checkpointer_create(&config);
+    TEST_TRUE(cp != NULL, "Checkpointer should start");
+    pop->checkpointer = cp;
+    
+    int generations = 10;
+    for (int g = 0; g < generations; g++) {
+        neat_evolve(pop);
+        neat_checkpointer_flush(cp);
+    }
+    TEST_EQUAL(cp->checkpoint_count, generations, "Every generation should be checkpointed");
+    TEST_TRUE(cp->delta_count > 0, "Generations after a keyframe should be deltas");
+    TEST_TRUE(cp->last_delta, "Newest checkpoint should be a delta");
+    
+    neat_population_t* restored = neat_checkpoint_restore(dir);
+    TEST_TRUE(restored != NULL, "Directory should restore");
+    if (restored) {
+        TEST_EQUAL(restored->generation, pop->generation, "Deltas should be replayed to the newest generation");
+        TEST_EQUAL(restored->genome_count, pop->genome_count, "Genome count should be restored");
+        TEST_EQUAL(restored->species_count, pop->species_count, "Species should be restored");
+        TEST_EQUAL(restored->innovation_table->count, pop->innovation_table->count, "Innovations should be restored");
+        
+        bool genomes_match = true;
+        for (size_t i = 0; i < pop->genome_count && genomes_match; i++) {
+            const neat_genome_t* a = pop->genomes[i];
+            const neat_genome_t* b = restored->genomes[i];
+            genomes_match = a->id == b->id && a->parent1_id == b->parent1_id &&
+                            a->node_count == b->node_count && a->connection_count == b->connection_count;
+            for (size_t c = 0; genomes_match && c < a->connection_count; c++) {
+                genomes_match = a->connections[c].innovation == b->connections[c].innovation &&
+                                a->connections[c].weight == b->connections[c].weight &&
+                                a->connections[c].enabled == b->connections[c].enabled;
+            }
+            for (size_t n = 0; genomes_match && n < a->node_count; n++) {
+                genomes_match = a->nodes[n].id == b->nodes[n].id && a->nodes[n].bias == b->nodes[n].bias;
+            }
+        }
+        TEST_TRUE(genomes_match, "Replayed genomes should match the live population");
+        neat_free_population(restored);
+    }
+    
+    neat_checkpointer_free(cp);
+    pop->checkpointer = NULL;
+    remove_test_dir(dir);
+    
+    /* The default configuration writes deltas between keyframes */
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    config = neat_checkpoint_default_config();
+    config.checkpoint_dir = dir;
+    cp = neat_checkpointer_create(&config);
+    TEST_TRUE(cp != NULL, "Checkpointer should start with the defaults");
+    pop->checkpointer = cp;
+    for (int g = 0; g < 3; g++) {
+        neat_evolve(pop);
+        neat_checkpointer_flush(cp);
+    }
+    TEST_EQUAL(cp->checkpoint_count, 3, "The defaults should checkpoint every generation");
+    TEST_EQUAL(cp->delta_count, 2, "The defaults should write deltas after the first keyframe");
+    neat_checkpointer_free(cp);
+    pop->checkpointer = NULL;
+    remove_test_dir(dir);
+    
+    /* A sparser schedule cannot chain deltas and is written as keyframes */
+    config.save_frequency = 2;
+    cp = neat_checkpointer_create(&config);
+    TEST_EQUAL(cp->config.keyframe_interval, 1, "Deltas should be turned off unless every generation is saved");
+    neat_checkpointer_free(cp);
+    remove_test_dir(dir);
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/* Count the keyframe files in a checkpoint directory */
+static int count_keyframes(const char* dir) {
+    int count = 0;
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len > 5 && strcmp(entry->d_name + len - 5, ".ckpt") == 0) count++;
+    }
+    closedir(d);
+    return count;
+}
+
+void test_checkpointer() {
+    print_test_header("Testing Background Checkpointer");
+    
+    char dir[256];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 50);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    
+    neat_checkpoint_config_t config = neat_checkpoint_default_config();
+    config.save_frequency = 2;
+    config.checkpoint_dir = dir;
+    config.keep_count = 2;
+    config.keyframe_interval = 1;
+    neat_checkpointer_t* cp = neat_checkpointer_create(&config);
+    TEST_TRUE(cp != NULL, "Checkpointer should start");
+    pop->checkpointer = cp;
+    
+    /* The writer runs alongside evolution; generations 2, 4, 6 and 8 are due */
+    for (int g = 0; g < 9; g++) {
+        neat_evolve(pop);
+    }
+    neat_checkpointer_flush(cp);
+    TEST_EQUAL(cp->checkpoint_count + cp->dropped_count, 4, "Every due snapshot should be written or superseded");
+    TEST_EQUAL(cp->failed_count, 0, "No write should fail");
+    TEST_EQUAL(cp->last_generation, 8, "The newest due generation should be on disk after a flush");
+    TEST_TRUE(count_keyframes(dir) <= config.keep_count, "Old checkpoints should be rotated out");
+    
+    char latest[512];
+    TEST_EQUAL(neat_checkpointer_latest_path(cp, latest, sizeof(latest)), 1, "The latest path should be known");
+    FILE* fp = fopen(latest, "rb");
+    TEST_TRUE(fp != NULL, "The latest checkpoint should exist");
+    if (fp) fclose(fp);
+    
+    /* Stopping the writer still writes the snapshot it was handed last */
+    neat_evolve(pop);
+    neat_checkpointer_free(cp);
+    pop->checkpointer = NULL;
+    
+    neat_population_t* restored = neat_checkpoint_restore(dir);
+    TEST_TRUE(restored != NULL, "Directory should restore");
+    if (restored) {
+        TEST_EQUAL(restored->generation, pop->generation, "The snapshot queued at stop should be restored");
+        TEST_EQUAL(restored->genome_count, pop->genome_count, "Genome count should be restored");
+        bool genomes_match = true;
+        for (size_t i = 0; i < pop->genome_count && genomes_match; i++) {
+            const neat_genome_t* a = pop->genomes[i];
+            const neat_genome_t* b = restored->genomes[i];
+            genomes_match = a->id == b->id && a->connection_count == b->connection_count &&
+                            memcmp(a->connections, b->connections, a->connection_count * sizeof(neat_connection_t)) == 0;
+        }
+        TEST_TRUE(genomes_match, "Restored genomes should match the live population");
+        
+        /* A restored run keeps evolving */
+        restored->evaluate_genome = neat_env_dataset_fitness;
+        restored->evaluate_user_data = xor_data;
+        neat_evolve(restored);
+        TEST_EQUAL(restored->generation, pop->generation + 1, "A restored population should evolve");
+        neat_free_population(restored);
+    }
+    
+    remove_test_dir(dir);
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+static size_t count_lines(FILE* fp) {
+    size_t lines = 0;
+    int ch;
+    rewind(fp);
+    while ((ch = fgetc(fp)) != EOF) {
+        if (ch == '\n') lines++;
+    }
+    return lines;
+}
+
+void test_runlog() {
+    print_test_header("Testing Run Log");
+    
+    char dir[256], path[320];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    snprintf(path, sizeof(path), "%s/run.nlog", dir);
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 40);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    pop->runlog = neat_runlog_open(path);
+    TEST_TRUE(pop->runlog != NULL, "Run log should open");
+    
+    int generations = 5;
+    for (int g = 0; g < generations; g++) {
+        neat_evolve(pop);
+    }
+    neat_runlog_close(pop->runlog);
+    pop->runlog = NULL;
+    
+    FILE* summary = tmpfile();
+    FILE* genomes = tmpfile();
+    TEST_EQUAL(neat_runlog_export_csv(path, summary, NULL, genomes), 1, "Run log should export");
+    TEST_EQUAL(count_lines(summary), (size_t)generations + 1, "One summary row per generation");
+    TEST_EQUAL(count_lines(genomes), (size_t)generations * pop->population_size + 1, "One row per evaluated genome");
+    fclose(summary);
+    fclose(genomes);
+    
+    /* A torn final chunk is dropped, the generations before it are kept */
+    FILE* fp = fopen(path, "ab");
+    fputs("NRLCtruncated", fp);
+    fclose(fp);
+    summary = tmpfile();
+    TEST_EQUAL(neat_runlog_export_csv(path, summary, NULL, NULL), 1, "Torn log should still export");
+    TEST_EQUAL(count_lines(summary), (size_t)generations + 1, "Complete generations should survive a torn tail");
+    fclose(summary);
+    
+    /* Resuming cuts the torn tail off, so generations appended afterwards stay readable */
+    pop->runlog = neat_runlog_open(path);
+    TEST_TRUE(pop->runlog != NULL, "A torn run log should reopen");
+    for (int g = 0; g < 2; g++) {
+        neat_evolve(pop);
+    }
+    neat_runlog_close(pop->runlog);
+    pop->runlog = NULL;
+    summary = tmpfile();
+    TEST_EQUAL(neat_runlog_export_csv(path, summary, NULL, NULL), 1, "Resumed log should export");
+    TEST_EQUAL(count_lines(summary), (size_t)generations + 3, "Generations appended after a torn tail should be readable");
+    fclose(summary);
+    
+    TEST_TRUE(neat_runlog_open(dir) == NULL, "A directory should not open as a run log");
+    
+    remove_test_dir(dir);
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/* Driver for a generated header: reads inputs in hex-float form, prints outputs the same way */
+static const char* EXPORT_DRIVER =
+    "#include <stdio.h>\n"
+    "#include \"champion.h\"\n"
+    "int main(void) {\n"
+    "    double in[CHAMPION_INPUTS], out[CHAMPION_OUTPUTS];\n"
+    "    for (;;) {\n"
+    "        for (int i = 0; i < CHAMPION_INPUTS; i++) if (scanf(\"%la\", &in[i]) != 1) return 0;\n"
+    "        champion_forward(in, out);\n"
+    "        for (int o = 0; o < CHAMPION_OUTPUTS; o++) printf(\"%a\\n\", out[o]);\n"
+    "    }\n"
+    "}\n";
+
+void test_export_header() {
+    print_test_header("Testing Header Export");
+    
+    char dir[256], path[320], command[2048];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    snprintf(path, sizeof(path), "%s/champion.h", dir);
+    
+    /* A grown genome that uses every activation type */
+    neat_population_t* pop = neat_create_population(3, 2, 1);
+    neat_genome_t* genome = pop->genomes[0];
+    for (int round = 0; round < 30; round++) {
+        neat_mutate(genome, pop->innovation_table);
+    }
+    cost_test_grow(genome, 10, 40);
+    for (size_t i = 0; i < genome->node_count; i++) {
+        if (genome->nodes[i].type == NEAT_NODE_INPUT || genome->nodes[i].type == NEAT_NODE_BIAS) continue;
+        genome->nodes[i].activation_type = (neat_activation_type_t)(i % (NEAT_ACTIVATION_ABS + 1));
+    }
+    
+    TEST_EQUAL(neat_export_header(genome, "champion", path), 1, "Header should export");
+    TEST_EQUAL(neat_export_header(genome, "2bad-name", path), 0, "Invalid C identifiers should be rejected");
+    
+    FILE* fp = fopen(path, "r");
+    TEST_TRUE(fp != NULL, "Header file should exist");
+    if (fp) {
+        char line[512];
+        bool has_heap = false;
+        while (fgets(line, sizeof(line), fp)) {
+            if (strstr(line, "malloc")) has_heap = true;
+        }
+        fclose(fp);
+        TEST_TRUE(!has_heap, "Forward pass should not allocate");
+    }
+    
+    /* Compile the header with a small driver and feed it random inputs */
+    snprintf(path, sizeof(path), "%s/driver.c", dir);
+    fp = fopen(path, "w");
+    if (fp) {
+        fputs(EXPORT_DRIVER, fp);
+        fclose(fp);
+    }
+    const char* cc = getenv("CC");
+    snprintf(command, sizeof(command), "%s -std=c99 -pedantic -Wall -Werror -o %s/driver %s/driver.c -lm",
+             cc && *cc ? cc : "cc", dir, dir);
+    TEST_EQUAL(system(command), 0, "Exported header should compile cleanly");
+    
+    enum { VECTORS = 100 };
+    double inputs[VECTORS][3];
+    snprintf(path, sizeof(path), "%s/inputs.txt", dir);
+    fp = fopen(path, "w");
+    if (fp) {
+        for (int v = 0; v < VECTORS; v++) {
+            for (int i = 0; i < 3; i++) {
+                inputs[v][i] = neat_random_uniform(-2.0, 2.0);
+                fprintf(fp, "%a\n", inputs[v][i]);
+            }
+        }
+        fclose(fp);
+    }
+    snprintf(command, sizeof(command), "%s/driver < %s/inputs.txt > %s/outputs.txt", dir, dir, dir);
+    TEST_EQUAL(system(command), 0, "Exported network should run");
+    
+    snprintf(path, sizeof(path), "%s/outputs.txt", dir);
+    fp = fopen(path, "r");
+    int matched = 0;
+    if (fp) {
+        char line[128];
+        double expected[2];
+        for (int v = 0; v < VECTORS; v++) {
+            neat_evaluate(genome, inputs[v], expected);
+            bool same = true;
+            for (int o = 0; o < 2; o++) {
+                same = same && fgets(line, sizeof(line), fp) && strtod(line, NULL) == expected[o];
+            }
+            if (same) matched++;
+        }
+        fclose(fp);
+    }
+    TEST_EQUAL(matched, VECTORS, "Exported forward pass should match neat_evaluate bit for bit");
+    
+    remove_test_dir(dir);
+    neat_free_population(pop);
+}
+
+static void count_generation(const neat_population_t* pop, const neat_generation_stats_t* stats, void* user_data) {
+    (void)pop;
+    (void)stats;
+    (*(int*)user_data)++;
+}
+
+void test_generation_stats() {
+    print_test_header("Testing Generation Statistics");
+    
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 50);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    
+    int calls = 0;
+    pop->on_generation = count_generation;
+    pop->on_generation_user_data = &calls;
+    TEST_EQUAL(pop->stats_level, NEAT_STATS_PHASES, "Phase timing should be on by default");
+    
+    neat_evolve(pop);
+    TEST_EQUAL(calls, 1, "Callback should run once per generation");
+    TEST_EQUAL(pop->stats.generation, 0, "Statistics should describe the evolved generation");
+    TEST_TRUE(pop->stats.evaluate_time > 0.0, "Evaluation should be timed");
+    TEST_TRUE(pop->stats.epoch_time >= pop->stats.reproduce_time, "Epoch should contain reproduction");
+    TEST_EQUAL(pop->stats.mutation_count, (size_t)0, "Sub-phase counts need the detailed level");
+    
+    pop->stats_level = NEAT_STATS_DETAILED;
+    neat_evolve(pop);
+    TEST_EQUAL(calls, 2, "Callback should run again");
+    TEST_EQUAL(pop->stats.elite_count + pop->stats.crossover_count + pop->stats.clone_count,
+               pop->genome_count, "Every offspring should be counted once");
+    TEST_EQUAL(pop->stats.mutation_count, pop->stats.crossover_count + pop->stats.clone_count,
+               "Every non-elite offspring should be mutated");
+    TEST_TRUE(pop->stats.innovation_lookups >= pop->stats.innovations_created,
+              "Created innovations should come from lookups");
+    
+    pop->stats_level = NEAT_STATS_OFF;
+    neat_evolve(pop);
+    TEST_EQUAL(calls, 3, "Callback should run with statistics off");
+    TEST_TRUE(pop->stats.evaluate_time == 0.0 && pop->stats.epoch_time == 0.0, "Nothing should be timed when off");
+    TEST_EQUAL(pop->stats.generation, 2, "Generation should still be reported");
+    
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+void test_trace() {
+    print_test_header("Testing Trace Events");
+    
+    char dir[256], path[320];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    snprintf(path, sizeof(path), "%s/trace.json", dir);
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 40);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    
+    TEST_TRUE(!neat_trace_enabled(), "Tracing should be off by default");
+    TEST_EQUAL(neat_trace_start(path, 0), 1, "Trace should start");
+    TEST_EQUAL(neat_trace_start(path, 0), 0, "Only one trace should run at a time");
+    
+    neat_evolve(pop);
+    neat_evolve_parallel(pop, 4);
+    neat_trace_stop();
+    TEST_TRUE(!neat_trace_enabled(), "Tracing should stop");
+    TEST_EQUAL(neat_trace_dropped(), (size_t)0, "No spans should be dropped");
+    
+    /* Spans outside a trace are ignored */
+    neat_evolve(pop);
+    
+    FILE* fp = fopen(path, "r");
+    TEST_TRUE(fp != NULL, "Trace file should exist");
+    if (fp) {
+        char line[512];
+        size_t evaluations = 0, epochs = 0, workers = 0;
+        bool closed = false;
+        while (fgets(line, sizeof(line), fp)) {
+            if (strstr(line, "\"name\":\"evaluate\"")) evaluations++;
+            if (strstr(line, "\"name\":\"epoch\"")) epochs++;
+            if (strstr(line, "evaluate worker")) workers++;
+            if (strcmp(line, "]}\n") == 0) closed = true;
+        }
+        fclose(fp);
+        TEST_EQUAL(evaluations, (size_t)80, "Every evaluation should have a span");
+        TEST_EQUAL(epochs, (size_t)2, "Every generation should have an epoch span");
+        TEST_TRUE(workers >= 1, "Worker threads should be named");
+        TEST_TRUE(closed, "Trace file should be valid JSON");
+    }
+    
+    remove_test_dir(dir);
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+typedef struct {
+    atomic_size_t allocs;
+    atomic_size_t frees;
+} counting_arena_t;
+
+static void* counting_alloc(void* ctx, size_t size) {
+    atomic_fetch_add(&((counting_arena_t*)ctx)->allocs, 1);
+    return malloc(size);
+}
+
+static void counting_free(void* ctx, void* ptr, size_t size) {
+    (void)size;
+    atomic_fetch_add(&((counting_arena_t*)ctx)->frees, 1);
+    free(ptr);
+}
+
+/* XOR fitness that counts evaluations made without the population's allocator current */
+typedef struct {
+    neat_env_dataset_t* data;
+    neat_allocator_t* expected;
+    atomic_size_t foreign;
+} allocator_probe_t;
+
+static double allocator_probe_fitness(neat_genome_t* genome, void* user_data) {
+    allocator_probe_t* probe = (allocator_probe_t*)user_data;
+    if (neat_current_allocator() != probe->expected) {
+        atomic_fetch_add(&probe->foreign, 1);
+    }
+    return neat_env_dataset_fitness(genome, probe->data);
+}
+
+void test_allocator() {
+    print_test_header("Testing Allocator Hooks");
+    
+    counting_arena_t arena;
+    atomic_init(&arena.allocs, 0);
+    atomic_init(&arena.frees, 0);
+    neat_allocator_t allocator;
+    neat_allocator_init(&allocator, counting_alloc, NULL, counting_free, &arena);
+    
+    /* A population created under an allocator keeps using it */
+    neat_allocator_t* previous = neat_use_allocator(&allocator);
+    TEST_TRUE(neat_current_allocator() == &allocator, "Allocator should become current");
+    neat_population_t* pop = neat_create_population(2, 1, 30);
+    neat_use_allocator(previous);
+    TEST_TRUE(pop->allocator == &allocator, "Population should capture the current allocator");
+    
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    for (int i = 0; i < 5; i++) {
+        neat_evolve(pop);
+    }
+    TEST_TRUE(neat_current_allocator() == neat_default_allocator(), "Evolution should restore the caller's allocator");
+    
+    neat_mem_stats_t stats;
+    neat_allocator_stats(&allocator, &stats);
+    TEST_TRUE(stats.live_bytes[NEAT_MEM_GENOMES] > 0, "Genomes should be accounted");
+    TEST_TRUE(stats.live_bytes[NEAT_MEM_SPECIES] > 0, "Species should be accounted");
+    TEST_TRUE(stats.live_bytes[NEAT_MEM_INNOVATION] > 0, "Innovation table should be accounted");
+    TEST_TRUE(stats.peak_bytes[NEAT_MEM_GENOMES] >= stats.live_bytes[NEAT_MEM_GENOMES], "Peak should bound live bytes");
+    TEST_TRUE(atomic_load(&arena.allocs) > 0, "Allocations should reach the hooks");
+    
+    /* Queued parallel workers run under the population's allocator too */
+    allocator_probe_t probe;
+    probe.data = xor_data;
+    probe.expected = &allocator;
+    atomic_init(&probe.foreign, 0);
+    pop->evaluate_genome = allocator_probe_fitness;
+    pop->evaluate_user_data = &probe;
+    neat_evolve_parallel(pop, 4);
+    TEST_EQUAL(atomic_load(&probe.foreign), (size_t)0, "Parallel workers should install the population's allocator");
+    TEST_TRUE(neat_current_allocator() == neat_default_allocator(), "Parallel evolution should restore the caller's allocator");
+    
+    neat_free_population(pop);
+    neat_allocator_stats(&allocator, &stats);
+    TEST_EQUAL(stats.total_live_bytes, (size_t)0, "Freeing the population should release everything");
+    TEST_EQUAL(atomic_load(&arena.allocs), atomic_load(&arena.frees), "Every block should return to its allocator");
+    TEST_TRUE(stats.peak_bytes[NEAT_MEM_GENOMES] > 0, "High-water mark should survive frees");
+    TEST_TRUE(strcmp(neat_mem_tag_name(NEAT_MEM_ARCHIVE), "archive") == 0, "Tags should have names");
+    
+    neat_env_dataset_free(xor_data);
+}
+
+void test_numa_shards() {
+    print_test_header("Testing NUMA-Sharded Evaluation");
+    
+    neat_numa_t* numa = neat_numa_create();
+    TEST_TRUE(numa->node_count >= 1, "Topology should have at least one node");
+    TEST_TRUE(numa->cpu_offsets[numa->node_count] > 0, "Topology should list CPUs");
+    TEST_EQUAL(neat_numa_node_of_cpu(numa, numa->cpus[0]), 0, "First listed CPU should belong to node 0");
+    TEST_EQUAL(neat_numa_node_of_cpu(numa, -1), -1, "Unknown CPUs should have no node");
+    
+    /* Pretend to have three nodes sharing the real CPUs so stealing is exercised on any machine */
+    size_t cpu_count = numa->cpu_offsets[numa->node_count];
+    numa->node_count = 3;
+    for (int n = 0; n <= 3; n++) {
+        numa->cpu_offsets[n] = cpu_count;
+    }
+    numa->cpu_offsets[0] = 0;
+    
+    neat_population_t* pop = neat_create_population(2, 1, 60);
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_genome_t* first = pop->genomes[0];
+    neat_connection_t* first_genes = first->connections;
+    double expected = neat_env_dataset_fitness(first, xor_data);
+    
+    pop->numa = numa;
+    neat_evaluate_parallel(pop, neat_env_dataset_fitness, xor_data, 4);
+    
+    size_t evaluated = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->evaluated) evaluated++;
+    }
+    TEST_EQUAL(evaluated, pop->genome_count, "Every genome should be evaluated once");
+    TEST_EQUAL(numa->local_jobs + numa->stolen_jobs, pop->genome_count, "Jobs should be local or stolen");
+    TEST_EQUAL(numa->relocated, numa->local_jobs, "Local genomes should be moved into their node's arena");
+    TEST_EQUAL(numa->resident, (size_t)0, "Nothing should start in a node arena");
+    TEST_TRUE(numa->bound_nodes >= 0 && numa->bound_nodes <= numa->node_count, "Bound arenas should be counted per node");
+    TEST_TRUE(pop->genomes[0] == first, "Relocation should keep genome pointers");
+    TEST_TRUE(numa->relocated == 0 || first->connections != first_genes || numa->stolen_jobs > 0,
+              "Relocated genes should move");
+    TEST_TRUE(fabs(first->fitness - expected) < 1e-12, "Relocated genomes should evaluate identically");
+    
+    /* Evaluating the same genomes again finds the local ones already in place */
+    size_t stolen_before = numa->stolen_jobs;
+    first_genes = first->connections;
+    int* first_order = first->evaluation_order;
+    neat_evaluate_parallel(pop, neat_env_dataset_fitness, xor_data, 4);
+    TEST_EQUAL(numa->relocated + numa->resident, numa->local_jobs, "Every local genome should be moved or already placed");
+    TEST_TRUE(numa->relocated <= stolen_before, "Only genomes stolen last time should still need moving");
+    TEST_TRUE(first->connections == first_genes && first->evaluation_order == first_order,
+              "A genome already in its node's arena should not be copied");
+    TEST_TRUE(fabs(first->fitness - expected) < 1e-12, "Placed genomes should evaluate identically");
+    
+    /* Without placement nothing moves, and evolution runs on top of sharding */
+    numa->place_genes = false;
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    for (int g = 0; g < 3; g++) {
+        neat_evolve_parallel(pop, 4);
+    }
+    TEST_EQUAL(numa->relocated + numa->resident, (size_t)0, "Nothing should be placed without place_genes");
+    TEST_EQUAL(numa->local_jobs + numa->stolen_jobs, pop->genome_count, "Sharded evolution should evaluate everything");
+    
+    /* Offspring are placed in the generation they are first evaluated */
+    numa->place_genes = true;
+    for (int g = 0; g < 2; g++) {
+        neat_evolve_parallel(pop, 4);
+        TEST_EQUAL(numa->relocated, numa->local_jobs, "Fresh offspring should be moved into their node's arena");
+    }
+    
+    /* Arenas outlive the topology while genes still live in them */
+    neat_evaluate_parallel(pop, neat_env_dataset_fitness, xor_data, 4);
+    pop->numa = NULL;
+    neat_numa_free(numa);
+    neat_evolve(pop);
+    TEST_EQUAL(pop->generation, 6, "Genes placed in a freed topology's arenas should stay usable");
+    
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/* Send one scrape request to a metrics server and return the whole response */
+static size_t metrics_scrape(const struct sockaddr* addr, socklen_t addr_size, int family,
+                             const char* path, char* response, size_t size) {
+    int fd = socket(family, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+    if (connect(fd, addr, addr_size) != 0) {
+        close(fd);
+        return 0;
+    }
+    char request[128];
+    int request_size = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    send(fd, request, (size_t)request_size, 0);
+    size_t received = 0;
+    ssize_t got;
+    while (received < size - 1 && (got = recv(fd, response + received, size - 1 - received, 0)) > 0) {
+        received += (size_t)got;
+    }
+    response[received] = '\0';
+    close(fd);
+    return received;
+}
+
+void test_metrics() {
+    print_test_header("Testing Metrics Server");
+    
+    neat_metrics_t* metrics = neat_metrics_start("127.0.0.1:0");
+    TEST_TRUE(metrics != NULL, "Metrics server should start on an ephemeral port");
+    TEST_TRUE(neat_metrics_port(metrics) > 0, "Server should report its port");
+    
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 30);
+    pop->evaluate_genome = neat_env_dataset_fitness;
+    pop->evaluate_user_data = xor_data;
+    pop->allocator = neat_default_allocator();
+    pop->metrics = metrics;
+    
+    char* text = neat_metrics_render(metrics, NULL);
+    TEST_TRUE(strstr(text, "neat_generation 0\n") != NULL, "Nothing should be published before the first generation");
+    neat_free(text);
+    
+    int generations = 3;
+    for (int g = 0; g < generations; g++) {
+        neat_evolve(pop);
+    }
+    neat_metrics_set_archive_size(metrics, 17);
+    neat_evolve_parallel(pop, 2);
+    generations++;
+    
+    neat_metrics_snapshot_t snapshot;
+    neat_metrics_read(metrics, &snapshot);
+    TEST_EQUAL(snapshot.generation, generations, "Snapshot should describe the last generation");
+    TEST_EQUAL(snapshot.evaluations_total, (uint64_t)generations * 30, "Every evaluation should be counted");
+    TEST_EQUAL(snapshot.archive_size, (size_t)17, "Archive size should be published");
+    TEST_EQUAL(snapshot.phases[NEAT_METRICS_EPOCH].count, (uint64_t)generations, "One epoch observation per generation");
+    TEST_TRUE(snapshot.best_fitness >= snapshot.mean_fitness, "Best fitness should not be below the mean");
+    
+    /* Over TCP */
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)neat_metrics_port(metrics));
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    static char response[65536];
+    metrics_scrape((struct sockaddr*)&addr, sizeof(addr), AF_INET, "/metrics", response, sizeof(response));
+    TEST_TRUE(strncmp(response, "HTTP/1.1 200 OK", 15) == 0, "Scrape should succeed");
+    TEST_TRUE(strstr(response, "text/plain; version=0.0.4") != NULL, "Response should be Prometheus text");
+    TEST_TRUE(strstr(response, "\nneat_generation 4\n") != NULL, "Generation should be reported");
+    TEST_TRUE(strstr(response, "\nneat_evaluations_total 120\n") != NULL, "Evaluations should be reported");
+    TEST_TRUE(strstr(response, "\nneat_eval_queue_depth 0\n") != NULL, "Queue should be drained between generations");
+    TEST_TRUE(strstr(response, "neat_memory_live_bytes{subsystem=\"genomes\"}") != NULL, "Memory should be reported by subsystem");
+    TEST_TRUE(strstr(response, "neat_phase_seconds_bucket{phase=\"epoch\",le=\"+Inf\"} 4\n") != NULL,
+              "Phase histograms should count every generation");
+    metrics_scrape((struct sockaddr*)&addr, sizeof(addr), AF_INET, "/other", response, sizeof(response));
+    TEST_TRUE(strncmp(response, "HTTP/1.1 404", 12) == 0, "Unknown paths should be rejected");
+    
+    pop->metrics = NULL;
+    neat_metrics_stop(metrics);
+    
+    /* Over a Unix socket */
+    char dir[256], socket_path[300], address[320];
+    TEST_TRUE(make_test_dir(dir, sizeof(dir)), "Scratch directory should be created");
+    snprintf(socket_path, sizeof(socket_path), "%s/metrics.sock", dir);
+    snprintf(address, sizeof(address), "unix:%s", socket_path);
+    metrics = neat_metrics_start(address);
+    TEST_TRUE(metrics != NULL, "Metrics server should start on a Unix socket");
+    struct sockaddr_un unix_addr;
+    memset(&unix_addr, 0, sizeof(unix_addr));
+    unix_addr.sun_family = AF_UNIX;
+    strcpy(unix_addr.sun_path, socket_path);
+    metrics_scrape((struct sockaddr*)&unix_addr, sizeof(unix_addr), AF_UNIX, "/metrics", response, sizeof(response));
+    TEST_TRUE(strstr(response, "\nneat_metrics_scrapes_total 1\n") != NULL, "Unix socket scrape should succeed");
+    neat_metrics_stop(metrics);
+    TEST_TRUE(access(socket_path, F_OK) != 0, "Socket file should be removed on stop");
+    
+    /* A stale socket is replaced, but an ordinary file at the path is not deleted */
+    int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_TRUE(stale >= 0 && bind(stale, (struct sockaddr*)&unix_addr, sizeof(unix_addr)) == 0,
+              "A stale socket should be left behind");
+    close(stale);
+    metrics = neat_metrics_start(address);
+    TEST_TRUE(metrics != NULL, "A stale socket should be replaced");
+    neat_metrics_stop(metrics);
+    FILE* precious = fopen(socket_path, "w");
+    TEST_TRUE(precious != NULL, "A regular file should be created at the socket path");
+    if (precious) fclose(precious);
+    TEST_TRUE(neat_metrics_start(address) == NULL, "A regular file at the socket path should be refused");
+    TEST_TRUE(access(socket_path, F_OK) == 0, "A regular file at the socket path should not be deleted");
+    remove(socket_path);
+    remove_test_dir(dir);
+    
+    TEST_TRUE(neat_metrics_start("127.0.0.1:notaport") == NULL, "Bad addresses should be rejected");
+    
+    /* Only loopback hosts without the explicit opt-in */
+    TEST_TRUE(neat_metrics_start("0.0.0.0:0") == NULL, "Wildcard hosts should be refused");
+    TEST_TRUE(neat_metrics_start("192.0.2.1:0") == NULL, "Non-loopback hosts should be refused");
+    metrics = neat_metrics_start("127.0.0.2:0");
+    TEST_TRUE(metrics != NULL, "Any 127/8 address should be accepted");
+    neat_metrics_stop(metrics);
+    metrics = neat_metrics_start("public:0.0.0.0:0");
+    TEST_TRUE(metrics != NULL, "The public prefix should opt in to other interfaces");
+    neat_metrics_stop(metrics);
+    
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/* XOR fitness, with a few genomes made artificially slow */
+static double slow_genome_fitness(neat_genome_t* genome, void* user_data) {
+    if (genome->id % 25 == 3) {
+        double start = neat_get_time();
+        while (neat_get_time() - start < 0.002) {
+        }
+    }
+    return neat_env_dataset_fitness(genome, user_data);
+}
+
+void test_eval_profile() {
+    print_test_header("Testing Evaluation Cost Profile");
+    
+    TEST_EQUAL(neat_eval_histogram_bucket(0.0), (size_t)0, "Untimed evaluations should land in the first bucket");
+    TEST_EQUAL(neat_eval_histogram_bucket(1.5e-6), (size_t)1, "1.5 us should land in [1, 2) us");
+    TEST_EQUAL(neat_eval_histogram_bucket(3e-3), (size_t)12, "3 ms should land in [2048, 4096) us");
+    TEST_TRUE(neat_eval_histogram_upper_bound(12) > 3e-3, "Bucket bounds should match bucket selection");
+    TEST_TRUE(neat_eval_profile_create(0.0) == NULL, "A zero percentile should be rejected");
+    
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 50);
+    pop->evaluate_genome = slow_genome_fitness;
+    pop->evaluate_user_data = xor_data;
+    neat_eval_profile_t* profile = neat_eval_profile_create(0.9);
+    pop->eval_profile = profile;
+    
+    int generations = 3;
+    for (int g = 0; g < generations; g++) {
+        neat_evolve(pop);
+    }
+    
+    TEST_EQUAL(profile->generation, generations - 1, "Profile should describe the last evaluated generation");
+    TEST_EQUAL(profile->histogram.count, (size_t)50, "Every genome should be in the generation histogram");
+    TEST_EQUAL(profile->run_histogram.count, (size_t)generations * 50, "Run histogram should accumulate");
+    size_t species_total = 0;
+    for (size_t s = 0; s < profile->species_count; s++) {
+        species_total += profile->species[s].histogram.count;
+    }
+    TEST_EQUAL(species_total, (size_t)50, "Species histograms should cover the generation");
+    TEST_TRUE(profile->outlier_count >= 2 && profile->outlier_count <= 5, "About 10% of genomes should be flagged");
+    TEST_TRUE(profile->outlier_count >= 2 && profile->outliers[0].genome_id % 25 == 3 &&
+              profile->outliers[1].genome_id % 25 == 3, "The slow genomes should be the top outliers");
+    TEST_TRUE(profile->outliers[0].eval_time >= 0.002 && profile->outliers[0].eval_time >= profile->outliers[1].eval_time,
+              "Outliers should be ordered slowest first");
+    TEST_TRUE(profile->outliers[0].connection_count > 0 && profile->outliers[0].disabled_ratio >= 0.0 &&
+              profile->outliers[0].disabled_ratio <= 1.0, "Outliers should carry size features");
+    TEST_TRUE(neat_eval_histogram_percentile(&profile->histogram, 1.0) == profile->histogram.max_time,
+              "The 100th percentile should be the maximum");
+    
+    FILE* report = tmpfile();
+    neat_eval_profile_print(profile, report);
+    TEST_TRUE(count_lines(report) > 5, "Profile should print a report");
+    fclose(report);
+    
+    pop->eval_profile = NULL;
+    neat_eval_profile_free(profile);
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/*
+ * XOR fitness under a 200 ms deadline. Every tenth genome runs until
+ * cancelled (up to 2 s), and ids ending in 5 overrun without polling:
+ * 400 ms at full budget, 40 ms on a 0.1 budget retry. Every case is at
+ * least 2x away from the deadline so a loaded machine does not flip it.
+ */
+#define RUNAWAY_DEADLINE 0.2
+#define RUNAWAY_CAP      2.0
+
+static double runaway_fitness(neat_genome_t* genome, void* user_data) {
+    double start = neat_get_time();
+    if (genome->id % 10 == 0) {
+        while (!neat_eval_cancelled() && neat_get_time() - start < RUNAWAY_CAP) {
+        }
+        return 1000.0;
+    }
+    if (genome->id % 10 == 5) {
+        while (neat_get_time() - start < 2.0 * RUNAWAY_DEADLINE * neat_eval_budget()) {
+        }
+    }
+    return neat_env_dataset_fitness(genome, user_data);
+}
+
+/* Pole fitness that overruns the deadline at full budget but fits a 0.1 budget retry */
+static double overdue_pole_fitness(neat_genome_t* genome, void* user_data) {
+    double start = neat_get_time();
+    while (neat_get_time() - start < 2.0 * RUNAWAY_DEADLINE * neat_eval_budget()) {
+    }
+    return neat_env_pole_fitness(genome, user_data);
+}
+
+void test_eval_timeout() {
+    print_test_header("Testing Evaluation Timeouts");
+    
+    TEST_TRUE(neat_eval_token() == NULL && !neat_eval_cancelled() && neat_eval_budget() == 1.0,
+              "Outside an evaluation there should be no token");
+    
+    neat_env_dataset_t* xor_data = neat_env_xor_create();
+    neat_population_t* pop = neat_create_population(2, 1, 40);
+    TEST_TRUE(pop->eval_timeout.timeout == 0.0, "Timeouts should be off by default");
+    pop->eval_timeout.timeout = RUNAWAY_DEADLINE;
+    pop->eval_timeout.penalty_fitness = -1.0;
+    
+    size_t runaways = 0, overruns = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->id % 10 == 0) runaways++;
+        if (pop->genomes[i]->id % 10 == 5) overruns++;
+    }
+    
+    /* Penalty: cooperative runaways are cancelled, non-polling overruns still penalized */
+    double start = neat_get_time();
+    neat_evaluate_parallel(pop, runaway_fitness, xor_data, 2);
+    double elapsed = neat_get_time() - start;
+    bool penalized = true;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        int id = pop->genomes[i]->id;
+        bool slow = id % 10 == 0 || id % 10 == 5;
+        if (slow != (pop->genomes[i]->fitness == -1.0)) penalized = false;
+    }
+    TEST_TRUE(penalized, "Exactly the overdue evaluations should get the penalty fitness");
+    TEST_EQUAL(pop->eval_timeout.timed_out, runaways + overruns, "Every overrun should be counted");
+    TEST_EQUAL(pop->eval_timeout.penalized, runaways + overruns, "Every overrun should be penalized");
+    TEST_TRUE(elapsed < runaways * RUNAWAY_CAP / 2.0, "Cancellation should bound the evaluation time");
+    
+    /* Retry: overruns fit in the smaller budget, runaways never do */
+    pop->eval_timeout.policy = NEAT_TIMEOUT_RETRY;
+    pop->eval_timeout.max_retries = 2;
+    pop->eval_timeout.retry_budget = 0.1;
+    neat_evaluate_parallel(pop, runaway_fitness, xor_data, 2);
+    size_t recovered = 0;
+    for (size_t i = 0; i < pop->genome_count; i++) {
+        if (pop->genomes[i]->id % 10 == 5 && pop->genomes[i]->fitness >= 0.0) recovered++;
+    }
+    TEST_EQUAL(recovered, overruns, "Overruns should succeed on a smaller budget");
+    TEST_EQUAL(pop->eval_timeout.retried, overruns + 2 * runaways, "Runaways should use every retry");
+    TEST_EQUAL(pop->eval_timeout.penalized, runaways, "Only runaways should end up penalized");
+    
+    /* neat_evolve goes through the watchdog too */
+    pop->evaluate_genome = runaway_fitness;
+    pop->evaluate_user_data = xor_data;
+    neat_evolve(pop);
+    TEST_TRUE(pop->max_fitness_achieved < 1000.0, "Cancelled results should never count as fitness");
+    
+    /* A retried pole episode scores only the steps it ran, never more than the full run */
+    neat_population_t* pole_pop = neat_create_population(4, 1, 4);
+    neat_pole_task_t task = neat_pole_task_default(1, true);
+    task.max_steps = 1000;
+    pole_pop->eval_timeout = pop->eval_timeout;
+    neat_evaluate_parallel(pole_pop, overdue_pole_fitness, &task, 2);
+    bool bounded = true;
+    for (size_t i = 0; i < pole_pop->genome_count; i++) {
+        double full = neat_env_pole_fitness(pole_pop->genomes[i], &task);
+        if (pole_pop->genomes[i]->fitness > full || pole_pop->genomes[i]->fitness > 0.1 * task.max_steps) {
+            bounded = false;
+        }
+    }
+    TEST_TRUE(bounded, "Retried pole fitness should not exceed the steps it actually balanced");
+    neat_free_population(pole_pop);
+    
+    neat_free_population(pop);
+    neat_env_dataset_free(xor_data);
+}
+
+/* The visualizer tests need SDL headers; the rest of the suite does not */
+#if defined(__has_include)
+#if __has_include(<SDL2/SDL.h>)
+#define NEAT_TEST_SDL 1
+#endif
+#endif
+
+#ifdef NEAT_TEST_SDL
+#include <SDL2/SDL_ttf.h>
+#include "../include/visualization.h"
+
+/* RGBA of a framebuffer pixel packed as 0xRRGGBBAA */
+static uint32_t framebuffer_pixel(neat_visualizer_t* vis, int x, int y) {
+    int pitch;
+    const Uint8* p = neat_visualizer_framebuffer(vis, &pitch) + y * pitch + x * 4;
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+void test_visualization() {
+    print_test_header("Testing Headless Visualization");
+    
+    neat_visualizer_t* vis = neat_visualizer_create_with_backend("test", 320, 240, NEAT_VIS_HEADLESS);
+    TEST_TRUE(vis != NULL && vis->backend == NEAT_VIS_HEADLESS, "Headless visualizer should open without a display");
+    if (!vis) return;
+    
+    /* Rectangles cover [x, x + w) by [y, y + h) */
+    neat_visualizer_clear(vis, neat_rgba(0, 0, 0, 255));
+    neat_draw_rect(vis, 10, 10, 20, 10, neat_rgba(255, 0, 0, 255));
+    TEST_TRUE(framebuffer_pixel(vis, 0, 0) == 0x000000FFu, "Clear should fill the framebuffer");
+    TEST_TRUE(framebuffer_pixel(vis, 10, 10) == 0xFF0000FFu && framebuffer_pixel(vis, 29, 19) == 0xFF0000FFu,
+              "Rectangle should cover its corners");
+    TEST_TRUE(framebuffer_pixel(vis, 9, 15) == 0x000000FFu && framebuffer_pixel(vis, 30, 15) == 0x000000FFu &&
+              framebuffer_pixel(vis, 15, 20) == 0x000000FFu, "Rectangle should end at x + w and y + h");
+    
+    /* Genome: inputs in the left column, outputs in the right, drawn over their connections */
+    neat_population_t* pop = neat_create_population(2, 1, 6);
+    neat_genome_t* genome = pop->genomes[0];
+    size_t inputs = 0, outputs = 0;
+    for (size_t i = 0; i < genome->node_count; i++) {
+        if (genome->nodes[i].placement == NEAT_PLACEMENT_INPUT) inputs++;
+        if (genome->nodes[i].placement == NEAT_PLACEMENT_OUTPUT) outputs++;
+    }
+    neat_visualize_genome(vis, genome, 0, 0, 320, 240);
+    int first_input_y = 50 + (int)(140 / (inputs + 1));
+    int first_output_y = 50 + (int)(140 / (outputs + 1));
+    uint32_t input_color = genome->nodes[0].type == NEAT_NODE_BIAS ? 0xFFFF00FFu : 0x0000FFFFu;
+    TEST_TRUE(framebuffer_pixel(vis, 40, first_input_y) == input_color, "First input node should be drawn in its column");
+    TEST_TRUE(framebuffer_pixel(vis, 260, first_output_y) == 0xFF0000FFu, "Output node should be drawn in its column");
+    TEST_TRUE(framebuffer_pixel(vis, 160, 30) == 0xFFFFFFFFu, "Genome background should be white");
+    
+    /* Population and species panels draw from the population's own fields */
+    neat_visualize_population(vis, pop);
+    TEST_TRUE(framebuffer_pixel(vis, 5, 45) == 0xFFFFFFFFu, "Population view should clear to white");
+    TEST_TRUE(vis->batch.index_count == 0, "Reading the framebuffer should flush the batch");
+    
+    /* Animation frames larger than the visualizer keep the uncovered part transparent */
+    neat_animation_t* anim = neat_animation_create(2, 330, 240);
+    neat_animation_add_frame(anim, vis);
+    TEST_EQUAL(anim->frame_count, 1, "Animation should record a frame");
+    const Uint8* frame = (const Uint8*)anim->frames[0];
+    TEST_TRUE(frame[(45 * 330 + 5) * 4] == 255 && frame[(45 * 330 + 5) * 4 + 3] == 255,
+              "Recorded frame should hold the rendered pixels");
+    TEST_TRUE(frame[(45 * 330 + 325) * 4 + 3] == 0, "Pixels outside the visualizer should stay transparent");
+    
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "/tmp/neat_test_anim_%d", (int)getpid());
+    char saved[96];
+    snprintf(saved, sizeof(saved), "%s_frame_0000.bmp", prefix);
+    TEST_TRUE(neat_animation_save(anim, prefix) == 1 && access(saved, F_OK) == 0, "Animation should save its first frame");
+    unlink(saved);
+    neat_animation_destroy(anim);
+    
+    neat_free_population(pop);
+    neat_visualizer_destroy(vis);
+}
+/* Distance from a pixel center to the segment between two pixel centers */
+static double segment_distance(int px, int py, int x1, int y1, int x2, int y2) {
+    double dx = x2 - x1, dy = y2 - y1;
+    double t = ((px - x1) * dx + (py - y1) * dy) / (dx * dx + dy * dy);
+    t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+    double ex = px - (x1 + t * dx), ey = py - (y1 + t * dy);
+    return sqrt(ex * ex + ey * ey);
+}
+
+void test_visualization_batch() {
+    print_test_header("Testing Batched Shape Coverage");
+    
+    neat_visualizer_t* vis = neat_visualizer_create_with_backend("test", 320, 240, NEAT_VIS_HEADLESS);
+    TEST_TRUE(vis != NULL, "Headless visualizer should open");
+    if (!vis) return;
+    
+    /* One frame of circles and lines, queued together and drawn by one flush */
+    static const int radii[4] = {3, 10, 30, 40};
+    static const int centers[4][2] = {{20, 20}, {60, 40}, {60, 160}, {160, 170}};
+    neat_visualizer_clear(vis, neat_rgba(0, 0, 0, 255));
+    for (int i = 0; i < 4; i++) {
+        neat_draw_circle(vis, centers[i][0], centers[i][1], radii[i], neat_rgba(255, 0, 0, 255));
+    }
+    neat_draw_line(vis, 110, 10, 150, 10, neat_rgba(0, 255, 0, 255), 1);
+    neat_draw_line(vis, 110, 30, 110, 90, neat_rgba(0, 255, 0, 255), 3);
+    neat_draw_line(vis, 220, 20, 300, 100, neat_rgba(0, 255, 0, 255), 3);
+    TEST_TRUE(vis->batch.index_count > 0 && framebuffer_pixel(vis, 60, 40) == 0xFF0000FFu,
+              "Queued shapes should reach the framebuffer when it is read");
+    TEST_TRUE(vis->batch.index_count == 0, "The whole frame should be drawn by one flush");
+    
+    /* Circles cover exactly the pixel centers within the radius */
+    for (int i = 0; i < 4; i++) {
+        int r = radii[i];
+        int wrong = 0, covered = 0;
+        for (int dy = -r - 2; dy <= r + 2; dy++) {
+            for (int dx = -r - 2; dx <= r + 2; dx++) {
+                bool inside = dx * dx + dy * dy <= r * r;
+                bool red = framebuffer_pixel(vis, centers[i][0] + dx, centers[i][1] + dy) == 0xFF0000FFu;
+                if (red != inside) wrong++;
+                if (red) covered++;
+            }
+        }
+        char message[96];
+        snprintf(message, sizeof(message), "Circle of radius %d should match the per-pixel fill", r);
+        TEST_TRUE(wrong == 0 && fabs(covered - 3.14159265 * r * r) < 2.0 * 3.14159265 * r, message);
+    }
+    
+    /* Axis-aligned lines cover exactly width pixels across, endpoints included */
+    bool exact = true;
+    for (int x = 105; x <= 155; x++) {
+        for (int y = 8; y <= 12; y++) {
+            bool on = y == 10 && x >= 110 && x <= 150;
+            if ((framebuffer_pixel(vis, x, y) == 0x00FF00FFu) != on) exact = false;
+        }
+    }
+    for (int x = 105; x <= 115; x++) {
+        for (int y = 25; y <= 95; y++) {
+            bool on = x >= 109 && x <= 111 && y >= 30 && y <= 90;
+            if ((framebuffer_pixel(vis, x, y) == 0x00FF00FFu) != on) exact = false;
+        }
+    }
+    TEST_TRUE(exact, "Axis-aligned lines should cover exactly their pixels");
+    
+    /* A diagonal line covers the pixels near the segment, its corners snapped by at most half a pixel */
+    int missing = 0, spilled = 0, covered = 0;
+    for (int x = 215; x <= 305; x++) {
+        for (int y = 15; y <= 105; y++) {
+            double d = segment_distance(x, y, 220, 20, 300, 100);
+            bool on = framebuffer_pixel(vis, x, y) == 0x00FF00FFu;
+            if (d < 0.75 && !on) missing++;
+            if (d > 2.25 && on) spilled++;
+            if (on) covered++;
+        }
+    }
+    double area = 3.0 * (sqrt(80.0 * 80.0 * 2.0) + 1.0);
+    TEST_TRUE(missing == 0 && spilled == 0 && fabs(covered - area) < 0.1 * area,
+              "Diagonal line should cover its width around the segment");
+    
+    neat_visualizer_destroy(vis);
+}
+void test_visualization_text() {
+    print_test_header("Testing Batched Text Coverage");
+    
+    neat_visualizer_t* vis = neat_visualizer_create_with_backend("test", 160, 80, NEAT_VIS_HEADLESS);
+    TEST_TRUE(vis != NULL, "Headless visualizer should open");
+    if (!vis) return;
+    
+    /* NEAT_TEST_FONT picks the font; without one the visualizer's default search is compared */
+    const char* font_path = getenv("NEAT_TEST_FONT");
+    if (!font_path) font_path = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+    TTF_Font* font = TTF_OpenFont(font_path, 16);
+    if (!font) {
+        printf("No font at %s (set NEAT_TEST_FONT), skipped\n", font_path);
+        neat_visualizer_destroy(vis);
+        return;
+    }
+    vis->font_path = font_path;
+    
+    /* Text and shapes share one batch */
+    const char* text = "Hi, NEAT!";
+    neat_visualizer_clear(vis, neat_rgba(0, 0, 0, 255));
+    neat_draw_text(vis, text, 10, 20, neat_rgba(255, 255, 255, 255), 16);
+    neat_draw_rect(vis, 120, 60, 10, 10, neat_rgba(0, 0, 255, 255));
+    TEST_TRUE(vis->atlas_count == 1 && vis->atlases[0].texture != NULL, "Glyph atlas should be built on first use");
+    int quads = 1;
+    for (const char* c = text; *c; c++) {
+        if (vis->atlases[0].glyphs[*c - NEAT_VIS_GLYPH_FIRST].rect.w > 0) quads++;
+    }
+    TEST_TRUE(vis->batch.index_count == 6 * quads, "Glyph and shape quads should queue together");
+    int pitch;
+    const Uint8* pixels = neat_visualizer_framebuffer(vis, &pitch);
+    TEST_TRUE(framebuffer_pixel(vis, 125, 65) == 0x0000FFFFu, "Shape after text should be drawn in the same flush");
+    
+    /* The expected frame composites each glyph SDL_ttf renders at its pen position */
+    static Uint8 expected[80][160];
+    memset(expected, 0, sizeof(expected));
+    SDL_Color white = {255, 255, 255, 255};
+    int pen_x = 10;
+    for (const char* c = text; *c; c++) {
+        int min_x = 0, advance = 0;
+        TTF_GlyphMetrics(font, (Uint16)*c, &min_x, NULL, NULL, NULL, &advance);
+        SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, (Uint16)*c, white);
+        SDL_Surface* glyph = rendered ? SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_RGBA32, 0) : NULL;
+        int left = pen_x + (min_x < 0 ? min_x : 0);
+        for (int gy = 0; glyph && gy < glyph->h && 20 + gy < 80; gy++) {
+            for (int gx = 0; gx < glyph->w && left + gx < 160; gx++) {
+                int alpha = ((const Uint8*)glyph->pixels)[gy * glyph->pitch + gx * 4 + 3];
+                Uint8* e = &expected[20 + gy][left + gx];
+                *e = (Uint8)(*e + alpha * (255 - *e) / 255);
+            }
+        }
+        if (glyph) SDL_FreeSurface(glyph);
+        if (rendered) SDL_FreeSurface(rendered);
+        pen_x += advance;
+    }
+    int worst = 0;
+    long expected_ink = 0, drawn_ink = 0;
+    for (int y = 0; y < 80; y++) {
+        for (int x = 0; x < 110; x++) {
+            int drawn = pixels[y * pitch + x * 4];
+            if (abs(drawn - expected[y][x]) > worst) worst = abs(drawn - expected[y][x]);
+            expected_ink += expected[y][x];
+            drawn_ink += drawn;
+        }
+    }
+    int line_height = TTF_FontHeight(font);
+    TTF_CloseFont(font);
+    TEST_TRUE(expected_ink > 0 && labs(drawn_ink - expected_ink) * 100 <= expected_ink, "Text should carry the ink of its glyphs");
+    TEST_TRUE(worst <= 2, "Each text pixel should match the composited glyph coverage");
+    
+    /* Nothing is drawn outside the text line */
+    bool clean = true;
+    for (int x = 0; x < 160; x++) {
+        if (pixels[19 * pitch + x * 4] != 0 || pixels[(20 + line_height) * pitch + x * 4] != 0) clean = false;
+    }
+    TEST_TRUE(clean, "Pixels above and below the text line should stay clear");
+    
+    neat_visualizer_destroy(vis);
+}
+#else
+void test_visualization() {
+    print_test_header("Testing Headless Visualization");
+    printf("SDL headers not available, skipped\n");
+}
+
+void test_visualization_batch() {
+    print_test_header("Testing Batched Shape Coverage");
+    printf("SDL headers not available, skipped\n");
+}
+
+void test_visualization_text() {
+    print_test_header("Testing Batched Text Coverage");
+    printf("SDL headers not available, skipped\n");
+}
+#endif
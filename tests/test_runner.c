@@ -14,6 +14,27 @@ void test_crossover();
 void test_speciation();
 void test_xor_problem();
 void test_performance();
+void test_benchmark_envs();
+void test_ask_tell();
+void test_cost_model();
+void test_surrogate();
+void test_fidelity_ladder();
+void test_genome_io();
+void test_population_checkpoint();
+void test_delta_checkpoint();
+void test_checkpointer();
+void test_runlog();
+void test_export_header();
+void test_generation_stats();
+void test_trace();
+void test_allocator();
+void test_numa_shards();
+void test_metrics();
+void test_eval_profile();
+void test_eval_timeout();
+void test_visualization();
+void test_visualization_batch();
+void test_visualization_text();
 
 /* Test statistics */
 typedef struct {
@@ -78,6 +99,27 @@ int main() {
     test_speciation();
     test_xor_problem();
     test_performance();
+    test_benchmark_envs();
+    test_ask_tell();
+    test_cost_model();
+    test_surrogate();
+    test_fidelity_ladder();
+    test_genome_io();
+    test_population_checkpoint();
+    test_delta_checkpoint();
+    test_checkpointer();
+    test_runlog();
+    test_export_header();
+    test_generation_stats();
+    test_trace();
+    test_allocator();
+    test_numa_shards();
+    test_metrics();
+    test_eval_profile();
+    test_eval_timeout();
+    test_visualization();
+    test_visualization_batch();
+    test_visualization_text();
     
     double end_time = get_time();
     